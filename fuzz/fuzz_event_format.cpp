@@ -0,0 +1,80 @@
+/*
+ * Copyright 2019 Valve Software
+ *
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+#include <algorithm>
+
+extern "C"
+{
+    #include "trace-cmd/event-parse.h"
+}
+
+/*
+  Event format parser fuzz target. Input is a tracefs event format file, then a
+  NUL, then raw record data. If the format parses, the record is printed with
+  its print fmt, which runs the parsed print args over the data.
+ */
+
+// Records from the loader are at most a page, so pad data out to that
+static const size_t s_record_size = 4096;
+
+extern "C" int LLVMFuzzerTestOneInput( const uint8_t *data, size_t size )
+{
+    const uint8_t *nul = ( const uint8_t * )memchr( data, 0, size );
+    size_t format_size = nul ? ( size_t )( nul - data ) : size;
+    struct pevent *pevent = pevent_alloc();
+    struct event_format *event = NULL;
+
+    if ( !pevent )
+        return 0;
+
+    pevent_set_long_size( pevent, 8 );
+
+    if ( !pevent_parse_format( pevent, &event, ( const char * )data, format_size, "fuzz" ) && event )
+    {
+        std::vector< uint8_t > buf( s_record_size );
+        struct pevent_record record;
+        struct trace_seq seq;
+
+        if ( nul )
+            memcpy( buf.data(), nul + 1, std::min< size_t >( size - format_size - 1, buf.size() ) );
+
+        memset( &record, 0, sizeof( record ) );
+        record.data = buf.data();
+        record.size = buf.size();
+
+        trace_seq_init( &seq );
+        pevent_event_info( &seq, event, &record );
+        trace_seq_destroy( &seq );
+    }
+
+    // Parsed event is owned by pevent
+    pevent_free( pevent );
+    return 0;
+}
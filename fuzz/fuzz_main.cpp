@@ -0,0 +1,109 @@
+/*
+ * Copyright 2019 Valve Software
+ *
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+
+/*
+  Replay driver for compilers without libFuzzer (gcc). Runs every file given on
+  the command line, or in directories given on the command line, through the
+  fuzz target once. Built with -fsanitize=address,undefined this turns the seed
+  corpora into regression tests:
+
+    _fuzz/fuzz_trace_read fuzz/corpus/trace_read
+
+  With clang, libFuzzer provides main() and this file isn't linked.
+ */
+
+extern "C" int LLVMFuzzerInitialize( int *argc, char ***argv );
+extern "C" int LLVMFuzzerTestOneInput( const uint8_t *data, size_t size );
+
+static bool run_file( const std::string &filename )
+{
+    FILE *fp = fopen( filename.c_str(), "rb" );
+
+    if ( !fp )
+    {
+        fprintf( stderr, "%s: %s\n", filename.c_str(), strerror( errno ) );
+        return false;
+    }
+
+    std::vector< uint8_t > data;
+    uint8_t buf[ 64 * 1024 ];
+    size_t len;
+
+    while ( ( len = fread( buf, 1, sizeof( buf ), fp ) ) > 0 )
+        data.insert( data.end(), buf, buf + len );
+    fclose( fp );
+
+    printf( "Running %s (%lu bytes)\n", filename.c_str(), data.size() );
+    LLVMFuzzerTestOneInput( data.data(), data.size() );
+    return true;
+}
+
+int main( int argc, char **argv )
+{
+    uint32_t count = 0;
+
+    LLVMFuzzerInitialize( &argc, &argv );
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        struct stat st;
+
+        if ( stat( argv[ i ], &st ) < 0 )
+        {
+            fprintf( stderr, "%s: %s\n", argv[ i ], strerror( errno ) );
+            return 1;
+        }
+
+        if ( !S_ISDIR( st.st_mode ) )
+        {
+            count += run_file( argv[ i ] );
+            continue;
+        }
+
+        DIR *dir = opendir( argv[ i ] );
+        struct dirent *entry;
+
+        while ( dir && ( entry = readdir( dir ) ) )
+        {
+            if ( entry->d_name[ 0 ] != '.' )
+                count += run_file( std::string( argv[ i ] ) + "/" + entry->d_name );
+        }
+        if ( dir )
+            closedir( dir );
+    }
+
+    printf( "Ran %u inputs\n", count );
+    return 0;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2019 Valve Software
+ *
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+
+#include <SDL.h>
+
+#include "imgui/imgui.h"
+#include "gpuvis_macros.h"
+#include "stlini.h"
+#include "gpuvis_utils.h"
+
+/*
+  Plot scanf string fuzz target. The first line of input is the scanf string,
+  and the rest is the print buffer it's matched against. Ie:
+
+    [Compositor] TimeSyncLastVsync: %f(
+    [Compositor] TimeSyncLastVsync: 10.342(1234)
+ */
+
+extern "C" int LLVMFuzzerTestOneInput( const uint8_t *data, size_t size )
+{
+    std::string input( ( const char * )data, size );
+    size_t eol = input.find( '\n' );
+    std::string scanf_str = input.substr( 0, eol );
+    std::string buf = ( eol == std::string::npos ) ? "" : input.substr( eol + 1 );
+    ParsePlotStr parse_plot_str;
+
+    // parse() should fail gracefully even if init() didn't find a %f
+    parse_plot_str.init( scanf_str.c_str() );
+    parse_plot_str.parse( buf.c_str() );
+    return 0;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2019 Valve Software
+ *
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+
+#include <SDL.h>
+
+#include "imgui/imgui.h"
+#include "gpuvis_macros.h"
+#include "stlini.h"
+#include "gpuvis_utils.h"
+
+// gpuvis_utils.cpp references the app singletons, which live in gpuvis.cpp.
+//  Fuzz targets don't link the app, so give them default instances here.
+
+CIniFile &s_ini()
+{
+    static CIniFile s_inifile;
+    return s_inifile;
+}
+
+Clrs &s_clrs()
+{
+    static Clrs s_clrs;
+    return s_clrs;
+}
+
+TextClrs &s_textclrs()
+{
+    static TextClrs s_textclrs;
+    return s_textclrs;
+}
+
+Actions &s_actions()
+{
+    static Actions s_actions;
+    return s_actions;
+}
+
+// Called once by libFuzzer (and fuzz_main.cpp) before any inputs are run
+extern "C" int LLVMFuzzerInitialize( int *argc, char ***argv )
+{
+    logf_init();
+    return 0;
+}
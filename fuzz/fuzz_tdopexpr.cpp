@@ -0,0 +1,90 @@
+/*
+ * Copyright 2019 Valve Software
+ *
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+#include <SDL.h>
+
+#include "imgui/imgui.h"
+#include "gpuvis_macros.h"
+#include "stlini.h"
+#include "tdopexpr.h"
+#include "gpuvis_utils.h"
+
+/*
+  Filter expression fuzz target. The first line of input is the expression, and
+  following lines are "key=value" pairs it's evaluated against. Ie:
+
+    $name == "sched_switch" && $pid > 100
+    name=sched_switch
+    pid=1234
+ */
+
+extern "C" int LLVMFuzzerTestOneInput( const uint8_t *data, size_t size )
+{
+    std::string input( ( const char * )data, size );
+    std::vector< std::string > lines = string_explode( input, '\n' );
+    std::unordered_map< std::string, std::string > vals;
+    StrPool strpool;
+    std::string errstr;
+
+    if ( lines.empty() )
+        return 0;
+
+    for ( size_t i = 1; i < lines.size(); i++ )
+    {
+        size_t eq = lines[ i ].find( '=' );
+
+        if ( eq != std::string::npos )
+            vals[ lines[ i ].substr( 0, eq ) ] = lines[ i ].substr( eq + 1 );
+    }
+
+    tdop_get_key_func get_key_func = [&strpool]( const char *name, size_t len )
+    {
+        return strpool.getstr( name, len );
+    };
+    tdop_get_keyval_func get_keyval_func = [&vals]( const char *name, char ( &buf )[ 64 ] )
+    {
+        auto it = vals.find( name );
+
+        return ( it != vals.end() ) ? it->second.c_str() : "";
+    };
+
+    class TdopExpr *tdop_expr = tdopexpr_compile( lines[ 0 ].c_str(), get_key_func, errstr );
+
+    if ( tdop_expr )
+    {
+        tdopexpr_exec( tdop_expr, get_keyval_func );
+        tdopexpr_delete( tdop_expr );
+    }
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2019 Valve Software
+ *
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+
+#include <SDL.h>
+
+#include "imgui/imgui.h"
+#include "gpuvis_macros.h"
+#include "stlini.h"
+#include "trace-cmd/trace-read.h"
+#include "gpuvis_utils.h"
+
+/*
+  read_trace_file() fuzz target. Input is written to a temp file and loaded like
+  a trace from the command line, so this covers trace.dat headers, event formats,
+  cpu page reads and kbuffer parsing, as well as the perf.data and text loaders.
+ */
+
+extern "C" int LLVMFuzzerTestOneInput( const uint8_t *data, size_t size )
+{
+    const char *tmpdir = getenv( "TMPDIR" );
+    std::string filename = string_format( "%s/gpuvis_fuzz.XXXXXX", tmpdir ? tmpdir : "/tmp" );
+    int fd = mkstemp( &filename[ 0 ] );
+
+    if ( fd < 0 )
+        return 0;
+
+    bool written = ( write( fd, data, size ) == ( ssize_t )size );
+
+    close( fd );
+
+    if ( written )
+    {
+        StrPool strpool;
+        trace_info_t trace_info;
+        EventCallback cb = []( const trace_event_t &event )
+        {
+            // Callback owns the fields array
+            delete [] event.fields;
+            return 0;
+        };
+
+        read_trace_file( filename.c_str(), strpool, trace_info, cb );
+
+        // Don't let log lines pile up over millions of runs
+        logf_clear();
+    }
+
+    unlink( filename.c_str() );
+    return 0;
+}
@@ -778,6 +778,7 @@ usage( void )
     printf( "  -fullscreen             run in fullscreen mode\n" );
     printf( "  -info                   display OpenGL renderer info\n" );
     printf( "  -geometry WxH+X+Y       window geometry\n" );
+    printf( "  -buffered               buffer trace markers per thread\n" );
 }
 
 int main( int argc, char *argv[] )
@@ -810,6 +811,10 @@ int main( int argc, char *argv[] )
         {
             printInfo = GL_TRUE;
         }
+        else if ( strcmp( argv[ i ], "-buffered" ) == 0 )
+        {
+            gpuvis_trace_set_buffered( 1 );
+        }
         else if ( strcmp( argv[ i ], "-stereo" ) == 0 )
         {
             stereo = GL_TRUE;
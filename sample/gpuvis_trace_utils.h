@@ -1,5 +1,5 @@
 //////////////////////////////////////////////////////////////////////////////
-// gpuvis_trace_utils.h - v0.10 - public domain
+// gpuvis_trace_utils.h - v0.11 - public domain
 //   no warranty is offered or implied; use this code at your own risk
 //
 // This is a single header file with useful utilities for gpuvis linux tracing
@@ -66,6 +66,18 @@ GPUVIS_EXTERN int gpuvis_trace_init( void );
 // Close tracefs trace_marker file.
 GPUVIS_EXTERN void gpuvis_trace_shutdown( void );
 
+// Buffered mode: markers are formatted into a per-thread buffer with the time
+// they were recorded and written to trace_marker in batches: up to TRACE_BUF_SIZE
+// bytes of newline separated markers per write(). Each marker gets an "offset="
+// so gpuvis places it at its original timestamp. Buffers are flushed when full,
+// when GPUVIS_TRACE_FLUSH_NS has passed since the oldest buffered marker, on
+// gpuvis_trace_flush(), and when the thread exits.
+// Batching saves syscalls, but the kernel still copies and timestamps every
+// write, and a marker isn't visible in the trace until its buffer is flushed.
+GPUVIS_EXTERN void gpuvis_trace_set_buffered( int enable );
+// Write the calling thread's buffered markers.
+GPUVIS_EXTERN void gpuvis_trace_flush( void );
+
 // Write user event to tracefs trace_marker.
 GPUVIS_EXTERN int gpuvis_trace_printf( const char *fmt, ... ) GPUVIS_ATTR_PRINTF( 1, 2 );
 GPUVIS_EXTERN int gpuvis_trace_vprintf( const char *fmt, va_list ap ) GPUVIS_ATTR_PRINTF( 1, 0 );
@@ -101,7 +113,7 @@ GPUVIS_EXTERN const char *gpuvis_get_tracefs_filename( char *buf, size_t buflen,
 // Internal function used by GPUVIS_COUNT_HOT_FUNC_CALLS macro
 GPUVIS_EXTERN void gpuvis_count_hot_func_calls_internal_( const char *func );
 
-inline uint64_t gpuvis_gettime_u64( void )
+static inline uint64_t gpuvis_gettime_u64( void )
 {
     struct timespec ts;
 
@@ -180,6 +192,9 @@ public:
 static inline int gpuvis_trace_init() { return -1; }
 static inline void gpuvis_trace_shutdown() {}
 
+static inline void gpuvis_trace_set_buffered( int enable ) {}
+static inline void gpuvis_trace_flush() {}
+
 static inline int gpuvis_trace_printf( const char *fmt, ... ) { return 0; }
 static inline int gpuvis_trace_vprintf( const char *fmt, va_list ap ) { return 0; }
 
@@ -219,6 +234,7 @@ static inline const char *gpuvis_get_tracefs_filename( char *buf, size_t buflen,
 
 #define _GNU_SOURCE 1
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
@@ -227,6 +243,7 @@ static inline const char *gpuvis_get_tracefs_filename( char *buf, size_t buflen,
 #include <sys/vfs.h>
 #include <linux/magic.h>
 #include <sys/syscall.h>
+#include <pthread.h>
 
 #undef GPUVIS_EXTERN
 #ifdef __cplusplus
@@ -242,10 +259,33 @@ static inline const char *gpuvis_get_tracefs_filename( char *buf, size_t buflen,
 #define GPUVIS_STR( x ) #x
 #define GPUVIS_STR_VALUE( x ) GPUVIS_STR( x )
 
+// Size of per-thread buffers for buffered markers
+#ifndef GPUVIS_TRACE_BUFFER_SIZE
+#define GPUVIS_TRACE_BUFFER_SIZE ( 64 * 1024 )
+#endif
+
+// Flush buffered markers once the oldest is this old (ns)
+#ifndef GPUVIS_TRACE_FLUSH_NS
+#define GPUVIS_TRACE_FLUSH_NS ( 10 * 1000000 )
+#endif
+
 static int g_trace_fd = -2;
 static int g_tracefs_dir_inited = 0;
 static char g_tracefs_dir[ PATH_MAX ];
 
+// Buffered markers: [ uint64_t ts ][ uint32_t len ][ char text[ len ] ], 8 byte aligned
+struct gpuvis_trace_buffer
+{
+    uint64_t t0;
+    size_t used;
+    char data[ GPUVIS_TRACE_BUFFER_SIZE ];
+};
+
+static volatile int g_trace_buffered = 0;
+static pthread_once_t g_trace_buffer_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_trace_buffer_key;
+static __thread struct gpuvis_trace_buffer *g_trace_buffer = NULL;
+
 #ifdef __cplusplus
 #include <unordered_map>
 
@@ -383,6 +423,7 @@ GPUVIS_EXTERN void gpuvis_count_hot_func_calls_internal_( const char *func )
 GPUVIS_EXTERN void gpuvis_trace_shutdown()
 {
     flush_hot_func_calls();
+    gpuvis_trace_flush();
 
     if ( g_trace_fd >= 0 )
         close( g_trace_fd );
@@ -392,42 +433,188 @@ GPUVIS_EXTERN void gpuvis_trace_shutdown()
     g_tracefs_dir[ 0 ] = 0;
 }
 
-static int trace_printf_impl( const char *keystr, const char *fmt, va_list ap ) GPUVIS_ATTR_PRINTF( 2, 0 );
-static int trace_printf_impl( const char *keystr, const char *fmt, va_list ap )
+// Format marker into buf. Returns length or -1 if there's nothing to write.
+static int trace_format( char *buf, size_t size, const char *keystr, const char *fmt, va_list ap ) GPUVIS_ATTR_PRINTF( 4, 0 );
+static int trace_format( char *buf, size_t size, const char *keystr, const char *fmt, va_list ap )
 {
-    int ret = -1;
+    int n = vsnprintf( buf, size, fmt, ap );
 
-    if ( gpuvis_trace_init() >= 0 )
+    if ( ( n > 0 ) || ( !n && keystr ) )
+    {
+        if ( ( size_t )n >= size )
+            n = size - 1;
+
+        if ( keystr && keystr[ 0 ] )
+        {
+            int keystrlen = strlen( keystr );
+
+            if ( ( size_t )n + keystrlen >= size )
+                n = size - keystrlen - 1;
+
+            strcpy( buf + n, keystr );
+
+            n += keystrlen;
+        }
+
+        return n;
+    }
+
+    return -1;
+}
+
+static void trace_buffer_write( const char *buf, size_t len )
+{
+    if ( g_trace_fd >= 0 )
     {
-        int n;
+        ssize_t ret = write( g_trace_fd, buf, len );
+        ( void )ret;
+    }
+}
+
+// Write buffered markers. As many markers as fit in TRACE_BUF_SIZE go out in
+// each trace_marker write, one per line, and gpuvis splits them back up into
+// separate print events.
+static void trace_buffer_flush( struct gpuvis_trace_buffer *tbuf )
+{
+    size_t offset = 0;
+    size_t batch_len = 0;
+    char batch[ TRACE_BUF_SIZE ];
+
+    while ( offset < tbuf->used )
+    {
+        int i, n;
+        uint64_t ts;
+        uint32_t len, textlen;
         char buf[ TRACE_BUF_SIZE ];
+        const char *text = tbuf->data + offset + sizeof( ts ) + sizeof( len );
+
+        memcpy( &ts, tbuf->data + offset, sizeof( ts ) );
+        memcpy( &len, tbuf->data + offset + sizeof( ts ), sizeof( len ) );
 
-        n = vsnprintf( buf, sizeof( buf ), fmt, ap );
+        // Leave room for the offset tag
+        textlen = ( len < sizeof( buf ) - 40 ) ? len : ( sizeof( buf ) - 40 );
+        while ( textlen && ( text[ textlen - 1 ] == '\n' || text[ textlen - 1 ] == ' ' ) )
+            textlen--;
 
-        if ( ( n > 0 ) || ( !n && keystr ) )
+        // Marker is written now, so tell gpuvis how long ago it happened
+        n = snprintf( buf, sizeof( buf ), "%.*s (offset=-%lu)\n", ( int )textlen, text,
+                      ( unsigned long )( gpuvis_gettime_u64() - ts ) );
+
+        // Keep each marker on its own line
+        for ( i = 0; i < n - 1; i++ )
         {
-            if ( ( size_t )n >= sizeof( buf ) )
-                n = sizeof( buf ) - 1;
+            if ( buf[ i ] == '\n' )
+                buf[ i ] = ' ';
+        }
 
-            if ( keystr && keystr[ 0 ] )
-            {
-                int keystrlen = strlen( keystr );
+        if ( batch_len + n > sizeof( batch ) )
+        {
+            trace_buffer_write( batch, batch_len );
+            batch_len = 0;
+        }
 
-                if ( ( size_t )n + keystrlen >= sizeof( buf ) )
-                    n = sizeof( buf ) - keystrlen - 1;
+        memcpy( batch + batch_len, buf, n );
+        batch_len += n;
 
-                strcpy( buf + n, keystr );
+        offset += ( sizeof( ts ) + sizeof( len ) + len + 7 ) & ~( size_t )7;
+    }
 
-                n += keystrlen;
-            }
+    if ( batch_len )
+        trace_buffer_write( batch, batch_len );
 
-            ret = write( g_trace_fd, buf, n );
+    tbuf->used = 0;
+}
+
+// Thread exit: flush and free this thread's buffer
+static void trace_buffer_destructor( void *data )
+{
+    struct gpuvis_trace_buffer *tbuf = ( struct gpuvis_trace_buffer * )data;
+
+    trace_buffer_flush( tbuf );
+    free( tbuf );
+}
+
+static void trace_buffer_key_init( void )
+{
+    pthread_key_create( &g_trace_buffer_key, trace_buffer_destructor );
+}
+
+static struct gpuvis_trace_buffer *trace_buffer_get( void )
+{
+    if ( !g_trace_buffer )
+    {
+        pthread_once( &g_trace_buffer_once, trace_buffer_key_init );
+
+        g_trace_buffer = ( struct gpuvis_trace_buffer * )malloc( sizeof( *g_trace_buffer ) );
+        if ( g_trace_buffer )
+        {
+            g_trace_buffer->t0 = 0;
+            g_trace_buffer->used = 0;
+            pthread_setspecific( g_trace_buffer_key, g_trace_buffer );
         }
     }
 
+    return g_trace_buffer;
+}
+
+static int trace_buffer_add( const char *buf, int n )
+{
+    uint32_t len = n;
+    uint64_t ts = gpuvis_gettime_u64();
+    size_t size = ( sizeof( ts ) + sizeof( len ) + len + 7 ) & ~( size_t )7;
+    struct gpuvis_trace_buffer *tbuf = trace_buffer_get();
+
+    if ( !tbuf )
+        return write( g_trace_fd, buf, n );
+
+    if ( tbuf->used + size > sizeof( tbuf->data ) )
+        trace_buffer_flush( tbuf );
+
+    if ( !tbuf->used )
+        tbuf->t0 = ts;
+
+    memcpy( tbuf->data + tbuf->used, &ts, sizeof( ts ) );
+    memcpy( tbuf->data + tbuf->used + sizeof( ts ), &len, sizeof( len ) );
+    memcpy( tbuf->data + tbuf->used + sizeof( ts ) + sizeof( len ), buf, len );
+    tbuf->used += size;
+
+    if ( ts - tbuf->t0 >= GPUVIS_TRACE_FLUSH_NS )
+        trace_buffer_flush( tbuf );
+
+    return n;
+}
+
+static int trace_printf_impl( const char *keystr, const char *fmt, va_list ap ) GPUVIS_ATTR_PRINTF( 2, 0 );
+static int trace_printf_impl( const char *keystr, const char *fmt, va_list ap )
+{
+    int ret = -1;
+
+    if ( gpuvis_trace_init() >= 0 )
+    {
+        char buf[ TRACE_BUF_SIZE ];
+        int n = trace_format( buf, sizeof( buf ), keystr, fmt, ap );
+
+        if ( n >= 0 )
+            ret = g_trace_buffered ? trace_buffer_add( buf, n ) : write( g_trace_fd, buf, n );
+    }
+
     return ret;
 }
 
+GPUVIS_EXTERN void gpuvis_trace_set_buffered( int enable )
+{
+    if ( !enable )
+        gpuvis_trace_flush();
+
+    g_trace_buffered = enable;
+}
+
+GPUVIS_EXTERN void gpuvis_trace_flush()
+{
+    if ( g_trace_buffer )
+        trace_buffer_flush( g_trace_buffer );
+}
+
 GPUVIS_EXTERN int gpuvis_trace_printf( const char *fmt, ... )
 {
     int ret;
@@ -554,6 +741,7 @@ GPUVIS_EXTERN int gpuvis_trigger_capture_and_keep_tracing( char *filename, size_
         filename[ 0 ] = 0;
 
     flush_hot_func_calls();
+    gpuvis_trace_flush();
 
     if ( gpuvis_tracing_on() )
     {
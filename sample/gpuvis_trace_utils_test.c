@@ -0,0 +1,233 @@
+//////////////////////////////////////////////////////////////////////////////
+// gpuvis_trace_utils_test.c - public domain
+//   no warranty is offered or implied; use this code at your own risk
+//
+// Tests for gpuvis_trace_utils.h buffered markers. Markers are written to a
+// temp file (or socket) instead of tracefs trace_marker, so no root is needed.
+//
+//   gpuvis_trace_utils_test          run tests
+//   gpuvis_trace_utils_test -bench   time unbuffered vs buffered markers
+//
+
+// Keep the timed flush out of the way of the offset tests
+#define GPUVIS_TRACE_FLUSH_NS ( 1000 * 1000000ULL )
+
+#define GPUVIS_TRACE_IMPLEMENTATION
+#include "gpuvis_trace_utils.h"
+
+#include <sys/socket.h>
+
+static int g_failed = 0;
+
+#define CHECK( _x ) do { if ( !( _x ) ) { \
+    printf( "%s:%d: CHECK( %s ) failed\n", __FILE__, __LINE__, #_x ); g_failed++; } } while ( 0 )
+
+static void sleep_ms( unsigned int ms )
+{
+    struct timespec ts = { 0, ms * 1000000L };
+
+    nanosleep( &ts, NULL );
+}
+
+static int open_tmpfile( void )
+{
+    char filename[ PATH_MAX ];
+    const char *tmpdir = getenv( "TMPDIR" );
+    int fd;
+
+    snprintf( filename, sizeof( filename ), "%s/gpuvis_trace_XXXXXX", tmpdir ? tmpdir : "/tmp" );
+
+    fd = mkstemp( filename );
+    if ( fd >= 0 )
+        unlink( filename );
+    return fd;
+}
+
+static void reset_file( int fd )
+{
+    ssize_t ret = ftruncate( fd, 0 );
+
+    ( void )ret;
+    lseek( fd, 0, SEEK_SET );
+}
+
+static size_t read_file( int fd, char *buf, size_t size )
+{
+    ssize_t n = pread( fd, buf, size - 1, 0 );
+
+    n = ( n < 0 ) ? 0 : n;
+    buf[ n ] = 0;
+    return n;
+}
+
+// Get offset from "text (offset=-N)" line. Returns -1 if it's not there.
+static long line_offset( const char *line, const char *text )
+{
+    unsigned long offset;
+    size_t len = strlen( text );
+
+    if ( strncmp( line, text, len ) || sscanf( line + len, " (offset=-%lu)", &offset ) != 1 )
+        return -1;
+    return offset;
+}
+
+// Unbuffered markers are written as is, one write per marker
+static void test_unbuffered( int fd )
+{
+    char buf[ 256 ];
+
+    reset_file( fd );
+    g_trace_fd = fd;
+    gpuvis_trace_set_buffered( 0 );
+
+    gpuvis_trace_printf( "marker %d", 1 );
+    gpuvis_trace_begin_ctx_printf( 7, "frame" );
+
+    read_file( fd, buf, sizeof( buf ) );
+    CHECK( !strcmp( buf, "marker 1frame (begin_ctx=7)" ) );
+}
+
+// Buffered markers are held until flushed, then written one per line with
+// how long ago each was recorded
+static void test_buffered_offsets( int fd )
+{
+    char buf[ 1024 ];
+    char *lines[ 4 ] = { NULL };
+    char *line, *saveptr = NULL;
+    long offset0, offset1, offset2;
+    int count = 0;
+
+    reset_file( fd );
+    g_trace_fd = fd;
+    gpuvis_trace_set_buffered( 1 );
+
+    gpuvis_trace_begin_ctx_printf( 1, "frame" );
+    sleep_ms( 4 );
+    gpuvis_trace_printf( "middle\n" );
+    sleep_ms( 4 );
+    gpuvis_trace_end_ctx_printf( 1, "frame" );
+
+    CHECK( read_file( fd, buf, sizeof( buf ) ) == 0 );
+
+    gpuvis_trace_flush();
+    gpuvis_trace_set_buffered( 0 );
+
+    read_file( fd, buf, sizeof( buf ) );
+    for ( line = strtok_r( buf, "\n", &saveptr ); line; line = strtok_r( NULL, "\n", &saveptr ) )
+    {
+        if ( count < 4 )
+            lines[ count ] = line;
+        count++;
+    }
+    CHECK( count == 3 );
+    if ( count != 3 )
+        return;
+
+    offset0 = line_offset( lines[ 0 ], "frame (begin_ctx=1)" );
+    offset1 = line_offset( lines[ 1 ], "middle" );
+    offset2 = line_offset( lines[ 2 ], "frame (end_ctx=1)" );
+
+    CHECK( offset0 >= 8 * 1000000L );
+    CHECK( offset1 >= 4 * 1000000L );
+    CHECK( offset2 >= 0 );
+    CHECK( offset0 - offset1 >= 4 * 1000000L );
+    CHECK( offset1 - offset2 >= 4 * 1000000L );
+}
+
+// A flush packs markers into as few TRACE_BUF_SIZE writes as it can. Uses a
+// SOCK_SEQPACKET socket so each write() can be read back separately.
+static void test_buffered_batches( void )
+{
+    int i, sv[ 2 ];
+    int writes = 0;
+    int lines = 0;
+    size_t total = 0;
+    char buf[ TRACE_BUF_SIZE * 2 ];
+
+    if ( socketpair( AF_UNIX, SOCK_SEQPACKET, 0, sv ) < 0 )
+    {
+        CHECK( !"socketpair failed" );
+        return;
+    }
+
+    g_trace_fd = sv[ 0 ];
+    gpuvis_trace_set_buffered( 1 );
+
+    for ( i = 0; i < 100; i++ )
+        gpuvis_trace_printf( "batched marker number %d", i );
+
+    gpuvis_trace_set_buffered( 0 );
+
+    for ( ;; )
+    {
+        ssize_t n = recv( sv[ 1 ], buf, sizeof( buf ), MSG_DONTWAIT );
+
+        if ( n <= 0 )
+            break;
+
+        CHECK( n <= TRACE_BUF_SIZE );
+        CHECK( buf[ n - 1 ] == '\n' );
+
+        for ( i = 0; i < n; i++ )
+            lines += ( buf[ i ] == '\n' );
+
+        total += n;
+        writes++;
+    }
+
+    CHECK( lines == 100 );
+    CHECK( writes > 1 );
+    CHECK( ( size_t )writes <= total / ( TRACE_BUF_SIZE / 2 ) + 1 );
+
+    close( sv[ 0 ] );
+    close( sv[ 1 ] );
+}
+
+// Nanoseconds per marker written to a regular file
+static double bench_markers( int fd, int buffered, int count )
+{
+    int i;
+    uint64_t t0;
+
+    reset_file( fd );
+    g_trace_fd = fd;
+    gpuvis_trace_set_buffered( buffered );
+
+    t0 = gpuvis_gettime_u64();
+    for ( i = 0; i < count; i++ )
+        gpuvis_trace_printf( "bench marker %d", i );
+    gpuvis_trace_set_buffered( 0 );
+
+    return ( double )( gpuvis_gettime_u64() - t0 ) / count;
+}
+
+int main( int argc, char **argv )
+{
+    int fd = open_tmpfile();
+
+    if ( fd < 0 )
+    {
+        printf( "Error: mkstemp failed: %s\n", strerror( errno ) );
+        return 1;
+    }
+
+    if ( ( argc > 1 ) && !strcmp( argv[ 1 ], "-bench" ) )
+    {
+        int count = 200000;
+
+        printf( "unbuffered: %.1f ns/marker\n", bench_markers( fd, 0, count ) );
+        printf( "buffered:   %.1f ns/marker\n", bench_markers( fd, 1, count ) );
+    }
+    else
+    {
+        test_unbuffered( fd );
+        test_buffered_offsets( fd );
+        test_buffered_batches();
+
+        printf( "%s\n", g_failed ? "FAILED" : "All tests passed" );
+    }
+
+    close( fd );
+    g_trace_fd = -2;
+    return g_failed ? 1 : 0;
+}
@@ -7,6 +7,7 @@
 // compile and run any of them on any platform, but your performance with the
 // non-native version will be less than optimal.
 
+#include <stddef.h>
 #include <string.h>
 #include <string>
 #include "MurmurHash3.h"
@@ -59,12 +60,17 @@ inline uint64_t rotl64 ( uint64_t x, int8_t r )
 
 FORCE_INLINE uint32_t getblock32 ( const uint32_t * p, int i )
 {
-  return p[i];
+  // Keys (ie strpool strings) aren't necessarily aligned
+  uint32_t val;
+  memcpy(&val, (const uint8_t *)p + (ptrdiff_t)i * (ptrdiff_t)sizeof(val), sizeof(val));
+  return val;
 }
 
 FORCE_INLINE uint64_t getblock64 ( const uint64_t * p, int i )
 {
-  return p[i];
+  uint64_t val;
+  memcpy(&val, (const uint8_t *)p + (ptrdiff_t)i * (ptrdiff_t)sizeof(val), sizeof(val));
+  return val;
 }
 
 //-----------------------------------------------------------------------------
@@ -279,6 +279,8 @@ void Opts::init()
     init_opt_bool( OPT_ShowEventList, "Toggle showing event list", "show_event_list", true );
     init_opt_bool( OPT_SyncEventListToGraph, "Sync event list to graph mouse location", "sync_eventlist_to_graph", true );
     init_opt_bool( OPT_HideSchedSwitchEvents, "Hide sched_switch events", "hide_sched_switch_events", true );
+    init_opt_bool( OPT_SuggestFrameMarkers, "Offer inferred frame markers after load", "suggest_frame_markers", true );
+    init_opt_bool( OPT_SyncTraceTabs, "Sync graph position and markers when switching traces", "sync_trace_tabs", true );
     init_opt_bool( OPT_ShowFps, "Show frame rate", "show_fps", false );
     init_opt_bool( OPT_VerticalSync, "Vertical sync", "vertical_sync", true );
 
@@ -290,6 +292,9 @@ void Opts::init()
     init_opt( OPT_Scale, "Font Scale: %.1f", "scale", 2.0f, 0.25f, 6.0f, OPT_Float | OPT_Hidden );
     init_opt( OPT_Gamma, "Font Gamma: %.1f", "gamma", 1.4f, 1.0f, 4.0f, OPT_Float | OPT_Hidden );
     init_opt_bool( OPT_TrimTrace, "Trim Trace to align CPU buffers", "trim_trace_to_cpu_buffers", true, OPT_Hidden );
+    init_opt_bool( OPT_ClockSync, "Align buffer clocks with clock sync markers", "clock_sync_markers", true, OPT_Hidden );
+    init_opt_bool( OPT_RecoverBadPages, "Skip corrupted trace pages", "recover_bad_pages", true, OPT_Hidden );
+    init_opt( OPT_EventMemoryBudget, "Event Memory Budget: %.0fMB", "event_memory_budget_mb", 0, 0, 1024 * 1024, OPT_Int | OPT_Hidden );
     init_opt_bool( OPT_UseFreetype, "Use Freetype", "use_freetype", true, OPT_Hidden );
 
     for ( uint32_t i = OPT_RenderCrtc0; i <= OPT_RenderCrtc9; i++ )
@@ -300,6 +305,11 @@ void Opts::init()
         init_opt_bool( i, desc.c_str(), inikey.c_str(), true );
     }
     init_opt_bool( OPT_RenderFrameMarkers, "Show render frame markers", "render_framemarkers", true );
+    init_opt_bool( OPT_RenderCriticalPath, "Show frame critical paths", "render_critical_path", true );
+    init_opt_bool( OPT_RenderScrollbarDensity, "Show trace overview in scrollbar", "render_scrollbar_density", true );
+    init_opt_bool( OPT_RenderThreadStates, "Show thread state bands in comm rows", "render_thread_states", true );
+    init_opt_bool( OPT_RenderCpuIrqs, "Show irq / softirq bands in cpu graph", "render_cpu_irqs", true );
+    init_opt_bool( OPT_RenderCpuPower, "Show cpu idle / frequency bands in cpu graph", "render_cpu_power", true );
 
     // Set up action mappings so we can display hotkeys in render_imgui_opt().
     m_options[ OPT_RenderCrtc0 ].action = action_toggle_vblank0;
@@ -496,33 +506,54 @@ void Opts::render_imgui_options()
 /*
  * MainApp
  */
-MainApp::state_t MainApp::get_state()
-{
-    return ( state_t )SDL_AtomicGet( &m_loading_info.state );
-}
-
 bool MainApp::is_trace_loaded()
 {
     return m_trace_win && ( m_trace_win->m_trace_events.get_load_status() == TraceEvents::Trace_Loaded );
 }
 
-void MainApp::set_state( state_t state, const char *filename )
+void MainApp::set_active_trace( TraceWin *win )
 {
-    if ( state == State_Loading )
-        m_loading_info.filename = filename;
-    else
-        m_loading_info.filename.clear();
+    TraceWin *prev = m_trace_win;
 
-    m_loading_info.win = NULL;
-    m_loading_info.thread = NULL;
+    if ( win == prev )
+        return;
+
+    m_trace_win = win;
+
+    // Keep graph position and markers in step so traces can be compared by flipping tabs
+    if ( win && prev && win->m_inited && prev->m_inited && s_opts().getb( OPT_SyncTraceTabs ) )
+    {
+        win->m_graph.start_ts = prev->m_graph.start_ts;
+        win->m_graph.length_ts = prev->m_graph.length_ts;
+        win->m_graph.ts_markers[ 0 ] = prev->m_graph.ts_markers[ 0 ];
+        win->m_graph.ts_markers[ 1 ] = prev->m_graph.ts_markers[ 1 ];
+        win->m_graph.recalc_timebufs = true;
+    }
 
-    SDL_AtomicSet( &m_loading_info.state, state );
+    m_show_trace_info.clear();
 }
 
-void MainApp::cancel_load_file()
+void MainApp::close_trace( TraceWin *win )
 {
-    // Switch to cancel loading if we're currently loading
-    SDL_AtomicCAS( &m_loading_info.state, State_Loading, State_CancelLoading );
+    auto it = std::find( m_trace_wins.begin(), m_trace_wins.end(), win );
+
+    if ( it == m_trace_wins.end() )
+        return;
+
+    it = m_trace_wins.erase( it );
+
+    if ( win == m_trace_win )
+    {
+        if ( it == m_trace_wins.end() )
+            m_trace_win = m_trace_wins.empty() ? NULL : m_trace_wins.back();
+        else
+            m_trace_win = *it;
+
+        m_show_trace_info.clear();
+    }
+
+    // Cancels and waits for the loader thread if it's still running
+    delete win;
 }
 
 static std::string unzip_first_file( const char *zipfile )
@@ -583,12 +614,6 @@ bool MainApp::load_file( const char *filename )
     std::string tmpfile;
     const char *ext = strrchr( filename, '.' );
 
-    if ( get_state() != State_Idle )
-    {
-        logf( "[Error] %s failed, currently loading %s.", __func__, m_loading_info.filename.c_str() );
-        return false;
-    }
-
     if ( ext && !strcmp( ext, ".zip" ) )
     {
         tmpfile = unzip_first_file( filename );
@@ -604,24 +629,32 @@ bool MainApp::load_file( const char *filename )
         return false;
     }
 
-    set_state( State_Loading, filename );
+    TraceWin *win = new TraceWin( filename, filesize );
+    trace_info_t &trace_info = win->m_trace_events.m_trace_info;
 
-    delete m_trace_win;
-    m_trace_win = new TraceWin( filename, filesize );
+    // Command line options only apply to the first trace loaded
+    trace_info.m_tracestart = m_loading_info.tracestart;
+    trace_info.m_tracelen = m_loading_info.tracelen;
+    trace_info.clock_anchors.swap( m_loading_info.clock_anchors );
+    trace_info.load_filters = m_loading_info.load_filters;
+    if ( !m_loading_info.sysroot.empty() )
+        win->m_trace_events.m_stack_syms.sysroot = m_loading_info.sysroot;
+    win->m_loader.export_dir.swap( m_loading_info.export_dir );
+    win->m_loader.sql_query.swap( m_loading_info.sql_query );
+    m_loading_info.tracestart = 0;
+    m_loading_info.tracelen = 0;
 
-    m_loading_info.win = m_trace_win;
-    m_loading_info.thread = SDL_CreateThread( thread_func, "eventloader", &m_loading_info );
-    if ( !m_loading_info.thread )
+    win->m_loader.thread = SDL_CreateThread( thread_func, "eventloader", win );
+    if ( !win->m_loader.thread )
     {
         logf( "[Error] %s: SDL_CreateThread failed.", __func__ );
 
-        delete m_trace_win;
-        m_trace_win = NULL;
-
-        set_state( State_Idle );
+        delete win;
         return false;
     }
 
+    m_trace_wins.push_back( win );
+    set_active_trace( win );
     return true;
 }
 
@@ -667,6 +700,10 @@ static void add_sched_switch_pid_comm( trace_info_t &trace_info, const trace_eve
 
 TraceEvents::~TraceEvents()
 {
+    // Out of core fields live in the event store mapping
+    if ( m_events.is_out_of_core() )
+        return;
+
     for ( trace_event_t &event : m_events )
     {
         if ( event.fields )
@@ -683,36 +720,57 @@ TraceEvents::~TraceEvents()
 int TraceEvents::new_event_cb( const trace_event_t &event )
 {
     // Add event to our m_events array
-    m_events.push_back( event );
+    if ( !m_events.push_back( event ) )
+    {
+        // Out of core storage is full: we own the fields, so free them and stop loading
+        delete [] event.fields;
+        m_load_failed = true;
+        return 1;
+    }
+
+    // event.fields may be freed below, so only use new_event from here on
+    trace_event_t &new_event = m_events.back();
+
+    if ( m_events.is_out_of_core() && new_event.numfields )
+    {
+        event_field_t *fields = m_events.store_fields( new_event.fields, new_event.numfields );
+
+        // Move fields into disk backed storage
+        if ( fields )
+        {
+            delete [] new_event.fields;
+            new_event.fields = fields;
+        }
+    }
 
     // If this is a sched_switch event, see if it has comm info we don't know about.
     // This is the reason we're initializing events in two passes to collect all this data.
-    if ( event.is_sched_switch() )
+    if ( new_event.is_sched_switch() )
     {
-        add_sched_switch_pid_comm( m_trace_info, event, "prev_pid", "prev_comm" );
-        add_sched_switch_pid_comm( m_trace_info, event, "next_pid", "next_comm" );
+        add_sched_switch_pid_comm( m_trace_info, new_event, "prev_pid", "prev_comm" );
+        add_sched_switch_pid_comm( m_trace_info, new_event, "next_pid", "next_comm" );
     }
-    else if ( event.is_ftrace_print() )
+    else if ( new_event.is_ftrace_print() )
     {
-        new_event_ftrace_print( m_events.back() );
+        new_event_ftrace_print( new_event );
     }
 
     // Record the maximum crtc value we've ever seen
-    m_crtc_max = std::max< int >( m_crtc_max, event.crtc );
+    m_crtc_max = std::max< int >( m_crtc_max, new_event.crtc );
 
     // 1+ means loading events
     SDL_AtomicAdd( &m_eventsloaded, 1 );
 
     // Return 1 to cancel loading
-    return ( s_app().get_state() == MainApp::State_CancelLoading );
+    return SDL_AtomicGet( &m_cancel_load );
 }
 
 int SDLCALL MainApp::thread_func( void *data )
 {
     util_time_t t0 = util_get_time();
-    loading_info_t *loading_info = ( loading_info_t *)data;
-    TraceEvents &trace_events = loading_info->win->m_trace_events;
-    const char *filename = loading_info->filename.c_str();
+    TraceWin *win = ( TraceWin * )data;
+    TraceEvents &trace_events = win->m_trace_events;
+    const char *filename = trace_events.m_filename.c_str();
 
     {
         GPUVIS_TRACE_BLOCKF( "read_trace_file: %s", filename );
@@ -720,24 +778,34 @@ int SDLCALL MainApp::thread_func( void *data )
         logf( "Reading trace file %s...", filename );
 
         trace_events.m_trace_info.trim_trace = s_opts().getb( OPT_TrimTrace );
+        trace_events.m_trace_info.clock_sync = s_opts().getb( OPT_ClockSync );
+        trace_events.m_trace_info.recover_bad_pages = s_opts().getb( OPT_RecoverBadPages );
 
-        trace_events.m_trace_info.m_tracestart = loading_info->tracestart;
-        trace_events.m_trace_info.m_tracelen = loading_info->tracelen;
-        loading_info->tracestart = 0;
-        loading_info->tracelen = 0;
+        int budget_mb = s_opts().geti( OPT_EventMemoryBudget );
+        if ( budget_mb > 0 )
+        {
+            const char *tmpdir = getenv( "TMPDIR" );
+
+            trace_events.m_events.init_out_of_core( tmpdir ? tmpdir : P_tmpdir, budget_mb );
+        }
 
         EventCallback trace_cb = std::bind( &TraceEvents::new_event_cb, &trace_events, _1 );
         int ret = read_trace_file( filename, trace_events.m_strpool,
                                    trace_events.m_trace_info, trace_cb );
-        if ( ret < 0 )
+        if ( ( ret < 0 ) || trace_events.m_load_failed )
         {
             logf( "[Error] read_trace_file(%s) failed.", filename );
 
             // -1 means loading error
             SDL_AtomicSet( &trace_events.m_eventsloaded, -1 );
-            s_app().set_state( State_Idle );
             return -1;
         }
+
+        for ( const load_filter_t &filter : trace_events.m_trace_info.load_filters )
+        {
+            logf( "Load filter %s: dropped %" PRIu64 " of %" PRIu64 " events",
+                  load_filter_str( filter ).c_str(), filter.dropped, filter.matched );
+        }
     }
 
     {
@@ -748,6 +816,9 @@ int SDLCALL MainApp::thread_func( void *data )
         // Call TraceEvents::init() to initialize all events, etc.
         trace_events.init();
 
+        // Drop events init() faulted in if we're out of core
+        trace_events.m_events.trim();
+
         float time_init = util_time_to_ms( t0, util_get_time() ) - time_load;
 
         const std::string str = string_format(
@@ -761,9 +832,29 @@ int SDLCALL MainApp::thread_func( void *data )
 #endif
     }
 
+    if ( !win->m_loader.export_dir.empty() )
+    {
+        std::string errstr;
+
+        if ( !export_arrow( trace_events, win->m_loader.export_dir.c_str(), errstr ) )
+            logf( "[Error] %s", errstr.c_str() );
+        win->m_loader.export_dir.clear();
+    }
+
+    if ( !win->m_loader.sql_query.empty() )
+    {
+        TraceSql sql;
+        std::string errstr;
+
+        if ( sql.query( trace_events, win->m_loader.sql_query.c_str(), errstr ) )
+            sql.print( stdout );
+        else
+            logf( "[Error] sql: %s", errstr.c_str() );
+        win->m_loader.sql_query.clear();
+    }
+
     // 0 means events have all all been loaded
     SDL_AtomicSet( &trace_events.m_eventsloaded, 0 );
-    s_app().set_state( State_Idle );
 
     return 0;
 }
@@ -864,20 +955,42 @@ void MainApp::shutdown( SDL_Window *window )
         save_window_pos( x - left, y - top, w, h );
     }
 
-    if ( m_loading_info.thread )
+    // Cancels any file loading going on and waits for loader threads
+    while ( !m_trace_wins.empty() )
+        close_trace( m_trace_wins.back() );
+}
+
+// --headless: load traces given on the command line, run any --exportarrow
+//  and --sql, and return without ever creating a window.
+int MainApp::run_headless()
+{
+    int ret = 0;
+
+    for ( const std::string &filename : m_loading_info.inputfiles )
+    {
+        if ( !load_file( filename.c_str() ) )
+            ret = -1;
+    }
+    m_loading_info.inputfiles.clear();
+
+    for ( TraceWin *win : m_trace_wins )
     {
-        // Cancel any file loading going on.
-        cancel_load_file();
+        SDL_WaitThread( win->m_loader.thread, NULL );
+        win->m_loader.thread = NULL;
 
-        // Wait for our thread to die.
-        SDL_WaitThread( m_loading_info.thread, NULL );
-        m_loading_info.thread = NULL;
+        if ( SDL_AtomicGet( &win->m_trace_events.m_eventsloaded ) < 0 )
+            ret = -1;
     }
 
-    set_state( State_Idle );
+    // No console window to show errors in
+    logf_update();
+    for ( const char *str : logf_get() )
+    {
+        if ( !strncasecmp( str, "[error]", 7 ) )
+            fprintf( stderr, "%s\n", str );
+    }
 
-    delete m_trace_win;
-    m_trace_win = NULL;
+    return ret;
 }
 
 void MainApp::render_save_filename()
@@ -987,6 +1100,9 @@ static void render_help_entry( const char *hotkey, const char *desc )
 
 void MainApp::render()
 {
+    // Vblank crtc options follow the trace being viewed
+    s_opts().set_crtc_max( is_trace_loaded() ? m_trace_win->m_trace_events.m_crtc_max : -1 );
+
     if ( m_trace_win && m_trace_win->m_open )
     {
         float w = ImGui::GetIO().DisplaySize.x;
@@ -999,8 +1115,7 @@ void MainApp::render()
     }
     else if ( m_trace_win )
     {
-        delete m_trace_win;
-        m_trace_win = NULL;
+        close_trace( m_trace_win );
     }
     else if ( !m_show_scale_popup && m_loading_info.inputfiles.empty() )
     {
@@ -1179,14 +1294,10 @@ void MainApp::render()
 
 void MainApp::update()
 {
-    if ( !m_loading_info.inputfiles.empty() && ( get_state() == State_Idle ) )
-    {
-        const char *filename = m_loading_info.inputfiles[ 0 ].c_str();
-
-        load_file( filename );
-
-        m_loading_info.inputfiles.erase( m_loading_info.inputfiles.begin() );
-    }
+    // Traces load in parallel, each on its own thread
+    for ( const std::string &filename : m_loading_info.inputfiles )
+        load_file( filename.c_str() );
+    m_loading_info.inputfiles.clear();
 
     if ( ( m_font_main.m_changed || m_font_small.m_changed ) &&
          !ImGui::IsMouseDown( 0 ) )
@@ -1212,8 +1323,8 @@ void MainApp::load_fonts()
 
     // Reset max rect size for the print events so they'll redo the CalcTextSize for the
     //  print graph row backgrounds (in graph_render_print_timeline).
-    if ( m_trace_win )
-        m_trace_win->m_trace_events.invalidate_ftraceprint_colors();
+    for ( TraceWin *win : m_trace_wins )
+        win->m_trace_events.invalidate_ftraceprint_colors();
 
     if ( s_ini().GetFloat( "scale", -1.0f ) == -1.0f )
     {
@@ -1272,17 +1383,8 @@ uint32_t TraceWin::ts_to_eventid( int64_t ts )
     if ( peventid )
         return *peventid;
 
-    trace_event_t x;
-    const std::vector< trace_event_t > &events = m_trace_events.m_events;
-
-    x.ts = ts;
-
-    auto eventidx = std::lower_bound( events.begin(), events.end(), x,
-        []( const trace_event_t &f1, const trace_event_t &f2 ) {
-            return f1.ts < f2.ts;
-        } );
-
-    uint32_t id = eventidx - events.begin();
+    const TraceEventStore &events = m_trace_events.m_events;
+    uint32_t id = events.lower_bound_ts( ts );
 
     if ( id >= events.size() )
         id = events.size() - 1;
@@ -1864,6 +1966,65 @@ void TraceEvents::init_i915_event( trace_event_t &event )
     }
 }
 
+void TraceEvents::init_dma_fence_event( trace_event_t &event )
+{
+    uint64_t key = get_dma_fence_key( event );
+    dma_fence_type_t event_type = get_dma_fence_type( event );
+
+    if ( !key || ( event_type == dma_fence_Max ) )
+        return;
+
+    if ( event_type == dma_fence_WaitStart )
+    {
+        m_dma_fence.wait_locs.m_map[ key ].push_back( event.id );
+    }
+    else if ( event_type == dma_fence_WaitEnd )
+    {
+        std::vector< uint32_t > *plocs = m_dma_fence.wait_locs.get_val( key );
+
+        if ( plocs )
+        {
+            // Find last unfinished wait on this fence from our pid
+            for ( auto it = plocs->rbegin(); it != plocs->rend(); it++ )
+            {
+                trace_event_t &event_begin = m_events[ *it ];
+
+                if ( ( event_begin.pid == event.pid ) && !event_begin.has_duration() )
+                {
+                    event_begin.duration = event.ts - event_begin.ts;
+                    event.duration = event_begin.duration;
+
+                    // Point wait_end to wait_start
+                    event.id_start = event_begin.id;
+                    break;
+                }
+            }
+        }
+    }
+    else
+    {
+        dma_fence_t *fence = m_dma_fence.fences.get_val_create( key );
+
+        // Keep the first queue / emit events and the last signaled event
+        if ( !is_valid_id( fence->eventids[ event_type ] ) || ( event_type == dma_fence_Signaled ) )
+            fence->eventids[ event_type ] = event.id;
+
+        if ( !fence->timeline )
+        {
+            // dma_fence events have timeline field, drm_sched events have ring name
+            const char *timeline = get_event_field_val( event, "timeline", NULL );
+
+            if ( !timeline )
+                timeline = get_event_field_val( event, "name", NULL );
+            if ( !timeline )
+                timeline = get_event_field_val( event, "ring", NULL );
+
+            if ( timeline && timeline[ 0 ] )
+                fence->timeline = timeline;
+        }
+    }
+}
+
 static int64_t normalize_vblank_diff( int64_t diff )
 {
     static const int64_t rates[] =
@@ -1984,6 +2145,37 @@ void TraceEvents::init_new_event( trace_event_t &event )
         if ( pid_comm )
             m_trace_info.pid_comm_map.set_val( event.pid, pid_comm );
     }
+    else if ( !strcmp( event.name, "sched_wakeup" ) ||
+              !strcmp( event.name, "sched_wakeup_new" ) )
+    {
+        // comm=Xorg pid=1180 prio=120 target_cpu=003
+        int pid = atoi( get_event_field_val( event, "pid", "0" ) );
+
+        if ( pid )
+            m_sched_wakeup_locs.add_location_u32( pid, event.id );
+    }
+    else if ( !strcmp( event.name, "cpu_idle" ) ||
+              !strcmp( event.name, "cpu_frequency" ) )
+    {
+        // cpu_idle: state=2 cpu_id=3 (state=4294967295 when leaving idle)
+        // cpu_frequency: state=1400000 cpu_id=3
+        uint32_t cpu = strtoul( get_event_field_val( event, "cpu_id", "0" ), NULL, 10 );
+        uint32_t val = strtoul( get_event_field_val( event, "state", "0" ), NULL, 10 );
+
+        if ( cpu < m_trace_info.cpus )
+        {
+            bool idle = ( event.name[ 4 ] == 'i' );
+            std::vector< cpu_step_t > &steps = idle ? m_cpu_idle[ cpu ] : m_cpu_freq[ cpu ];
+
+            if ( steps.empty() || ( steps.back().val != val ) )
+                steps.push_back( { event.ts, val } );
+
+            if ( idle && ( val != CPU_IDLE_ACTIVE ) )
+                m_cpu_idle_max = std::max< uint32_t >( m_cpu_idle_max, val );
+            else if ( !idle )
+                m_cpu_freq_max = std::max< uint32_t >( m_cpu_freq_max, val );
+        }
+    }
 #if 0
     // Disabled for now. Need to figure out how to prevent sudo, bash, etc from becoming the parent. Ie:
     //    <...>-7860  [021]  3726.235512: sched_process_fork:   comm=sudo pid=7860 child_comm=sudo child_pid=7861
@@ -2008,6 +2200,14 @@ void TraceEvents::init_new_event( trace_event_t &event )
         init_i915_event( event );
     }
 
+    if ( event.is_dma_fence() )
+        init_dma_fence_event( event );
+
+    if ( !strncmp( event.name, "block_rq_", 9 ) )
+        init_block_rq_event( event );
+    else if ( !strncmp( event.name, "amdgpu_bo_", 10 ) || !strncmp( event.name, "i915_gem_object_", 16 ) )
+        init_gpu_mem_event( event );
+
     if ( !strcmp( event.name, "amdgpu_job_msg" ) )
     {
         const char *msg = get_event_field_val( event, "msg", NULL );
@@ -2083,7 +2283,8 @@ void TraceEvents::init()
 
     m_vblank_info.resize( m_crtc_max + 1 );
 
-    s_opts().set_crtc_max( m_crtc_max );
+    m_cpu_idle.resize( m_trace_info.cpus );
+    m_cpu_freq.resize( m_trace_info.cpus );
 
     {
         // Initialize events...
@@ -2093,6 +2294,10 @@ void TraceEvents::init()
             init_new_event( event );
     }
 
+    // Finish up block requests and gpu memory ledger built in init_new_event
+    calculate_block_devs();
+    calculate_gpu_mem();
+
     // Figure out median vblank intervals
     calculate_vblank_info();
 
@@ -2103,6 +2308,28 @@ void TraceEvents::init()
     calculate_i915_req_event_durations();
     calculate_i915_reqwait_event_durations();
 
+    // Init generic dma_fence / drm_sched durations
+    calculate_dma_fence_durations();
+
+    // Gather amd and intel gpu jobs for critical path calculations
+    calculate_gpu_jobs();
+    calculate_api_links();
+
+    // Bin event rate and gpu busy time for scrollbar overview
+    calculate_density();
+
+    // Per-thread running / runnable / sleeping runs from scheduler events
+    calculate_thread_states();
+
+    // Pair irq and softirq entry / exit events per cpu
+    calculate_irq_intervals();
+
+    // Attribute kworker execution to work functions
+    calculate_workqueue();
+
+    // Infer frame boundaries from periodic events
+    calculate_frame_candidates();
+
     // Init print column information
     calculate_event_print_info();
 
@@ -2112,6 +2339,12 @@ void TraceEvents::init()
     // Update tgid colors
     update_tgid_colors();
 
+    // Symbolize kernel_stack, user_stack and perf callchain addresses
+    calculate_stack_syms();
+
+    // Run anomaly rules over everything calculated above
+    calculate_anomalies();
+
     std::vector< INIEntry > entries = s_ini().GetSectionEntries( "$imgui_eventcolors$" );
 
     // Restore event colors
@@ -2215,7 +2448,7 @@ void TraceEvents::set_event_color( const std::string &eventname, ImU32 color )
 void TraceEvents::calculate_amd_event_durations()
 {
     std::vector< uint32_t > erase_list;
-    std::vector< trace_event_t > &events = m_events;
+    TraceEventStore &events = m_events;
     float label_sat = s_clrs().getalpha( col_Graph_TimelineLabelSat );
     float label_alpha = s_clrs().getalpha( col_Graph_TimelineLabelAlpha );
 
@@ -2473,76 +2706,1484 @@ void TraceEvents::calculate_i915_req_event_durations()
         // execute-delay: req_submit -> req_in
         set_duration |= intel_set_duration( events[ i915_req_Submit ], events[ i915_req_In ], col_Graph_Bari915ExecuteDelay );
 
-        // execute (start to user interrupt): req_in -> engine_notify
-        set_duration |= intel_set_duration( events[ i915_req_In ], events[ i915_req_Notify ], col_Graph_Bari915Execute );
+        // execute (start to user interrupt): req_in -> engine_notify
+        set_duration |= intel_set_duration( events[ i915_req_In ], events[ i915_req_Notify ], col_Graph_Bari915Execute );
+
+        // context-complete-delay (user interrupt to context complete): engine_notify -> req_out
+        set_duration |= intel_set_duration( events[ i915_req_Notify ], events[ i915_req_Out ], col_Graph_Bari915CtxCompleteDelay );
+
+        // If we didn't get an intel_engine_notify event, do req_in -> req_out
+        set_duration |= intel_set_duration( events[ i915_req_In ], events[ i915_req_Out ], col_Graph_Bari915Execute );
+
+        if ( set_duration )
+        {
+            char buf[ 64 ];
+            uint32_t hashval;
+            int pid = events[ i915_req_Queue ] ? events[ i915_req_Queue ]->pid : 0;
+
+            if ( ringno_is_class_instance )
+                hashval = m_strpool.getu32f( "i915_req %s%u", get_i915_engine_str( buf, ringno ), ringno >> 4 );
+            else
+                hashval = m_strpool.getu32f( "i915_req ring%u", ringno );
+
+            for ( uint32_t i = 0; i < i915_req_Max; i++ )
+            {
+                if ( events[ i ] )
+                {
+                    // Switch the kernel pids in this group to match the i915_request_queue event (ioctl from user space).
+                    if ( pid && !events[ i ]->pid )
+                        events[ i ]->pid = pid;
+
+                    events[ i ]->graph_row_id = ( uint32_t )-1;
+                    m_i915.req_locs.add_location_u32( hashval, events[ i ]->id );
+                }
+            }
+        }
+    }
+
+    // Sort the events in the ring maps
+    for ( auto &req_locs : m_i915.req_locs.m_locs.m_map )
+    {
+        row_pos_t row_pos;
+        std::vector< uint32_t > &locs = req_locs.second;
+        // const char *name = m_strpool.findstr( req_locs.first );
+
+        std::sort( locs.begin(), locs.end() );
+
+        for ( uint32_t idx : locs )
+        {
+            if ( m_events[ idx ].graph_row_id != ( uint32_t )-1 )
+                continue;
+
+            trace_event_t &event = m_events[ idx ];
+            const std::vector< uint32_t > *plocs;
+            const trace_event_t *pevent = !strcmp( event.name, "intel_engine_notify" ) ?
+                        &m_events[ event.id_start ] : &event;
+
+            plocs = m_i915.gem_req_locs.get_locations( *pevent );
+            if ( plocs )
+            {
+                int64_t min_ts = m_events[ plocs->front() ].ts;
+                int64_t max_ts = m_events[ plocs->back() ].ts;
+                uint32_t row = row_pos.get_row( min_ts, max_ts );
+
+                for ( uint32_t i : *plocs )
+                    m_events[ i ].graph_row_id = row;
+            }
+        }
+
+        m_row_count.m_map[ req_locs.first ] = row_pos.m_rows;
+    }
+}
+
+dma_fence_type_t get_dma_fence_type( const trace_event_t &event )
+{
+    const char *name = event.name;
+
+    if ( !strncmp( name, "drm_", 4 ) )
+    {
+        // Older kernels: drm_sched_job, drm_run_job. v6.17+: drm_sched_job_queue, drm_sched_job_run
+        if ( !strcmp( name, "drm_sched_job" ) || !strcmp( name, "drm_sched_job_queue" ) )
+            return dma_fence_Job;
+        else if ( !strcmp( name, "drm_run_job" ) || !strcmp( name, "drm_sched_job_run" ) )
+            return dma_fence_RunJob;
+
+        return dma_fence_Max;
+    }
+
+    // fence_* events were renamed to dma_fence_* post v4.9
+    if ( !strncmp( name, "dma_", 4 ) )
+        name += 4;
+
+    if ( !strcmp( name, "fence_emit" ) )
+        return dma_fence_Emit;
+    else if ( !strcmp( name, "fence_enable_signal" ) )
+        return dma_fence_EnableSignal;
+    else if ( !strcmp( name, "fence_signaled" ) )
+        return dma_fence_Signaled;
+    else if ( !strcmp( name, "fence_wait_start" ) )
+        return dma_fence_WaitStart;
+    else if ( !strcmp( name, "fence_wait_end" ) )
+        return dma_fence_WaitEnd;
+
+    return dma_fence_Max;
+}
+
+uint64_t get_dma_fence_key( const trace_event_t &event )
+{
+    // dma_fence_*: driver=%s timeline=%s context=%u seqno=%u
+    const char *context = get_event_field_val( event, "context", NULL );
+    const char *seqno = get_event_field_val( event, "seqno", NULL );
+
+    if ( !context || !seqno )
+    {
+        // drm_sched_job: fence=%llu:%llu (fence_context, fence_seqno fields)
+        context = get_event_field_val( event, "fence_context", NULL );
+        seqno = get_event_field_val( event, "fence_seqno", NULL );
+
+        if ( !context || !seqno )
+            return 0;
+    }
+
+    uint64_t ctx = strtoull( context, NULL, 10 );
+    uint64_t seq = strtoull( seqno, NULL, 10 );
+
+    return ( ctx << 32 ) | ( uint32_t )seq;
+}
+
+/*
+  Driver agnostic fence timelines. Every fence is key'd on its context and seqno:
+
+    drm_sched_job         dev=card0, fence=13:5, ring=gfx, job count:1, hw job count:0
+    drm_run_job           dev=card0, fence=13:5, ring=gfx, job count:0, hw job count:1
+    dma_fence_emit        driver=nouveau timeline=nouveau context=13 seqno=5
+    dma_fence_signaled    driver=nouveau timeline=nouveau context=13 seqno=5
+
+  Execution starts at drm_run_job (or dma_fence_emit) or when the previous fence
+  on the same timeline signaled, whichever is later. Queued time is from the
+  first event we saw for the fence up to execution start.
+
+  amdgpu timelines are already handled by the amdgpu_cs_ioctl code above, so they're skipped here.
+ */
+void TraceEvents::calculate_dma_fence_durations()
+{
+    float label_sat = s_clrs().getalpha( col_Graph_TimelineLabelSat );
+    float label_alpha = s_clrs().getalpha( col_Graph_TimelineLabelAlpha );
+
+    for ( auto &fence_item : m_dma_fence.fences.m_map )
+    {
+        const dma_fence_t &fence = fence_item.second;
+        uint32_t signaled_id = fence.eventids[ dma_fence_Signaled ];
+
+        if ( !fence.timeline || !is_valid_id( signaled_id ) )
+            continue;
+
+        if ( m_amd_timeline_locs.get_locations_str( fence.timeline ) )
+            continue;
+
+        uint32_t hashval = m_strpool.getu32f( "fence %s", fence.timeline );
+
+        m_dma_fence.timeline_locs.add_location_u32( hashval, signaled_id );
+    }
+
+    for ( auto &timeline_locs : m_dma_fence.timeline_locs.m_locs.m_map )
+    {
+        row_pos_t row_pos;
+        int64_t last_signaled_ts = 0;
+        std::vector< uint32_t > &locs = timeline_locs.second;
+
+        std::sort( locs.begin(), locs.end() );
+
+        for ( uint32_t idx : locs )
+        {
+            trace_event_t &signaled = m_events[ idx ];
+            dma_fence_t *fence = m_dma_fence.fences.get_val( get_dma_fence_key( signaled ) );
+            uint32_t start_id = idx;
+            uint32_t exec_id = INVALID_ID;
+
+            // First event we saw for this fence
+            for ( uint32_t i = dma_fence_Job; i < dma_fence_Signaled; i++ )
+                start_id = std::min< uint32_t >( start_id, fence->eventids[ i ] );
+
+            if ( is_valid_id( fence->eventids[ dma_fence_RunJob ] ) )
+                exec_id = fence->eventids[ dma_fence_RunJob ];
+            else if ( is_valid_id( fence->eventids[ dma_fence_Emit ] ) )
+                exec_id = fence->eventids[ dma_fence_Emit ];
+            else
+                exec_id = start_id;
+
+            trace_event_t &event_start = m_events[ start_id ];
+            int64_t exec_ts = Clamp< int64_t >( m_events[ exec_id ].ts, last_signaled_ts, signaled.ts );
+
+            exec_ts = std::max< int64_t >( exec_ts, event_start.ts );
+
+            fence->exec_ts = exec_ts;
+
+            signaled.duration = signaled.ts - exec_ts;
+            if ( start_id != idx )
+            {
+                signaled.id_start = start_id;
+                event_start.duration = exec_ts - event_start.ts;
+            }
+
+            // Submitting process is whoever queued or emitted this fence
+            signaled.user_comm = event_start.comm;
+            signaled.graph_row_id = row_pos.get_row( event_start.ts, signaled.ts );
+
+            signaled.flags |= TRACE_FLAG_AUTOGEN_COLOR;
+            signaled.color = imgui_col_from_hashval( hashstr32( signaled.user_comm ), label_sat, label_alpha );
+
+            last_signaled_ts = signaled.ts;
+        }
+
+        m_row_count.m_map[ timeline_locs.first ] = row_pos.m_rows;
+    }
+}
+
+void TraceEvents::calculate_gpu_jobs()
+{
+    // amdgpu_cs_ioctl -> amdgpu_sched_run_job -> fence_signaled
+    for ( auto &timeline_locs : m_amd_timeline_locs.m_locs.m_map )
+    {
+        for ( uint32_t index : timeline_locs.second )
+        {
+            const trace_event_t &fence_signaled = m_events[ index ];
+
+            if ( !fence_signaled.is_fence_signaled() ||
+                 !is_valid_id( fence_signaled.id_start ) ||
+                 !fence_signaled.has_duration() )
+                continue;
+
+            const trace_event_t &sched_run_job = m_events[ fence_signaled.id_start ];
+            const trace_event_t &cs_ioctl = is_valid_id( sched_run_job.id_start ) ?
+                        m_events[ sched_run_job.id_start ] : sched_run_job;
+            gpu_job_t job;
+
+            job.submit_ts = cs_ioctl.ts;
+            job.submit_pid = ( cs_ioctl.id != sched_run_job.id ) ? cs_ioctl.pid : 0;
+            job.submit_eventid = ( cs_ioctl.id != sched_run_job.id ) ? cs_ioctl.id : INVALID_ID;
+            job.exec_ts = fence_signaled.ts - fence_signaled.duration;
+            job.end_ts = fence_signaled.ts;
+            job.end_eventid = fence_signaled.id;
+            job.end_cpu = fence_signaled.cpu;
+            job.row_hashval = timeline_locs.first;
+
+            m_gpu_jobs.push_back( job );
+        }
+    }
+
+    // i915_request_queue / add -> i915_request_in -> intel_engine_notify / i915_request_out
+    for ( auto &req_locs : m_i915.req_locs.m_locs.m_map )
+    {
+        for ( uint32_t index : req_locs.second )
+        {
+            const trace_event_t &event_in = m_events[ index ];
+
+            if ( get_i915_reqtype( event_in ) != i915_req_In )
+                continue;
+
+            const trace_event_t *events[ i915_req_Max ] = { NULL };
+            const std::vector< uint32_t > *plocs = m_i915.gem_req_locs.get_locations( event_in );
+
+            if ( !plocs )
+                continue;
+
+            for ( uint32_t i : *plocs )
+            {
+                i915_type_t event_type = get_i915_reqtype( m_events[ i ] );
+
+                if ( event_type < i915_req_Max )
+                    events[ event_type ] = &m_events[ i ];
+            }
+
+            const trace_event_t *event_submit = events[ i915_req_Queue ] ? events[ i915_req_Queue ] : events[ i915_req_Add ];
+            const trace_event_t *event_end = events[ i915_req_Notify ] ? events[ i915_req_Notify ] : events[ i915_req_Out ];
+
+            if ( event_submit && event_end && ( event_end->ts >= event_in.ts ) )
+            {
+                gpu_job_t job;
+
+                job.submit_ts = event_submit->ts;
+                job.submit_pid = event_submit->pid;
+                job.submit_eventid = event_submit->id;
+                job.exec_ts = event_in.ts;
+                job.end_ts = event_end->ts;
+                job.end_eventid = event_end->id;
+                job.end_cpu = event_end->cpu;
+                job.row_hashval = req_locs.first;
+
+                m_gpu_jobs.push_back( job );
+            }
+        }
+    }
+
+    // drm_sched_job / dma_fence_emit -> dma_fence_signaled
+    for ( auto &timeline_locs : m_dma_fence.timeline_locs.m_locs.m_map )
+    {
+        for ( uint32_t index : timeline_locs.second )
+        {
+            const trace_event_t &signaled = m_events[ index ];
+            const dma_fence_t *fence = m_dma_fence.fences.get_val( get_dma_fence_key( signaled ) );
+            const trace_event_t &event_start = is_valid_id( signaled.id_start ) ?
+                        m_events[ signaled.id_start ] : signaled;
+            gpu_job_t job;
+
+            job.submit_ts = event_start.ts;
+            job.submit_pid = event_start.pid;
+            job.submit_eventid = ( event_start.id != signaled.id ) ? event_start.id : INVALID_ID;
+            job.exec_ts = fence->exec_ts;
+            job.end_ts = signaled.ts;
+            job.end_eventid = signaled.id;
+            job.end_cpu = signaled.cpu;
+            job.row_hashval = timeline_locs.first;
+
+            m_gpu_jobs.push_back( job );
+        }
+    }
+
+    std::sort( m_gpu_jobs.begin(), m_gpu_jobs.end(),
+               []( const gpu_job_t &lx, const gpu_job_t &rx ) { return lx.end_ts < rx.end_ts; } );
+}
+
+/*
+  Api markers are ftrace prints (gpuvis_trace_utils.h scopes and markers like
+  vkQueueSubmit, glFlush, frame scopes, etc). A gpu job submission is linked to
+  the innermost marker scope on the submitting thread which contains it or,
+  failing that, the latest marker on that thread shortly before it.
+ */
+void TraceEvents::calculate_api_links()
+{
+    // Max time between end of a marker and the submission it caused
+    static const int64_t s_max_marker_gap = 2 * NSECS_PER_MSEC;
+    // Max marker scope length we'll look back for
+    static const int64_t s_max_marker_scope = 100 * NSECS_PER_MSEC;
+
+    struct api_marker_t
+    {
+        int64_t ts0;
+        int64_t ts1;
+        uint32_t eventid;
+    };
+    util_umap< int, std::vector< api_marker_t > > pid_markers;
+
+    if ( m_gpu_jobs.empty() || m_ftrace.print_locs.empty() )
+        return;
+
+    // Per-pid marker intervals
+    for ( uint32_t id : m_ftrace.print_locs )
+    {
+        const trace_event_t &event = m_events[ id ];
+        const print_info_t *print_info = m_ftrace.print_info.get_val( id );
+        int64_t ts0 = print_info ? print_info->ts : event.ts;
+        int64_t ts1 = event.has_duration() ? ( ts0 + event.duration ) : ts0;
+
+        pid_markers.get_val_create( event.pid )->push_back( { ts0, ts1, id } );
+    }
+
+    for ( auto &item : pid_markers.m_map )
+    {
+        std::sort( item.second.begin(), item.second.end(),
+                   []( const api_marker_t &lx, const api_marker_t &rx ) { return lx.ts0 < rx.ts0; } );
+    }
+
+    for ( uint32_t ijob = 0; ijob < m_gpu_jobs.size(); ijob++ )
+    {
+        const gpu_job_t &job = m_gpu_jobs[ ijob ];
+        const std::vector< api_marker_t > *markers = pid_markers.get_val( job.submit_pid );
+
+        if ( !markers || !is_valid_id( job.submit_eventid ) )
+            continue;
+
+        auto it = std::upper_bound( markers->begin(), markers->end(), job.submit_ts,
+                                    []( int64_t ts, const api_marker_t &marker ) { return ts < marker.ts0; } );
+        uint32_t marker_id = INVALID_ID;
+        int64_t marker_ts = INT64_MIN;
+
+        while ( it != markers->begin() )
+        {
+            const api_marker_t &marker = *--it;
+
+            if ( marker.ts0 < job.submit_ts - s_max_marker_scope )
+                break;
+
+            if ( marker.ts1 >= job.submit_ts )
+            {
+                // Innermost scope containing the submission, unless a marker
+                //  inside it ended just before the submission: that's closer.
+                if ( !is_valid_id( marker_id ) )
+                    marker_id = marker.eventid;
+                break;
+            }
+
+            if ( ( marker.ts1 > marker_ts ) && ( job.submit_ts - marker.ts1 <= s_max_marker_gap ) )
+            {
+                marker_id = marker.eventid;
+                marker_ts = marker.ts1;
+            }
+        }
+
+        if ( is_valid_id( marker_id ) )
+        {
+            m_api_links.job_marker.m_map[ job.submit_eventid ] = marker_id;
+            m_api_links.job_marker.m_map[ job.end_eventid ] = marker_id;
+            m_api_links.marker_jobs.get_val_create( marker_id )->push_back( ijob );
+        }
+    }
+}
+
+void TraceEvents::calculate_density()
+{
+    // Number of overview bins for entire trace
+    static const uint32_t s_density_bins = 2048;
+
+    if ( m_events.empty() )
+        return;
+
+    int64_t min_ts = m_events.front().ts;
+    int64_t max_ts = m_events.back().ts;
+
+    m_density.min_ts = min_ts;
+    m_density.bin_ts = std::max< int64_t >( 1, ( max_ts - min_ts ) / s_density_bins + 1 );
+    m_density.events.assign( s_density_bins, 0 );
+    m_density.gpu_busy.assign( s_density_bins, 0.0f );
+
+    for ( const trace_event_t &event : m_events )
+        m_density.events[ ( event.ts - min_ts ) / m_density.bin_ts ]++;
+
+    m_density.events_max = *std::max_element( m_density.events.begin(), m_density.events.end() );
+
+    // Spread gpu job execution time over the bins it covers. Jobs on different
+    //  rings overlap, so busy is clamped to 1.
+    for ( const gpu_job_t &job : m_gpu_jobs )
+    {
+        int64_t ts0 = std::max< int64_t >( job.exec_ts, min_ts );
+        int64_t ts1 = std::min< int64_t >( job.end_ts, max_ts );
+
+        if ( ts0 >= ts1 )
+            continue;
+
+        for ( int64_t bin = ( ts0 - min_ts ) / m_density.bin_ts; ts0 < ts1; bin++ )
+        {
+            int64_t bin_end = min_ts + ( bin + 1 ) * m_density.bin_ts;
+            int64_t ts = std::min< int64_t >( ts1, bin_end );
+
+            m_density.gpu_busy[ bin ] += ( float )( ts - ts0 ) / m_density.bin_ts;
+            ts0 = ts;
+        }
+    }
+
+    for ( float &busy : m_density.gpu_busy )
+        busy = std::min< float >( busy, 1.0f );
+}
+
+const char *thread_states_t::state_str( uint32_t state )
+{
+    switch ( state )
+    {
+    case THREAD_STATE_Running:         return "Running";
+    case THREAD_STATE_Runnable:        return "Runnable";
+    case THREAD_STATE_Sleeping:        return "Sleeping";
+    case THREAD_STATE_Uninterruptible: return "Uninterruptible";
+    }
+
+    return "Unknown";
+}
+
+size_t thread_states_t::find_run( int64_t ts ) const
+{
+    auto it = std::upper_bound( runs.begin(), runs.end(), ts,
+                                []( int64_t val, const thread_state_run_t &run ) { return val < run.ts; } );
+
+    return ( it == runs.begin() ) ? runs.size() : ( it - runs.begin() - 1 );
+}
+
+void thread_states_t::get_totals_at( int64_t ts, int64_t end_ts,
+                                     std::array< int64_t, THREAD_STATE_Max > &times ) const
+{
+    ts = std::min< int64_t >( ts, end_ts );
+
+    size_t idx = find_run( ts );
+
+    if ( idx >= runs.size() )
+    {
+        times.fill( 0 );
+        return;
+    }
+
+    // Start at closest checkpoint and add runs up to ts
+    size_t i = idx - ( idx % s_checkpoint );
+
+    times = totals[ i / s_checkpoint ];
+    for ( ; i < idx; i++ )
+        times[ runs[ i ].state ] += runs[ i + 1 ].ts - runs[ i ].ts;
+
+    times[ runs[ idx ].state ] += ts - runs[ idx ].ts;
+}
+
+void thread_states_t::get_state_times( int64_t ts0, int64_t ts1, int64_t end_ts,
+                                       std::array< int64_t, THREAD_STATE_Max > &times ) const
+{
+    std::array< int64_t, THREAD_STATE_Max > times0;
+
+    get_totals_at( ts0, end_ts, times0 );
+    get_totals_at( ts1, end_ts, times );
+
+    for ( size_t i = 0; i < times.size(); i++ )
+        times[ i ] -= times0[ i ];
+}
+
+void TraceEvents::calculate_thread_states()
+{
+    static const char *s_names[] =
+    {
+        "sched_switch", "sched_waking", "sched_wakeup", "sched_wakeup_new"
+    };
+    std::vector< uint32_t > locs;
+
+    for ( const char *name : s_names )
+    {
+        const std::vector< uint32_t > *plocs = m_eventnames_locs.get_locations_str( name );
+
+        if ( plocs )
+            locs.insert( locs.end(), plocs->begin(), plocs->end() );
+    }
+
+    if ( locs.empty() )
+        return;
+
+    // Event ids are in ts order
+    std::sort( locs.begin(), locs.end() );
+
+    auto add_run = [this]( int pid, const trace_event_t &event, uint32_t state )
+    {
+        // Skip idle tasks
+        if ( pid <= 0 )
+            return;
+
+        std::vector< thread_state_run_t > &runs = m_thread_states.get_val_create( pid )->runs;
+
+        if ( !runs.empty() )
+        {
+            thread_state_run_t &run = runs.back();
+
+            if ( run.state == state )
+                return;
+
+            if ( run.ts == event.ts )
+            {
+                // Zero length run: replace it, and merge with previous run if they match
+                if ( ( runs.size() > 1 ) && ( runs[ runs.size() - 2 ].state == state ) )
+                {
+                    runs.pop_back();
+                }
+                else
+                {
+                    run.eventid = event.id;
+                    run.state = state;
+                }
+                return;
+            }
+        }
+
+        runs.push_back( { event.ts, event.id, state } );
+    };
+
+    for ( uint32_t id : locs )
+    {
+        const trace_event_t &event = m_events[ id ];
+
+        if ( event.is_sched_switch() )
+        {
+            int next_pid = atoi( get_event_field_val( event, "next_pid", "0" ) );
+            int prev_state = atoi( get_event_field_val( event, "prev_state", "0" ) );
+            int task_state = prev_state & ( TASK_REPORT_MAX - 1 );
+            uint32_t state = THREAD_STATE_Sleeping;
+
+            if ( !task_state )
+                state = THREAD_STATE_Runnable;
+            else if ( task_state & TASK_UNINTERRUPTIBLE )
+                state = THREAD_STATE_Uninterruptible;
+
+            add_run( event.pid, event, state );
+            add_run( next_pid, event, THREAD_STATE_Running );
+        }
+        else
+        {
+            // sched_waking comes before sched_wakeup, so first one marks us runnable
+            int pid = atoi( get_event_field_val( event, "pid", "0" ) );
+            thread_states_t *pstates = m_thread_states.get_val( pid );
+
+            if ( !pstates ||
+                 ( ( pstates->runs.back().state != THREAD_STATE_Running ) &&
+                   ( pstates->runs.back().state != THREAD_STATE_Runnable ) ) )
+            {
+                add_run( pid, event, THREAD_STATE_Runnable );
+            }
+        }
+    }
+
+    // Store state totals every s_checkpoint runs
+    for ( auto &it : m_thread_states.m_map )
+    {
+        thread_states_t &states = it.second;
+        const std::vector< thread_state_run_t > &runs = states.runs;
+        std::array< int64_t, THREAD_STATE_Max > times;
+
+        times.fill( 0 );
+        states.totals.reserve( runs.size() / thread_states_t::s_checkpoint + 1 );
+
+        for ( size_t i = 0; i < runs.size(); i++ )
+        {
+            if ( !( i % thread_states_t::s_checkpoint ) )
+                states.totals.push_back( times );
+
+            if ( i + 1 < runs.size() )
+                times[ runs[ i ].state ] += runs[ i + 1 ].ts - runs[ i ].ts;
+        }
+    }
+}
+
+void TraceEvents::calculate_irq_intervals()
+{
+    static const char *s_names[] =
+    {
+        "irq_handler_entry", "irq_handler_exit", "softirq_entry", "softirq_exit"
+    };
+    std::vector< uint32_t > locs;
+
+    for ( const char *name : s_names )
+    {
+        const std::vector< uint32_t > *plocs = m_eventnames_locs.get_locations_str( name );
+
+        if ( plocs )
+            locs.insert( locs.end(), plocs->begin(), plocs->end() );
+    }
+
+    if ( locs.empty() )
+        return;
+
+    std::sort( locs.begin(), locs.end() );
+
+    // Stack of open handlers per cpu
+    std::vector< std::vector< irq_interval_t > > open( m_trace_info.cpus );
+
+    m_irq_intervals.resize( m_trace_info.cpus );
+
+    for ( uint32_t id : locs )
+    {
+        const trace_event_t &event = m_events[ id ];
+
+        if ( event.cpu >= m_trace_info.cpus )
+            continue;
+
+        std::vector< irq_interval_t > &stack = open[ event.cpu ];
+        bool softirq = ( event.name[ 0 ] == 's' );
+        uint32_t irq = atoi( get_event_field_val( event, softirq ? "vec" : "irq", "0" ) );
+
+        if ( strstr( event.name, "_entry" ) )
+        {
+            irq_interval_t interval;
+
+            interval.ts0 = event.ts;
+            interval.ts1 = event.ts;
+            interval.entry_eventid = event.id;
+            interval.irq = irq;
+            interval.softirq = softirq;
+            interval.depth = std::min< size_t >( stack.size(), UINT8_MAX );
+
+            stack.push_back( interval );
+
+            if ( !softirq && !m_irq_names.get_val( irq ) )
+            {
+                const char *name = get_event_field_val( event, "name", NULL );
+
+                if ( name )
+                    m_irq_names.m_map[ irq ] = m_strpool.getstr( name );
+            }
+        }
+        else
+        {
+            // Find matching entry. Anything above it lost its exit event.
+            for ( size_t i = stack.size(); i > 0; i-- )
+            {
+                irq_interval_t &interval = stack[ i - 1 ];
+
+                if ( ( interval.irq == irq ) && ( interval.softirq == softirq ) )
+                {
+                    interval.ts1 = event.ts;
+                    m_irq_intervals[ event.cpu ].push_back( interval );
+
+                    stack.resize( i - 1 );
+                    break;
+                }
+            }
+        }
+    }
+
+    // Intervals were added on exit, so nested handlers come before outer ones
+    for ( std::vector< irq_interval_t > &intervals : m_irq_intervals )
+    {
+        std::sort( intervals.begin(), intervals.end(),
+                   []( const irq_interval_t &lx, const irq_interval_t &rx )
+                   {
+                       return ( lx.ts0 < rx.ts0 ) || ( ( lx.ts0 == rx.ts0 ) && ( lx.depth < rx.depth ) );
+                   } );
+    }
+}
+
+size_t TraceEvents::get_irq_interval_idx( uint32_t cpu, int64_t ts )
+{
+    const std::vector< irq_interval_t > &intervals = m_irq_intervals[ cpu ];
+    size_t idx = std::lower_bound( intervals.begin(), intervals.end(), ts,
+                                   []( const irq_interval_t &interval, int64_t val ) { return interval.ts0 < val; } ) -
+                 intervals.begin();
+
+    // Back up to handlers which started before ts and are still running. Outermost
+    //  handlers don't overlap, so stop at first one which ended before ts.
+    while ( idx > 0 )
+    {
+        const irq_interval_t &interval = intervals[ idx - 1 ];
+
+        if ( !interval.depth && ( interval.ts1 <= ts ) )
+            break;
+        idx--;
+    }
+
+    return idx;
+}
+
+int64_t TraceEvents::get_irq_stats( uint32_t cpu, int64_t ts0, int64_t ts1,
+                                    util_umap< uint32_t, irq_stats_t > &stats )
+{
+    int64_t total = 0;
+
+    if ( cpu >= m_irq_intervals.size() )
+        return 0;
+
+    const std::vector< irq_interval_t > &intervals = m_irq_intervals[ cpu ];
+
+    for ( size_t idx = get_irq_interval_idx( cpu, ts0 );
+          ( idx < intervals.size() ) && ( intervals[ idx ].ts0 < ts1 );
+          idx++ )
+    {
+        const irq_interval_t &interval = intervals[ idx ];
+        int64_t duration = std::min< int64_t >( interval.ts1, ts1 ) - std::max< int64_t >( interval.ts0, ts0 );
+
+        if ( duration <= 0 )
+            continue;
+
+        irq_stats_t *pstats = stats.get_val_create( interval.key() );
+
+        pstats->count++;
+        pstats->total_ts += duration;
+        pstats->max_ts = std::max< int64_t >( pstats->max_ts, duration );
+
+        if ( !interval.depth )
+            total += duration;
+    }
+
+    return total;
+}
+
+std::string TraceEvents::get_irq_name( uint32_t key )
+{
+    static const char *s_softirq_names[] =
+    {
+        "HI", "TIMER", "NET_TX", "NET_RX", "BLOCK", "IRQ_POLL", "TASKLET", "SCHED", "HRTIMER", "RCU"
+    };
+    uint32_t irq = key & 0xffff;
+
+    if ( key >> 16 )
+    {
+        if ( irq < ARRAY_SIZE( s_softirq_names ) )
+            return string_format( "%s (softirq)", s_softirq_names[ irq ] );
+        return string_format( "softirq %u", irq );
+    }
+
+    const char **name = m_irq_names.get_val( irq );
+
+    if ( name )
+        return string_format( "%s (irq %u)", *name, irq );
+    return string_format( "irq %u", irq );
+}
+
+void TraceEvents::get_cpu_step_times( const std::vector< cpu_step_t > &steps, int64_t ts0, int64_t ts1,
+                                      util_umap< uint32_t, int64_t > &times )
+{
+    int64_t end_ts = m_events.back().ts;
+    auto it = std::upper_bound( steps.begin(), steps.end(), ts0,
+                                []( int64_t val, const cpu_step_t &step ) { return val < step.ts; } );
+
+    // Start at step active at ts0
+    if ( it != steps.begin() )
+        it--;
+
+    for ( ; ( it != steps.end() ) && ( it->ts < ts1 ); it++ )
+    {
+        int64_t step_ts1 = ( it + 1 != steps.end() ) ? ( it + 1 )->ts : end_ts;
+        int64_t duration = std::min< int64_t >( step_ts1, ts1 ) - std::max< int64_t >( it->ts, ts0 );
+
+        if ( duration > 0 )
+            *times.get_val( it->val, 0 ) += duration;
+    }
+}
+
+uint32_t TraceEvents::get_cpu_freq_avg( uint32_t cpu, int64_t ts0, int64_t ts1 )
+{
+    double total = 0.0;
+    int64_t total_ts = 0;
+    util_umap< uint32_t, int64_t > times;
+
+    if ( cpu >= m_cpu_freq.size() )
+        return 0;
+
+    get_cpu_step_times( m_cpu_freq[ cpu ], ts0, ts1, times );
+
+    for ( const auto &it : times.m_map )
+    {
+        total += ( double )it.first * it.second;
+        total_ts += it.second;
+    }
+
+    return total_ts ? ( uint32_t )( total / total_ts ) : 0;
+}
+
+// Get function name from workqueue "function" field: "0xffffffff8112d0a0 (vmstat_update)"
+static const char *get_work_function( StrPool &strpool, const trace_event_t &event )
+{
+    const char *function = get_event_field_val( event, "function", NULL );
+
+    if ( function )
+    {
+        const char *name = strchr( function, '(' );
+
+        if ( name )
+            return strpool.getstr( name + 1, strcspn( name + 1, ")" ) );
+        return function;
+    }
+
+    return "unknown";
+}
+
+void TraceEvents::calculate_workqueue()
+{
+    static const char *s_names[] =
+    {
+        "workqueue_queue_work", "workqueue_activate_work",
+        "workqueue_execute_start", "workqueue_execute_end"
+    };
+    std::vector< uint32_t > locs;
+
+    for ( const char *name : s_names )
+    {
+        const std::vector< uint32_t > *plocs = m_eventnames_locs.get_locations_str( name );
+
+        if ( plocs )
+            locs.insert( locs.end(), plocs->begin(), plocs->end() );
+    }
+
+    if ( locs.empty() )
+        return;
+
+    std::sort( locs.begin(), locs.end() );
+
+    // Queued work key'd on work struct address
+    util_umap< uint64_t, work_item_t > queued;
+    // Executing work key'd on kworker pid
+    util_umap< int, work_item_t > executing;
+
+    for ( uint32_t id : locs )
+    {
+        const trace_event_t &event = m_events[ id ];
+        uint64_t work = strtoull( get_event_field_val( event, "work", "0" ), NULL, 16 );
+        const char *name = event.name + 10;
+
+        if ( !strcmp( name, "queue_work" ) )
+        {
+            work_item_t *item = queued.get_val_create( work );
+
+            item->queue_ts = event.ts;
+            item->activate_ts = event.ts;
+            item->queue_pid = event.pid;
+            item->queue_cpu = event.cpu;
+        }
+        else if ( !strcmp( name, "activate_work" ) )
+        {
+            work_item_t *item = queued.get_val( work );
+
+            if ( item )
+                item->activate_ts = event.ts;
+        }
+        else if ( !strcmp( name, "execute_start" ) )
+        {
+            work_item_t *item = executing.get_val_create( event.pid );
+            work_item_t *queued_item = queued.get_val( work );
+
+            if ( queued_item )
+            {
+                *item = *queued_item;
+                queued.m_map.erase( work );
+            }
+            else
+            {
+                item->queue_ts = event.ts;
+                item->activate_ts = event.ts;
+                item->queue_pid = -1;
+                item->queue_cpu = -1;
+            }
+
+            item->start_ts = event.ts;
+            item->start_eventid = event.id;
+            item->function = get_work_function( m_strpool, event );
+            item->exec_pid = event.pid;
+        }
+        else if ( !strcmp( name, "execute_end" ) )
+        {
+            work_item_t *item = executing.get_val( event.pid );
+
+            if ( !item )
+                continue;
+
+            uint32_t idx = m_workqueue.items.size();
+            const char *row_name = m_strpool.getstrf( "work %s", item->function );
+            uint32_t hashval = hashstr32( row_name );
+            work_stats_t *stats = m_workqueue.func_stats.get_val_create( hashval );
+            int64_t exec_ts = event.ts - item->start_ts;
+
+            item->end_ts = event.ts;
+            item->end_eventid = event.id;
+
+            m_workqueue.items.push_back( *item );
+            m_workqueue.item_locs.m_map[ event.id ] = idx;
+            m_workqueue.pid_items.get_val_create( event.pid )->push_back( idx );
+            m_workqueue.func_locs.add_location_u32( hashval, event.id );
+
+            stats->count++;
+            stats->exec_total += exec_ts;
+            stats->exec_max = std::max< int64_t >( stats->exec_max, exec_ts );
+
+            if ( item->queue_pid >= 0 )
+            {
+                int64_t latency = item->start_ts - item->queue_ts;
+
+                stats->latency_count++;
+                stats->latency_total += latency;
+                stats->latency_max = std::max< int64_t >( stats->latency_max, latency );
+            }
+
+            executing.m_map.erase( event.pid );
+        }
+    }
+
+    float label_sat = s_clrs().getalpha( col_Graph_TimelineLabelSat );
+    float label_alpha = s_clrs().getalpha( col_Graph_TimelineLabelAlpha );
+
+    // Lay out queued + executing bars in "work %s" rows
+    for ( auto &func_locs : m_workqueue.func_locs.m_locs.m_map )
+    {
+        row_pos_t row_pos;
+
+        for ( uint32_t id : func_locs.second )
+        {
+            trace_event_t &event = m_events[ id ];
+            const work_item_t *item = get_work_item( id );
+
+            event.id_start = item->start_eventid;
+            event.duration = item->end_ts - item->start_ts;
+            event.graph_row_id = row_pos.get_row( item->queue_ts, item->end_ts );
+
+            // Color by whoever queued the work
+            if ( item->queue_pid >= 0 )
+            {
+                event.user_comm = comm_from_pid( item->queue_pid );
+
+                if ( event.user_comm )
+                {
+                    event.flags |= TRACE_FLAG_AUTOGEN_COLOR;
+                    event.color = imgui_col_from_hashval( hashstr32( event.user_comm ), label_sat, label_alpha );
+                }
+            }
+        }
+
+        m_row_count.m_map[ func_locs.first ] = row_pos.m_rows;
+    }
+}
+
+const work_item_t *TraceEvents::get_work_item( uint32_t end_eventid )
+{
+    uint32_t *idx = m_workqueue.item_locs.get_val( end_eventid );
+
+    return idx ? &m_workqueue.items[ *idx ] : NULL;
+}
+
+void TraceEvents::get_work_items( int pid, int64_t ts0, int64_t ts1, std::vector< const work_item_t * > &items )
+{
+    const std::vector< uint32_t > *pitems = m_workqueue.pid_items.get_val( pid );
+
+    if ( !pitems )
+        return;
+
+    // Items for a kworker don't overlap, so they're sorted by both start and end
+    auto it = std::upper_bound( pitems->begin(), pitems->end(), ts0,
+                                [this]( int64_t val, uint32_t idx ) { return val < m_workqueue.items[ idx ].end_ts; } );
+
+    for ( ; ( it != pitems->end() ) && ( m_workqueue.items[ *it ].start_ts < ts1 ); it++ )
+        items.push_back( &m_workqueue.items[ *it ] );
+}
+
+// Return "block %u,%u" row name hashval for block_rq_* event, or 0
+static uint32_t get_block_dev_hashval( StrPool &strpool, const trace_event_t &event )
+{
+    const char *devstr = get_event_field_val( event, "dev", NULL );
+    uint32_t major = 0;
+    uint32_t minor = 0;
+
+    if ( !devstr )
+        return 0;
+
+    if ( strchr( devstr, ',' ) )
+    {
+        // Text captures: "dev=8,0"
+        if ( sscanf( devstr, "%u,%u", &major, &minor ) != 2 )
+            return 0;
+    }
+    else
+    {
+        // trace.dat dev_t: MKDEV( major, minor )
+        uint64_t dev = strtoull( devstr, NULL, 0 );
+
+        major = dev >> 20;
+        minor = dev & 0xfffff;
+    }
+
+    return strpool.getu32f( "block %u,%u", major, minor );
+}
+
+/*
+  block_rq_insert     dev=8,0 rwbs=WS bytes=4096 sector=1234 nr_sector=8 comm=app
+  block_rq_issue      dev=8,0 rwbs=WS bytes=4096 sector=1234 nr_sector=8 comm=kworker
+  block_rq_complete   dev=8,0 rwbs=WS sector=1234 nr_sector=8 error=0
+
+  Requests are matched on device and sector. blk-mq requests can go straight to
+  issue without an insert, in which case insert ts is the issue ts.
+ */
+void TraceEvents::init_block_rq_event( trace_event_t &event )
+{
+    const char *type = event.name + 9;
+    bool insert = !strcmp( type, "insert" );
+    bool issue = !strcmp( type, "issue" );
+    bool requeue = !strcmp( type, "requeue" );
+    bool complete = !strcmp( type, "complete" );
+
+    if ( !insert && !issue && !requeue && !complete )
+        return;
+
+    const char *sectorstr = get_event_field_val( event, "sector", NULL );
+    uint32_t hashval = sectorstr ? get_block_dev_hashval( m_strpool, event ) : 0;
+
+    if ( !hashval )
+        return;
+
+    uint64_t sector = strtoull( sectorstr, NULL, 10 );
+    block_dev_t *dev = m_block_devs.get_val_create( hashval );
+    block_rq_t *rq = dev->pending.get_val( sector );
+    uint32_t depth = dev->depth.empty() ? 0 : dev->depth.back().depth;
+
+    auto set_depth = [dev, &event]( uint32_t val )
+    {
+        if ( !dev->depth.empty() && ( dev->depth.back().ts == event.ts ) )
+            dev->depth.back().depth = val;
+        else
+            dev->depth.push_back( { event.ts, val } );
+
+        dev->depth_max = std::max< uint32_t >( dev->depth_max, val );
+    };
+
+    if ( !dev->name )
+        dev->name = m_strpool.findstr( hashval );
+
+    if ( insert || ( issue && !rq ) )
+    {
+        rq = dev->pending.get_val_create( sector );
+
+        rq->insert_ts = event.ts;
+        rq->issue_ts = INT64_MAX;
+        rq->sector = sector;
+    }
+
+    if ( !rq )
+        return;
+
+    if ( issue )
+    {
+        if ( rq->issue_ts == INT64_MAX )
+            set_depth( depth + 1 );
+
+        rq->issue_ts = event.ts;
+    }
+    else if ( requeue )
+    {
+        // Back on the queue. It'll be issued again.
+        if ( rq->issue_ts != INT64_MAX )
+            set_depth( depth ? depth - 1 : 0 );
+
+        rq->issue_ts = INT64_MAX;
+        return;
+    }
+
+    if ( insert || issue )
+    {
+        rq->nr_sector = strtoul( get_event_field_val( event, "nr_sector", "0" ), NULL, 10 );
+        rq->pid = event.pid;
+        rq->rwbs = get_event_field_val( event, "rwbs" );
+        return;
+    }
+
+    // Completed
+    if ( rq->issue_ts == INT64_MAX )
+        rq->issue_ts = rq->insert_ts;
+    else
+        set_depth( depth ? depth - 1 : 0 );
+
+    rq->complete_ts = event.ts;
+
+    event.duration = rq->complete_ts - rq->issue_ts;
+    dev->duration_max = std::max< int64_t >( dev->duration_max, rq->complete_ts - rq->insert_ts );
+
+    // First graph row that's free when this request was inserted
+    size_t row = 0;
+
+    while ( ( row < dev->row_end_ts.size() ) && ( dev->row_end_ts[ row ] > rq->insert_ts ) )
+        row++;
+
+    if ( row == dev->row_end_ts.size() )
+    {
+        if ( row < Opts::MAX_ROW_SIZE )
+            dev->row_end_ts.push_back( 0 );
+        else
+            row = event.id % Opts::MAX_ROW_SIZE;
+    }
+
+    dev->row_end_ts[ row ] = std::max< int64_t >( dev->row_end_ts[ row ], rq->complete_ts );
+    event.graph_row_id = row;
+
+    dev->locs.push_back( event.id );
+    dev->requests.push_back( *rq );
+    dev->pending.m_map.erase( sector );
+}
+
+void TraceEvents::calculate_block_devs()
+{
+    for ( auto it = m_block_devs.m_map.begin(); it != m_block_devs.m_map.end(); )
+    {
+        block_dev_t &dev = it->second;
+
+        // Requests which never completed are dropped
+        dev.pending.m_map.clear();
+
+        if ( dev.locs.empty() )
+        {
+            it = m_block_devs.m_map.erase( it );
+            continue;
+        }
+
+        m_row_count.m_map[ it->first ] = dev.row_end_ts.size();
+
+        dev.row_end_ts.clear();
+        dev.row_end_ts.shrink_to_fit();
+        ++it;
+    }
+}
+
+bool TraceEvents::get_block_stats( const char *row_name, int64_t ts0, int64_t ts1, block_stats_t &stats )
+{
+    const block_dev_t *dev = m_block_devs.get_val( hashstr32( row_name ) );
+
+    if ( !dev )
+        return false;
+
+    const std::vector< block_rq_t > &requests = dev->requests;
+    auto cmp_lower = []( const block_rq_t &rq, int64_t ts ) { return rq.complete_ts < ts; };
+    auto it0 = std::lower_bound( requests.begin(), requests.end(), ts0, cmp_lower );
+    auto it1 = std::lower_bound( it0, requests.end(), ts1, cmp_lower );
+    std::vector< int64_t > latencies;
+    int64_t queued_total = 0;
+
+    latencies.reserve( it1 - it0 );
+
+    for ( auto it = it0; it != it1; it++ )
+    {
+        latencies.push_back( it->complete_ts - it->issue_ts );
+
+        queued_total += it->issue_ts - it->insert_ts;
+        stats.bytes += ( uint64_t )it->nr_sector * 512;
+    }
+
+    stats.count = latencies.size();
+    if ( !stats.count )
+        return true;
+
+    stats.queued_avg = queued_total / stats.count;
+
+    // Partition for percentiles in increasing order so each nth_element only
+    //  looks at the part above the previous one.
+    auto percentile = [&latencies]( size_t start, uint32_t pct )
+    {
+        size_t n = std::min< size_t >( latencies.size() - 1, latencies.size() * pct / 100 );
+
+        std::nth_element( latencies.begin() + start, latencies.begin() + n, latencies.end() );
+        return n;
+    };
+    size_t n50 = percentile( 0, 50 );
+    size_t n90 = percentile( n50, 90 );
+    size_t n99 = percentile( n90, 99 );
+
+    stats.p50 = latencies[ n50 ];
+    stats.p90 = latencies[ n90 ];
+    stats.p99 = latencies[ n99 ];
+    stats.max = *std::max_element( latencies.begin() + n99, latencies.end() );
+    return true;
+}
+
+const block_rq_t *TraceEvents::get_block_rq( const trace_event_t &event )
+{
+    if ( strcmp( event.name, "block_rq_complete" ) )
+        return NULL;
+
+    const block_dev_t *dev = m_block_devs.get_val( get_block_dev_hashval( m_strpool, event ) );
+
+    if ( dev )
+    {
+        size_t idx = vec_find_eventid( dev->locs, event.id );
+
+        if ( ( idx < dev->locs.size() ) && ( dev->locs[ idx ] == event.id ) )
+            return &dev->requests[ idx ];
+    }
+
+    return NULL;
+}
+
+// Live gpu memory allocs are snapshotted every s_gpu_mem_snapshot allocs
+static const size_t s_gpu_mem_snapshot = 65536;
+
+// Filter string for events which change the gpu memory ledger
+static const char s_gpu_mem_filter[] =
+    "$name=amdgpu_bo_create || $name=amdgpu_bo_move || "
+    "$name=i915_gem_object_create || $name=i915_gem_object_destroy";
+
+const char *TraceEvents::gpu_mem_domain_str( uint32_t domain )
+{
+    switch ( domain )
+    {
+    case GPU_MEM_VRAM:   return "VRAM";
+    case GPU_MEM_GTT:    return "GTT";
+    case GPU_MEM_System: return "System";
+    }
+
+    return "All";
+}
+
+/*
+  amdgpu_bo_create          bo=0xffff8f3a1c2d4000, pages=256, type=0, preferred=4, allowed=6, visible=1
+  amdgpu_bo_move            bo=0xffff8f3a1c2d4000, from=2, to=1, size=1048576
+  i915_gem_object_create    obj=0xffff8f3a1c2d4000, size=0x100000
+  i915_gem_object_destroy   obj=0xffff8f3a1c2d4000
+
+  amdgpu has no bo free tracepoint, so a bo is considered freed when its
+  handle shows up in a new amdgpu_bo_create. Bos created before the trace
+  started are picked up from their first move. i915 objects are accounted
+  as system memory. amdgpu_vm_bo_* events map bos into gpu address spaces
+  and don't change residency, so they aren't part of the ledger.
+ */
+void TraceEvents::init_gpu_mem_event( trace_event_t &event )
+{
+    static const uint32_t s_ttm_domains[] = { GPU_MEM_System, GPU_MEM_GTT, GPU_MEM_VRAM };
+    bool amdgpu = ( event.name[ 0 ] == 'a' );
+    const char *type = amdgpu ? event.name + 10 : event.name + 16;
+    uint64_t handle = strtoull( get_event_field_val( event, amdgpu ? "bo" : "obj", "0" ), NULL, 16 );
+    uint64_t size = 0;
+    uint32_t domain = GPU_MEM_Max;
+
+    if ( !handle )
+        return;
+
+    if ( !strcmp( type, "create" ) )
+    {
+        if ( amdgpu )
+        {
+            // AMDGPU_GEM_DOMAIN_CPU 0x1, GTT 0x2, VRAM 0x4
+            uint32_t prefer = strtoul( get_event_field_val( event, "prefer", "0" ), NULL, 0 );
+
+            if ( !prefer )
+                prefer = strtoul( get_event_field_val( event, "allow", "0" ), NULL, 0 );
+
+            domain = ( prefer & 0x4 ) ? GPU_MEM_VRAM : ( prefer & 0x2 ) ? GPU_MEM_GTT : GPU_MEM_System;
+            size = strtoull( get_event_field_val( event, "pages", "0" ), NULL, 0 ) * 4096;
+        }
+        else
+        {
+            domain = GPU_MEM_System;
+            size = strtoull( get_event_field_val( event, "size", "0" ), NULL, 0 );
+        }
+    }
+    else if ( amdgpu && !strcmp( type, "move" ) )
+    {
+        // TTM_PL_SYSTEM 0, TTM_PL_TT 1, TTM_PL_VRAM 2. Other placements (GDS, etc.) aren't tracked.
+        uint32_t from = strtoul( get_event_field_val( event, "old_placement", "0" ), NULL, 0 );
+        uint32_t to = strtoul( get_event_field_val( event, "new_placement", "0" ), NULL, 0 );
+
+        if ( to >= ARRAY_SIZE( s_ttm_domains ) )
+            return;
+
+        domain = s_ttm_domains[ to ];
+        size = strtoull( get_event_field_val( event, "bo_size", "0" ), NULL, 0 );
+
+        if ( ( from == 2 ) && ( domain != GPU_MEM_VRAM ) )
+            m_gpu_mem.evictions.push_back( { event.id, size } );
+    }
+    else if ( amdgpu || strcmp( type, "destroy" ) )
+    {
+        return;
+    }
+
+    // Close current residency for this handle
+    uint32_t *pidx = m_gpu_mem.live.get_val( handle );
+    std::vector< uint32_t > changed;
+
+    if ( pidx )
+    {
+        gpu_mem_alloc_t &alloc = m_gpu_mem.allocs[ *pidx ];
+
+        alloc.ts1 = event.ts;
+        m_gpu_mem.live_bytes[ alloc.domain ] -= alloc.size;
+        changed.push_back( alloc.domain );
+
+        // Moves can leave size out on older kernels
+        if ( !size )
+            size = alloc.size;
+
+        m_gpu_mem.live.m_map.erase( handle );
+    }
+
+    if ( domain < GPU_MEM_Max )
+    {
+        m_gpu_mem.live.m_map[ handle ] = m_gpu_mem.allocs.size();
+        m_gpu_mem.allocs.push_back( { event.ts, INT64_MAX, size, event.id, domain } );
+        m_gpu_mem.live_bytes[ domain ] += size;
+        changed.push_back( domain );
+    }
+
+    for ( uint32_t d : changed )
+    {
+        std::string name = string_format( "plot:gpumem %s MB", gpu_mem_domain_str( d ) );
+        GraphPlot &plot = get_plot( name.c_str() );
+        float valf = m_gpu_mem.live_bytes[ d ] / ( 1024.0f * 1024.0f );
+
+        if ( plot.m_name.empty() )
+        {
+            plot.m_name = name;
+            plot.m_filter_str = s_gpu_mem_filter;
+            m_gpu_mem.plots.push_back( { name, d } );
+        }
+
+        plot.m_minval = std::min< float >( plot.m_minval, valf );
+        plot.m_maxval = std::max< float >( plot.m_maxval, valf );
+        plot.m_plotdata.push_back( { event.ts, event.id, valf } );
+    }
+
+    m_tdopexpr_locs.add_location_str( s_gpu_mem_filter, event.id );
+}
+
+void TraceEvents::calculate_gpu_mem()
+{
+    std::vector< gpu_mem_alloc_t > &allocs = m_gpu_mem.allocs;
 
-        // context-complete-delay (user interrupt to context complete): engine_notify -> req_out
-        set_duration |= intel_set_duration( events[ i915_req_Notify ], events[ i915_req_Out ], col_Graph_Bari915CtxCompleteDelay );
+    m_gpu_mem.live.m_map.clear();
 
-        // If we didn't get an intel_engine_notify event, do req_in -> req_out
-        set_duration |= intel_set_duration( events[ i915_req_In ], events[ i915_req_Out ], col_Graph_Bari915Execute );
+    if ( allocs.empty() )
+        return;
 
-        if ( set_duration )
-        {
-            char buf[ 64 ];
-            uint32_t hashval;
-            int pid = events[ i915_req_Queue ] ? events[ i915_req_Queue ]->pid : 0;
+    // Live sets for fast "what's allocated at ts" queries
+    std::vector< uint32_t > live;
 
-            if ( ringno_is_class_instance )
-                hashval = m_strpool.getu32f( "i915_req %s%u", get_i915_engine_str( buf, ringno ), ringno >> 4 );
-            else
-                hashval = m_strpool.getu32f( "i915_req ring%u", ringno );
+    m_gpu_mem.snapshots.push_back( live );
 
-            for ( uint32_t i = 0; i < i915_req_Max; i++ )
-            {
-                if ( events[ i ] )
-                {
-                    // Switch the kernel pids in this group to match the i915_request_queue event (ioctl from user space).
-                    if ( pid && !events[ i ]->pid )
-                        events[ i ]->pid = pid;
+    for ( size_t i = s_gpu_mem_snapshot; i < allocs.size(); i += s_gpu_mem_snapshot )
+    {
+        int64_t ts = allocs[ i ].ts0;
+        std::vector< uint32_t > next;
 
-                    events[ i ]->graph_row_id = ( uint32_t )-1;
-                    m_i915.req_locs.add_location_u32( hashval, events[ i ]->id );
-                }
-            }
+        for ( uint32_t idx : live )
+        {
+            if ( allocs[ idx ].ts1 > ts )
+                next.push_back( idx );
+        }
+        for ( size_t idx = i - s_gpu_mem_snapshot; idx < i; idx++ )
+        {
+            if ( allocs[ idx ].ts1 > ts )
+                next.push_back( idx );
         }
+
+        live.swap( next );
+        m_gpu_mem.snapshots.push_back( live );
     }
 
-    // Sort the events in the ring maps
-    for ( auto &req_locs : m_i915.req_locs.m_locs.m_map )
+    // VRAM eviction rate plot
+    if ( !m_gpu_mem.evictions.empty() )
     {
-        row_pos_t row_pos;
-        std::vector< uint32_t > &locs = req_locs.second;
-        // const char *name = m_strpool.findstr( req_locs.first );
-
-        std::sort( locs.begin(), locs.end() );
+        const char *name = "plot:gpumem VRAM evictions MB/s";
+        GraphPlot &plot = get_plot( name );
+        int64_t min_ts = m_events.front().ts;
+        int64_t max_ts = m_events.back().ts;
+        int64_t bin_ts = std::max< int64_t >( NSECS_PER_MSEC, ( max_ts - min_ts ) / 4096 + 1 );
+        size_t bins = ( max_ts - min_ts ) / bin_ts + 1;
+        std::vector< uint64_t > bytes( bins, 0 );
+        std::vector< uint32_t > eventids( bins, INVALID_ID );
+        uint32_t eventid = m_gpu_mem.evictions.front().first;
+        double scale = ( double )NSECS_PER_SEC / bin_ts / ( 1024.0 * 1024.0 );
 
-        for ( uint32_t idx : locs )
+        for ( const auto &eviction : m_gpu_mem.evictions )
         {
-            if ( m_events[ idx ].graph_row_id != ( uint32_t )-1 )
-                continue;
+            size_t bin = ( m_events[ eviction.first ].ts - min_ts ) / bin_ts;
 
-            trace_event_t &event = m_events[ idx ];
-            const std::vector< uint32_t > *plocs;
-            const trace_event_t *pevent = !strcmp( event.name, "intel_engine_notify" ) ?
-                        &m_events[ event.id_start ] : &event;
+            bytes[ bin ] += eviction.second;
+            if ( !is_valid_id( eventids[ bin ] ) )
+                eventids[ bin ] = eviction.first;
+        }
 
-            plocs = m_i915.gem_req_locs.get_locations( *pevent );
-            if ( plocs )
-            {
-                int64_t min_ts = m_events[ plocs->front() ].ts;
-                int64_t max_ts = m_events[ plocs->back() ].ts;
-                uint32_t row = row_pos.get_row( min_ts, max_ts );
+        plot.m_name = name;
+        plot.m_filter_str = "$name=amdgpu_bo_move";
+        plot.m_plotdata.reserve( bins );
 
-                for ( uint32_t i : *plocs )
-                    m_events[ i ].graph_row_id = row;
-            }
+        for ( size_t bin = 0; bin < bins; bin++ )
+        {
+            float valf = bytes[ bin ] * scale;
+
+            // Bins without evictions point at the previous eviction event
+            if ( is_valid_id( eventids[ bin ] ) )
+                eventid = eventids[ bin ];
+
+            plot.m_minval = std::min< float >( plot.m_minval, valf );
+            plot.m_maxval = std::max< float >( plot.m_maxval, valf );
+            plot.m_plotdata.push_back( { min_ts + ( int64_t )bin * bin_ts, eventid, valf } );
         }
 
-        m_row_count.m_map[ req_locs.first ] = row_pos.m_rows;
+        m_gpu_mem.plots.push_back( { name, GPU_MEM_VRAM } );
     }
 }
 
+void TraceEvents::get_gpu_mem_live( int64_t ts, uint32_t domain, size_t count,
+                                    std::vector< const gpu_mem_alloc_t * > &live )
+{
+    const std::vector< gpu_mem_alloc_t > &allocs = m_gpu_mem.allocs;
+    size_t idx = std::upper_bound( allocs.begin(), allocs.end(), ts,
+                                   []( int64_t val, const gpu_mem_alloc_t &alloc ) { return val < alloc.ts0; } ) -
+                 allocs.begin();
+
+    if ( !idx )
+        return;
+
+    // Start with live set from snapshot before ts, then add allocs up to ts
+    size_t snapshot = ( idx - 1 ) / s_gpu_mem_snapshot;
+    auto add_alloc = [&]( uint32_t i )
+    {
+        const gpu_mem_alloc_t &alloc = allocs[ i ];
+
+        if ( ( alloc.ts1 > ts ) && ( ( domain == GPU_MEM_Max ) || ( alloc.domain == domain ) ) )
+            live.push_back( &alloc );
+    };
+
+    for ( uint32_t i : m_gpu_mem.snapshots[ snapshot ] )
+        add_alloc( i );
+    for ( size_t i = snapshot * s_gpu_mem_snapshot; i < idx; i++ )
+        add_alloc( i );
+
+    count = std::min< size_t >( count, live.size() );
+    std::partial_sort( live.begin(), live.begin() + count, live.end(),
+                       []( const gpu_mem_alloc_t *lx, const gpu_mem_alloc_t *rx ) { return lx->size > rx->size; } );
+    live.resize( count );
+}
+
 const std::vector< uint32_t > *TraceEvents::get_locs( const char *name,
         loc_type_t *ptype, std::string *errstr )
 {
@@ -2579,6 +4220,23 @@ const std::vector< uint32_t > *TraceEvents::get_locs( const char *name,
         type = LOC_TYPE_i915Request;
         plocs = m_i915.req_locs.get_locations_str( name );
     }
+    else if ( !strncmp( name, "fence ", 6 ) )
+    {
+        type = LOC_TYPE_DmaFence;
+        plocs = m_dma_fence.timeline_locs.get_locations_str( name );
+    }
+    else if ( !strncmp( name, "work ", 5 ) )
+    {
+        type = LOC_TYPE_Workqueue;
+        plocs = m_workqueue.func_locs.get_locations_str( name );
+    }
+    else if ( !strncmp( name, "block ", 6 ) )
+    {
+        block_dev_t *dev = m_block_devs.get_val( hashstr32( name ) );
+
+        type = LOC_TYPE_BlockDev;
+        plocs = dev ? &dev->locs : NULL;
+    }
     else if ( !strncmp( name, "plot:", 5 ) )
     {
         GraphPlot *plot = get_plot_ptr( name );
@@ -2743,15 +4401,23 @@ TraceWin::TraceWin( const char *filename, size_t filesize )
 
 TraceWin::~TraceWin()
 {
+    if ( m_loader.thread )
+    {
+        // Cancel any loading going on and wait for our thread to die.
+        SDL_AtomicSet( &m_trace_events.m_cancel_load, 1 );
+        SDL_WaitThread( m_loader.thread, NULL );
+        m_loader.thread = NULL;
+    }
+
     s_ini().PutStr( "event_filter_buf", m_filter.buf );
 
+    m_critical_path.shutdown();
+
     m_graph.rows.shutdown();
 
     m_frame_markers.shutdown();
     m_create_graph_row_dlg.shutdown();
     m_create_row_filter_dlg.shutdown();
-
-    s_opts().set_crtc_max( -1 );
 }
 
 void TraceWin::render()
@@ -2787,6 +4453,15 @@ void TraceWin::render()
 
                 m_eventlist.do_gotoevent = true;
                 m_eventlist.goto_eventid = ts_to_eventid( m_graph.start_ts + m_graph.length_ts / 2 );
+
+                // Offer inferred frame markers if we found a convincing one
+                if ( s_opts().getb( OPT_SuggestFrameMarkers ) &&
+                     m_frame_markers.m_left_frames.empty() &&
+                     !m_trace_events.m_frame_candidates.empty() &&
+                     ( m_trace_events.m_frame_candidates[ 0 ].confidence >= 0.5f ) )
+                {
+                    m_create_filter_eventid = m_trace_events.m_events.size();
+                }
             }
 
             if ( !s_opts().getb( OPT_ShowEventList ) ||
@@ -2814,6 +4489,10 @@ void TraceWin::render()
             // Render plot, graph rows, filter dialogs, etc
             graph_dialogs_render();
 
+            // Frame markers changed: recalculate critical paths in background
+            if ( m_critical_path.m_frames_gen != m_frame_markers.m_frames_gen )
+                m_critical_path.start( m_trace_events, m_frame_markers );
+
             m_inited = true;
         }
     }
@@ -2827,7 +4506,7 @@ void TraceWin::render()
         if ( ImGui::Button( "Cancel" ) ||
              ( ImGui::IsWindowFocused() && s_actions().get( action_escape ) ) )
         {
-            s_app().cancel_load_file();
+            SDL_AtomicSet( &m_trace_events.m_cancel_load, 1 );
         }
     }
     else
@@ -2858,6 +4537,77 @@ void TraceWin::trace_render_info()
     if ( !trace_info.uname.empty() )
         ImGui::Text( "Trace uname: %s", trace_info.uname.c_str() );
 
+    if ( !trace_info.clocks.empty() )
+        ImGui::Text( "Trace clock: %s", trace_info.clocks[ 0 ].trace_clock.c_str() );
+
+    {
+        size_t gaps = 0;
+        uint64_t missed = 0;
+        uint64_t bad_pages = 0;
+
+        for ( const cpu_info_t &cpu_info : trace_info.cpu_info )
+        {
+            gaps += cpu_info.missed_events.size();
+            missed += cpu_info.missed_events_count;
+            bad_pages += cpu_info.bad_pages;
+        }
+
+        if ( gaps )
+        {
+            ImGui::Text( "%sLost events: %" PRIu64 " in %lu gaps%s", s_textclrs().str( TClr_Bright ),
+                         missed, gaps, s_textclrs().str( TClr_Def ) );
+        }
+        if ( bad_pages )
+        {
+            ImGui::Text( "%sBad pages skipped: %" PRIu64 "%s", s_textclrs().str( TClr_Bright ),
+                         bad_pages, s_textclrs().str( TClr_Def ) );
+        }
+    }
+
+    if ( ( trace_info.clocks.size() > 1 ) &&
+         ImGui::CollapsingHeader( "Buffer Clocks" ) )
+    {
+        if ( imgui_begin_columns( "buffer_clocks", { "Buffer", "Clock", "Offset", "Drift (ppm)", "Sync Pairs" } ) )
+            ImGui::SetColumnWidth( 0, imgui_scale( 200.0f ) );
+
+        for ( size_t i = 1; i < trace_info.clocks.size(); i++ )
+        {
+            const trace_clock_info_t &clock = trace_info.clocks[ i ];
+
+            ImGui::Text( "%s", clock.buffer.c_str() );
+            ImGui::NextColumn();
+            ImGui::Text( "%s", clock.trace_clock.c_str() );
+            ImGui::NextColumn();
+            ImGui::Text( "%s", ts_to_timestr( clock.offset, 6 ).c_str() );
+            ImGui::NextColumn();
+            ImGui::Text( "%.3f", clock.drift * 1000000.0 );
+            ImGui::NextColumn();
+            ImGui::Text( "%u", clock.sync_pairs );
+            ImGui::NextColumn();
+        }
+
+        ImGui::EndColumns();
+    }
+
+    if ( !trace_info.load_filters.empty() &&
+         ImGui::CollapsingHeader( "Load Filters" ) )
+    {
+        if ( imgui_begin_columns( "load_filters", { "Filter", "Matched", "Dropped" } ) )
+            ImGui::SetColumnWidth( 0, imgui_scale( 350.0f ) );
+
+        for ( const load_filter_t &filter : trace_info.load_filters )
+        {
+            ImGui::Text( "%s", load_filter_str( filter ).c_str() );
+            ImGui::NextColumn();
+            ImGui::Text( "%" PRIu64, filter.matched );
+            ImGui::NextColumn();
+            ImGui::Text( "%" PRIu64, filter.dropped );
+            ImGui::NextColumn();
+        }
+
+        ImGui::EndColumns();
+    }
+
     if ( !m_graph.rows.m_graph_rows_list.empty() &&
          ImGui::CollapsingHeader( "Graph Row Info" ) )
     {
@@ -2953,6 +4703,106 @@ void TraceWin::trace_render_info()
         ImGui::EndColumns();
     }
 
+    if ( m_critical_path.is_running() )
+    {
+        ImGui::Text( "Calculating frame critical paths..." );
+    }
+    else if ( m_critical_path.is_ready() &&
+              !m_critical_path.m_frames.empty() &&
+              ImGui::CollapsingHeader( "Frame Critical Paths" ) )
+    {
+        const std::vector< CriticalPath::frame_t > &frames = m_critical_path.m_frames;
+
+        ImGui::Text( "%lu frames (%.2fms)", frames.size(), m_critical_path.m_time_ms );
+
+        if ( imgui_begin_columns( "critical_path", { "Frame", "Length", "Running", "Runnable",
+                                  "Blocked", "Fence Wakeup", "GPU Queued", "GPU Executing" } ) )
+        {
+            ImGui::SetColumnWidth( 0, imgui_scale( 75.0f ) );
+        }
+
+        ImGuiListClipper clipper( frames.size() );
+        while ( clipper.Step() )
+        {
+            for ( int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++ )
+            {
+                const CriticalPath::frame_t &frame = frames[ i ];
+                std::string label = string_format( "%d", i );
+
+                // Click on frame to go to it in the graph
+                if ( ImGui::Selectable( label.c_str(), false, ImGuiSelectableFlags_SpanAllColumns ) )
+                    frame_markers_goto( i, true );
+                ImGui::NextColumn();
+
+                ImGui::Text( "%s", ts_to_timestr( frame.ts1 - frame.ts0, 4 ).c_str() );
+                ImGui::NextColumn();
+
+                for ( uint32_t type = 0; type < CriticalPath::CPATH_Max; type++ )
+                {
+                    if ( frame.seg_ts[ type ] )
+                        ImGui::Text( "%s", ts_to_timestr( frame.seg_ts[ type ], 4 ).c_str() );
+                    ImGui::NextColumn();
+                }
+            }
+        }
+
+        ImGui::EndColumns();
+    }
+
+    anomalies_render_info();
+
+    stacks_render_info();
+
+    if ( ImGui::CollapsingHeader( "SQL Query" ) )
+    {
+        ImGui::InputTextMultiline( "##sql_query", m_sql_buf, sizeof( m_sql_buf ),
+                                   ImVec2( -1.0f, ImGui::GetTextLineHeight() * 4 ) );
+
+        if ( ImGui::Button( "Run Query" ) )
+        {
+            m_sql_errstr.clear();
+            m_sql.query( m_trace_events, m_sql_buf, m_sql_errstr );
+        }
+        ImGui::SameLine();
+        ImGui::TextDisabled( "Tables: events, fields, prints, sched_switch, gpu_jobs" );
+
+        if ( !m_sql_errstr.empty() )
+        {
+            ImGui::TextColored( ImVec4( 1, 0, 0, 1 ), "%s", m_sql_errstr.c_str() );
+        }
+        else if ( !m_sql.m_cols.empty() )
+        {
+            size_t cols = m_sql.m_cols.size();
+
+            ImGui::Text( "%lu rows%s (%.2fms)", m_sql.m_rows,
+                         m_sql.m_truncated ? " (truncated)" : "", m_sql.m_time_ms );
+
+            imgui_begin_columns( "sql_results", cols );
+
+            for ( const std::string &col : m_sql.m_cols )
+            {
+                ImGui::TextColored( s_clrs().getv4( col_BrightText ), "%s", col.c_str() );
+                ImGui::NextColumn();
+            }
+            ImGui::Separator();
+
+            ImGuiListClipper clipper( m_sql.m_vals.size() / cols );
+            while ( clipper.Step() )
+            {
+                for ( int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++ )
+                {
+                    for ( size_t col = 0; col < cols; col++ )
+                    {
+                        ImGui::Text( "%s", m_sql.m_vals[ i * cols + col ].c_str() );
+                        ImGui::NextColumn();
+                    }
+                }
+            }
+
+            ImGui::EndColumns();
+        }
+    }
+
     if ( ImGui::CollapsingHeader( "Event info" ) )
     {
         if ( imgui_begin_columns( "event_info", { "Event Name", "Count", "Pct" } ) )
@@ -3005,6 +4855,10 @@ void TraceWin::trace_render_info()
             if ( cpu_info.dropped_events )
                 ImGui::Text( "Dropped events: %" PRIu64, cpu_info.dropped_events );
             ImGui::Text( "Read events: %" PRIu64, cpu_info.read_events );
+            if ( !cpu_info.missed_events.empty() )
+                ImGui::Text( "Lost events: %" PRIu64 " (%lu gaps)", cpu_info.missed_events_count, cpu_info.missed_events.size() );
+            if ( cpu_info.bad_pages )
+                ImGui::Text( "Bad pages: %" PRIu64, cpu_info.bad_pages );
             //$ ImGui::Text( "file offset: %" PRIu64 "\n", cpu_info.file_offset );
             ImGui::EndGroup();
 
@@ -3022,7 +4876,9 @@ void TraceWin::trace_render_info()
                     "  Oldest event ts: The oldest timestamp in the buffer.",
                     "  Now ts: The current timestamp.",
                     "  Dropped events: Events lost due to overwrite option being off.",
-                    "  Read events: The number of events read."
+                    "  Read events: The number of events read.",
+                    "  Lost events: Events lost to ring buffer overruns, from page headers.",
+                    "  Bad pages: Corrupted pages skipped while loading."
                 };
                 const char *clr_bright = s_textclrs().str( TClr_Bright );
                 const char *clr_def = s_textclrs().str( TClr_Def );
@@ -3080,6 +4936,41 @@ void TraceWin::graph_center_event( uint32_t eventid )
     m_graph.show_row_name = event.comm;
 }
 
+void TraceWin::api_links_render_menuitems( uint32_t eventid )
+{
+    const uint32_t *marker_id = m_trace_events.m_api_links.job_marker.get_val( eventid );
+    const std::vector< uint32_t > *jobs = m_trace_events.m_api_links.marker_jobs.get_val( eventid );
+
+    if ( marker_id )
+    {
+        const char *buf = get_event_field_val( get_event( *marker_id ), "buf" );
+        std::string label = string_format( "Go to api marker: %s", buf );
+
+        if ( ImGui::MenuItem( label.c_str() ) )
+            graph_center_event( *marker_id );
+    }
+
+    if ( jobs && ImGui::BeginMenu( "Go to gpu execution" ) )
+    {
+        for ( uint32_t ijob : *jobs )
+        {
+            const gpu_job_t &job = m_trace_events.m_gpu_jobs[ ijob ];
+            const char *row_name = m_trace_events.m_strpool.findstr( job.row_hashval );
+            std::string label = string_format( "%s: %s (queued %s)",
+                                               row_name ? row_name : "gpu",
+                                               ts_to_timestr( job.end_ts - job.exec_ts, 4 ).c_str(),
+                                               ts_to_timestr( job.exec_ts - job.submit_ts, 4 ).c_str() );
+
+            ImGui::PushID( ijob );
+            if ( ImGui::MenuItem( label.c_str() ) )
+                graph_center_event( job.end_eventid );
+            ImGui::PopID();
+        }
+
+        ImGui::EndMenu();
+    }
+}
+
 bool TraceWin::eventlist_render_popupmenu( uint32_t eventid )
 {
     if ( !ImGui::BeginPopup( "EventsListPopup" ) )
@@ -3094,6 +4985,8 @@ bool TraceWin::eventlist_render_popupmenu( uint32_t eventid )
     if ( ImGui::MenuItem( label.c_str() ) )
         graph_center_event( eventid );
 
+    api_links_render_menuitems( eventid );
+
     // Set / Goto / Clear Markers
     {
         int idx = graph_marker_menuitem( "Set Marker", false, action_graph_set_markerA );
@@ -3307,6 +5200,10 @@ bool TraceWin::eventlist_handle_mouse( const trace_event_t &event, uint32_t i )
             ttip += "\n";
             ttip += get_event_fields_str( event, ": ", '\n' );
 
+            std::string stack = m_trace_events.get_stack_str( event, "  " );
+            if ( !stack.empty() )
+                ttip += "\nStack:\n" + stack;
+
             ImGui::SetTooltip( "%s", ttip.c_str() );
 
             if ( s_actions().get( action_graph_pin_tooltip ) )
@@ -3625,6 +5522,8 @@ void TraceWin::eventlist_render()
                 m_eventlist.end_eventid = end_idx;
             }
 
+            m_trace_events.m_events.prefetch( m_eventlist.start_eventid, m_eventlist.end_eventid + 1 );
+
             int64_t prev_ts = INT64_MIN;
 
             // Loop through and draw events
@@ -4446,7 +6345,7 @@ void MainApp::open_trace_dialog()
     else
     {
         const char *file = noc_file_dialog_open( NOC_FILE_DIALOG_OPEN,
-                                 "trace-cmd files (*.dat;*.trace)\0*.dat;*.trace\0",
+                                 "trace files (*.dat;*.trace;*.data;*.txt;*.html)\0*.dat;*.trace;*.data;*.txt;*.html\0",
                                  NULL, "trace.dat" );
 
         if ( file && file[ 0 ] )
@@ -4507,6 +6406,29 @@ void MainApp::render_menu( const char *str_id )
                     return close_popup;
                 };
             }
+
+            if ( ImGui::MenuItem( "Export Arrow tables to..." ) )
+            {
+                m_saving_info.filename_orig.clear();
+                m_saving_info.title = "Export events as Arrow files to directory:";
+                strcpy_safe( m_saving_info.filename_buf, "gpuvis_arrow" );
+
+                // Lambda for writing events, fields, prints, and gpu jobs tables
+                m_saving_info.save_cb = [&]( save_info_t &save_info )
+                {
+                    return export_arrow( m_trace_win->m_trace_events, save_info.filename_new.c_str(),
+                                         save_info.errstr );
+                };
+            }
+        }
+
+        if ( m_trace_win )
+        {
+            const char *basename = get_path_filename( m_trace_win->m_trace_events.m_filename.c_str() );
+            std::string label = string_format( "Close '%s'", basename );
+
+            if ( ImGui::MenuItem( label.c_str() ) )
+                m_trace_win->m_open = false;
         }
 
         if ( ImGui::MenuItem( "Quit", s_actions().hotkey_str( action_quit ).c_str() ) )
@@ -4526,6 +6448,28 @@ void MainApp::render_menu( const char *str_id )
         ImGui::EndMenu();
     }
 
+    // Trace tabs
+    if ( m_trace_wins.size() > 1 )
+    {
+        TraceWin *active = m_trace_win;
+
+        ImGui::Separator();
+
+        for ( TraceWin *win : m_trace_wins )
+        {
+            const char *basename = get_path_filename( win->m_trace_events.m_filename.c_str() );
+
+            ImGui::PushID( win );
+            if ( ImGui::MenuItem( basename, NULL, win == m_trace_win ) )
+                active = win;
+            ImGui::PopID();
+        }
+
+        ImGui::Separator();
+
+        set_active_trace( active );
+    }
+
     if ( s_opts().getb( OPT_ShowFps ) )
     {
         ImGui::Text( "%s%.2f ms/frame (%.1f FPS)%s",
@@ -4612,12 +6556,33 @@ void MainApp::parse_cmdline( int argc, char **argv )
         { "scale", ya_required_argument, 0, 0 },
         { "tracestart", ya_required_argument, 0, 0 },
         { "tracelen", ya_required_argument, 0, 0 },
+        { "clockanchor", ya_required_argument, 0, 0 },
+        { "exportarrow", ya_required_argument, 0, 0 },
+        { "sql", ya_required_argument, 0, 0 },
+        { "loadfilter", ya_required_argument, 0, 0 },
+        { "sysroot", ya_required_argument, 0, 0 },
+        { "headless", ya_no_argument, 0, 0 },
 #if !defined( GPUVIS_TRACE_UTILS_DISABLE )
         { "trace", ya_no_argument, 0, 0 },
 #endif
         { 0, 0, 0, 0 }
     };
 
+    // Load filters saved in ini file apply to every trace we load
+    for ( const INIEntry &entry : s_ini().GetSectionEntries( "$load_filters$" ) )
+    {
+        load_filter_t filter;
+        std::string errstr;
+
+        if ( parse_load_filter( entry.second.c_str(), filter, errstr ) )
+            m_loading_info.load_filters.push_back( filter );
+        else
+            logf( "[Error] %s", errstr.c_str() );
+    }
+
+    // Root dir for user stack binaries and debug files
+    m_loading_info.sysroot = s_ini().GetStr( "stack_sysroot", "/" );
+
     int c;
     int opt_ind = 0;
     while ( ( c = ya_getopt_long( argc, argv, "i:",
@@ -4632,9 +6597,42 @@ void MainApp::parse_cmdline( int argc, char **argv )
                 m_loading_info.tracestart = timestr_to_ts( ya_optarg );
             else if ( !strcasecmp( "tracelen", long_opts[ opt_ind ].name ) )
                 m_loading_info.tracelen = timestr_to_ts( ya_optarg );
+            else if ( !strcasecmp( "clockanchor", long_opts[ opt_ind ].name ) )
+            {
+                // --clockanchor buffer:offset_ms[:drift_ppm]
+                const char *offset = strchr( ya_optarg, ':' );
+
+                if ( offset )
+                {
+                    trace_clock_info_t anchor;
+                    const char *drift = strchr( offset + 1, ':' );
+
+                    anchor.buffer.assign( ya_optarg, offset - ya_optarg );
+                    anchor.offset = timestr_to_ts( offset + 1 );
+                    anchor.drift = drift ? ( atof( drift + 1 ) / 1000000.0 ) : 0.0;
+
+                    m_loading_info.clock_anchors.push_back( anchor );
+                }
+            }
+            else if ( !strcasecmp( "exportarrow", long_opts[ opt_ind ].name ) )
+                m_loading_info.export_dir = ya_optarg;
+            else if ( !strcasecmp( "sql", long_opts[ opt_ind ].name ) )
+                m_loading_info.sql_query = ya_optarg;
+            else if ( !strcasecmp( "loadfilter", long_opts[ opt_ind ].name ) )
+            {
+                // --loadfilter system=irq,name=softirq_raise,pid=0,cpu=1,sample=10
+                load_filter_t filter;
+                std::string errstr;
+
+                if ( parse_load_filter( ya_optarg, filter, errstr ) )
+                    m_loading_info.load_filters.push_back( filter );
+                else
+                    logf( "[Error] %s", errstr.c_str() );
+            }
+            else if ( !strcasecmp( "sysroot", long_opts[ opt_ind ].name ) )
+                m_loading_info.sysroot = ya_optarg;
             break;
         case 'i':
-            m_loading_info.inputfiles.clear();
             m_loading_info.inputfiles.push_back( ya_optarg );
             break;
 
@@ -4643,11 +6641,9 @@ void MainApp::parse_cmdline( int argc, char **argv )
         }
     }
 
+    // Each trace file given opens in its own tab
     for ( ; ya_optind < argc; ya_optind++ )
-    {
-        m_loading_info.inputfiles.clear();
         m_loading_info.inputfiles.push_back( argv[ ya_optind ] );
-    }
 }
 
 static void imgui_render( SDL_Window *window )
@@ -4692,10 +6688,16 @@ int main( int argc, char **argv )
     }
 #endif
 
+    // --headless loads traces, runs --exportarrow / --sql, and exits: no video needed
+    bool headless = false;
+
+    for ( int i = 1; i < argc; i++ )
+        headless |= !strcasecmp( argv[ i ], "--headless" );
+
     SetHighDPI();
 
     // Initialize SDL
-    if ( SDL_Init( SDL_INIT_VIDEO | SDL_INIT_TIMER ) )
+    if ( SDL_Init( headless ? SDL_INIT_TIMER : ( SDL_INIT_VIDEO | SDL_INIT_TIMER ) ) )
     {
         fprintf( stderr, "Error. SDL_Init failed: %s\n", SDL_GetError() );
         return -1;
@@ -4727,6 +6729,25 @@ int main( int argc, char **argv )
     MainApp &app = s_app();
     app.init( argc, argv );
 
+    if ( headless )
+    {
+        int ret = app.run_headless();
+
+        app.shutdown( NULL );
+        s_ini().Close();
+
+        logf_clear();
+        logf_shutdown();
+
+        ImGui::DestroyContext();
+        SDL_Quit();
+
+#if !defined( GPUVIS_TRACE_UTILS_DISABLE )
+        gpuvis_trace_shutdown();
+#endif
+        return ret;
+    }
+
     // Setup imgui default text color
     s_textclrs().update_colors();
 
@@ -41,6 +41,9 @@ enum loc_type_t
     LOC_TYPE_AMDTimeline_hw,
     LOC_TYPE_i915RequestWait,
     LOC_TYPE_i915Request,
+    LOC_TYPE_DmaFence,
+    LOC_TYPE_Workqueue,
+    LOC_TYPE_BlockDev,
     LOC_TYPE_Max
 };
 
@@ -60,6 +63,39 @@ enum i915_type_t
 };
 i915_type_t get_i915_reqtype( const trace_event_t &event );
 
+enum dma_fence_type_t
+{
+    dma_fence_Job,          // drm_sched_job: job queued to scheduler entity
+    dma_fence_RunJob,       // drm_run_job: job handed to hw ring
+    dma_fence_Emit,         // dma_fence_emit
+    dma_fence_EnableSignal, // dma_fence_enable_signal
+    dma_fence_Signaled,     // dma_fence_signaled
+
+    dma_fence_WaitStart,    // dma_fence_wait_start
+    dma_fence_WaitEnd,      // dma_fence_wait_end
+
+    dma_fence_Max
+};
+dma_fence_type_t get_dma_fence_type( const trace_event_t &event );
+
+// Return ( context << 32 ) | seqno key for dma_fence and drm_sched events (or 0)
+uint64_t get_dma_fence_key( const trace_event_t &event );
+
+struct dma_fence_t
+{
+    // Event ids for dma_fence_Job .. dma_fence_Signaled
+    uint32_t eventids[ dma_fence_WaitStart ] =
+    {
+        INVALID_ID, INVALID_ID, INVALID_ID, INVALID_ID, INVALID_ID
+    };
+
+    // Fence timeline name: "gfx_0.0.0", "nouveau", etc.
+    const char *timeline = nullptr;
+
+    // Time fence started executing on hw
+    int64_t exec_ts = INT64_MAX;
+};
+
 class TraceLocations
 {
 public:
@@ -166,24 +202,6 @@ public:
     std::string m_scanf_str;
 };
 
-class ParsePlotStr
-{
-public:
-    ParsePlotStr() {}
-    ~ParsePlotStr() {}
-
-    bool init( const char *scanf_str );
-    bool parse( const char *buf );
-
-public:
-    float m_valf;
-    const char *m_val_start;
-    const char *m_val_end;
-
-    const char *m_scanf_str = nullptr;
-    size_t m_scanf_len = 0;
-};
-
 class CreatePlotDlg
 {
 public:
@@ -275,6 +293,73 @@ public:
     util_umap< uint32_t, row_filter_t > &m_graph_row_filters;
 };
 
+// Inferred frame boundary: event signature which repeats with a steady period
+struct frame_candidate_t
+{
+    // Frame marker filter expression matching signature events
+    std::string filter;
+    // Median period between signature events
+    int64_t period_ts;
+    // Number of events matching signature
+    uint32_t count;
+    // 0..1: how consistently signature events mark a single frame
+    float confidence;
+};
+
+// Anomaly scan rule: flag matching events whose measured value exceeds threshold
+enum anomaly_metric_t
+{
+    ANOMALY_Duration,   // Event duration
+    ANOMALY_Interval,   // Time since previous matching event
+    ANOMALY_Runnable,   // sched_switch: time next_pid was runnable before switch in
+    ANOMALY_Latency,    // sched_switch: wakeup to switch in time for next_pid
+    ANOMALY_Max
+};
+
+struct anomaly_rule_t
+{
+    std::string name;
+    // Filter expression. Empty uses the best inferred frame marker filter.
+    std::string filter;
+    // Graph row or thread comm ("RenderThread", "RenderThread-1234", "gfx")
+    //  this rule is limited to. Empty for all events.
+    std::string scope;
+    uint32_t metric;
+    int64_t threshold_ts;
+
+    static const char *metric_str( uint32_t metric );
+};
+
+struct anomaly_t
+{
+    uint32_t rule;
+    uint32_t eventid;
+    // Measured value which exceeded rule threshold
+    int64_t val_ts;
+};
+
+// Symbol for a kernel_stack, user_stack or perf callchain address
+struct stack_sym_t
+{
+    // "func+0x1c", or NULL if unresolved
+    const char *func = nullptr;
+    // "file.c:123" from DWARF line info, or NULL
+    const char *line = nullptr;
+    // Binary user addresses are in. NULL for kernel addresses.
+    const char *module = nullptr;
+};
+
+// Unique stack and how many events recorded it
+struct stack_info_t
+{
+    // Stack field value. Identical stacks share the same string pool pointer.
+    const char *stack;
+    int tgid;
+    uint32_t count;
+    // First event with this stack
+    uint32_t eventid;
+};
+
 class FrameMarkers
 {
 public:
@@ -328,6 +413,9 @@ public:
     std::vector< uint32_t > m_left_frames;
     std::vector< uint32_t > m_right_frames;
 
+    // Bumped every time m_left_frames / m_right_frames are set
+    uint32_t m_frames_gen = 0;
+
     // Which frame is left, right, and selected in graph
     int m_frame_marker_left = -1;
     int m_frame_marker_right = -1;
@@ -349,6 +437,223 @@ struct print_info_t
     ImVec2 size;
 };
 
+// GPU job from submission to completion. Built from amdgpu cs_ioctl / sched_run_job /
+//  fence_signaled chains and i915 request_queue / add / in / notify / out events.
+struct gpu_job_t
+{
+    // User space submission ts and pid (amdgpu_cs_ioctl, i915_request_queue)
+    int64_t submit_ts;
+    int submit_pid;
+    // Submission event id or INVALID_ID if we didn't see it
+    uint32_t submit_eventid;
+
+    // Started executing on gpu
+    int64_t exec_ts;
+
+    // Job completed (fence_signaled, intel_engine_notify, i915_request_out)
+    int64_t end_ts;
+    uint32_t end_eventid;
+    uint32_t end_cpu;
+
+    // Hashval of graph row this job is drawn in: "gfx", "i915_req ring0", etc.
+    uint32_t row_hashval;
+};
+
+// Thread scheduling states derived from sched_switch prev_state and sched_waking / sched_wakeup
+enum thread_state_type_t
+{
+    THREAD_STATE_Unknown,
+    THREAD_STATE_Running,
+    THREAD_STATE_Runnable,        // Preempted, or woken but not running yet
+    THREAD_STATE_Sleeping,        // TASK_INTERRUPTIBLE, stopped, etc.
+    THREAD_STATE_Uninterruptible, // TASK_UNINTERRUPTIBLE (usually I/O)
+    THREAD_STATE_Max
+};
+
+// Run length encoded thread state: state lasts until ts of the next run
+struct thread_state_run_t
+{
+    int64_t ts;
+    uint32_t eventid;
+    uint32_t state;
+};
+
+struct thread_states_t
+{
+    // State totals up to the start of every s_checkpoint'th run, so range
+    //  queries only walk a handful of runs.
+    static const size_t s_checkpoint = 64;
+
+    std::vector< thread_state_run_t > runs;
+    std::vector< std::array< int64_t, THREAD_STATE_Max > > totals;
+
+    static const char *state_str( uint32_t state );
+
+    // Return index of run at ts, or runs.size() if ts is before first run
+    size_t find_run( int64_t ts ) const;
+    // Time spent in each state from ts0 to ts1
+    void get_state_times( int64_t ts0, int64_t ts1, int64_t end_ts,
+                          std::array< int64_t, THREAD_STATE_Max > &times ) const;
+
+protected:
+    void get_totals_at( int64_t ts, int64_t end_ts,
+                        std::array< int64_t, THREAD_STATE_Max > &times ) const;
+};
+
+// Hard irq or softirq handler execution on a cpu, paired from
+//  irq_handler_entry / exit and softirq_entry / exit events.
+struct irq_interval_t
+{
+    int64_t ts0;
+    int64_t ts1;
+    uint32_t entry_eventid;
+
+    // irq number, or softirq vector
+    uint16_t irq;
+    uint8_t softirq;
+
+    // Nesting depth: 0 for outermost handler
+    uint8_t depth;
+
+    // Key for irq stats maps
+    uint32_t key() const { return ( softirq << 16 ) | irq; }
+};
+
+struct irq_stats_t
+{
+    uint32_t count = 0;
+    int64_t total_ts = 0;
+    int64_t max_ts = 0;
+};
+
+// Run length encoded per cpu value from power events: val lasts until ts
+//  of the next step. cpu_idle val is the idle state or CPU_IDLE_ACTIVE,
+//  cpu_frequency val is kHz.
+struct cpu_step_t
+{
+    int64_t ts;
+    uint32_t val;
+};
+#define CPU_IDLE_ACTIVE ( ( uint32_t )-1 )
+
+// Work item executed by a kworker, paired from workqueue_queue_work,
+//  workqueue_activate_work, workqueue_execute_start and execute_end.
+struct work_item_t
+{
+    // Queued and activated ts. Set to start_ts if events weren't found.
+    int64_t queue_ts;
+    int64_t activate_ts;
+    int64_t start_ts;
+    int64_t end_ts;
+
+    uint32_t start_eventid;
+    uint32_t end_eventid;
+
+    // Work function name: "vmstat_update", "drm_sched_job_timedout", etc.
+    const char *function;
+
+    // Pid and cpu which queued the work (-1 if queue event wasn't found)
+    int queue_pid;
+    int queue_cpu;
+
+    // kworker pid which executed the work
+    int exec_pid;
+};
+
+struct work_stats_t
+{
+    uint32_t count = 0;
+    int64_t exec_total = 0;
+    int64_t exec_max = 0;
+
+    // Queue to execute_start latency for items with queue events
+    uint32_t latency_count = 0;
+    int64_t latency_total = 0;
+    int64_t latency_max = 0;
+};
+
+// Block request paired from block_rq_insert, block_rq_issue and block_rq_complete
+struct block_rq_t
+{
+    // Insert ts is issue ts for requests which skipped the io scheduler
+    int64_t insert_ts;
+    int64_t issue_ts;
+    int64_t complete_ts;
+
+    uint64_t sector;
+    uint32_t nr_sector;
+
+    // Issuing pid and rwbs string ("R", "WS", "FWS", etc.)
+    int pid;
+    const char *rwbs;
+};
+
+// Device queue depth (issued but not completed requests) starting at ts
+struct block_depth_t
+{
+    int64_t ts;
+    uint32_t depth;
+};
+
+struct block_dev_t
+{
+    // "block 8,0", etc.
+    const char *name = nullptr;
+
+    // block_rq_complete event ids and matching requests, in completion order
+    std::vector< uint32_t > locs;
+    std::vector< block_rq_t > requests;
+
+    std::vector< block_depth_t > depth;
+    uint32_t depth_max = 0;
+
+    // Longest insert to complete time
+    int64_t duration_max = 0;
+
+    // Inserted / issued requests key'd on sector. Cleared after load.
+    util_umap< uint64_t, block_rq_t > pending;
+
+    // End ts of last request drawn in each graph row
+    std::vector< int64_t > row_end_ts;
+};
+
+struct block_stats_t
+{
+    uint32_t count = 0;
+    uint64_t bytes = 0;
+
+    // Issue to complete latency percentiles
+    int64_t p50 = 0;
+    int64_t p90 = 0;
+    int64_t p99 = 0;
+    int64_t max = 0;
+
+    // Average insert to issue time
+    int64_t queued_avg = 0;
+};
+
+enum gpu_mem_domain_t
+{
+    GPU_MEM_VRAM,
+    GPU_MEM_GTT,
+    GPU_MEM_System,
+    GPU_MEM_Max
+};
+
+// Buffer object residency in one memory domain. Moves end one residency
+//  and start another in the new domain.
+struct gpu_mem_alloc_t
+{
+    // Created or moved into domain, and freed or moved out (INT64_MAX if still live)
+    int64_t ts0;
+    int64_t ts1;
+    uint64_t size;
+
+    // amdgpu_bo_create, amdgpu_bo_move, or i915_gem_object_create event
+    uint32_t eventid;
+    uint32_t domain;
+};
+
 struct ftrace_row_info_t
 {
     // pid=-1: rows+count for all ftrace print events
@@ -360,6 +665,89 @@ struct ftrace_row_info_t
     uint32_t count = 0;
 };
 
+// Array of trace events. By default this is a std::vector, but with an event
+// memory budget set it lives in a disk backed mapping split into fixed size
+// blocks. Blocks outside the most recently used working set are released so
+// the kernel can page them out, and are transparently faulted back in on access.
+class TraceEventStore
+{
+public:
+    TraceEventStore() {}
+    ~TraceEventStore();
+
+    // Store events in a file under dir, keeping resident blocks under budget_mb
+    bool init_out_of_core( const char *dir, size_t budget_mb );
+    bool is_out_of_core() const { return m_fd >= 0; }
+
+    size_t size() const                                 { return m_size; }
+    bool empty() const                                  { return !m_size; }
+
+    trace_event_t &operator[]( size_t i )               { return m_data[ i ]; }
+    const trace_event_t &operator[]( size_t i ) const   { return m_data[ i ]; }
+    trace_event_t &front()                              { return m_data[ 0 ]; }
+    const trace_event_t &front() const                  { return m_data[ 0 ]; }
+    trace_event_t &back()                               { return m_data[ m_size - 1 ]; }
+    const trace_event_t &back() const                   { return m_data[ m_size - 1 ]; }
+
+    trace_event_t *begin()                              { return m_data; }
+    trace_event_t *end()                                { return m_data + m_size; }
+    const trace_event_t *begin() const                  { return m_data; }
+    const trace_event_t *end() const                    { return m_data + m_size; }
+
+    // Returns false if out of core storage couldn't grow (disk full, etc.)
+    bool push_back( const trace_event_t &event );
+
+    // Copy event fields into disk backed storage (out of core mode only)
+    event_field_t *store_fields( const event_field_t *fields, uint32_t numfields );
+
+    // Index of first event with ts >= ts, using block min/max timestamps
+    size_t lower_bound_ts( int64_t ts ) const;
+
+    // Mark events [id0, id1) as in use, prefetch them, and release least
+    //  recently used blocks over our memory budget.
+    void prefetch( uint32_t id0, uint32_t id1 );
+
+    // Release all blocks outside the working set, including blocks which were
+    //  faulted in by walking all events.
+    void trim();
+
+public:
+    struct block_t
+    {
+        int64_t min_ts = INT64_MAX;
+        int64_t max_ts = INT64_MIN;
+
+        // prefetch() tick this block was last used, 0 if released
+        uint64_t last_used = 0;
+    };
+
+    // Number of events in each block
+    static const size_t s_block_events = 64 * 1024;
+
+protected:
+    bool reserve( size_t count );
+    void release_blocks( size_t keep, bool all );
+
+protected:
+    std::vector< trace_event_t > m_vec;
+    trace_event_t *m_data = nullptr;
+    size_t m_size = 0;
+
+    std::vector< block_t > m_blocks;
+    uint64_t m_tick = 0;
+    size_t m_budget_blocks = 0;
+
+    // Disk backed event and field mappings
+    int m_fd = -1;
+    size_t m_capacity = 0;
+
+    int m_fields_fd = -1;
+    event_field_t *m_fields = nullptr;
+    size_t m_fields_size = 0;
+    size_t m_fields_capacity = 0;
+    size_t m_fields_released = 0;
+};
+
 class TraceEvents
 {
 public:
@@ -389,11 +777,69 @@ public:
     enum switch_t { SCHED_SWITCH_PREV, SCHED_SWITCH_NEXT };
     const std::vector< uint32_t > *get_sched_switch_locs( int pid, switch_t switch_type );
 
+    // Return stack field value ("0xffffffff81234567 0x7f0012345678 ...") or NULL
+    const char *get_event_stack( const trace_event_t &event );
+    // Return symbol for stack address in process tgid, or NULL
+    const stack_sym_t *get_stack_sym( int tgid, uint64_t addr );
+    // Symbolized stack with one "prefix func (file:line) [module]" line per frame
+    std::string get_stack_str( const trace_event_t &event, const char *prefix,
+                               uint32_t max_frames = UINT32_MAX );
+
     void calculate_amd_event_durations();
     void calculate_i915_req_event_durations();
     void calculate_i915_reqwait_event_durations();
     void calculate_event_print_info();
     void calculate_vblank_info();
+    void calculate_dma_fence_durations();
+    void calculate_gpu_jobs();
+    // Link user space api markers (ftrace prints) to gpu job submissions which follow them
+    void calculate_api_links();
+    void calculate_density();
+    void calculate_thread_states();
+    void calculate_irq_intervals();
+    void calculate_workqueue();
+
+    // Look for periodic event signatures which could be used as frame markers
+    void calculate_frame_candidates();
+
+    // Evaluate anomaly rules in one parallel pass over all events
+    void calculate_anomalies();
+
+    // Resolve unique stack addresses in parallel with ELF / DWARF info from sysroot
+    void calculate_stack_syms();
+
+    void calculate_block_devs();
+    void calculate_gpu_mem();
+
+    // Largest allocations live at ts in domain (GPU_MEM_Max for all domains)
+    void get_gpu_mem_live( int64_t ts, uint32_t domain, size_t count,
+                           std::vector< const gpu_mem_alloc_t * > &allocs );
+    static const char *gpu_mem_domain_str( uint32_t domain );
+
+    // Stats for requests completed on device between ts0 and ts1
+    bool get_block_stats( const char *row_name, int64_t ts0, int64_t ts1, block_stats_t &stats );
+    // Request for block_rq_complete event, or NULL
+    const block_rq_t *get_block_rq( const trace_event_t &event );
+
+    // Work item for workqueue_execute_end event id, or NULL
+    const work_item_t *get_work_item( uint32_t end_eventid );
+    // Work items pid executed between ts0 and ts1
+    void get_work_items( int pid, int64_t ts0, int64_t ts1, std::vector< const work_item_t * > &items );
+
+    // Index of first interval on cpu which is running at or after ts
+    size_t get_irq_interval_idx( uint32_t cpu, int64_t ts );
+    // Irq / softirq handler time per irq key between ts0 and ts1 on cpu.
+    //  Returns time cpu spent in outermost handlers (nested time counted once).
+    int64_t get_irq_stats( uint32_t cpu, int64_t ts0, int64_t ts1,
+                           util_umap< uint32_t, irq_stats_t > &stats );
+    // "amdgpu (irq 52)", "NET_RX (softirq)", etc.
+    std::string get_irq_name( uint32_t key );
+
+    // Time spent at each step value between ts0 and ts1
+    void get_cpu_step_times( const std::vector< cpu_step_t > &steps, int64_t ts0, int64_t ts1,
+                             util_umap< uint32_t, int64_t > &times );
+    // Time weighted average frequency (kHz) between ts0 and ts1
+    uint32_t get_cpu_freq_avg( uint32_t cpu, int64_t ts0, int64_t ts1 );
 
     void invalidate_ftraceprint_colors();
     void update_ftraceprint_colors();
@@ -447,6 +893,9 @@ public:
     void init_sched_process_fork( trace_event_t &event );
     void init_amd_timeline_event( trace_event_t &event );
     void init_i915_event( trace_event_t &event );
+    void init_dma_fence_event( trace_event_t &event );
+    void init_block_rq_event( trace_event_t &event );
+    void init_gpu_mem_event( trace_event_t &event );
 
     int new_event_cb( const trace_event_t &event );
     void new_event_ftrace_print( trace_event_t &event );
@@ -462,7 +911,7 @@ public:
 
     StrPool m_strpool;
     trace_info_t m_trace_info;
-    std::vector< trace_event_t > m_events;
+    TraceEventStore m_events;
 
     // Max drm_vblank_event crc value we've seen
     int m_crtc_max = -1;
@@ -492,12 +941,144 @@ public:
     util_umap< int, int64_t > m_sched_switch_time_pid;
     int64_t m_sched_switch_time_total = 0;
 
+    // Map of woken pid to sched_wakeup, sched_wakeup_new event locations.
+    TraceLocations m_sched_wakeup_locs;
+
+    // All gpu jobs sorted by end_ts
+    std::vector< gpu_job_t > m_gpu_jobs;
+
+    struct
+    {
+        // Gpu job submission and completion event ids to api marker print event id
+        util_umap< uint32_t, uint32_t > job_marker;
+        // Api marker print event id to m_gpu_jobs indices
+        util_umap< uint32_t, std::vector< uint32_t > > marker_jobs;
+    } m_api_links;
+
+    // Map of pid to thread state runs
+    util_umap< int, thread_states_t > m_thread_states;
+
+    // Per cpu irq / softirq intervals sorted by ts0
+    std::vector< std::vector< irq_interval_t > > m_irq_intervals;
+    // Map of irq number to irq_handler_entry name
+    util_umap< uint32_t, const char * > m_irq_names;
+
+    // Per cpu idle states and frequencies from cpu_idle / cpu_frequency events
+    std::vector< std::vector< cpu_step_t > > m_cpu_idle;
+    std::vector< std::vector< cpu_step_t > > m_cpu_freq;
+    uint32_t m_cpu_idle_max = 0;
+    uint32_t m_cpu_freq_max = 0;
+
+    // Whole trace overview drawn behind the graph scrollbar
+    struct
+    {
+        int64_t min_ts = 0;
+        int64_t bin_ts = 1;
+
+        // Event count per bin, and max bin count
+        std::vector< uint32_t > events;
+        uint32_t events_max = 0;
+
+        // Fraction of bin time gpu jobs were executing (0..1)
+        std::vector< float > gpu_busy;
+    } m_density;
+
     // plot name to GraphPlot
     util_umap< uint32_t, GraphPlot > m_graph_plots;
 
     // map of pid to 'thread1-1234 (mainthread-1233)'
     util_umap< int, const char * > m_pid_commstr_map;
 
+    struct
+    {
+        // Fences from all drivers key'd on ( context << 32 ) | seqno
+        util_umap< uint64_t, dma_fence_t > fences;
+
+        // dma_fence_wait_start events key'd on fence key
+        util_umap< uint64_t, std::vector< uint32_t > > wait_locs;
+
+        // dma_fence_signaled events key'd on: "fence %s",timeline
+        TraceLocations timeline_locs;
+    } m_dma_fence;
+
+    struct
+    {
+        // Executed work items in execute_end order
+        std::vector< work_item_t > items;
+
+        // Map of workqueue_execute_end eventid to items index
+        util_umap< uint32_t, uint32_t > item_locs;
+
+        // Map of kworker pid to items indices
+        util_umap< int, std::vector< uint32_t > > pid_items;
+
+        // workqueue_execute_end events key'd on: "work %s",function
+        TraceLocations func_locs;
+
+        // Stats key'd on row name hashval
+        util_umap< uint32_t, work_stats_t > func_stats;
+    } m_workqueue;
+
+    struct
+    {
+        // Buffer object residencies sorted by ts0
+        std::vector< gpu_mem_alloc_t > allocs;
+
+        // Indices of allocs live at the start of every 64k'th alloc
+        std::vector< std::vector< uint32_t > > snapshots;
+
+        // Bytes currently live per domain. Only valid while loading.
+        uint64_t live_bytes[ GPU_MEM_Max ] = {};
+        // Map of bo handle to live allocs index. Cleared after load.
+        util_umap< uint64_t, uint32_t > live;
+
+        // VRAM evictions: amdgpu_bo_move event ids and bytes
+        std::vector< std::pair< uint32_t, uint64_t > > evictions;
+
+        // Derived plot names ("plot:gpumem VRAM MB", etc.) and their domain
+        std::vector< std::pair< std::string, uint32_t > > plots;
+    } m_gpu_mem;
+
+    // Frame marker candidates sorted by confidence
+    std::vector< frame_candidate_t > m_frame_candidates;
+
+    struct
+    {
+        // Local root for user binaries and debug files ("/" for this machine)
+        std::string sysroot = "/";
+
+        // "caller" and "callchain" field keys
+        const char *caller_str = nullptr;
+        const char *callchain_str = nullptr;
+
+        // Kernel address symbols
+        util_umap< uint64_t, stack_sym_t > kernel;
+        // User address symbols key'd on tgid, then address
+        util_umap< int, util_umap< uint64_t, stack_sym_t > > user;
+
+        // Unique stacks sorted by count
+        std::vector< stack_info_t > stacks;
+
+        uint32_t addrs = 0;
+        uint32_t resolved = 0;
+        uint32_t modules = 0;
+        float time_ms = 0.0f;
+    } m_stack_syms;
+
+    struct
+    {
+        // Default rules plus rules from $anomaly_rules$ ini section
+        std::vector< anomaly_rule_t > rules;
+        // Issue count per rule
+        std::vector< uint32_t > counts;
+        // Issues found, sorted by eventid
+        std::vector< anomaly_t > issues;
+        float time_ms = 0.0f;
+    } m_anomalies;
+
+    // Block devices key'd on row name hashval: "block %u,%u"
+    util_umap< uint32_t, block_dev_t > m_block_devs;
+
     // Map hashed row name to count of rows calculated by row_pos_t
     util_umap< uint32_t, uint32_t > m_row_count;
 
@@ -546,6 +1127,9 @@ public:
         util_umap< uint64_t, uint32_t > begin_ctx;
         util_umap< uint64_t, uint32_t > end_ctx;
 
+        // Map of ftrace print event id to "offset=" ts offset (buffered markers)
+        util_umap< uint32_t, int64_t > ts_offsets;
+
         // map of ftrace buf '( lefthashval << 32 ) + event.pid' to ftrace start event id
         util_umap< uint64_t, uint32_t > pairs_ctx;
 
@@ -572,6 +1156,145 @@ public:
 
     // 0: events loaded, 1+: loading events, -1: error
     SDL_atomic_t m_eventsloaded = { 1 };
+    // Set to 1 to cancel loading
+    SDL_atomic_t m_cancel_load = { 0 };
+    // Set by loader thread if event storage couldn't grow
+    bool m_load_failed = false;
+};
+
+// tdop expression callbacks for filtering events
+const char *filter_get_key_func( StrPool *strpool, const char *name, size_t len );
+const char *filter_get_keyval_func( trace_info_t *trace_info, const trace_event_t *event,
+                                    const char *name, char ( &buf )[ 64 ] );
+
+// Export events, event fields, ftrace prints and gpu jobs as Arrow IPC (Feather V2)
+//  files in dir: events.arrow, fields.arrow, prints.arrow, gpu_jobs.arrow.
+bool export_arrow( TraceEvents &trace_events, const char *dir, std::string &errstr );
+
+struct sqlite3;
+
+// SQL queries over loaded trace data. Tables (events, fields, prints, sched_switch,
+//  gpu_jobs) are sqlite virtual tables reading straight from TraceEvents.
+class TraceSql
+{
+public:
+    TraceSql() {}
+    ~TraceSql();
+
+    // Run sql statements. Results of the last statement returning rows are
+    //  stored in m_cols / m_vals.
+    bool query( TraceEvents &trace_events, const char *sql, std::string &errstr );
+
+    // Write results as tab separated text
+    void print( FILE *fp ) const;
+
+    // Event locations for pid (built on first use)
+    const std::vector< uint32_t > *get_pid_locs( int pid );
+
+public:
+    TraceEvents *m_trace_events = nullptr;
+    struct sqlite3 *m_db = nullptr;
+
+    bool m_pid_locs_inited = false;
+    util_umap< int, std::vector< uint32_t > > m_pid_locs;
+
+    // Result column names and row major values (NULL values are empty)
+    std::vector< std::string > m_cols;
+    std::vector< std::string > m_vals;
+    size_t m_rows = 0;
+    bool m_truncated = false;
+    float m_time_ms = 0.0f;
+};
+
+class CriticalPath
+{
+public:
+    CriticalPath() {}
+    ~CriticalPath() { shutdown(); }
+
+    enum seg_type_t
+    {
+        CPATH_Running,          // Thread on cpu
+        CPATH_Runnable,         // Thread woken or preempted, waiting for cpu
+        CPATH_Blocked,          // Thread sleeping, no waker found
+        CPATH_BlockedFence,     // Fence signaled, waiting for wakeup
+        CPATH_GpuQueued,        // Job submitted, waiting to execute on gpu
+        CPATH_GpuExecuting,     // Job executing on gpu
+        CPATH_Max
+    };
+    static const char *seg_type_str( seg_type_t type );
+
+    struct segment_t
+    {
+        seg_type_t type;
+
+        // Thread pid for cpu segments, -1 for gpu segments
+        int pid;
+        // Graph row name hashval for gpu segments
+        uint32_t row_hashval;
+        // Event this segment was derived from
+        uint32_t eventid;
+
+        int64_t ts0;
+        int64_t ts1;
+    };
+
+    struct frame_t
+    {
+        int64_t ts0;
+        int64_t ts1;
+
+        // Index and count of this frame's segments in m_segments
+        uint32_t seg_first;
+        uint32_t seg_count;
+
+        // Total time for each segment type
+        int64_t seg_ts[ CPATH_Max ];
+    };
+
+public:
+    // Kick off background critical path calculation for current frame markers
+    void start( TraceEvents &trace_events, const FrameMarkers &frame_markers );
+    // Cancel and wait for background thread
+    void shutdown();
+
+    bool is_running() { return ( SDL_AtomicGet( &m_state ) == State_Running ); }
+    bool is_ready() { return ( SDL_AtomicGet( &m_state ) == State_Ready ); }
+
+    // Return index of first frame ending at or after ts
+    size_t find_frame( int64_t ts );
+
+protected:
+    static int SDLCALL thread_func( void *data );
+
+    void calculate_frame( frame_t &frame, uint32_t right_eventid );
+    void add_segment( frame_t &frame, seg_type_t type, int pid, uint32_t row_hashval,
+                      uint32_t eventid, int64_t ts0, int64_t ts1 );
+
+    const gpu_job_t *find_fence_job( const trace_event_t &wakeup, int64_t block_ts );
+
+public:
+    enum state_t
+    {
+        State_Idle,
+        State_Running,
+        State_Cancel,
+        State_Ready
+    };
+    SDL_atomic_t m_state = { State_Idle };
+    SDL_Thread *m_thread = nullptr;
+
+    // FrameMarkers::m_frames_gen we were started with
+    uint32_t m_frames_gen = 0;
+
+    TraceEvents *m_trace_events = nullptr;
+    std::vector< uint32_t > m_left_frames;
+    std::vector< uint32_t > m_right_frames;
+
+    // Only valid when is_ready() returns true
+    std::vector< frame_t > m_frames;
+    std::vector< segment_t > m_segments;
+    float m_time_ms = 0.0f;
 };
 
 class GraphRows
@@ -678,6 +1401,7 @@ protected:
     // Internal render graph functions
     void graph_render_resizer( graph_info_t &gi );
     void graph_render_hscrollbar( graph_info_t &gi );
+    void graph_render_density( const ImVec2 &pos, const ImVec2 &size, int64_t min_ts, int64_t max_ts );
 
     // Render graph rows
     void graph_render_rows( graph_info_t &gi );
@@ -697,10 +1421,18 @@ protected:
     uint32_t graph_render_plot( graph_info_t &gi );
     // Render regular trace events
     uint32_t graph_render_row_events( graph_info_t &gi );
+    // Render running / runnable / sleeping band for comm rows
+    void graph_render_thread_states( graph_info_t &gi );
     // Render intel i915 request_wait events
     uint32_t graph_render_i915_reqwait_events( graph_info_t &gi );
     // Render intel i915 request_add, request_submit, request_in, request_out, intel_engine_notify
     uint32_t graph_render_i915_req_events( graph_info_t &gi );
+    // Render dma_fence / drm_sched timeline
+    uint32_t graph_render_dma_fence_timeline( graph_info_t &gi );
+    // Render workqueue function timeline
+    uint32_t graph_render_workqueue_timeline( graph_info_t &gi );
+    // Render block device requests and queue depth
+    uint32_t graph_render_block_timeline( graph_info_t &gi );
 
     // Render graph decorations
     void graph_render_time_ticks( graph_info_t &gi, float h0, float h1 );
@@ -711,6 +1443,7 @@ protected:
     void graph_render_eventlist_selection( graph_info_t &gi );
     void graph_render_row_labels( graph_info_t &gi );
     void graph_render_framemarker_frames( graph_info_t &gi );
+    void graph_render_critical_path( graph_info_t &gi );
 
     bool frame_markers_enabled();
     void frame_markers_goto( int target, bool fit_frame );
@@ -731,6 +1464,9 @@ protected:
     void graph_mouse_tooltip_vblanks( std::string &ttip, graph_info_t &gi, int64_t mouse_ts );
     void graph_mouse_tooltip_markers( std::string &ttip, graph_info_t &gi, int64_t mouse_ts );
     void graph_mouse_tooltip_sched_switch( std::string &ttip, graph_info_t &gi, int64_t mouse_ts );
+    void graph_mouse_tooltip_thread_states( std::string &ttip, graph_info_t &gi, int64_t mouse_ts );
+    void graph_mouse_tooltip_irqs( std::string &ttip, graph_info_t &gi, int64_t mouse_ts );
+    void graph_mouse_tooltip_cpu_power( std::string &ttip, graph_info_t &gi, int64_t mouse_ts );
     void graph_mouse_tooltip_hovered_items( std::string &ttip, graph_info_t &gi, int64_t mouse_ts );
     void graph_mouse_tooltip_hovered_amd_fence_signaled( std::string &ttip, graph_info_t &gi, int64_t mouse_ts );
 
@@ -749,6 +1485,13 @@ protected:
     void zoom_graph_row();
 
     void graph_center_event( uint32_t eventid );
+    // Menu items to jump between api markers and gpu jobs they submitted
+    void api_links_render_menuitems( uint32_t eventid );
+
+    // Anomaly scan issues list in trace info
+    void anomalies_render_info();
+    // Unique stacks by count in trace info
+    void stacks_render_info();
 
     int graph_marker_menuitem( const char *label, bool check_valid, action_t action );
 
@@ -770,6 +1513,14 @@ public:
     // Whether our window is open or not
     bool m_open = true;
 
+    // Background loader thread and command line requests run once loaded
+    struct
+    {
+        SDL_Thread *thread = nullptr;
+        std::string export_dir;
+        std::string sql_query;
+    } m_loader;
+
     // false first time through render() call
     bool m_inited = false;
 
@@ -794,6 +1545,23 @@ public:
     uint32_t m_create_filter_eventid = INVALID_ID;
     FrameMarkers m_frame_markers;
 
+    // Per frame critical path (calculated in background thread)
+    CriticalPath m_critical_path;
+
+    // Anomaly issues list view: sorted / filtered indices into m_anomalies.issues
+    struct
+    {
+        int sort = 0;
+        int rule = -1;
+        bool dirty = true;
+        std::vector< uint32_t > order;
+    } m_anomalies_view;
+
+    // SQL query window in trace info
+    TraceSql m_sql;
+    std::string m_sql_errstr;
+    char m_sql_buf[ 2048 ] = "SELECT name, count(*) AS count FROM events GROUP BY name ORDER BY count DESC";
+
     util_umap< int64_t, uint32_t > m_ts_to_eventid_cache;
 
     // Filter data
@@ -905,6 +1673,10 @@ public:
 
         float scroll_pos = -1.0f;
         float scroll_x = -1.0f;
+
+        // Scrollbar overview bins with frames longer than 2x median frame
+        std::vector< uint8_t > density_hitches;
+        uint32_t density_frames_gen = ( uint32_t )-1;
     } m_graph;
 
     // Pinned graph tooltip windows
@@ -935,6 +1707,8 @@ enum : uint32_t
     OPT_ShowEventList,
     OPT_SyncEventListToGraph,
     OPT_HideSchedSwitchEvents,
+    OPT_SyncTraceTabs,
+    OPT_SuggestFrameMarkers,
     OPT_RenderCrtc0,
     OPT_RenderCrtc1,
     OPT_RenderCrtc2,
@@ -946,6 +1720,11 @@ enum : uint32_t
     OPT_RenderCrtc8,
     OPT_RenderCrtc9,
     OPT_RenderFrameMarkers,
+    OPT_RenderCriticalPath,
+    OPT_RenderScrollbarDensity,
+    OPT_RenderThreadStates,
+    OPT_RenderCpuIrqs,
+    OPT_RenderCpuPower,
     OPT_GraphHeight,
     OPT_GraphHeightZoomed,
     OPT_EventListRowCount,
@@ -953,6 +1732,9 @@ enum : uint32_t
     OPT_Gamma,
     OPT_UseFreetype,
     OPT_TrimTrace,
+    OPT_ClockSync,
+    OPT_RecoverBadPages,
+    OPT_EventMemoryBudget,
     OPT_ShowFps,
     OPT_VerticalSync,
     OPT_PresetMax
@@ -1051,9 +1833,10 @@ public:
     void shutdown( SDL_Window *window );
 
     bool load_file( const char *filename );
-    void cancel_load_file();
+    void close_trace( TraceWin *win );
+    void set_active_trace( TraceWin *win );
 
-    // Trace file loaded and viewing?
+    // Active trace file loaded and viewing?
     bool is_trace_loaded();
 
     void render();
@@ -1077,29 +1860,32 @@ public:
 
     void open_trace_dialog();
 
-    enum state_t
-    {
-        State_Idle,
-        State_Loading,
-        State_CancelLoading
-    };
-    state_t get_state();
-    void set_state( state_t state, const char *filename = nullptr );
+    int run_headless();
 
     static int SDLCALL thread_func( void *data );
 
 public:
+    // Command line options applied to the next trace we load
     struct loading_info_t
     {
-        // State_Idle, Loading, Loaded, CancelLoading
-        SDL_atomic_t state = { 0 };
-
         uint64_t tracestart = 0;
         uint64_t tracelen = 0;
 
-        std::string filename;
-        TraceWin *win = nullptr;
-        SDL_Thread *thread = nullptr;
+        // Buffer clock anchors from --clockanchor
+        std::vector< trace_clock_info_t > clock_anchors;
+
+        // Export loaded trace as Arrow files to this directory (--exportarrow)
+        std::string export_dir;
+
+        // SQL query to run on loaded trace, results written to stdout (--sql)
+        std::string sql_query;
+
+        // Events to drop or sample while loading (--loadfilter, $load_filters$ ini section)
+        std::vector< load_filter_t > load_filters;
+
+        // Local root for stack symbol lookups (--sysroot, stack_sysroot ini key)
+        std::string sysroot;
+
         std::vector< std::string > inputfiles;
     };
     loading_info_t m_loading_info;
@@ -1117,6 +1903,9 @@ public:
     };
     save_info_t m_saving_info;
 
+    // Open traces, each loading or viewing independently
+    std::vector< TraceWin * > m_trace_wins;
+    // Trace currently being viewed
     TraceWin *m_trace_win = nullptr;
 
     FontInfo m_font_main;
@@ -0,0 +1,657 @@
+/*
+ * Copyright 2019 Valve Software
+ *
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <string>
+#include <future>
+#include <thread>
+
+#include <SDL.h>
+
+#include "imgui/imgui.h"
+#include "imgui/imgui_internal.h"   // BeginColumns(), EndColumns() WIP
+#include "gpuvis_macros.h"
+#include "stlini.h"
+#include "tdopexpr.h"
+#include "trace-cmd/trace-read.h"
+#include "gpuvis_utils.h"
+#include "gpuvis.h"
+
+/*
+  Anomaly scan. Rules are the defaults below plus the $anomaly_rules$ ini section:
+
+    [$anomaly_rules$]
+    Long fence wait=duration,5,,$name =~ _request_wait_end
+    Game thread latency=latency,0.5,GameThread,$name = sched_switch
+
+  Value is "metric,threshold_ms,scope,filter", with metrics:
+
+    duration: event duration
+    interval: time since previous event matching the filter
+    runnable: sched_switch only, time next_pid was runnable before switching in
+    latency:  sched_switch only, runnable time which started with a wakeup
+
+  Scope is a graph row or thread comm the rule is limited to. An empty filter
+  uses the best inferred frame marker filter. Ini rules replace default rules
+  with the same name, and an empty value disables the default rule.
+
+  All rules are evaluated in a single pass: events are split into one chunk per
+  hardware thread and each worker runs every rule against each event in its
+  chunk, with its own compiled copy of the rule filters (tdop expressions keep
+  state while executing). Cheap checks (metric, scope, threshold) run before the
+  filter expression. Interval rules record matches per chunk and are stitched
+  together once the workers finish.
+ */
+
+// Minimum number of events per worker
+static const uint32_t s_min_chunk_events = 256 * 1024;
+
+// Default frame budget (60Hz)
+static const int64_t s_frame_budget_ts = NSECS_PER_MSEC * 50 / 3;
+
+struct anomaly_scope_t
+{
+    bool scoped = false;
+    // Sorted event ids in scope
+    std::vector< uint32_t > locs;
+    // Sorted thread ids for sched_switch metrics. Empty for any thread.
+    std::vector< int > pids;
+};
+
+struct anomaly_worker_t
+{
+    uint32_t id0;
+    uint32_t id1;
+
+    // Compiled rule filters. NULL for disabled rules.
+    std::vector< class TdopExpr * > exprs;
+
+    // Duration, runnable and latency issues in event order
+    std::vector< anomaly_t > issues;
+    // Matching event ids for interval rules
+    std::vector< std::vector< uint32_t > > matches;
+};
+
+const char *anomaly_rule_t::metric_str( uint32_t metric )
+{
+    switch ( metric )
+    {
+    case ANOMALY_Duration: return "duration";
+    case ANOMALY_Interval: return "interval";
+    case ANOMALY_Runnable: return "runnable";
+    case ANOMALY_Latency:  return "latency";
+    }
+
+    return "";
+}
+
+// Parse "metric,threshold_ms,scope,filter"
+static bool parse_anomaly_rule( const std::string &name, const std::string &val,
+                                anomaly_rule_t &rule, std::string &errstr )
+{
+    std::vector< std::string > args;
+    size_t pos = 0;
+
+    // Filter is last so it can contain commas
+    for ( int i = 0; i < 3; i++ )
+    {
+        size_t comma = val.find( ',', pos );
+
+        if ( comma == std::string::npos )
+        {
+            errstr = string_format( "anomaly rule '%s': expected metric,threshold_ms,scope,filter", name.c_str() );
+            return false;
+        }
+
+        args.push_back( string_trimmed( val.substr( pos, comma - pos ) ) );
+        pos = comma + 1;
+    }
+    args.push_back( string_trimmed( val.substr( pos ) ) );
+
+    rule.name = name;
+    rule.metric = ANOMALY_Max;
+    for ( uint32_t metric = 0; metric < ANOMALY_Max; metric++ )
+    {
+        if ( !strcasecmp( args[ 0 ].c_str(), anomaly_rule_t::metric_str( metric ) ) )
+            rule.metric = metric;
+    }
+    if ( rule.metric == ANOMALY_Max )
+    {
+        errstr = string_format( "anomaly rule '%s': unknown metric '%s'", name.c_str(), args[ 0 ].c_str() );
+        return false;
+    }
+
+    rule.threshold_ts = ( int64_t )( atof( args[ 1 ].c_str() ) * NSECS_PER_MSEC );
+    if ( rule.threshold_ts <= 0 )
+    {
+        errstr = string_format( "anomaly rule '%s': bad threshold '%s'", name.c_str(), args[ 1 ].c_str() );
+        return false;
+    }
+
+    rule.scope = args[ 2 ];
+    rule.filter = args[ 3 ];
+    return true;
+}
+
+static void get_default_rules( TraceEvents &trace_events, std::vector< anomaly_rule_t > &rules )
+{
+    rules.push_back( { "Frame over budget", "", "", ANOMALY_Interval, s_frame_budget_ts } );
+
+    for ( size_t crtc = 0; crtc < trace_events.m_vblank_info.size(); crtc++ )
+    {
+        int64_t median_ts = trace_events.m_vblank_info[ crtc ].median_diff_ts;
+
+        if ( median_ts )
+        {
+            rules.push_back( { string_format( "Missed vblank crtc %lu", crtc ),
+                               string_format( "$name = drm_vblank_event && $crtc = %lu", crtc ),
+                               "", ANOMALY_Interval, median_ts * 3 / 2 } );
+        }
+    }
+
+    // i915_gem_request_wait_end on older kernels, i915_request_wait_end on newer
+    rules.push_back( { "Long fence wait", "$name =~ _request_wait_end", "",
+                       ANOMALY_Duration, 5 * NSECS_PER_MSEC } );
+    // wait_start and wait_end both get the wait duration: only count the end
+    rules.push_back( { "Long dma_fence wait", "$name = dma_fence_wait_end", "",
+                       ANOMALY_Duration, 5 * NSECS_PER_MSEC } );
+    rules.push_back( { "Long runnable", "$name = sched_switch", "",
+                       ANOMALY_Runnable, 2 * NSECS_PER_MSEC } );
+
+    // Render thread is whichever thread submitted the most gpu jobs
+    util_umap< int, uint32_t > submits;
+    int render_pid = 0;
+    uint32_t render_count = 0;
+
+    for ( const gpu_job_t &job : trace_events.m_gpu_jobs )
+    {
+        uint32_t *count = submits.get_val_create( job.submit_pid );
+
+        if ( ( job.submit_pid > 0 ) && ( ++*count > render_count ) )
+        {
+            render_pid = job.submit_pid;
+            render_count = *count;
+        }
+    }
+
+    if ( render_pid )
+    {
+        rules.push_back( { "Render thread sched latency", "$name = sched_switch",
+                           trace_events.comm_from_pid( render_pid, "<...>" ),
+                           ANOMALY_Latency, NSECS_PER_MSEC } );
+    }
+}
+
+// Scope is a thread comm ("RenderThread-1234"), all threads with a comm name
+//  ("RenderThread"), or a graph row name ("gfx").
+static bool get_anomaly_scope( TraceEvents &trace_events, const std::string &scope,
+                               anomaly_scope_t &out )
+{
+    out.scoped = !scope.empty();
+    if ( !out.scoped )
+        return true;
+
+    const std::vector< uint32_t > *plocs = trace_events.get_comm_locs( scope.c_str() );
+
+    if ( plocs )
+    {
+        const char *pidstr = strrchr( scope.c_str(), '-' );
+
+        out.locs = *plocs;
+        if ( pidstr )
+            out.pids.push_back( atoi( pidstr + 1 ) );
+    }
+    else
+    {
+        for ( const auto &it : trace_events.m_trace_info.pid_comm_map.m_map )
+        {
+            if ( scope == it.second )
+            {
+                const char *comm = trace_events.comm_from_pid( it.first );
+
+                plocs = trace_events.get_comm_locs( comm );
+                if ( plocs )
+                {
+                    out.locs.insert( out.locs.end(), plocs->begin(), plocs->end() );
+                    out.pids.push_back( it.first );
+                }
+            }
+        }
+
+        if ( out.locs.empty() )
+        {
+            plocs = trace_events.get_locs( scope.c_str() );
+            if ( plocs )
+                out.locs = *plocs;
+        }
+
+        std::sort( out.locs.begin(), out.locs.end() );
+        out.locs.erase( std::unique( out.locs.begin(), out.locs.end() ), out.locs.end() );
+        std::sort( out.pids.begin(), out.pids.end() );
+    }
+
+    return !out.locs.empty();
+}
+
+// Time pid spent runnable before being switched in by sched_switch event. If
+//  wakeup_only is set, don't count runnable time from being preempted.
+static int64_t get_runnable_ts( TraceEvents &trace_events, const trace_event_t &event,
+                                int pid, bool wakeup_only )
+{
+    const thread_states_t *states = trace_events.m_thread_states.get_val( pid );
+
+    if ( !states )
+        return 0;
+
+    const std::vector< thread_state_run_t > &runs = states->runs;
+    size_t idx = states->find_run( event.ts );
+
+    if ( !idx || ( idx >= runs.size() ) || ( runs[ idx ].eventid != event.id ) )
+        return 0;
+
+    const thread_state_run_t &run = runs[ idx - 1 ];
+
+    if ( run.state != THREAD_STATE_Runnable )
+        return 0;
+    if ( wakeup_only && trace_events.m_events[ run.eventid ].is_sched_switch() )
+        return 0;
+
+    return event.ts - run.ts;
+}
+
+static void anomaly_scan( TraceEvents &trace_events, const std::vector< anomaly_rule_t > &rules,
+                          const std::vector< anomaly_scope_t > &scopes, anomaly_worker_t &worker )
+{
+    const trace_event_t *pevent = NULL;
+    tdop_get_keyval_func get_keyval_func = [&]( const char *name, char ( &buf )[ 64 ] )
+    {
+        return filter_get_keyval_func( &trace_events.m_trace_info, pevent, name, buf );
+    };
+    std::vector< size_t > cursors( rules.size() );
+
+    // Start scope cursors at the first event in our chunk
+    for ( size_t i = 0; i < rules.size(); i++ )
+    {
+        const std::vector< uint32_t > &locs = scopes[ i ].locs;
+
+        cursors[ i ] = std::lower_bound( locs.begin(), locs.end(), worker.id0 ) - locs.begin();
+    }
+
+    for ( uint32_t id = worker.id0; id < worker.id1; id++ )
+    {
+        const trace_event_t &event = trace_events.m_events[ id ];
+        bool is_sched_switch = event.is_sched_switch();
+        int next_pid = -1;
+
+        pevent = &event;
+
+        for ( size_t i = 0; i < rules.size(); i++ )
+        {
+            const anomaly_rule_t &rule = rules[ i ];
+            const anomaly_scope_t &scope = scopes[ i ];
+            int64_t val = 0;
+
+            if ( !worker.exprs[ i ] )
+                continue;
+
+            if ( rule.metric == ANOMALY_Duration )
+            {
+                if ( !event.has_duration() || ( event.duration <= rule.threshold_ts ) )
+                    continue;
+            }
+            else if ( ( rule.metric != ANOMALY_Interval ) && !is_sched_switch )
+            {
+                continue;
+            }
+
+            if ( scope.scoped )
+            {
+                const std::vector< uint32_t > &locs = scope.locs;
+                size_t &cursor = cursors[ i ];
+
+                while ( ( cursor < locs.size() ) && ( locs[ cursor ] < id ) )
+                    cursor++;
+                if ( ( cursor >= locs.size() ) || ( locs[ cursor ] != id ) )
+                    continue;
+            }
+
+            if ( rule.metric == ANOMALY_Duration )
+            {
+                val = event.duration;
+            }
+            else if ( rule.metric != ANOMALY_Interval )
+            {
+                if ( next_pid < 0 )
+                    next_pid = atoi( get_event_field_val( event, "next_pid", "0" ) );
+
+                if ( !scope.pids.empty() &&
+                     !std::binary_search( scope.pids.begin(), scope.pids.end(), next_pid ) )
+                    continue;
+
+                val = get_runnable_ts( trace_events, event, next_pid, rule.metric == ANOMALY_Latency );
+                if ( val <= rule.threshold_ts )
+                    continue;
+            }
+
+            const char *ret = tdopexpr_exec( worker.exprs[ i ], get_keyval_func );
+
+            if ( !ret[ 0 ] )
+                continue;
+
+            if ( rule.metric == ANOMALY_Interval )
+                worker.matches[ i ].push_back( id );
+            else
+                worker.issues.push_back( { ( uint32_t )i, id, val } );
+        }
+    }
+}
+
+void TraceEvents::calculate_anomalies()
+{
+    std::vector< anomaly_rule_t > &rules = m_anomalies.rules;
+    util_time_t t0 = util_get_time();
+
+    get_default_rules( *this, rules );
+
+    for ( const INIEntry &entry : s_ini().GetSectionEntries( "$anomaly_rules$" ) )
+    {
+        anomaly_rule_t rule;
+        std::string errstr;
+        const std::string &name = entry.first;
+
+        // Ini rules replace default rules with the same name
+        rules.erase( std::remove_if( rules.begin(), rules.end(),
+                                     [&name]( const anomaly_rule_t &r ) { return r.name == name; } ),
+                     rules.end() );
+
+        if ( string_trimmed( entry.second ).empty() )
+            continue;
+
+        if ( parse_anomaly_rule( name, entry.second, rule, errstr ) )
+            rules.push_back( rule );
+        else
+            logf( "[Error] %s", errstr.c_str() );
+    }
+
+    m_anomalies.counts.assign( rules.size(), 0 );
+    if ( rules.empty() || m_events.empty() )
+        return;
+
+    GPUVIS_TRACE_BLOCKF( "calculate_anomalies: %lu rules", rules.size() );
+
+    std::vector< anomaly_scope_t > scopes( rules.size() );
+    std::vector< bool > enabled( rules.size() );
+
+    for ( size_t i = 0; i < rules.size(); i++ )
+    {
+        anomaly_rule_t &rule = rules[ i ];
+
+        // Rules without filters use the best inferred frame marker
+        if ( rule.filter.empty() && !m_frame_candidates.empty() )
+            rule.filter = m_frame_candidates[ 0 ].filter;
+
+        if ( rule.filter.empty() )
+            continue;
+
+        enabled[ i ] = get_anomaly_scope( *this, rule.scope, scopes[ i ] );
+        if ( !enabled[ i ] )
+            logf( "[Error] anomaly rule '%s': scope '%s' not found", rule.name.c_str(), rule.scope.c_str() );
+    }
+
+    // Split events into one chunk per worker thread
+    uint32_t event_count = m_events.size();
+    uint32_t chunks = std::max< uint32_t >( 1, std::thread::hardware_concurrency() );
+
+    chunks = std::min< uint32_t >( chunks, ( event_count + s_min_chunk_events - 1 ) / s_min_chunk_events );
+    chunks = std::max< uint32_t >( chunks, 1 );
+
+    std::vector< anomaly_worker_t > workers( chunks );
+    tdop_get_key_func get_key_func = std::bind( filter_get_key_func, &m_strpool, _1, _2 );
+
+    // Compile filters here: compiling adds strings to our string pool
+    for ( uint32_t w = 0; w < chunks; w++ )
+    {
+        anomaly_worker_t &worker = workers[ w ];
+
+        worker.id0 = ( uint64_t )event_count * w / chunks;
+        worker.id1 = ( uint64_t )event_count * ( w + 1 ) / chunks;
+        worker.exprs.resize( rules.size() );
+        worker.matches.resize( rules.size() );
+
+        for ( size_t i = 0; i < rules.size(); i++ )
+        {
+            if ( enabled[ i ] )
+            {
+                std::string errstr;
+
+                worker.exprs[ i ] = tdopexpr_compile( rules[ i ].filter.c_str(), get_key_func, errstr );
+
+                if ( !worker.exprs[ i ] )
+                {
+                    logf( "[Error] anomaly rule '%s': compiling '%s': %s", rules[ i ].name.c_str(),
+                          rules[ i ].filter.c_str(), errstr.c_str() );
+                    enabled[ i ] = false;
+                }
+            }
+        }
+    }
+
+    std::vector< std::future< void > > threads;
+
+    for ( anomaly_worker_t &worker : workers )
+    {
+        threads.push_back( std::async( std::launch::async, anomaly_scan, std::ref( *this ),
+                                       std::cref( rules ), std::cref( scopes ), std::ref( worker ) ) );
+    }
+
+    std::vector< anomaly_t > &issues = m_anomalies.issues;
+
+    for ( size_t w = 0; w < workers.size(); w++ )
+    {
+        threads[ w ].get();
+
+        issues.insert( issues.end(), workers[ w ].issues.begin(), workers[ w ].issues.end() );
+    }
+
+    // Stitch interval rule matches together across chunks
+    for ( size_t i = 0; i < rules.size(); i++ )
+    {
+        uint32_t previd = INVALID_ID;
+
+        if ( rules[ i ].metric != ANOMALY_Interval )
+            continue;
+
+        for ( const anomaly_worker_t &worker : workers )
+        {
+            for ( uint32_t id : worker.matches[ i ] )
+            {
+                if ( is_valid_id( previd ) )
+                {
+                    int64_t val = m_events[ id ].ts - m_events[ previd ].ts;
+
+                    if ( val > rules[ i ].threshold_ts )
+                        issues.push_back( { ( uint32_t )i, id, val } );
+                }
+                previd = id;
+            }
+        }
+    }
+
+    for ( anomaly_worker_t &worker : workers )
+    {
+        for ( class TdopExpr *expr : worker.exprs )
+            tdopexpr_delete( expr );
+    }
+
+    std::sort( issues.begin(), issues.end(),
+               []( const anomaly_t &lx, const anomaly_t &rx )
+               {
+                   return ( lx.eventid < rx.eventid ) ||
+                          ( ( lx.eventid == rx.eventid ) && ( lx.rule < rx.rule ) );
+               } );
+
+    for ( const anomaly_t &issue : issues )
+        m_anomalies.counts[ issue.rule ]++;
+
+    m_anomalies.time_ms = util_time_to_ms( t0, util_get_time() );
+
+    logf( "Found %lu anomalies from %lu rules in %.2fms (%u threads)",
+          issues.size(), rules.size(), m_anomalies.time_ms, chunks );
+}
+
+void TraceWin::anomalies_render_info()
+{
+    static const char *s_sort_by[] = { "Time", "Rule", "Value", "Over threshold" };
+    const std::vector< anomaly_rule_t > &rules = m_trace_events.m_anomalies.rules;
+    const std::vector< uint32_t > &counts = m_trace_events.m_anomalies.counts;
+    const std::vector< anomaly_t > &issues = m_trace_events.m_anomalies.issues;
+
+    if ( rules.empty() || !ImGui::CollapsingHeader( "Anomalies" ) )
+        return;
+
+    ImGui::Text( "%lu issues from %lu rules (%.2fms)", issues.size(), rules.size(),
+                 m_trace_events.m_anomalies.time_ms );
+
+    std::string preview = ( m_anomalies_view.rule < 0 ) ?
+                "All rules" : rules[ m_anomalies_view.rule ].name;
+
+    ImGui::PushItemWidth( imgui_scale( 250.0f ) );
+    if ( ImGui::BeginCombo( "Rule", preview.c_str() ) )
+    {
+        if ( ImGui::Selectable( "All rules", m_anomalies_view.rule < 0 ) )
+        {
+            m_anomalies_view.rule = -1;
+            m_anomalies_view.dirty = true;
+        }
+
+        for ( size_t i = 0; i < rules.size(); i++ )
+        {
+            const anomaly_rule_t &rule = rules[ i ];
+            std::string label = string_format( "%s (%u)", rule.name.c_str(), counts[ i ] );
+
+            ImGui::PushID( ( int )i );
+            if ( ImGui::Selectable( label.c_str(), m_anomalies_view.rule == ( int )i ) )
+            {
+                m_anomalies_view.rule = i;
+                m_anomalies_view.dirty = true;
+            }
+            if ( ImGui::IsItemHovered() )
+            {
+                ImGui::SetTooltip( "%s > %s\nScope: %s\nFilter: %s",
+                                   anomaly_rule_t::metric_str( rule.metric ),
+                                   ts_to_timestr( rule.threshold_ts, 2 ).c_str(),
+                                   rule.scope.empty() ? "all events" : rule.scope.c_str(),
+                                   rule.filter.empty() ? "(no frame marker found)" : rule.filter.c_str() );
+            }
+            ImGui::PopID();
+        }
+
+        ImGui::EndCombo();
+    }
+
+    ImGui::SameLine();
+    if ( ImGui::Combo( "Sort by", &m_anomalies_view.sort, s_sort_by, ARRAY_SIZE( s_sort_by ) ) )
+        m_anomalies_view.dirty = true;
+    ImGui::PopItemWidth();
+
+    std::vector< uint32_t > &order = m_anomalies_view.order;
+
+    if ( m_anomalies_view.dirty )
+    {
+        order.clear();
+        for ( uint32_t i = 0; i < issues.size(); i++ )
+        {
+            if ( ( m_anomalies_view.rule < 0 ) || ( issues[ i ].rule == ( uint32_t )m_anomalies_view.rule ) )
+                order.push_back( i );
+        }
+
+        // Issues are in event order, so stable sorts keep time order within ties
+        if ( m_anomalies_view.sort == 1 )
+        {
+            std::stable_sort( order.begin(), order.end(),
+                              [&issues]( uint32_t lx, uint32_t rx ) { return issues[ lx ].rule < issues[ rx ].rule; } );
+        }
+        else if ( m_anomalies_view.sort == 2 )
+        {
+            std::stable_sort( order.begin(), order.end(),
+                              [&issues]( uint32_t lx, uint32_t rx ) { return issues[ lx ].val_ts > issues[ rx ].val_ts; } );
+        }
+        else if ( m_anomalies_view.sort == 3 )
+        {
+            auto ratio = [&]( uint32_t i ) { return ( double )issues[ i ].val_ts / rules[ issues[ i ].rule ].threshold_ts; };
+
+            std::stable_sort( order.begin(), order.end(),
+                              [&ratio]( uint32_t lx, uint32_t rx ) { return ratio( lx ) > ratio( rx ); } );
+        }
+
+        m_anomalies_view.dirty = false;
+    }
+
+    if ( imgui_begin_columns( "anomalies", { "Time", "Rule", "Value", "Threshold", "Thread" } ) )
+        ImGui::SetColumnWidth( 1, imgui_scale( 250.0f ) );
+
+    ImGuiListClipper clipper( order.size() );
+    while ( clipper.Step() )
+    {
+        for ( int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++ )
+        {
+            const anomaly_t &issue = issues[ order[ i ] ];
+            const anomaly_rule_t &rule = rules[ issue.rule ];
+            const trace_event_t &event = get_event( issue.eventid );
+            bool selected = ( m_eventlist.selected_eventid == event.id );
+            std::string label = ts_to_timestr( event.ts, 6 );
+
+            // Click on issue to go to its event in the graph
+            ImGui::PushID( i );
+            if ( ImGui::Selectable( label.c_str(), selected, ImGuiSelectableFlags_SpanAllColumns ) )
+                graph_center_event( issue.eventid );
+            ImGui::PopID();
+            ImGui::NextColumn();
+
+            ImGui::Text( "%s", rule.name.c_str() );
+            ImGui::NextColumn();
+
+            ImGui::Text( "%s", ts_to_timestr( issue.val_ts, 4 ).c_str() );
+            ImGui::NextColumn();
+
+            ImGui::Text( "%s", ts_to_timestr( rule.threshold_ts, 4 ).c_str() );
+            ImGui::NextColumn();
+
+            ImGui::Text( "%s", event.comm );
+            ImGui::NextColumn();
+        }
+    }
+
+    ImGui::EndColumns();
+}
@@ -66,6 +66,21 @@ _XTAG( col_Graph_BarSelRect, 0xd9fff300, "Graph timeline selected bar rectangle"
 _XTAG( col_Graph_BarText, IM_COL32( 0xff, 0xff, 0xff, 255 ), "Graph timeline bar text" )
 _XTAG( col_Graph_TaskRunning, 0x4fff00ff, "Sched_switch task running block" )
 _XTAG( col_Graph_TaskSleeping, 0x4fffff00, "Sched_switch task sleeping block" )
+_XTAG( col_Graph_ThreadRunning, 0xff00c000, "Thread state band running" )
+_XTAG( col_Graph_ThreadRunnable, 0xff00a5ff, "Thread state band runnable (waiting for cpu)" )
+_XTAG( col_Graph_ThreadSleeping, 0x60a0a0a0, "Thread state band sleeping" )
+_XTAG( col_Graph_ThreadUninterruptible, 0xff3030e0, "Thread state band uninterruptible sleep" )
+_XTAG( col_Graph_CpuHardIrq, 0xff3050ff, "Cpu graph hard irq handler band" )
+_XTAG( col_Graph_CpuSoftIrq, 0xffffa040, "Cpu graph softirq handler band" )
+_XTAG( col_Graph_CpuIdle, 0xffa06020, "Cpu graph idle state band (deeper states are more opaque)" )
+_XTAG( col_Graph_CpuFreq, 0xff20c0ff, "Cpu graph frequency band (higher clocks are more opaque)" )
+_XTAG( col_Graph_BlockRead, 0xd940c040, "Block device read request bar" )
+_XTAG( col_Graph_BlockWrite, 0xd94060ff, "Block device write request bar" )
+_XTAG( col_Graph_BlockQueueDepth, 0x50ffffff, "Block device queue depth plot" )
+_XTAG( col_Graph_MissedEvents, 0xff3030ff, "Cpu graph lost events marker" )
+_XTAG( col_Graph_DensityEvents, 0xc0b0a060, "Scrollbar overview event rate" )
+_XTAG( col_Graph_DensityGpuBusy, 0xff00c0ff, "Scrollbar overview gpu busy" )
+_XTAG( col_Graph_DensityHitch, 0x900000ff, "Scrollbar overview long frames" )
 
 _XTAG( col_Graph_Bari915ReqWait, 0x4f0000ff, "i915 reqwait bar" )
 
@@ -79,6 +94,13 @@ _XTAG( col_FrameMarkerBk0, 0x32323232, "Frame Marker Background #0" )
 _XTAG( col_FrameMarkerBk1, 0x64646464, "Frame Marker Background #1" )
 _XTAG( col_FrameMarkerSelected, 0x0000ff31, "Selected Frame Marker Background" )
 
+_XTAG( col_CritPath_Running, 0xff00ff00, "Critical path thread running" )
+_XTAG( col_CritPath_Runnable, 0xff00ffff, "Critical path thread runnable" )
+_XTAG( col_CritPath_Blocked, 0xff9e9e9e, "Critical path thread blocked" )
+_XTAG( col_CritPath_BlockedFence, 0xff0000ff, "Critical path fence signaled to thread wakeup" )
+_XTAG( col_CritPath_GpuQueued, 0xffff8000, "Critical path gpu job queued" )
+_XTAG( col_CritPath_GpuExecuting, 0xffff00ff, "Critical path gpu job executing" )
+
 // ImGui colors
 _XTAG( col_ImGui_Text, 0xffe6e6e6, "ImGui text" )
 _XTAG( col_ImGui_TextDisabled, 0xff666666, "ImGui disabled text" )
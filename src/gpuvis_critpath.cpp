@@ -0,0 +1,313 @@
+/*
+ * Copyright 2019 Valve Software
+ *
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <string>
+
+#include <SDL.h>
+
+#include "imgui/imgui.h"
+#include "gpuvis_macros.h"
+#include "stlini.h"
+#include "trace-cmd/trace-read.h"
+#include "gpuvis_utils.h"
+#include "gpuvis.h"
+
+/*
+  Critical path for a frame is found by walking backwards in time from the
+  right frame marker event until we hit the left frame marker timestamp:
+
+    - Thread running: emit a running segment back to when it was switched in.
+    - Thread preempted (switched out with TASK_RUNNING): runnable until switched back in.
+    - Thread sleeping: find the sched_wakeup for it. Time from wakeup to switch in
+      is runnable. Then follow whoever woke us up:
+        - If a gpu job signaled its fence on the waking cpu right before the wakeup,
+          follow the job: fence to wakeup, gpu executing, gpu queued, and continue
+          on the submitting thread at submission time.
+        - Otherwise continue on the waking thread at the wakeup time.
+    - No wakeup found: blocked back to when it was switched out.
+
+  All segments are contiguous, so the segment totals add up to the frame length
+  (less any time we couldn't attribute at the start of the frame).
+ */
+
+// Max number of steps we'll walk backwards for a single frame
+static const uint32_t s_max_steps = 16384;
+
+// Max number of gpu jobs we'll look at when searching for a fence wakeup
+static const uint32_t s_max_fence_jobs = 64;
+
+const char *CriticalPath::seg_type_str( seg_type_t type )
+{
+    switch ( type )
+    {
+    case CPATH_Running:      return "Running";
+    case CPATH_Runnable:     return "Runnable";
+    case CPATH_Blocked:      return "Blocked";
+    case CPATH_BlockedFence: return "Fence Wakeup";
+    case CPATH_GpuQueued:    return "GPU Queued";
+    case CPATH_GpuExecuting: return "GPU Executing";
+    case CPATH_Max:          break;
+    }
+
+    return "";
+}
+
+// Return index of first event in locs with ts >= ts
+static size_t locs_lower_bound_ts( const TraceEventStore &events,
+                                   const std::vector< uint32_t > &locs, int64_t ts )
+{
+    auto it = std::lower_bound( locs.begin(), locs.end(), ts,
+                                [&events]( uint32_t id, int64_t val ) { return events[ id ].ts < val; } );
+
+    return it - locs.begin();
+}
+
+void CriticalPath::start( TraceEvents &trace_events, const FrameMarkers &frame_markers )
+{
+    shutdown();
+
+    m_frames_gen = frame_markers.m_frames_gen;
+    m_trace_events = &trace_events;
+    m_left_frames = frame_markers.m_left_frames;
+    m_right_frames = frame_markers.m_right_frames;
+
+    m_frames.clear();
+    m_segments.clear();
+
+    if ( m_left_frames.empty() )
+        return;
+
+    SDL_AtomicSet( &m_state, State_Running );
+
+    m_thread = SDL_CreateThread( thread_func, "critical_path", this );
+    if ( !m_thread )
+    {
+        logf( "[Error] %s: SDL_CreateThread failed.", __func__ );
+        SDL_AtomicSet( &m_state, State_Idle );
+    }
+}
+
+void CriticalPath::shutdown()
+{
+    if ( m_thread )
+    {
+        SDL_AtomicCAS( &m_state, State_Running, State_Cancel );
+
+        SDL_WaitThread( m_thread, NULL );
+        m_thread = nullptr;
+    }
+
+    SDL_AtomicSet( &m_state, State_Idle );
+}
+
+size_t CriticalPath::find_frame( int64_t ts )
+{
+    auto it = std::lower_bound( m_frames.begin(), m_frames.end(), ts,
+                                []( const frame_t &frame, int64_t val ) { return frame.ts1 < val; } );
+
+    return it - m_frames.begin();
+}
+
+int SDLCALL CriticalPath::thread_func( void *data )
+{
+    CriticalPath *critpath = ( CriticalPath * )data;
+    TraceEventStore &events = critpath->m_trace_events->m_events;
+    size_t count = critpath->m_right_frames.size();
+    util_time_t t0 = util_get_time();
+
+    GPUVIS_TRACE_BLOCKF( "critical_path: %lu frames", count );
+
+    critpath->m_frames.resize( count );
+
+    for ( size_t i = 0; i < count; i++ )
+    {
+        CriticalPath::frame_t &frame = critpath->m_frames[ i ];
+
+        if ( SDL_AtomicGet( &critpath->m_state ) == State_Cancel )
+        {
+            critpath->m_frames.clear();
+            critpath->m_segments.clear();
+            return -1;
+        }
+
+        frame.ts0 = events[ critpath->m_left_frames[ i ] ].ts;
+        frame.ts1 = events[ critpath->m_right_frames[ i ] ].ts;
+        frame.seg_first = critpath->m_segments.size();
+        frame.seg_count = 0;
+        memset( frame.seg_ts, 0, sizeof( frame.seg_ts ) );
+
+        critpath->calculate_frame( frame, critpath->m_right_frames[ i ] );
+    }
+
+    critpath->m_time_ms = util_time_to_ms( t0, util_get_time() );
+
+    logf( "Calculated %lu frame critical paths in %.2fms", count, critpath->m_time_ms );
+
+    SDL_AtomicCAS( &critpath->m_state, State_Running, State_Ready );
+    return 0;
+}
+
+void CriticalPath::add_segment( frame_t &frame, seg_type_t type, int pid, uint32_t row_hashval,
+                                uint32_t eventid, int64_t ts0, int64_t ts1 )
+{
+    // Clip to start of frame
+    ts0 = std::max< int64_t >( ts0, frame.ts0 );
+
+    if ( ts1 > ts0 )
+    {
+        m_segments.push_back( { type, pid, row_hashval, eventid, ts0, ts1 } );
+
+        frame.seg_count++;
+        frame.seg_ts[ type ] += ts1 - ts0;
+    }
+}
+
+// Find gpu job which signaled its fence between block_ts and our wakeup event.
+const gpu_job_t *CriticalPath::find_fence_job( const trace_event_t &wakeup, int64_t block_ts )
+{
+    const std::vector< gpu_job_t > &jobs = m_trace_events->m_gpu_jobs;
+    auto it = std::upper_bound( jobs.begin(), jobs.end(), wakeup.ts,
+                                []( int64_t val, const gpu_job_t &job ) { return val < job.end_ts; } );
+
+    for ( uint32_t i = 0; ( i < s_max_fence_jobs ) && ( it != jobs.begin() ); i++ )
+    {
+        const gpu_job_t &job = *--it;
+
+        if ( job.end_ts < block_ts )
+            break;
+
+        // Fence interrupt handler wakes waiters on the cpu it signaled from. If the
+        // waker is the idle task, assume the latest signaled fence woke us up.
+        if ( ( job.end_cpu == wakeup.cpu ) || !wakeup.pid )
+            return &job;
+    }
+
+    return NULL;
+}
+
+void CriticalPath::calculate_frame( frame_t &frame, uint32_t right_eventid )
+{
+    TraceEvents &trace_events = *m_trace_events;
+    const TraceEventStore &events = trace_events.m_events;
+    const trace_event_t &right_event = events[ right_eventid ];
+    int pid = right_event.pid;
+    int64_t ts = right_event.ts;
+
+    for ( uint32_t step = 0; ( step < s_max_steps ) && pid && ( ts > frame.ts0 ); step++ )
+    {
+        // sched_switch events with our pid as prev_pid. Duration is time running.
+        const std::vector< uint32_t > *plocs = trace_events.get_sched_switch_locs(
+                    pid, TraceEvents::SCHED_SWITCH_PREV );
+
+        if ( !plocs )
+            break;
+
+        const std::vector< uint32_t > &locs = *plocs;
+        size_t idx = locs_lower_bound_ts( events, locs, ts );
+
+        if ( idx < locs.size() )
+        {
+            const trace_event_t &switch_out = events[ locs[ idx ] ];
+
+            if ( switch_out.has_duration() && ( switch_out.ts - switch_out.duration < ts ) )
+            {
+                int64_t run_ts = switch_out.ts - switch_out.duration;
+
+                // Thread was running at ts
+                add_segment( frame, CPATH_Running, pid, 0, switch_out.id, run_ts, ts );
+                ts = run_ts;
+                continue;
+            }
+        }
+
+        // Thread wasn't running at ts. Find when it was switched out.
+        if ( !idx )
+            break;
+
+        const trace_event_t &switch_out = events[ locs[ idx - 1 ] ];
+
+        if ( switch_out.flags & TRACE_FLAG_SCHED_SWITCH_TASK_RUNNING )
+        {
+            // Preempted
+            add_segment( frame, CPATH_Runnable, pid, 0, switch_out.id, switch_out.ts, ts );
+            ts = switch_out.ts;
+            continue;
+        }
+
+        // Sleeping - find the last wakeup before we were switched back in
+        const trace_event_t *wakeup = NULL;
+        const std::vector< uint32_t > *pwakeups = trace_events.m_sched_wakeup_locs.get_locations_u32( pid );
+
+        if ( pwakeups )
+        {
+            size_t i = locs_lower_bound_ts( events, *pwakeups, ts + 1 );
+
+            if ( i && ( events[ pwakeups->at( i - 1 ) ].ts >= switch_out.ts ) )
+                wakeup = &events[ pwakeups->at( i - 1 ) ];
+        }
+
+        if ( !wakeup )
+        {
+            add_segment( frame, CPATH_Blocked, pid, 0, switch_out.id, switch_out.ts, ts );
+            ts = switch_out.ts;
+            continue;
+        }
+
+        add_segment( frame, CPATH_Runnable, pid, 0, wakeup->id, wakeup->ts, ts );
+
+        const gpu_job_t *job = find_fence_job( *wakeup, switch_out.ts );
+
+        if ( job )
+        {
+            add_segment( frame, CPATH_BlockedFence, pid, 0, wakeup->id, job->end_ts, wakeup->ts );
+            add_segment( frame, CPATH_GpuExecuting, -1, job->row_hashval, job->end_eventid, job->exec_ts, job->end_ts );
+            add_segment( frame, CPATH_GpuQueued, -1, job->row_hashval, job->end_eventid, job->submit_ts, job->exec_ts );
+
+            // Continue on the thread which submitted the job
+            pid = job->submit_pid;
+            ts = job->submit_ts;
+        }
+        else if ( wakeup->pid && ( wakeup->pid != pid ) )
+        {
+            // Continue on the thread which woke us up
+            pid = wakeup->pid;
+            ts = wakeup->ts;
+        }
+        else
+        {
+            // Woken by idle (timer, irq, etc.) or ourselves
+            add_segment( frame, CPATH_Blocked, pid, 0, switch_out.id, switch_out.ts, wakeup->ts );
+            ts = switch_out.ts;
+        }
+    }
+}
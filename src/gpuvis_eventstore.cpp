@@ -0,0 +1,367 @@
+/*
+ * Copyright 2019 Valve Software
+ *
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <string>
+
+#if !defined( _WIN32 )
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#include <SDL.h>
+
+#include "imgui/imgui.h"
+#include "gpuvis_macros.h"
+#include "stlini.h"
+#include "trace-cmd/trace-read.h"
+#include "gpuvis_utils.h"
+#include "gpuvis.h"
+
+/*
+  Out of core event storage:
+
+  Events and their field arrays are written to two unlinked temp files which are
+  mmap'd MAP_SHARED into a large reserved address range. The files are grown a
+  block at a time as events are added, so pointers to events and fields never
+  move.
+
+  Since the mappings are file backed, the kernel can always write pages out and
+  fault them back in. We help it along by tracking which blocks the graph and
+  event list are looking at (prefetch) and dropping everything else over our
+  memory budget with MADV_DONTNEED. Code which walks all events (init, critical
+  path, etc.) just faults blocks in as it goes.
+ */
+
+#if defined( _WIN32 )
+
+TraceEventStore::~TraceEventStore()
+{
+}
+
+bool TraceEventStore::init_out_of_core( const char *dir, size_t budget_mb )
+{
+    logf( "[Error] %s: out of core event storage not supported on this platform.", __func__ );
+    return false;
+}
+
+bool TraceEventStore::reserve( size_t count )
+{
+    return false;
+}
+
+void TraceEventStore::release_blocks( size_t keep, bool all )
+{
+}
+
+event_field_t *TraceEventStore::store_fields( const event_field_t *fields, uint32_t numfields )
+{
+    return NULL;
+}
+
+#else
+
+// Address space we reserve for each of the event and field mappings
+static const size_t s_reserve_bytes = ( size_t )1 << 40;
+
+static const size_t s_block_bytes = TraceEventStore::s_block_events * sizeof( trace_event_t );
+
+// Number of fields we grow the fields file by
+static const size_t s_fields_grow = 1024 * 1024;
+
+static int create_unlinked_file( const char *dir, const char *name )
+{
+    std::string filename = string_format( "%s/%s.XXXXXX", dir, name );
+    int fd = mkstemp( &filename[ 0 ] );
+
+    if ( fd < 0 )
+    {
+        logf( "[Error] %s: mkstemp(%s) failed: %s", __func__, filename.c_str(), strerror( errno ) );
+        return -1;
+    }
+
+    // File goes away when we close it (or exit)
+    unlink( filename.c_str() );
+    return fd;
+}
+
+static void *map_reserve( int fd )
+{
+    void *ptr = mmap( NULL, s_reserve_bytes, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_NORESERVE, fd, 0 );
+
+    if ( ptr == MAP_FAILED )
+    {
+        logf( "[Error] %s: mmap failed: %s", __func__, strerror( errno ) );
+        return NULL;
+    }
+
+    return ptr;
+}
+
+TraceEventStore::~TraceEventStore()
+{
+    if ( m_fd >= 0 )
+    {
+        munmap( m_data, s_reserve_bytes );
+        close( m_fd );
+    }
+
+    if ( m_fields_fd >= 0 )
+    {
+        munmap( m_fields, s_reserve_bytes );
+        close( m_fields_fd );
+    }
+}
+
+bool TraceEventStore::init_out_of_core( const char *dir, size_t budget_mb )
+{
+    // Only allowed before any events have been added
+    if ( m_size || is_out_of_core() )
+        return false;
+
+    m_fd = create_unlinked_file( dir, "gpuvis_events" );
+    m_fields_fd = create_unlinked_file( dir, "gpuvis_fields" );
+
+    if ( m_fd >= 0 )
+        m_data = ( trace_event_t * )map_reserve( m_fd );
+    if ( m_fields_fd >= 0 )
+        m_fields = ( event_field_t * )map_reserve( m_fields_fd );
+
+    if ( !m_data || !m_fields )
+    {
+        if ( m_data )
+            munmap( m_data, s_reserve_bytes );
+        if ( m_fields )
+            munmap( m_fields, s_reserve_bytes );
+        if ( m_fd >= 0 )
+            close( m_fd );
+        if ( m_fields_fd >= 0 )
+            close( m_fields_fd );
+
+        m_data = nullptr;
+        m_fields = nullptr;
+        m_fd = -1;
+        m_fields_fd = -1;
+        return false;
+    }
+
+    // Always keep at least the block being written and one other block resident
+    m_budget_blocks = std::max< size_t >( 2, ( budget_mb * 1024 * 1024 ) / s_block_bytes );
+
+    logf( "Out of core event storage in %s: %lu blocks (%luMB) resident",
+          dir, m_budget_blocks, ( m_budget_blocks * s_block_bytes ) / ( 1024 * 1024 ) );
+    return true;
+}
+
+bool TraceEventStore::reserve( size_t count )
+{
+    size_t bytes = count * sizeof( trace_event_t );
+
+    if ( bytes > s_reserve_bytes )
+        return false;
+
+    if ( ftruncate( m_fd, bytes ) < 0 )
+    {
+        logf( "[Error] %s: ftruncate failed: %s", __func__, strerror( errno ) );
+        return false;
+    }
+
+    m_capacity = count;
+    return true;
+}
+
+void TraceEventStore::release_blocks( size_t keep, bool all )
+{
+    // Find last_used tick of the keep'th most recently used block
+    std::vector< uint64_t > ticks;
+    uint64_t min_tick = 1;
+
+    for ( const block_t &block : m_blocks )
+    {
+        if ( block.last_used )
+            ticks.push_back( block.last_used );
+    }
+
+    if ( ticks.size() > keep )
+    {
+        auto nth = ticks.end() - keep;
+
+        std::nth_element( ticks.begin(), nth, ticks.end() );
+        min_tick = ( nth == ticks.end() ) ? UINT64_MAX : *nth;
+    }
+
+    // Drop blocks outside our working set. Blocks we already released may have
+    //  been faulted back in by random access, so those are only dropped with all.
+    for ( size_t i = 0; i < m_blocks.size(); i++ )
+    {
+        block_t &block = m_blocks[ i ];
+
+        if ( ( block.last_used || all ) && ( block.last_used < min_tick ) )
+        {
+            size_t count = std::min< size_t >( s_block_events, m_size - i * s_block_events );
+
+            madvise( m_data + i * s_block_events, count * sizeof( trace_event_t ), MADV_DONTNEED );
+            block.last_used = 0;
+        }
+    }
+
+    // Fields are only touched for events we're displaying, so drop them all
+    size_t fields_start = all ? 0 : m_fields_released;
+    size_t fields_end = ( m_fields_size * sizeof( event_field_t ) ) & ~( size_t )( 4096 - 1 );
+
+    if ( fields_end > fields_start )
+        madvise( ( char * )m_fields + fields_start, fields_end - fields_start, MADV_DONTNEED );
+    m_fields_released = fields_end;
+}
+
+event_field_t *TraceEventStore::store_fields( const event_field_t *fields, uint32_t numfields )
+{
+    if ( m_fields_size + numfields > m_fields_capacity )
+    {
+        size_t capacity = m_fields_capacity + std::max< size_t >( s_fields_grow, numfields );
+        size_t bytes = capacity * sizeof( event_field_t );
+
+        if ( ( bytes > s_reserve_bytes ) || ( ftruncate( m_fields_fd, bytes ) < 0 ) )
+            return NULL;
+
+        m_fields_capacity = capacity;
+    }
+
+    event_field_t *dst = m_fields + m_fields_size;
+
+    memcpy( dst, fields, numfields * sizeof( event_field_t ) );
+    m_fields_size += numfields;
+
+    return dst;
+}
+
+#endif // _WIN32
+
+bool TraceEventStore::push_back( const trace_event_t &event )
+{
+    size_t iblock = m_size / s_block_events;
+
+    if ( !is_out_of_core() )
+    {
+        m_vec.push_back( event );
+        m_data = m_vec.data();
+    }
+    else
+    {
+        if ( ( m_size >= m_capacity ) && !reserve( m_capacity + s_block_events ) )
+        {
+            logf( "[Error] %s: failed to grow event storage.", __func__ );
+            return false;
+        }
+
+        m_data[ m_size ] = event;
+    }
+
+    m_size++;
+
+    if ( iblock >= m_blocks.size() )
+    {
+        m_blocks.push_back( block_t() );
+
+        if ( is_out_of_core() )
+        {
+            // Previous block is done: let it go if we're over budget
+            m_blocks[ iblock ].last_used = ++m_tick;
+            release_blocks( m_budget_blocks, false );
+        }
+    }
+
+    block_t &block = m_blocks[ iblock ];
+
+    block.min_ts = std::min< int64_t >( block.min_ts, event.ts );
+    block.max_ts = std::max< int64_t >( block.max_ts, event.ts );
+    return true;
+}
+
+size_t TraceEventStore::lower_bound_ts( int64_t ts ) const
+{
+    // First block which has events >= ts
+    auto it = std::lower_bound( m_blocks.begin(), m_blocks.end(), ts,
+                                []( const block_t &block, int64_t val ) { return block.max_ts < val; } );
+
+    if ( it == m_blocks.end() )
+        return m_size;
+
+    size_t start = ( it - m_blocks.begin() ) * s_block_events;
+    size_t end = std::min< size_t >( start + s_block_events, m_size );
+    const trace_event_t *event = std::lower_bound( m_data + start, m_data + end, ts,
+                                                   []( const trace_event_t &e, int64_t val ) { return e.ts < val; } );
+
+    return event - m_data;
+}
+
+void TraceEventStore::prefetch( uint32_t id0, uint32_t id1 )
+{
+    bool changed = false;
+
+    id1 = std::min< size_t >( id1, m_size );
+
+    if ( !is_out_of_core() || ( id0 >= id1 ) )
+        return;
+
+    for ( size_t i = id0 / s_block_events; i <= ( id1 - 1 ) / s_block_events; i++ )
+    {
+        block_t &block = m_blocks[ i ];
+
+        if ( !block.last_used )
+        {
+#if !defined( _WIN32 )
+            size_t count = std::min< size_t >( s_block_events, m_size - i * s_block_events );
+
+            madvise( m_data + i * s_block_events, count * sizeof( trace_event_t ), MADV_WILLNEED );
+#endif
+            changed = true;
+        }
+
+        block.last_used = ++m_tick;
+    }
+
+    // Working set changed: drop least recently used blocks
+    if ( changed )
+        release_blocks( m_budget_blocks, false );
+}
+
+void TraceEventStore::trim()
+{
+    if ( is_out_of_core() )
+        release_blocks( m_budget_blocks, true );
+}
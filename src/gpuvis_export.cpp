@@ -0,0 +1,981 @@
+/*
+ * Copyright 2019 Valve Software
+ *
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <string>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <memory>
+
+#if !defined( _WIN32 )
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#include <SDL.h>
+
+#include "imgui/imgui.h"
+#include "gpuvis_macros.h"
+#include "stlini.h"
+#include "trace-cmd/trace-read.h"
+#include "gpuvis_utils.h"
+#include "gpuvis.h"
+
+/*
+  Arrow IPC file (Feather V2) export:
+
+  Each table is written as a separate file:
+
+    "ARROW1\0\0"
+    Schema message
+    DictionaryBatch message (id 0: utf8 strings used by this table)
+    RecordBatch messages
+    End of stream marker
+    Footer flatbuffer, int32 footer size, "ARROW1"
+
+  Messages are 0xFFFFFFFF, int32 metadata size, Message flatbuffer (padded to 8),
+  and then the body buffers (each padded to 8).
+
+  All string columns are dictionary encoded against the StrPool strings. A first
+  pass over the table marks which pool strings are used, those get packed into
+  the dictionary, and a second pass converts string pointers to dictionary
+  indices while building the record batches. Both passes run on record batches
+  in parallel, and batches are written in order as each wave completes.
+ */
+
+// Rows per record batch
+static const size_t s_batch_rows = 1024 * 1024;
+
+// Arrow MetadataVersion::V5
+static const int16_t s_metadata_version = 4;
+
+// Arrow MessageHeader union types
+enum arrow_header_t
+{
+    ARROW_HEADER_Schema = 1,
+    ARROW_HEADER_DictionaryBatch = 2,
+    ARROW_HEADER_RecordBatch = 3,
+};
+
+// Arrow Type union types
+enum arrow_typeid_t
+{
+    ARROW_TYPE_Int = 2,
+    ARROW_TYPE_Utf8 = 5,
+};
+
+enum export_type_t
+{
+    EXPORT_Int32,
+    EXPORT_UInt32,
+    EXPORT_Int64,
+    EXPORT_Str,     // const char * from StrPool, dictionary encoded
+};
+
+struct export_col_t
+{
+    const char *name;
+    export_type_t type;
+
+    // Values equal to null_val are written as nulls
+    bool has_null;
+    int64_t null_val;
+};
+
+struct export_table_t
+{
+    const char *name;
+    std::vector< export_col_t > cols;
+
+    // Row count of each record batch
+    std::vector< size_t > batch_rows;
+
+    // Write values of column col for record batch into dst (sized batch_rows * 8)
+    std::function< void ( size_t batch, size_t col, void *dst ) > fill;
+};
+
+/*
+ * Minimal flatbuffer builder.
+ *
+ * Flatbuffers are normally built back to front. We build front to back instead,
+ * writing each table with zero placeholders for offset fields and patching them
+ * once the child objects have been written after it (uoffsets point forward).
+ */
+struct fb_field_t
+{
+    uint32_t size;      // 0: field not present
+    uint64_t val;
+};
+
+static fb_field_t fb_none()                { return { 0, 0 }; }
+static fb_field_t fb_bool( bool val )      { return { 1, val }; }
+static fb_field_t fb_u8( uint8_t val )     { return { 1, val }; }
+static fb_field_t fb_i16( int16_t val )    { return { 2, ( uint16_t )val }; }
+static fb_field_t fb_i32( int32_t val )    { return { 4, ( uint32_t )val }; }
+static fb_field_t fb_i64( int64_t val )    { return { 8, ( uint64_t )val }; }
+static fb_field_t fb_offset()              { return { 4, 0 }; }
+
+class FlatBuf
+{
+public:
+    // Start with root table offset
+    FlatBuf() { m_buf.resize( 4, 0 ); }
+
+    // Write table with fields in field id order, returning position of table.
+    //  Field positions are returned in pos so offset fields can be patched.
+    template < size_t N >
+    size_t table( const fb_field_t ( &fields )[ N ], size_t ( &pos )[ N ] )
+    {
+        // vtable: uint16 vtable size, table size, field offsets
+        align( 2 );
+        size_t vtable = m_buf.size();
+        m_buf.resize( vtable + 4 + 2 * N, 0 );
+        set< uint16_t >( vtable, 4 + 2 * N );
+
+        align( 8 );
+        size_t tbl = m_buf.size();
+        put< int32_t >( ( int32_t )( tbl - vtable ) );
+
+        std::fill( pos, pos + N, 0 );
+
+        // Lay out largest fields first so everything stays naturally aligned
+        for ( uint32_t size = 8; size; size >>= 1 )
+        {
+            for ( size_t i = 0; i < N; i++ )
+            {
+                if ( fields[ i ].size != size )
+                    continue;
+
+                align( size );
+                pos[ i ] = m_buf.size();
+                m_buf.insert( m_buf.end(), ( const uint8_t * )&fields[ i ].val,
+                              ( const uint8_t * )&fields[ i ].val + size );
+            }
+        }
+
+        set< uint16_t >( vtable + 2, m_buf.size() - tbl );
+        for ( size_t i = 0; i < N; i++ )
+            set< uint16_t >( vtable + 4 + 2 * i, pos[ i ] ? ( pos[ i ] - tbl ) : 0 );
+
+        return tbl;
+    }
+
+    // Vector of structs. Returns position of vector.
+    size_t vec_structs( const void *data, size_t elemsize, size_t count )
+    {
+        // Elements are 8 byte aligned, so length goes at 8n + 4
+        align( 4 );
+        if ( !( m_buf.size() & 7 ) )
+            pad( 4 );
+
+        size_t vec = m_buf.size();
+        put< uint32_t >( count );
+        m_buf.insert( m_buf.end(), ( const uint8_t * )data, ( const uint8_t * )data + elemsize * count );
+        return vec;
+    }
+
+    // Vector of offsets. Element i at vec + 4 + 4 * i needs to be patched.
+    size_t vec_offsets( size_t count )
+    {
+        align( 4 );
+
+        size_t vec = m_buf.size();
+        put< uint32_t >( count );
+        m_buf.resize( m_buf.size() + 4 * count, 0 );
+        return vec;
+    }
+
+    size_t string( const char *str )
+    {
+        size_t len = strlen( str );
+
+        align( 4 );
+
+        size_t pos = m_buf.size();
+        put< uint32_t >( len );
+        m_buf.insert( m_buf.end(), ( const uint8_t * )str, ( const uint8_t * )str + len + 1 );
+        return pos;
+    }
+
+    // Point offset at pos to target
+    void patch( size_t pos, size_t target )
+    {
+        set< uint32_t >( pos, target - pos );
+    }
+
+    void finish( size_t root )
+    {
+        patch( 0, root );
+        align( 8 );
+    }
+
+    void align( size_t size )
+    {
+        if ( m_buf.size() & ( size - 1 ) )
+            pad( size - ( m_buf.size() & ( size - 1 ) ) );
+    }
+    void pad( size_t size )
+    {
+        m_buf.resize( m_buf.size() + size, 0 );
+    }
+
+    template < typename T >
+    void put( T val )
+    {
+        m_buf.insert( m_buf.end(), ( const uint8_t * )&val, ( const uint8_t * )&val + sizeof( T ) );
+    }
+    template < typename T >
+    void set( size_t pos, T val )
+    {
+        memcpy( &m_buf[ pos ], &val, sizeof( T ) );
+    }
+
+public:
+    std::vector< uint8_t > m_buf;
+};
+
+// Arrow FieldNode and Buffer structs
+struct arrow_node_t
+{
+    int64_t length;
+    int64_t null_count;
+};
+struct arrow_buffer_t
+{
+    int64_t offset;
+    int64_t length;
+};
+
+// Arrow Block struct (footer)
+struct arrow_block_t
+{
+    int64_t offset;
+    int32_t metadata_len;
+    int32_t pad;
+    int64_t body_len;
+};
+
+struct arrow_batch_t
+{
+    size_t rows = 0;
+    std::vector< arrow_node_t > nodes;
+    std::vector< arrow_buffer_t > buffers;
+    std::vector< uint8_t > body;
+
+    void add_buffer( const void *data, size_t len )
+    {
+        buffers.push_back( { ( int64_t )body.size(), ( int64_t )len } );
+
+        body.insert( body.end(), ( const uint8_t * )data, ( const uint8_t * )data + len );
+        body.resize( ( body.size() + 7 ) & ~7, 0 );
+    }
+};
+
+static size_t fb_int_type( FlatBuf &fb, int32_t bitwidth, bool is_signed )
+{
+    const fb_field_t fields[] = { fb_i32( bitwidth ), fb_bool( is_signed ) };
+    size_t pos[ 2 ];
+
+    return fb.table( fields, pos );
+}
+
+static size_t fb_schema( FlatBuf &fb, const std::vector< export_col_t > &cols )
+{
+    const fb_field_t schema_fields[] = { fb_i16( 0 ) /* Little endian */, fb_offset() };
+    size_t schema_pos[ 2 ];
+    size_t schema = fb.table( schema_fields, schema_pos );
+    size_t vec = fb.vec_offsets( cols.size() );
+
+    fb.patch( schema_pos[ 1 ], vec );
+
+    for ( size_t i = 0; i < cols.size(); i++ )
+    {
+        const export_col_t &col = cols[ i ];
+        bool is_str = ( col.type == EXPORT_Str );
+
+        // Field: name, nullable, type_type, type, dictionary, children
+        const fb_field_t fields[] =
+        {
+            fb_offset(), fb_bool( true ),
+            fb_u8( is_str ? ARROW_TYPE_Utf8 : ARROW_TYPE_Int ), fb_offset(),
+            is_str ? fb_offset() : fb_none(), fb_offset()
+        };
+        size_t pos[ 6 ];
+        size_t field = fb.table( fields, pos );
+
+        fb.patch( vec + 4 + 4 * i, field );
+        fb.patch( pos[ 0 ], fb.string( col.name ) );
+
+        if ( is_str )
+        {
+            const fb_field_t utf8_fields[] = { fb_none() };
+            size_t utf8_pos[ 1 ];
+
+            fb.patch( pos[ 3 ], fb.table( utf8_fields, utf8_pos ) );
+
+            // DictionaryEncoding: id, indexType, isOrdered
+            const fb_field_t dict_fields[] = { fb_i64( 0 ), fb_offset(), fb_bool( false ) };
+            size_t dict_pos[ 3 ];
+
+            fb.patch( pos[ 4 ], fb.table( dict_fields, dict_pos ) );
+            fb.patch( dict_pos[ 1 ], fb_int_type( fb, 32, true ) );
+        }
+        else
+        {
+            fb.patch( pos[ 3 ], fb_int_type( fb, ( col.type == EXPORT_Int64 ) ? 64 : 32,
+                                             col.type != EXPORT_UInt32 ) );
+        }
+
+        fb.patch( pos[ 5 ], fb.vec_offsets( 0 ) );
+    }
+
+    return schema;
+}
+
+static size_t fb_record_batch( FlatBuf &fb, const arrow_batch_t &batch )
+{
+    // RecordBatch: length, nodes, buffers
+    const fb_field_t fields[] = { fb_i64( batch.rows ), fb_offset(), fb_offset() };
+    size_t pos[ 3 ];
+    size_t record_batch = fb.table( fields, pos );
+
+    fb.patch( pos[ 1 ], fb.vec_structs( batch.nodes.data(), sizeof( arrow_node_t ), batch.nodes.size() ) );
+    fb.patch( pos[ 2 ], fb.vec_structs( batch.buffers.data(), sizeof( arrow_buffer_t ), batch.buffers.size() ) );
+    return record_batch;
+}
+
+class ArrowFile
+{
+public:
+    ArrowFile() {}
+    ~ArrowFile() { if ( m_fp ) fclose( m_fp ); }
+
+    bool open( const char *filename )
+    {
+        static const char magic[ 8 ] = { 'A', 'R', 'R', 'O', 'W', '1', 0, 0 };
+
+        m_fp = fopen( filename, "wb" );
+        return m_fp && write( magic, sizeof( magic ) );
+    }
+
+    bool write_schema( const std::vector< export_col_t > &cols )
+    {
+        FlatBuf fb;
+        size_t pos[ 4 ];
+        size_t message = message_table( fb, ARROW_HEADER_Schema, 0, pos );
+
+        fb.patch( pos[ 2 ], fb_schema( fb, cols ) );
+        fb.finish( message );
+
+        return write_message( fb, NULL );
+    }
+
+    bool write_dictionary( const arrow_batch_t &batch )
+    {
+        FlatBuf fb;
+        size_t pos[ 4 ];
+        size_t message = message_table( fb, ARROW_HEADER_DictionaryBatch, batch.body.size(), pos );
+
+        // DictionaryBatch: id, data
+        const fb_field_t fields[] = { fb_i64( 0 ), fb_offset() };
+        size_t dict_pos[ 2 ];
+
+        fb.patch( pos[ 2 ], fb.table( fields, dict_pos ) );
+        fb.patch( dict_pos[ 1 ], fb_record_batch( fb, batch ) );
+        fb.finish( message );
+
+        return write_message( fb, &batch, &m_dictionaries );
+    }
+
+    bool write_batch( const arrow_batch_t &batch )
+    {
+        FlatBuf fb;
+        size_t pos[ 4 ];
+        size_t message = message_table( fb, ARROW_HEADER_RecordBatch, batch.body.size(), pos );
+
+        fb.patch( pos[ 2 ], fb_record_batch( fb, batch ) );
+        fb.finish( message );
+
+        return write_message( fb, &batch, &m_batches );
+    }
+
+    bool write_footer( const std::vector< export_col_t > &cols )
+    {
+        static const char magic[ 6 ] = { 'A', 'R', 'R', 'O', 'W', '1' };
+        FlatBuf fb;
+
+        // Footer: version, schema, dictionaries, recordBatches
+        const fb_field_t fields[] = { fb_i16( s_metadata_version ), fb_offset(), fb_offset(), fb_offset() };
+        size_t pos[ 4 ];
+        size_t footer = fb.table( fields, pos );
+
+        fb.patch( pos[ 1 ], fb_schema( fb, cols ) );
+        fb.patch( pos[ 2 ], fb.vec_structs( m_dictionaries.data(), sizeof( arrow_block_t ), m_dictionaries.size() ) );
+        fb.patch( pos[ 3 ], fb.vec_structs( m_batches.data(), sizeof( arrow_block_t ), m_batches.size() ) );
+        fb.finish( footer );
+
+        // End of stream marker, then footer
+        const uint32_t eos[ 2 ] = { 0xffffffff, 0 };
+        int32_t size = fb.m_buf.size();
+        bool ret = write( eos, sizeof( eos ) ) &&
+                write( fb.m_buf.data(), fb.m_buf.size() ) &&
+                write( &size, sizeof( size ) ) &&
+                write( magic, sizeof( magic ) );
+
+        ret = !fclose( m_fp ) && ret;
+        m_fp = NULL;
+        return ret;
+    }
+
+protected:
+    // Message: version, header_type, header, bodyLength
+    size_t message_table( FlatBuf &fb, uint8_t header_type, size_t body_len, size_t ( &pos )[ 4 ] )
+    {
+        const fb_field_t fields[] =
+        {
+            fb_i16( s_metadata_version ), fb_u8( header_type ), fb_offset(), fb_i64( body_len )
+        };
+
+        return fb.table( fields, pos );
+    }
+
+    bool write_message( const FlatBuf &fb, const arrow_batch_t *batch,
+                        std::vector< arrow_block_t > *blocks = NULL )
+    {
+        const uint32_t continuation = 0xffffffff;
+        int32_t size = fb.m_buf.size();
+
+        if ( blocks )
+        {
+            blocks->push_back( { m_offset, ( int32_t )( 8 + size ), 0,
+                                 batch ? ( int64_t )batch->body.size() : 0 } );
+        }
+
+        return write( &continuation, sizeof( continuation ) ) &&
+                write( &size, sizeof( size ) ) &&
+                write( fb.m_buf.data(), fb.m_buf.size() ) &&
+                ( !batch || write( batch->body.data(), batch->body.size() ) );
+    }
+
+    bool write( const void *data, size_t size )
+    {
+        m_offset += size;
+        return !size || ( fwrite( data, size, 1, m_fp ) == 1 );
+    }
+
+public:
+    FILE *m_fp = NULL;
+    int64_t m_offset = 0;
+
+    std::vector< arrow_block_t > m_dictionaries;
+    std::vector< arrow_block_t > m_batches;
+};
+
+class ArrowExporter
+{
+public:
+    ArrowExporter( TraceEvents &trace_events ) : m_trace_events( trace_events ) {}
+    ~ArrowExporter() {}
+
+    void init_strings();
+    bool write_table( const export_table_t &table, const std::string &filename, std::string &errstr );
+
+protected:
+    int32_t str_index( const char *str ) const
+    {
+        if ( str )
+        {
+            auto it = m_str_index.find( str );
+
+            if ( it != m_str_index.end() )
+                return it->second;
+        }
+        return -1;
+    }
+
+    void mark_strings( const export_table_t &table, size_t batch, std::atomic< uint8_t > *used );
+    void build_batch( const export_table_t &table, size_t batch, const std::vector< int32_t > &remap,
+                      arrow_batch_t &out );
+
+public:
+    TraceEvents &m_trace_events;
+    unsigned m_threads = 1;
+
+    // All StrPool strings and their index
+    std::vector< const char * > m_strs;
+    std::unordered_map< const char *, int32_t > m_str_index;
+};
+
+void ArrowExporter::init_strings()
+{
+    m_strs.clear();
+    m_strs.reserve( m_trace_events.m_strpool.m_pool.m_map.size() );
+
+    for ( const auto &it : m_trace_events.m_strpool.m_pool.m_map )
+        m_strs.push_back( it.second );
+
+    m_str_index.clear();
+    m_str_index.reserve( m_strs.size() );
+
+    for ( size_t i = 0; i < m_strs.size(); i++ )
+        m_str_index[ m_strs[ i ] ] = ( int32_t )i;
+
+    m_threads = std::max< unsigned >( 1, std::thread::hardware_concurrency() );
+}
+
+void ArrowExporter::mark_strings( const export_table_t &table, size_t batch, std::atomic< uint8_t > *used )
+{
+    std::vector< const char * > strs( table.batch_rows[ batch ] );
+
+    for ( size_t col = 0; col < table.cols.size(); col++ )
+    {
+        if ( table.cols[ col ].type != EXPORT_Str )
+            continue;
+
+        table.fill( batch, col, strs.data() );
+
+        for ( const char *str : strs )
+        {
+            int32_t idx = str_index( str );
+
+            if ( idx >= 0 )
+                used[ idx ].store( 1, std::memory_order_relaxed );
+        }
+    }
+}
+
+template < typename T >
+static void build_column( arrow_batch_t &out, const export_col_t &col, const T *vals, size_t rows )
+{
+    std::vector< uint8_t > validity;
+    int64_t null_count = 0;
+
+    if ( col.has_null )
+    {
+        for ( size_t i = 0; i < rows; i++ )
+            null_count += ( ( int64_t )vals[ i ] == col.null_val );
+
+        if ( null_count )
+        {
+            validity.resize( ( rows + 7 ) / 8, 0 );
+
+            for ( size_t i = 0; i < rows; i++ )
+            {
+                if ( ( int64_t )vals[ i ] != col.null_val )
+                    validity[ i >> 3 ] |= ( 1 << ( i & 7 ) );
+            }
+        }
+    }
+
+    out.nodes.push_back( { ( int64_t )rows, null_count } );
+    out.add_buffer( validity.data(), validity.size() );
+    out.add_buffer( vals, rows * sizeof( T ) );
+}
+
+void ArrowExporter::build_batch( const export_table_t &table, size_t batch,
+                                 const std::vector< int32_t > &remap, arrow_batch_t &out )
+{
+    size_t rows = table.batch_rows[ batch ];
+    std::vector< uint64_t > vals( rows );
+
+    out.rows = rows;
+
+    for ( size_t col = 0; col < table.cols.size(); col++ )
+    {
+        const export_col_t &export_col = table.cols[ col ];
+
+        table.fill( batch, col, vals.data() );
+
+        switch ( export_col.type )
+        {
+        case EXPORT_Int32:
+            build_column( out, export_col, ( const int32_t * )vals.data(), rows );
+            break;
+        case EXPORT_UInt32:
+            build_column( out, export_col, ( const uint32_t * )vals.data(), rows );
+            break;
+        case EXPORT_Int64:
+            build_column( out, export_col, ( const int64_t * )vals.data(), rows );
+            break;
+        case EXPORT_Str:
+        {
+            // Convert string pointers to dictionary indices in place
+            const char **strs = ( const char ** )vals.data();
+            int32_t *indices = ( int32_t * )vals.data();
+            const export_col_t str_col = { export_col.name, EXPORT_Str, true, -1 };
+
+            for ( size_t i = 0; i < rows; i++ )
+            {
+                int32_t idx = str_index( strs[ i ] );
+
+                indices[ i ] = ( idx >= 0 ) ? remap[ idx ] : -1;
+            }
+
+            build_column( out, str_col, indices, rows );
+            break;
+        }
+        }
+    }
+}
+
+bool ArrowExporter::write_table( const export_table_t &table, const std::string &filename, std::string &errstr )
+{
+    size_t batch_count = table.batch_rows.size();
+    std::unique_ptr< std::atomic< uint8_t >[] > used( new std::atomic< uint8_t >[ m_strs.size() ]() );
+
+    // Mark strings used by this table
+    {
+        std::atomic< size_t > next_batch( 0 );
+        std::vector< std::future< void > > threads;
+
+        for ( unsigned i = 0; i < std::min< size_t >( m_threads, batch_count ); i++ )
+        {
+            threads.push_back( std::async( std::launch::async, [&]()
+            {
+                size_t batch;
+
+                while ( ( batch = next_batch.fetch_add( 1 ) ) < batch_count )
+                    mark_strings( table, batch, used.get() );
+            } ) );
+        }
+        for ( std::future< void > &thread : threads )
+            thread.get();
+    }
+
+    // Pack used strings into our dictionary
+    arrow_batch_t dict;
+    std::vector< int32_t > remap( m_strs.size(), -1 );
+    std::vector< int32_t > offsets( 1, 0 );
+    std::vector< char > data;
+
+    for ( size_t i = 0; i < m_strs.size(); i++ )
+    {
+        if ( !used[ i ].load( std::memory_order_relaxed ) )
+            continue;
+
+        size_t len = strlen( m_strs[ i ] );
+
+        if ( data.size() + len > INT32_MAX )
+        {
+            errstr = string_format( "%s: string dictionary larger than 2GB", table.name );
+            return false;
+        }
+
+        remap[ i ] = ( int32_t )( offsets.size() - 1 );
+        data.insert( data.end(), m_strs[ i ], m_strs[ i ] + len );
+        offsets.push_back( ( int32_t )data.size() );
+    }
+
+    dict.rows = offsets.size() - 1;
+    dict.nodes.push_back( { ( int64_t )dict.rows, 0 } );
+    dict.add_buffer( NULL, 0 );
+    dict.add_buffer( offsets.data(), offsets.size() * sizeof( int32_t ) );
+    dict.add_buffer( data.data(), data.size() );
+
+    ArrowFile file;
+
+    if ( !file.open( filename.c_str() ) ||
+         !file.write_schema( table.cols ) ||
+         !file.write_dictionary( dict ) )
+    {
+        errstr = string_format( "Error writing %s: %s", filename.c_str(), strerror( errno ) );
+        return false;
+    }
+
+    // Build record batches in parallel, writing each wave out in order
+    for ( size_t wave = 0; wave < batch_count; wave += m_threads )
+    {
+        size_t count = std::min< size_t >( m_threads, batch_count - wave );
+        std::vector< arrow_batch_t > batches( count );
+        std::vector< std::future< void > > threads;
+
+        for ( size_t i = 0; i < count; i++ )
+        {
+            threads.push_back( std::async( std::launch::async,
+                                           &ArrowExporter::build_batch, this, std::cref( table ),
+                                           wave + i, std::cref( remap ), std::ref( batches[ i ] ) ) );
+        }
+
+        for ( size_t i = 0; i < count; i++ )
+        {
+            threads[ i ].get();
+
+            if ( !file.write_batch( batches[ i ] ) )
+            {
+                errstr = string_format( "Error writing %s: %s", filename.c_str(), strerror( errno ) );
+                return false;
+            }
+
+            // Free batch memory as soon as it's written
+            std::vector< uint8_t >().swap( batches[ i ].body );
+        }
+    }
+
+    if ( !file.write_footer( table.cols ) )
+    {
+        errstr = string_format( "Error writing %s: %s", filename.c_str(), strerror( errno ) );
+        return false;
+    }
+
+    return true;
+}
+
+// Split row count into record batches
+static std::vector< size_t > export_batches( size_t rows )
+{
+    std::vector< size_t > batch_rows;
+
+    for ( size_t row = 0; row < rows; row += s_batch_rows )
+        batch_rows.push_back( std::min< size_t >( s_batch_rows, rows - row ) );
+
+    return batch_rows;
+}
+
+template < typename T, typename F >
+static void export_fill( void *dst, size_t row0, size_t rows, F func )
+{
+    T *vals = ( T * )dst;
+
+    for ( size_t i = 0; i < rows; i++ )
+        vals[ i ] = func( row0 + i );
+}
+
+static void export_events_table( const TraceEventStore &events, export_table_t &table )
+{
+    table.name = "events";
+    table.cols =
+    {
+        { "id", EXPORT_UInt32, false, 0 },
+        { "ts", EXPORT_Int64, false, 0 },
+        { "duration", EXPORT_Int64, true, INT64_MAX },
+        { "id_start", EXPORT_UInt32, true, INVALID_ID },
+        { "pid", EXPORT_Int32, false, 0 },
+        { "cpu", EXPORT_UInt32, false, 0 },
+        { "flags", EXPORT_UInt32, false, 0 },
+        { "seqno", EXPORT_UInt32, false, 0 },
+        { "crtc", EXPORT_Int32, true, -1 },
+        { "comm", EXPORT_Str, true, 0 },
+        { "system", EXPORT_Str, true, 0 },
+        { "name", EXPORT_Str, true, 0 },
+        { "user_comm", EXPORT_Str, true, 0 },
+    };
+    table.batch_rows = export_batches( events.size() );
+
+    table.fill = [&events]( size_t batch, size_t col, void *dst )
+    {
+        size_t row0 = batch * s_batch_rows;
+        size_t rows = std::min< size_t >( s_batch_rows, events.size() - row0 );
+
+        switch ( col )
+        {
+        case 0: export_fill< uint32_t >( dst, row0, rows, [&]( size_t i ) { return events[ i ].id; } ); break;
+        case 1: export_fill< int64_t >( dst, row0, rows, [&]( size_t i ) { return events[ i ].ts; } ); break;
+        case 2: export_fill< int64_t >( dst, row0, rows, [&]( size_t i ) { return events[ i ].duration; } ); break;
+        case 3: export_fill< uint32_t >( dst, row0, rows, [&]( size_t i ) { return events[ i ].id_start; } ); break;
+        case 4: export_fill< int32_t >( dst, row0, rows, [&]( size_t i ) { return events[ i ].pid; } ); break;
+        case 5: export_fill< uint32_t >( dst, row0, rows, [&]( size_t i ) { return events[ i ].cpu; } ); break;
+        case 6: export_fill< uint32_t >( dst, row0, rows, [&]( size_t i ) { return events[ i ].flags; } ); break;
+        case 7: export_fill< uint32_t >( dst, row0, rows, [&]( size_t i ) { return events[ i ].seqno; } ); break;
+        case 8: export_fill< int32_t >( dst, row0, rows, [&]( size_t i ) { return events[ i ].crtc; } ); break;
+        case 9: export_fill< const char * >( dst, row0, rows, [&]( size_t i ) { return events[ i ].comm; } ); break;
+        case 10: export_fill< const char * >( dst, row0, rows, [&]( size_t i ) { return events[ i ].system; } ); break;
+        case 11: export_fill< const char * >( dst, row0, rows, [&]( size_t i ) { return events[ i ].name; } ); break;
+        case 12: export_fill< const char * >( dst, row0, rows, [&]( size_t i ) { return events[ i ].user_comm; } ); break;
+        }
+    };
+}
+
+// Event fields: one row per event field. Batches are split on event boundaries.
+static void export_fields_table( const TraceEventStore &events, export_table_t &table,
+                                 std::vector< size_t > &batch_event0 )
+{
+    size_t rows = 0;
+
+    table.name = "fields";
+    table.cols =
+    {
+        { "event_id", EXPORT_UInt32, false, 0 },
+        { "key", EXPORT_Str, true, 0 },
+        { "value", EXPORT_Str, true, 0 },
+    };
+
+    batch_event0.push_back( 0 );
+    for ( size_t id = 0; id < events.size(); id++ )
+    {
+        rows += events[ id ].numfields;
+
+        if ( rows >= s_batch_rows )
+        {
+            table.batch_rows.push_back( rows );
+            batch_event0.push_back( id + 1 );
+            rows = 0;
+        }
+    }
+    if ( rows )
+        table.batch_rows.push_back( rows );
+    else
+        batch_event0.pop_back();
+    batch_event0.push_back( events.size() );
+
+    table.fill = [&events, &batch_event0]( size_t batch, size_t col, void *dst )
+    {
+        size_t row = 0;
+
+        for ( size_t id = batch_event0[ batch ]; id < batch_event0[ batch + 1 ]; id++ )
+        {
+            const trace_event_t &event = events[ id ];
+
+            for ( uint32_t i = 0; i < event.numfields; i++, row++ )
+            {
+                if ( col == 0 )
+                    ( ( uint32_t * )dst )[ row ] = event.id;
+                else if ( col == 1 )
+                    ( ( const char ** )dst )[ row ] = event.fields[ i ].key;
+                else
+                    ( ( const char ** )dst )[ row ] = event.fields[ i ].value;
+            }
+        }
+    };
+}
+
+static void export_prints_table( TraceEvents &trace_events, export_table_t &table )
+{
+    const std::vector< uint32_t > &locs = trace_events.m_ftrace.print_locs;
+    const util_umap< uint32_t, print_info_t > &print_info = trace_events.m_ftrace.print_info;
+    const TraceEventStore &events = trace_events.m_events;
+
+    table.name = "prints";
+    table.cols =
+    {
+        { "event_id", EXPORT_UInt32, false, 0 },
+        { "ts", EXPORT_Int64, false, 0 },
+        { "pid", EXPORT_Int32, false, 0 },
+        { "tgid", EXPORT_Int32, false, 0 },
+        { "duration", EXPORT_Int64, true, INT64_MAX },
+        { "buf", EXPORT_Str, true, 0 },
+    };
+    table.batch_rows = export_batches( locs.size() );
+
+    table.fill = [&locs, &print_info, &events]( size_t batch, size_t col, void *dst )
+    {
+        size_t row0 = batch * s_batch_rows;
+        size_t rows = std::min< size_t >( s_batch_rows, locs.size() - row0 );
+        auto info = [&]( size_t i ) { return print_info.get_val( locs[ i ] ); };
+
+        switch ( col )
+        {
+        case 0: export_fill< uint32_t >( dst, row0, rows, [&]( size_t i ) { return locs[ i ]; } ); break;
+        case 1: export_fill< int64_t >( dst, row0, rows, [&]( size_t i ) { return info( i ) ? info( i )->ts : events[ locs[ i ] ].ts; } ); break;
+        case 2: export_fill< int32_t >( dst, row0, rows, [&]( size_t i ) { return events[ locs[ i ] ].pid; } ); break;
+        case 3: export_fill< int32_t >( dst, row0, rows, [&]( size_t i ) { return info( i ) ? info( i )->tgid : 0; } ); break;
+        case 4: export_fill< int64_t >( dst, row0, rows, [&]( size_t i ) { return events[ locs[ i ] ].duration; } ); break;
+        case 5: export_fill< const char * >( dst, row0, rows, [&]( size_t i ) { return info( i ) ? info( i )->buf : NULL; } ); break;
+        }
+    };
+}
+
+// amdgpu, i915 and dma_fence submission -> execution -> completion chains
+static void export_gpu_jobs_table( TraceEvents &trace_events, export_table_t &table )
+{
+    const std::vector< gpu_job_t > &jobs = trace_events.m_gpu_jobs;
+    StrPool &strpool = trace_events.m_strpool;
+
+    table.name = "gpu_jobs";
+    table.cols =
+    {
+        { "row", EXPORT_Str, true, 0 },
+        { "submit_ts", EXPORT_Int64, false, 0 },
+        { "submit_pid", EXPORT_Int32, false, 0 },
+        { "exec_ts", EXPORT_Int64, false, 0 },
+        { "end_ts", EXPORT_Int64, false, 0 },
+        { "end_eventid", EXPORT_UInt32, true, INVALID_ID },
+        { "end_cpu", EXPORT_UInt32, false, 0 },
+    };
+    table.batch_rows = export_batches( jobs.size() );
+
+    table.fill = [&jobs, &strpool]( size_t batch, size_t col, void *dst )
+    {
+        size_t row0 = batch * s_batch_rows;
+        size_t rows = std::min< size_t >( s_batch_rows, jobs.size() - row0 );
+
+        switch ( col )
+        {
+        case 0: export_fill< const char * >( dst, row0, rows, [&]( size_t i ) { return strpool.findstr( jobs[ i ].row_hashval ); } ); break;
+        case 1: export_fill< int64_t >( dst, row0, rows, [&]( size_t i ) { return jobs[ i ].submit_ts; } ); break;
+        case 2: export_fill< int32_t >( dst, row0, rows, [&]( size_t i ) { return jobs[ i ].submit_pid; } ); break;
+        case 3: export_fill< int64_t >( dst, row0, rows, [&]( size_t i ) { return jobs[ i ].exec_ts; } ); break;
+        case 4: export_fill< int64_t >( dst, row0, rows, [&]( size_t i ) { return jobs[ i ].end_ts; } ); break;
+        case 5: export_fill< uint32_t >( dst, row0, rows, [&]( size_t i ) { return jobs[ i ].end_eventid; } ); break;
+        case 6: export_fill< uint32_t >( dst, row0, rows, [&]( size_t i ) { return jobs[ i ].end_cpu; } ); break;
+        }
+    };
+}
+
+bool export_arrow( TraceEvents &trace_events, const char *dir, std::string &errstr )
+{
+    GPUVIS_TRACE_BLOCKF( "export_arrow: %s", dir );
+
+    util_time_t t0 = util_get_time();
+    ArrowExporter exporter( trace_events );
+    std::vector< size_t > fields_batch_event0;
+    export_table_t tables[ 4 ];
+
+#if !defined( _WIN32 )
+    if ( mkdir( dir, S_IRWXU | S_IRWXG | S_IRWXO ) && ( errno != EEXIST ) )
+    {
+        errstr = string_format( "Error creating %s: %s", dir, strerror( errno ) );
+        return false;
+    }
+#endif
+
+    exporter.init_strings();
+
+    export_events_table( trace_events.m_events, tables[ 0 ] );
+    export_fields_table( trace_events.m_events, tables[ 1 ], fields_batch_event0 );
+    export_prints_table( trace_events, tables[ 2 ] );
+    export_gpu_jobs_table( trace_events, tables[ 3 ] );
+
+    for ( const export_table_t &table : tables )
+    {
+        std::string filename = string_format( "%s/%s.arrow", dir, table.name );
+
+        if ( !exporter.write_table( table, filename, errstr ) )
+            return false;
+    }
+
+    logf( "Exported %lu events to %s in %.2fms", trace_events.m_events.size(), dir,
+          util_time_to_ms( t0, util_get_time() ) );
+    return true;
+}
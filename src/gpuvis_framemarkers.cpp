@@ -140,6 +140,14 @@ bool FrameMarkers::show_dlg( TraceEvents &trace_events, uint32_t eventid )
             snprintf_safe( dlg.m_left_marker_buf, "$name = %s", event.name );
     }
 
+    if ( !trace_events.m_frame_candidates.empty() &&
+         ( !dlg.m_left_marker_buf[ 0 ] || !trace_events.get_tdopexpr_locs( dlg.m_left_marker_buf ) ) )
+    {
+        // Current filter doesn't match anything: default to best inferred frame boundary
+        strcpy_safe( dlg.m_left_marker_buf, trace_events.m_frame_candidates[ 0 ].filter.c_str() );
+        dlg.m_right_marker_buf[ 0 ] = 0;
+    }
+
     if ( !dlg.m_left_marker_buf[ 0 ] )
         strcpy_safe( dlg.m_left_marker_buf, "$name = drm_vblank_event && $crtc = 0" );
 
@@ -213,6 +221,48 @@ bool FrameMarkers::render_dlg( TraceEvents &trace_events )
         ImGui::Separator();
     }
 
+    if ( !trace_events.m_frame_candidates.empty() &&
+         ImGui::CollapsingHeader( "Inferred Frame Markers", ImGuiTreeNodeFlags_DefaultOpen ) )
+    {
+        ImGui::BeginChild( "inferred_filters", ImVec2( 0.0f, imgui_scale( 150.0f ) ) );
+        ImGui::Indent();
+
+        ImGuiSelectableFlags flags = ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_DontClosePopups;
+
+        imgui_begin_columns( "framemarker_inferred", { "Filter", "Period", "Confidence" } );
+
+        for ( const frame_candidate_t &candidate : trace_events.m_frame_candidates )
+        {
+            const char *str = candidate.filter.c_str();
+
+            ImGui::PushID( str );
+
+            if ( ImGui::Selectable( str, false, flags ) )
+            {
+                clear_dlg();
+
+                strcpy_safe( dlg.m_left_marker_buf, str );
+                dlg.m_right_marker_buf[ 0 ] = 0;
+            }
+            ImGui::NextColumn();
+
+            ImGui::Text( "%s (%.1f fps)", ts_to_timestr( candidate.period_ts, 2 ).c_str(),
+                         ( double )NSECS_PER_SEC / candidate.period_ts );
+            ImGui::NextColumn();
+
+            ImGui::Text( "%.2f", candidate.confidence );
+            ImGui::NextColumn();
+            ImGui::Separator();
+
+            ImGui::PopID();
+        }
+
+        ImGui::EndColumns();
+
+        ImGui::Unindent();
+        ImGui::EndChild();
+    }
+
     if ( ImGui::CollapsingHeader( "Previous Filters", ImGuiTreeNodeFlags_DefaultOpen ) )
     {
         ImGui::BeginChild( "previous_filters", ImVec2( 0.0f, imgui_scale( 150.0f ) ) );
@@ -343,6 +393,7 @@ void FrameMarkers::setup_frames( TraceEvents &trace_events, bool set_frames )
     {
         m_left_frames.clear();
         m_right_frames.clear();
+        m_frames_gen++;
     }
 
     // Go through all the right eventids...
@@ -379,3 +430,236 @@ void FrameMarkers::setup_frames( TraceEvents &trace_events, bool set_frames )
         }
     }
 }
+
+/*
+  Frame boundary inference. For each event signature (event name, vblank crtc,
+  or ftrace print text up to the first digit) we histogram the time lags between
+  every event and the events following it within s_max_lag. That's the
+  autocorrelation of the signature's event train: a signature firing once per
+  frame has its first strong peak at the frame period.
+
+  The peak is then refined by matching each event with the successor closest to
+  the period, and scored on how many events have a successor there (coverage),
+  how steady those periods are (jitter), and how many signature events there are
+  per period. Anything firing several times per frame can't mark frames alone.
+ */
+
+// Frame periods we look for: 500fps down to 10fps
+static const int64_t s_min_period = 2 * NSECS_PER_MSEC;
+static const int64_t s_max_period = 100 * NSECS_PER_MSEC;
+
+// Lag histogram bucket size and max lag
+static const int64_t s_lag_bin = NSECS_PER_MSEC / 10;
+static const int64_t s_max_lag = s_max_period + s_max_period / 4;
+
+// Signatures need this many events, and we look at this many of them at most
+static const size_t s_min_signature_count = 32;
+static const size_t s_max_signature_samples = 4096;
+
+// Max number of successors we look at for each sampled event
+static const size_t s_max_lag_events = 512;
+
+// Candidates below this confidence aren't reported
+static const float s_min_confidence = 0.2f;
+static const size_t s_max_candidates = 16;
+
+static bool score_frame_signature( const std::vector< int64_t > &ts, frame_candidate_t &candidate )
+{
+    size_t n = ts.size();
+    int64_t span = ts.back() - ts.front();
+
+    if ( ( n < s_min_signature_count ) || ( span <= 0 ) )
+        return false;
+
+    // Skip anything firing way more than a few times per frame, or less than once
+    int64_t mean_ts = span / ( n - 1 );
+    if ( ( mean_ts < s_min_period / 8 ) || ( mean_ts > s_max_period * 2 ) )
+        return false;
+
+    size_t stride = std::max< size_t >( 1, n / s_max_signature_samples );
+    std::vector< uint32_t > hist( s_max_lag / s_lag_bin + 1, 0 );
+
+    for ( size_t i = 0; i < n; i += stride )
+    {
+        size_t jmax = std::min< size_t >( n, i + s_max_lag_events );
+
+        for ( size_t j = i + 1; ( j < jmax ) && ( ts[ j ] - ts[ i ] < s_max_lag ); j++ )
+            hist[ ( ts[ j ] - ts[ i ] ) / s_lag_bin ]++;
+    }
+
+    // Smooth over neighboring buckets and find the largest peak
+    size_t bin0 = s_min_period / s_lag_bin;
+    size_t bin1 = s_max_period / s_lag_bin;
+    std::vector< uint32_t > smooth( bin1 + 2, 0 );
+    uint32_t peak = 0;
+
+    for ( size_t b = bin0; b <= bin1; b++ )
+    {
+        smooth[ b ] = hist[ b - 1 ] + hist[ b ] + hist[ b + 1 ];
+        peak = std::max< uint32_t >( peak, smooth[ b ] );
+    }
+    if ( !peak )
+        return false;
+
+    // Fundamental is the first local max close to the peak. Later peaks are harmonics.
+    size_t bin = bin1;
+    for ( size_t b = bin0 + 1; b < bin1; b++ )
+    {
+        if ( ( smooth[ b ] * 10 >= peak * 6 ) &&
+             ( smooth[ b ] >= smooth[ b - 1 ] ) && ( smooth[ b ] >= smooth[ b + 1 ] ) )
+        {
+            bin = b;
+            break;
+        }
+    }
+
+    // Match each sampled event with successor closest to the period
+    int64_t period = bin * s_lag_bin + s_lag_bin / 2;
+    int64_t tolerance = period * 15 / 100;
+    std::vector< int64_t > deltas;
+    size_t samples = 0;
+
+    for ( size_t i = 0; i + 1 < n; i += stride )
+    {
+        int64_t best = INT64_MAX;
+        size_t jmax = std::min< size_t >( n, i + s_max_lag_events );
+
+        samples++;
+        for ( size_t j = i + 1; ( j < jmax ) && ( ts[ j ] - ts[ i ] <= period + tolerance ); j++ )
+        {
+            int64_t delta = ts[ j ] - ts[ i ];
+
+            if ( std::abs( delta - period ) < std::abs( best - period ) )
+                best = delta;
+        }
+
+        if ( std::abs( best - period ) <= tolerance )
+            deltas.push_back( best );
+    }
+
+    if ( deltas.size() < s_min_signature_count / 4 )
+        return false;
+
+    std::nth_element( deltas.begin(), deltas.begin() + deltas.size() / 2, deltas.end() );
+    period = deltas[ deltas.size() / 2 ];
+
+    double jitter = 0.0;
+    for ( int64_t delta : deltas )
+        jitter += std::abs( delta - period );
+    jitter /= deltas.size() * ( double )period;
+
+    double coverage = ( double )deltas.size() / samples;
+    double per_period = ( double )( n - 1 ) * period / span;
+
+    candidate.period_ts = period;
+    candidate.count = n;
+    candidate.confidence = coverage * std::max( 0.0, 1.0 - 4.0 * jitter ) / std::max( 1.0, per_period );
+
+    return candidate.confidence >= s_min_confidence;
+}
+
+// Ftrace print signature: print text up to the first digit. Returns empty string if not usable.
+static std::string get_print_signature( const char *buf )
+{
+    size_t len = strcspn( buf, "0123456789\"" );
+
+    if ( buf[ len ] == '"' )
+        return "";
+
+    while ( len && strchr( " \t:=#(,[-", buf[ len - 1 ] ) )
+        len--;
+
+    if ( len < 4 )
+        return "";
+
+    return std::string( buf, std::min< size_t >( len, 64 ) );
+}
+
+void TraceEvents::calculate_frame_candidates()
+{
+    GPUVIS_TRACE_BLOCK( __func__ );
+
+    util_time_t t0 = util_get_time();
+    std::vector< int64_t > ts;
+
+    m_frame_candidates.clear();
+
+    auto add_signature = [&]( const std::vector< uint32_t > &locs, const std::string &filter )
+    {
+        frame_candidate_t candidate;
+
+        if ( locs.size() < s_min_signature_count )
+            return;
+
+        ts.clear();
+        for ( uint32_t id : locs )
+            ts.push_back( m_events[ id ].ts );
+
+        if ( score_frame_signature( ts, candidate ) )
+        {
+            candidate.filter = filter;
+            m_frame_candidates.push_back( candidate );
+        }
+    };
+
+    // Event names (vblanks are split by crtc)
+    for ( const auto &item : m_eventnames_locs.m_locs.m_map )
+    {
+        const std::vector< uint32_t > &locs = item.second;
+        const trace_event_t &event = m_events[ locs[ 0 ] ];
+
+        if ( event.is_ftrace_print() )
+            continue;
+
+        if ( event.is_vblank() )
+            add_signature( locs, string_format( "$name = %s && $crtc = %d", event.name, event.crtc ) );
+        else
+            add_signature( locs, string_format( "$name = %s", event.name ) );
+    }
+
+    // Ftrace prints grouped by their leading text
+    {
+        util_umap< uint32_t, std::vector< uint32_t > > print_locs;
+        util_umap< uint32_t, std::string > print_sigs;
+
+        for ( uint32_t id : m_ftrace.print_locs )
+        {
+            const std::string sig = get_print_signature( get_event_field_val( m_events[ id ], "buf" ) );
+
+            if ( !sig.empty() )
+            {
+                uint32_t hashval = hashstr32( sig );
+
+                print_locs.get_val_create( hashval )->push_back( id );
+                print_sigs.get_val( hashval, sig );
+            }
+        }
+
+        for ( const auto &item : print_locs.m_map )
+        {
+            const std::string *sig = print_sigs.get_val( item.first );
+
+            add_signature( item.second, string_format( "$buf =~ \"%s\"", sig->c_str() ) );
+        }
+    }
+
+    std::sort( m_frame_candidates.begin(), m_frame_candidates.end(),
+               []( const frame_candidate_t &lx, const frame_candidate_t &rx ) { return lx.confidence > rx.confidence; } );
+    if ( m_frame_candidates.size() > s_max_candidates )
+        m_frame_candidates.resize( s_max_candidates );
+
+    float time_ms = util_time_to_ms( t0, util_get_time() );
+
+    if ( m_frame_candidates.empty() )
+    {
+        logf( "No frame marker candidates found (%.2fms)", time_ms );
+    }
+    else
+    {
+        const frame_candidate_t &best = m_frame_candidates[ 0 ];
+
+        logf( "Found %lu frame marker candidates in %.2fms. Best: %s (%.2f fps, confidence %.2f)",
+              m_frame_candidates.size(), time_ms, best.filter.c_str(),
+              ( double )NSECS_PER_SEC / best.period_ts, best.confidence );
+    }
+}
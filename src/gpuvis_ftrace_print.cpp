@@ -285,13 +285,15 @@ void TraceEvents::new_event_ftrace_print( trace_event_t &event )
     {
         ts_offset_str += 7;
         ts_offset = atoll( ts_offset_str );
+        if ( ts_offset )
+            m_ftrace.ts_offsets.get_val( event.id, ts_offset );
 
         buf = trim_ftrace_print_buf( newbuf, buf, ts_offset_str, 7 );
     }
 
-    if ( !tid_offset_str && !ts_offset_str )
+    if ( !tid_offset_str )
     {
-        // Hash the buf string
+        // Hash the buf string (with any "offset=" trimmed off)
         uint32_t hashval = hashstr32( buf );
         uint64_t key = ( ( uint64_t )event.pid << 32 );
 
@@ -302,9 +304,10 @@ void TraceEvents::new_event_ftrace_print( trace_event_t &event )
         {
             // Found hash+pid in duration map. Value is start event id.
             trace_event_t &event0 = m_events[ *event0id ];
+            const int64_t *ts_offset0 = m_ftrace.ts_offsets.get_val( event0.id );
 
             event0.id_start = event.id;
-            event0.duration = event.ts - event0.ts;
+            event0.duration = ( event.ts + ts_offset ) - ( event0.ts + ( ts_offset0 ? *ts_offset0 : 0 ) );
             event0.color_index = hashval;
             event.color_index = hashval;
 
@@ -392,9 +395,14 @@ void TraceEvents::new_event_ftrace_print( trace_event_t &event )
                 // We have a begin/end pair for this ctx
                 trace_event_t &event0 = m_events[ *begin_eventid ];
                 const trace_event_t &event1 = m_events[ *end_eventid ];
+                const int64_t *ts_offset0 = m_ftrace.ts_offsets.get_val( event0.id );
+                const int64_t *ts_offset1 = m_ftrace.ts_offsets.get_val( event1.id );
+
+                // Buffered markers are written late: use the ts they were recorded at
+                ts_offset = ts_offset0 ? *ts_offset0 : 0;
 
                 event0.id_start = event1.id;
-                event0.duration = event1.ts - event0.ts;
+                event0.duration = ( event1.ts + ( ts_offset1 ? *ts_offset1 : 0 ) ) - ( event0.ts + ts_offset );
 
                 // Handle the case where a begin_ctx has no text, or vice versa
                 if ( buf[ 0 ] )
@@ -205,6 +205,23 @@ public:
 
     int hovered_framemarker_frame = -1;
 
+    // Hovered thread state band run
+    int hovered_thread_state_pid = -1;
+    size_t hovered_thread_state_idx = 0;
+
+    // Hovered irq / softirq interval in cpu graph
+    uint32_t hovered_irq_cpu = 0;
+    const irq_interval_t *hovered_irq = nullptr;
+
+    // Hovered cpu idle / frequency step in cpu graph
+    uint32_t hovered_cpu_step_cpu = 0;
+    const cpu_step_t *hovered_cpu_step = nullptr;
+    bool hovered_cpu_step_idle = false;
+
+    // Hovered lost events marker in cpu graph
+    const missed_events_t *hovered_missed_events = nullptr;
+    uint32_t hovered_missed_events_cpu = 0;
+
     bool timeline_render_user;
     bool graph_only_filtered;
 
@@ -511,7 +528,10 @@ static option_id_t get_comm_option_id( const std::string &row_name, loc_type_t r
          row_type == LOC_TYPE_Plot ||
          row_type == LOC_TYPE_AMDTimeline ||
          row_type == LOC_TYPE_i915RequestWait ||
-         row_type == LOC_TYPE_i915Request )
+         row_type == LOC_TYPE_i915Request ||
+         row_type == LOC_TYPE_DmaFence ||
+         row_type == LOC_TYPE_Workqueue ||
+         row_type == LOC_TYPE_BlockDev )
     {
         int defval = 4;
         int minval = 4;
@@ -554,6 +574,9 @@ RenderGraphRowCallback graph_info_t::get_render_cb( loc_type_t row_type )
     case LOC_TYPE_AMDTimeline_hw:  return std::bind( &TraceWin::graph_render_amdhw_timeline, &win, _1 );
     case LOC_TYPE_i915Request:     return std::bind( &TraceWin::graph_render_i915_req_events, &win, _1 );
     case LOC_TYPE_i915RequestWait: return std::bind( &TraceWin::graph_render_i915_reqwait_events, &win, _1 );
+    case LOC_TYPE_DmaFence:        return std::bind( &TraceWin::graph_render_dma_fence_timeline, &win, _1 );
+    case LOC_TYPE_Workqueue:       return std::bind( &TraceWin::graph_render_workqueue_timeline, &win, _1 );
+    case LOC_TYPE_BlockDev:        return std::bind( &TraceWin::graph_render_block_timeline, &win, _1 );
     // LOC_TYPE_Comm or LOC_TYPE_Tdopexpr hopefully...
     default:                       return std::bind( &TraceWin::graph_render_row_events, &win, _1 );
     }
@@ -720,6 +743,8 @@ void graph_info_t::set_ts( int64_t start_ts, int64_t length_ts )
     eventstart = win.ts_to_eventid( ts0 );
     eventend = win.ts_to_eventid( ts1 );
 
+    win.m_trace_events.m_events.prefetch( eventstart, eventend + 1 );
+
     tsdx = ts1 - ts0 + 1;
     tsdxrcp = 1.0 / tsdx;
 }
@@ -728,7 +753,7 @@ void graph_info_t::init()
 {
     const ImVec2 windowpos = ImGui::GetCursorScreenPos();
     const ImVec2 windowsize = ImGui::GetContentRegionAvail();
-    const std::vector< trace_event_t > &events = win.m_trace_events.m_events;
+    const TraceEventStore &events = win.m_trace_events.m_events;
 
     rcwin = { windowpos.x, windowpos.y, windowsize.x, windowsize.y };
 
@@ -1331,6 +1356,34 @@ uint32_t TraceWin::graph_render_plot( graph_info_t &gi )
                 m_trace_events.m_events[ idx0 ].color : 0xffffffff;
     ImU32 color_point = imgui_col_complement( color_line );
 
+    // Dense plots get several points per pixel when zoomed out. Those are
+    //  merged into first, min, max, and last points for each pixel column.
+    struct
+    {
+        float x = -FLT_MAX;
+        float first = 0.0f;
+        float min = 0.0f;
+        float max = 0.0f;
+        float last = 0.0f;
+        uint32_t count = 0;
+    } bucket;
+    auto flush_bucket = [&]()
+    {
+        if ( bucket.count )
+        {
+            points.push_back( ImVec2( bucket.x, bucket.first ) );
+            if ( bucket.count > 2 )
+            {
+                points.push_back( ImVec2( bucket.x, bucket.min ) );
+                points.push_back( ImVec2( bucket.x, bucket.max ) );
+            }
+            if ( bucket.count > 1 )
+                points.push_back( ImVec2( bucket.x, bucket.last ) );
+        }
+        bucket.count = 0;
+    };
+    size_t plotdata_count = 0;
+
     for ( size_t idx = index0; idx < plot.m_plotdata.size(); idx++ )
     {
         GraphPlot::plotdata_t &data = plot.m_plotdata[ idx ];
@@ -1343,18 +1396,33 @@ uint32_t TraceWin::graph_render_plot( graph_info_t &gi )
             maxval = y;
         }
 
-        points.push_back( ImVec2( x, y ) );
+        if ( floorf( x ) != bucket.x )
+        {
+            flush_bucket();
+
+            bucket.x = floorf( x );
+            bucket.first = y;
+            bucket.min = y;
+            bucket.max = y;
+        }
+
+        bucket.min = std::min< float >( bucket.min, y );
+        bucket.max = std::max< float >( bucket.max, y );
+        bucket.last = y;
+        bucket.count++;
+        plotdata_count++;
 
         minval = std::min< float >( minval, y );
         maxval = std::max< float >( maxval, y );
 
         // Check if we're mouse hovering this event
-        if ( gi.mouse_over )
+        if ( gi.mouse_over && ( fabsf( x - gi.mouse_pos.x ) < imgui_scale( 8.0f ) ) )
             gi.add_mouse_hovered_event( x, get_event( data.eventid ) );
 
         if ( x >= gi.rc.x + gi.rc.w )
             break;
     }
+    flush_bucket();
 
     if ( points.size() )
     {
@@ -1377,15 +1445,18 @@ uint32_t TraceWin::graph_render_plot( graph_info_t &gi )
         ImGui::GetWindowDrawList()->AddPolyline( points.data(), points.size(),
                                                  color_line, closed, thickness );
 
-        for ( const ImVec2 &pt : points )
+        // Only draw points if they're not merged
+        for ( size_t i = 0; ( plotdata_count == points.size() ) && ( i < points.size() ); i++ )
         {
+            const ImVec2 &pt = points[ i ];
+
             imgui_drawrect_filled( pt.x - imgui_scale( 1.5f ), pt.y - imgui_scale( 1.5f ),
                                    imgui_scale( 3.0f ), imgui_scale( 3.0f ),
                                    color_point );
         }
     }
 
-    return points.size();
+    return plotdata_count;
 }
 
 class row_draw_info_t
@@ -1649,6 +1720,133 @@ uint32_t TraceWin::graph_render_cpus_timeline( graph_info_t &gi )
         DrawList->AddLine( ImVec2( x, y + row_h ), ImVec2( x + gi.rc.w, y + row_h ), color );
     }
 
+    // Irq and softirq handlers along the bottom of each cpu row
+    if ( s_opts().getb( OPT_RenderCpuIrqs ) )
+    {
+        ImU32 color_irq[ 2 ] =
+        {
+            s_clrs().get( col_Graph_CpuHardIrq ),
+            s_clrs().get( col_Graph_CpuSoftIrq )
+        };
+        float band_h = std::max< float >( imgui_scale( 2.0f ), floor( row_h / 5 ) );
+
+        for ( uint32_t cpu = 0; cpu < std::min< size_t >( cpus, m_trace_events.m_irq_intervals.size() ); cpu++ )
+        {
+            const std::vector< irq_interval_t > &intervals = m_trace_events.m_irq_intervals[ cpu ];
+            float y = gi.rc.y + ( cpu + 1 ) * row_h - band_h;
+
+            if ( ( y > gi.rcwin.y + gi.rcwin.h ) || ( y + band_h < gi.rcwin.y ) )
+                continue;
+
+            for ( size_t idx = m_trace_events.get_irq_interval_idx( cpu, gi.ts0 );
+                  ( idx < intervals.size() ) && ( intervals[ idx ].ts0 <= gi.ts1 );
+                  idx++ )
+            {
+                const irq_interval_t &interval = intervals[ idx ];
+                float x0 = gi.ts_to_screenx( interval.ts0 );
+                float x1 = gi.ts_to_screenx( interval.ts1 );
+                float w = std::max< float >( x1 - x0, 1.0f );
+
+                imgui_drawrect_filled( x0, y, w, band_h, color_irq[ interval.softirq ] );
+
+                if ( gi.mouse_pos_in_rect( { x0, y, w, band_h } ) )
+                {
+                    gi.hovered_irq = &interval;
+                    gi.hovered_irq_cpu = cpu;
+                }
+            }
+        }
+    }
+
+    // Idle state and frequency steps along the top of each cpu row
+    if ( s_opts().getb( OPT_RenderCpuPower ) )
+    {
+        float band_h = std::max< float >( imgui_scale( 2.0f ), floor( row_h / 6 ) );
+        int64_t end_ts = m_trace_events.m_events.back().ts;
+
+        for ( uint32_t cpu = 0; cpu < std::min< size_t >( cpus, m_trace_events.m_cpu_idle.size() ); cpu++ )
+        {
+            float y = gi.rc.y + cpu * row_h + imgui_scale( 1.0f );
+
+            if ( ( y > gi.rcwin.y + gi.rcwin.h ) || ( y + band_h * 2 < gi.rcwin.y ) )
+                continue;
+
+            for ( int i = 0; i < 2; i++ )
+            {
+                bool idle = ( i == 0 );
+                const std::vector< cpu_step_t > &steps = idle ?
+                            m_trace_events.m_cpu_idle[ cpu ] : m_trace_events.m_cpu_freq[ cpu ];
+                auto it = std::upper_bound( steps.begin(), steps.end(), gi.ts0,
+                                            []( int64_t val, const cpu_step_t &step ) { return val < step.ts; } );
+                float y0 = y + i * band_h;
+
+                if ( it != steps.begin() )
+                    it--;
+
+                for ( ; ( it != steps.end() ) && ( it->ts <= gi.ts1 ); it++ )
+                {
+                    int64_t ts1 = ( it + 1 != steps.end() ) ? ( it + 1 )->ts : end_ts;
+                    float x0 = gi.ts_to_screenx( it->ts );
+                    float x1 = gi.ts_to_screenx( ts1 );
+                    float w = std::max< float >( x1 - x0, 1.0f );
+                    ImU32 step_color;
+
+                    if ( idle )
+                    {
+                        if ( it->val == CPU_IDLE_ACTIVE )
+                            continue;
+
+                        // Deeper idle states are more opaque
+                        step_color = s_clrs().get( col_Graph_CpuIdle,
+                                                   0x40 + 0xbf * ( it->val + 1 ) / ( m_trace_events.m_cpu_idle_max + 1 ) );
+                    }
+                    else
+                    {
+                        // Higher frequencies are more opaque
+                        step_color = s_clrs().get( col_Graph_CpuFreq,
+                                                   0x20 + ( uint32_t )( 0xdfULL * it->val / std::max< uint32_t >( 1, m_trace_events.m_cpu_freq_max ) ) );
+                    }
+
+                    imgui_drawrect_filled( x0, y0, w, band_h, step_color );
+
+                    if ( gi.mouse_pos_in_rect( { x0, y0, w, band_h } ) )
+                    {
+                        gi.hovered_cpu_step = &*it;
+                        gi.hovered_cpu_step_cpu = cpu;
+                        gi.hovered_cpu_step_idle = idle;
+                    }
+                }
+            }
+        }
+    }
+
+    // Mark ring buffer overruns and skipped pages
+    const std::vector< cpu_info_t > &cpu_info = m_trace_events.m_trace_info.cpu_info;
+    ImU32 color_missed = s_clrs().get( col_Graph_MissedEvents );
+    float w = imgui_scale( 3.0f );
+
+    for ( uint32_t cpu = 0; cpu < std::min< size_t >( cpus, cpu_info.size() ); cpu++ )
+    {
+        const std::vector< missed_events_t > &missed = cpu_info[ cpu ].missed_events;
+        auto it = std::lower_bound( missed.begin(), missed.end(), gi.ts0,
+                                    []( const missed_events_t &m, int64_t ts ) { return m.ts < ts; } );
+        float y = gi.rc.y + cpu * row_h;
+
+        for ( ; ( it != missed.end() ) && ( it->ts <= gi.ts1 ); it++ )
+        {
+            float x = gi.ts_to_screenx( it->ts );
+
+            DrawList->AddLine( ImVec2( x, y ), ImVec2( x, y + row_h ), color_missed, imgui_scale( 1.0f ) );
+            DrawList->AddTriangleFilled( ImVec2( x - w, y ), ImVec2( x + w, y ), ImVec2( x, y + w * 2 ), color_missed );
+
+            if ( gi.mouse_pos_in_rect( { x - w, y, w * 2, row_h } ) )
+            {
+                gi.hovered_missed_events = &*it;
+                gi.hovered_missed_events_cpu = cpu;
+            }
+        }
+    }
+
     imgui_pop_font();
     return count;
 }
@@ -2074,6 +2272,291 @@ uint32_t TraceWin::graph_render_amd_timeline( graph_info_t &gi )
     return num_events;
 }
 
+uint32_t TraceWin::graph_render_dma_fence_timeline( graph_info_t &gi )
+{
+    imgui_push_smallfont();
+
+    rect_t hov_rect;
+    uint32_t num_events = 0;
+    uint32_t timeline_row_count = std::max< uint32_t >( 1, gi.rc.h / gi.text_h );
+    ImU32 col_hwqueue = s_clrs().get( col_Graph_BarHwQueue );
+    const std::vector< uint32_t > &locs = *gi.prinfo_cur->plocs;
+    bool render_timeline_events = s_opts().getb( OPT_TimelineEvents );
+    bool render_timeline_labels = s_opts().getb( OPT_TimelineLabels ) &&
+            !ImGui::GetIO().KeyAlt;
+
+    event_renderer_t event_renderer( gi, gi.rc.y, gi.rc.w, gi.rc.h );
+
+    event_renderer.m_maxwidth = 1.0f;
+
+    for ( size_t idx = vec_find_eventid( locs, gi.eventstart );
+          idx < locs.size();
+          idx++ )
+    {
+        const trace_event_t &fence_signaled = get_event( locs[ idx ] );
+        const trace_event_t &event_start = is_valid_id( fence_signaled.id_start ) ?
+                    get_event( fence_signaled.id_start ) : fence_signaled;
+
+        if ( event_start.ts >= gi.ts1 )
+            continue;
+
+        float y = gi.rc.y + ( fence_signaled.graph_row_id % timeline_row_count ) * gi.text_h;
+
+        // drm_sched_job / dma_fence_emit  drm_run_job   |   dma_fence_signaled
+        //       |-------------------------------|------------|
+        //       |hwqueue-->                     |hw->        |
+        float x_start = gi.ts_to_screenx( event_start.ts );
+        float x_exec = gi.ts_to_screenx( fence_signaled.ts - fence_signaled.duration );
+        float x_end = gi.ts_to_screenx( fence_signaled.ts );
+
+        if ( gi.mouse_pos_in_rect( { x_start, y, x_end - x_start, gi.text_h } ) )
+        {
+            hov_rect = { x_start, y, x_end - x_start, gi.text_h };
+
+            gi.add_mouse_hovered_event( x_end, fence_signaled, true );
+        }
+
+        // Draw hw queue bar
+        if ( x_exec != x_start )
+            imgui_drawrect_filled( x_start, y, x_exec - x_start, gi.text_h, col_hwqueue );
+
+        // Draw hw running bar
+        imgui_drawrect_filled( x_exec, y, x_end - x_exec, gi.text_h, fence_signaled.color );
+
+        if ( render_timeline_labels && fence_signaled.user_comm )
+        {
+            const ImVec2 size = ImGui::CalcTextSize( fence_signaled.user_comm );
+            float x_text = std::max< float >( x_start, gi.rc.x ) + imgui_scale( 2.0f );
+
+            if ( x_end - x_text >= size.x )
+            {
+                imgui_draw_text( x_text, y + imgui_scale( 1.0f ),
+                                 s_clrs().get( col_Graph_BarText ), fence_signaled.user_comm );
+            }
+        }
+
+        if ( render_timeline_events )
+        {
+            event_renderer.set_y( y, gi.text_h );
+
+            if ( event_start.id != fence_signaled.id )
+                event_renderer.add_event( event_start.id, x_start, event_start.color );
+            event_renderer.add_event( fence_signaled.id, x_end, fence_signaled.color );
+        }
+
+        num_events++;
+    }
+
+    event_renderer.done();
+    event_renderer.draw_event_markers();
+
+    imgui_drawrect( hov_rect, s_clrs().get( col_Graph_BarSelRect ) );
+
+    imgui_pop_font();
+
+    return num_events;
+}
+
+uint32_t TraceWin::graph_render_workqueue_timeline( graph_info_t &gi )
+{
+    imgui_push_smallfont();
+
+    rect_t hov_rect;
+    uint32_t num_events = 0;
+    uint32_t timeline_row_count = std::max< uint32_t >( 1, gi.rc.h / gi.text_h );
+    ImU32 col_queued = s_clrs().get( col_Graph_BarHwQueue );
+    const std::vector< uint32_t > &locs = *gi.prinfo_cur->plocs;
+    bool render_timeline_events = s_opts().getb( OPT_TimelineEvents );
+    bool render_timeline_labels = s_opts().getb( OPT_TimelineLabels ) &&
+            !ImGui::GetIO().KeyAlt;
+
+    event_renderer_t event_renderer( gi, gi.rc.y, gi.rc.w, gi.rc.h );
+
+    event_renderer.m_maxwidth = 1.0f;
+
+    for ( size_t idx = vec_find_eventid( locs, gi.eventstart );
+          idx < locs.size();
+          idx++ )
+    {
+        const trace_event_t &execute_end = get_event( locs[ idx ] );
+        const work_item_t *item = m_trace_events.get_work_item( execute_end.id );
+
+        if ( item->queue_ts >= gi.ts1 )
+            continue;
+
+        float y = gi.rc.y + ( execute_end.graph_row_id % timeline_row_count ) * gi.text_h;
+
+        // queue_work    execute_start     execute_end
+        //     |-------------|-----------------|
+        //     |queued-->    |executing->      |
+        float x_queue = gi.ts_to_screenx( item->queue_ts );
+        float x_start = gi.ts_to_screenx( item->start_ts );
+        float x_end = gi.ts_to_screenx( item->end_ts );
+
+        if ( gi.mouse_pos_in_rect( { x_queue, y, x_end - x_queue, gi.text_h } ) )
+        {
+            hov_rect = { x_queue, y, x_end - x_queue, gi.text_h };
+
+            gi.add_mouse_hovered_event( x_end, execute_end, true );
+        }
+
+        // Draw queued bar
+        if ( x_start != x_queue )
+            imgui_drawrect_filled( x_queue, y, x_start - x_queue, gi.text_h, col_queued );
+
+        // Draw executing bar
+        imgui_drawrect_filled( x_start, y, std::max< float >( x_end - x_start, 1.0f ), gi.text_h, execute_end.color );
+
+        if ( render_timeline_labels && execute_end.user_comm )
+        {
+            const ImVec2 size = ImGui::CalcTextSize( execute_end.user_comm );
+            float x_text = std::max< float >( x_queue, gi.rc.x ) + imgui_scale( 2.0f );
+
+            if ( x_end - x_text >= size.x )
+            {
+                imgui_draw_text( x_text, y + imgui_scale( 1.0f ),
+                                 s_clrs().get( col_Graph_BarText ), execute_end.user_comm );
+            }
+        }
+
+        if ( render_timeline_events )
+        {
+            event_renderer.set_y( y, gi.text_h );
+
+            event_renderer.add_event( item->start_eventid, x_start, get_event( item->start_eventid ).color );
+            event_renderer.add_event( execute_end.id, x_end, execute_end.color );
+        }
+
+        num_events++;
+    }
+
+    event_renderer.done();
+    event_renderer.draw_event_markers();
+
+    imgui_drawrect( hov_rect, s_clrs().get( col_Graph_BarSelRect ) );
+
+    imgui_pop_font();
+
+    return num_events;
+}
+
+uint32_t TraceWin::graph_render_block_timeline( graph_info_t &gi )
+{
+    uint32_t hashval = hashstr32( gi.prinfo_cur->row_name );
+    const block_dev_t *dev = m_trace_events.m_block_devs.get_val( hashval );
+
+    if ( !dev )
+        return 0;
+
+    rect_t hov_rect;
+    uint32_t num_events = 0;
+    uint32_t row_count = std::max< uint32_t >( 1, m_trace_events.m_row_count.m_map[ hashval ] );
+    float row_h = std::max< float >( 2.0f, gi.rc.h / row_count );
+    uint32_t timeline_row_count = std::max< uint32_t >( 1, gi.rc.h / row_h );
+    ImU32 col_queued = s_clrs().get( col_Graph_BarHwQueue );
+    ImU32 col_read = s_clrs().get( col_Graph_BlockRead );
+    ImU32 col_write = s_clrs().get( col_Graph_BlockWrite );
+    const std::vector< uint32_t > &locs = dev->locs;
+
+    // Right edge of last bar drawn in each row, so we skip sub-pixel requests
+    //  which land on top of each other when zoomed out.
+    std::vector< float > row_x( timeline_row_count, -FLT_MAX );
+
+    for ( size_t idx = vec_find_eventid( locs, gi.eventstart );
+          idx < locs.size();
+          idx++ )
+    {
+        const block_rq_t &rq = dev->requests[ idx ];
+
+        // Requests are in completion order, so bail once nothing can start on screen
+        if ( rq.complete_ts - dev->duration_max > gi.ts1 )
+            break;
+        if ( rq.insert_ts >= gi.ts1 )
+            continue;
+
+        const trace_event_t &complete = get_event( locs[ idx ] );
+        uint32_t row = complete.graph_row_id % timeline_row_count;
+        float y = gi.rc.y + row * row_h;
+
+        // insert         issue             complete
+        //   |--------------|-----------------|
+        //   |queued-->     |device->         |
+        float x_insert = gi.ts_to_screenx( rq.insert_ts );
+        float x_issue = gi.ts_to_screenx( rq.issue_ts );
+        float x_end = gi.ts_to_screenx( rq.complete_ts );
+
+        num_events++;
+
+        if ( ( x_end - x_insert < 1.0f ) && ( x_end < row_x[ row ] + 1.0f ) )
+            continue;
+        row_x[ row ] = x_end;
+
+        if ( gi.mouse_pos_in_rect( { x_insert, y, x_end - x_insert, row_h } ) )
+        {
+            hov_rect = { x_insert, y, x_end - x_insert, row_h };
+
+            gi.add_mouse_hovered_event( x_end, complete, true );
+        }
+
+        if ( x_issue != x_insert )
+            imgui_drawrect_filled( x_insert, y, x_issue - x_insert, row_h, col_queued );
+
+        imgui_drawrect_filled( x_issue, y, std::max< float >( x_end - x_issue, 1.0f ), row_h,
+                               ( rq.rwbs && strchr( rq.rwbs, 'W' ) ) ? col_write : col_read );
+    }
+
+    // Queue depth plot. Steps narrower than a pixel are merged, keeping the max depth.
+    const std::vector< block_depth_t > &depth = dev->depth;
+    auto it = std::upper_bound( depth.begin(), depth.end(), gi.ts0,
+                                []( int64_t val, const block_depth_t &step ) { return val < step.ts; } );
+    ImU32 col_depth = s_clrs().get( col_Graph_BlockQueueDepth );
+    float depth_scale = gi.rc.h / std::max< uint32_t >( 1, dev->depth_max );
+    int64_t end_ts = m_trace_events.m_events.back().ts;
+    float bucket_x = -FLT_MAX;
+    uint32_t bucket_depth = 0;
+
+    auto draw_depth = [&]( float x, float w, uint32_t val )
+    {
+        if ( val )
+            imgui_drawrect_filled( x, gi.rc.y + gi.rc.h - val * depth_scale, w, val * depth_scale, col_depth );
+    };
+
+    if ( it != depth.begin() )
+        it--;
+
+    for ( ; ( it != depth.end() ) && ( it->ts <= gi.ts1 ); it++ )
+    {
+        int64_t ts1 = ( it + 1 != depth.end() ) ? ( it + 1 )->ts : end_ts;
+        float x0 = gi.ts_to_screenx( it->ts );
+        float x1 = gi.ts_to_screenx( ts1 );
+
+        if ( x1 - x0 >= 1.0f )
+        {
+            draw_depth( bucket_x, 1.0f, bucket_depth );
+            bucket_depth = 0;
+
+            draw_depth( x0, x1 - x0, it->depth );
+        }
+        else
+        {
+            float x = floorf( x0 );
+
+            if ( x != bucket_x )
+            {
+                draw_depth( bucket_x, 1.0f, bucket_depth );
+                bucket_x = x;
+                bucket_depth = 0;
+            }
+            bucket_depth = std::max< uint32_t >( bucket_depth, it->depth );
+        }
+    }
+    draw_depth( bucket_x, 1.0f, bucket_depth );
+
+    imgui_drawrect( hov_rect, s_clrs().get( col_Graph_BarSelRect ) );
+
+    return num_events;
+}
+
 uint32_t TraceWin::graph_render_row_events( graph_info_t &gi )
 {
     const std::vector< uint32_t > &locs = *gi.prinfo_cur->plocs;
@@ -2160,11 +2643,64 @@ uint32_t TraceWin::graph_render_row_events( graph_info_t &gi )
                 }
             }
         }
+
+        if ( s_opts().getb( OPT_RenderThreadStates ) )
+            graph_render_thread_states( gi );
     }
 
     return event_renderer.m_num_events;
 }
 
+void TraceWin::graph_render_thread_states( graph_info_t &gi )
+{
+    int pid = gi.prinfo_cur->pid;
+    const thread_states_t *pstates = m_trace_events.m_thread_states.get_val( pid );
+
+    if ( !pstates )
+        return;
+
+    const std::vector< thread_state_run_t > &runs = pstates->runs;
+    int64_t end_ts = m_trace_events.m_events.back().ts;
+    float band_h = std::max< float >( 2.0f, gi.text_h / 4 );
+    float y = gi.rc.y + gi.rc.h - band_h - 1;
+    ImU32 colors[ THREAD_STATE_Max ] =
+    {
+        0,
+        s_clrs().get( col_Graph_ThreadRunning ),
+        s_clrs().get( col_Graph_ThreadRunnable ),
+        s_clrs().get( col_Graph_ThreadSleeping ),
+        s_clrs().get( col_Graph_ThreadUninterruptible ),
+    };
+    size_t idx = pstates->find_run( gi.ts0 );
+
+    if ( idx >= runs.size() )
+        idx = 0;
+
+    for ( ; idx < runs.size(); idx++ )
+    {
+        const thread_state_run_t &run = runs[ idx ];
+        int64_t ts1 = ( idx + 1 < runs.size() ) ? runs[ idx + 1 ].ts : end_ts;
+
+        // Bail if we're off the right side of our graph
+        if ( run.ts > gi.ts1 )
+            break;
+        if ( run.state == THREAD_STATE_Unknown )
+            continue;
+
+        float x0 = gi.ts_to_screenx( run.ts );
+        float x1 = gi.ts_to_screenx( ts1 );
+        float w = std::max< float >( x1 - x0, 1.0f );
+
+        imgui_drawrect_filled( x0, y, w, band_h, colors[ run.state ] );
+
+        if ( gi.mouse_pos_in_rect( { x0, y - 1, w, band_h + 2 } ) )
+        {
+            gi.hovered_thread_state_pid = pid;
+            gi.hovered_thread_state_idx = idx;
+        }
+    }
+}
+
 uint32_t TraceWin::graph_render_i915_reqwait_events( graph_info_t &gi )
 {
     const trace_event_t *pevent_sel = NULL;
@@ -2689,6 +3225,80 @@ void TraceWin::graph_render_framemarker_frames( graph_info_t &gi )
     }
 }
 
+void TraceWin::graph_render_critical_path( graph_info_t &gi )
+{
+    if ( gi.prinfo_zoom ||
+         !s_opts().getb( OPT_RenderCriticalPath ) ||
+         !m_critical_path.is_ready() )
+    {
+        return;
+    }
+
+    static const colors_t s_cols[ CriticalPath::CPATH_Max ] =
+    {
+        col_CritPath_Running,
+        col_CritPath_Runnable,
+        col_CritPath_Blocked,
+        col_CritPath_BlockedFence,
+        col_CritPath_GpuQueued,
+        col_CritPath_GpuExecuting,
+    };
+    std::vector< uint32_t > row_hashvals;
+    const std::vector< CriticalPath::frame_t > &frames = m_critical_path.m_frames;
+
+    // Hashvals of gpu timeline row names: "gfx", "gfx hw", "i915_req ring0", etc.
+    for ( const row_info_t &ri : gi.row_info )
+    {
+        size_t len = ri.row_name.size();
+
+        if ( ri.row_type == LOC_TYPE_AMDTimeline_hw )
+            len -= 3;
+        row_hashvals.push_back( hashstr32( ri.row_name.c_str(), len ) );
+    }
+
+    for ( size_t idx = m_critical_path.find_frame( gi.ts0 ); idx < frames.size(); idx++ )
+    {
+        const CriticalPath::frame_t &frame = frames[ idx ];
+
+        if ( frame.ts0 > gi.ts1 )
+            break;
+
+        for ( uint32_t i = frame.seg_first; i < frame.seg_first + frame.seg_count; i++ )
+        {
+            const CriticalPath::segment_t &seg = m_critical_path.m_segments[ i ];
+
+            if ( ( seg.ts1 < gi.ts0 ) || ( seg.ts0 > gi.ts1 ) )
+                continue;
+
+            float x0 = gi.ts_to_screenx( seg.ts0 );
+            float x1 = gi.ts_to_screenx( seg.ts1 );
+            ImU32 color = s_clrs().get( s_cols[ seg.type ] );
+
+            for ( size_t row = 0; row < gi.row_info.size(); row++ )
+            {
+                const row_info_t &ri = gi.row_info[ row ];
+
+                if ( seg.pid >= 0 )
+                {
+                    if ( ( ri.row_type != LOC_TYPE_Comm ) || ( ri.pid != seg.pid ) )
+                        continue;
+                }
+                else if ( row_hashvals[ row ] != seg.row_hashval )
+                {
+                    continue;
+                }
+
+                float y = gi.rcwin.y + ri.row_y + gi.start_y;
+                float h = imgui_scale( 3.0f );
+
+                // Underline the segment and draw a box around it
+                imgui_drawrect_filled( x0, y + ri.row_h - h, x1 - x0, h, color );
+                imgui_drawrect( x0, y, x1 - x0, ri.row_h, color );
+            }
+        }
+    }
+}
+
 void TraceWin::graph_render_mouse_pos( graph_info_t &gi )
 {
     // Don't render mouse position if we're resizing the graph (it flashes).
@@ -2830,7 +3440,7 @@ void TraceWin::graph_render_row_labels( graph_info_t &gi )
 
 void TraceWin::graph_range_check_times()
 {
-    const std::vector< trace_event_t > &events = m_trace_events.m_events;
+    const TraceEventStore &events = m_trace_events.m_events;
 
     if ( m_graph.length_ts < m_graph.s_min_length )
     {
@@ -2888,6 +3498,9 @@ bool TraceWin::is_graph_row_zoomable()
     case LOC_TYPE_Plot:
     case LOC_TYPE_Print:
     case LOC_TYPE_i915Request:
+    case LOC_TYPE_DmaFence:
+    case LOC_TYPE_Workqueue:
+    case LOC_TYPE_BlockDev:
         return true;
     default:
         return false;
@@ -3117,7 +3730,7 @@ void TraceWin::graph_handle_keyboard_scroll( graph_info_t &gi )
         return;
 
     int64_t start_ts = m_graph.start_ts;
-    const std::vector< trace_event_t > &events = m_trace_events.m_events;
+    const TraceEventStore &events = m_trace_events.m_events;
 
     if ( s_actions().get( action_scroll_up ) )
     {
@@ -3356,6 +3969,7 @@ void TraceWin::graph_render()
         graph_render_time_ticks( gi, imgui_scale( 16.0f ), imgui_scale( 4.0f ) );
         graph_render_vblanks( gi );
         graph_render_framemarker_frames( gi );
+        graph_render_critical_path( gi );
         graph_render_mouse_pos( gi );
         graph_render_eventids( gi );
         graph_render_mouse_selection( gi );
@@ -3418,6 +4032,19 @@ void TraceWin::graph_render_hscrollbar( graph_info_t &gi )
 
     {
         int style_count = 0;
+        bool render_density = s_opts().getb( OPT_RenderScrollbarDensity ) &&
+                !m_trace_events.m_density.events.empty();
+
+        if ( render_density )
+        {
+            graph_render_density( ImGui::GetCursorScreenPos(), ImVec2( w2, scrollbar_size ), min_ts, max_ts );
+
+            // Let the overview show through the scrollbar background
+            ImU32 col = ImGui::GetColorU32( ImGuiCol_ScrollbarBg );
+
+            ImGui::PushStyleColor( ImGuiCol_ScrollbarBg, ( col & ~IM_COL32_A_MASK ) | 0x40000000 );
+            style_count++;
+        }
 
         if ( m_frame_markers.m_frame_marker_selected != -1 )
         {
@@ -3488,6 +4115,115 @@ void TraceWin::graph_render_hscrollbar( graph_info_t &gi )
     frame_markers_goto( target, true );
 }
 
+void TraceWin::graph_render_density( const ImVec2 &pos, const ImVec2 &size, int64_t min_ts, int64_t max_ts )
+{
+    const auto &density = m_trace_events.m_density;
+    size_t bins = density.events.size();
+
+    // Mark bins covered by frames longer than twice the median frame
+    if ( m_graph.density_frames_gen != m_frame_markers.m_frames_gen )
+    {
+        const std::vector< uint32_t > &left_frames = m_frame_markers.m_left_frames;
+        const std::vector< uint32_t > &right_frames = m_frame_markers.m_right_frames;
+        std::vector< int64_t > lens;
+
+        m_graph.density_frames_gen = m_frame_markers.m_frames_gen;
+        m_graph.density_hitches.assign( bins, 0 );
+
+        for ( size_t i = 0; i < left_frames.size(); i++ )
+            lens.push_back( m_trace_events.m_events[ right_frames[ i ] ].ts - m_trace_events.m_events[ left_frames[ i ] ].ts );
+
+        if ( !lens.empty() )
+        {
+            std::vector< int64_t > sorted = lens;
+            std::nth_element( sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end() );
+            int64_t median = sorted[ sorted.size() / 2 ];
+
+            for ( size_t i = 0; i < lens.size(); i++ )
+            {
+                if ( lens[ i ] <= 2 * median )
+                    continue;
+
+                int64_t ts0 = m_trace_events.m_events[ left_frames[ i ] ].ts;
+                int64_t bin0 = ( ts0 - density.min_ts ) / density.bin_ts;
+                int64_t bin1 = ( ts0 + lens[ i ] - density.min_ts ) / density.bin_ts;
+
+                bin0 = Clamp< int64_t >( bin0, 0, bins - 1 );
+                bin1 = Clamp< int64_t >( bin1, 0, bins - 1 );
+                for ( int64_t bin = bin0; bin <= bin1; bin++ )
+                    m_graph.density_hitches[ bin ] = 1;
+            }
+        }
+    }
+
+    ImDrawList *draw_list = ImGui::GetWindowDrawList();
+    ImU32 col_events = s_clrs().get( col_Graph_DensityEvents );
+    ImU32 col_gpu = s_clrs().get( col_Graph_DensityGpuBusy );
+    ImU32 col_hitch = s_clrs().get( col_Graph_DensityHitch );
+    float events_scale = 1.0f / logf( density.events_max + 1.0f );
+    float gpu_alpha = ( col_gpu >> IM_COL32_A_SHIFT ) & 0xff;
+    float gpu_h = size.y * 0.3f;
+    float dx = size.x * density.bin_ts / ( max_ts - min_ts );
+    float x0 = pos.x + size.x * ( density.min_ts - min_ts ) / ( max_ts - min_ts );
+    int hovered_bin = -1;
+
+    if ( ImGui::IsWindowHovered( ImGuiHoveredFlags_ChildWindows ) &&
+         ImGui::IsMouseHoveringRect( pos, ImVec2( pos.x + size.x, pos.y + size.y ) ) )
+    {
+        hovered_bin = ( int )( ( ImGui::GetMousePos().x - x0 ) / dx );
+    }
+
+    for ( size_t bin = 0; bin < bins; )
+    {
+        // Merge bins which land in the same pixel column
+        float x = x0 + bin * dx;
+        size_t bin_end = bin;
+        uint32_t events = 0;
+        float busy = 0.0f;
+        bool hitch = false;
+
+        do
+        {
+            events = std::max< uint32_t >( events, density.events[ bin_end ] );
+            busy = std::max< float >( busy, density.gpu_busy[ bin_end ] );
+            hitch |= !!m_graph.density_hitches[ bin_end ];
+            bin_end++;
+        } while ( ( bin_end < bins ) && ( x0 + bin_end * dx < x + 1.0f ) );
+
+        float x1 = std::max< float >( x0 + bin_end * dx, x + 1.0f );
+
+        if ( hitch )
+            draw_list->AddRectFilled( ImVec2( x, pos.y ), ImVec2( x1, pos.y + size.y ), col_hitch );
+        if ( events )
+        {
+            float h = size.y * logf( events + 1.0f ) * events_scale;
+
+            draw_list->AddRectFilled( ImVec2( x, pos.y + size.y - h ), ImVec2( x1, pos.y + size.y ), col_events );
+        }
+        if ( busy > 0.0f )
+        {
+            ImU32 col = ( col_gpu & ~IM_COL32_A_MASK ) | ( ( ImU32 )( busy * gpu_alpha ) << IM_COL32_A_SHIFT );
+
+            draw_list->AddRectFilled( ImVec2( x, pos.y ), ImVec2( x1, pos.y + gpu_h ), col );
+        }
+
+        bin = bin_end;
+    }
+
+    if ( ( hovered_bin >= 0 ) && ( ( size_t )hovered_bin < bins ) )
+    {
+        int64_t ts = density.min_ts + hovered_bin * density.bin_ts;
+        std::string str = string_format( "%s: %u events, gpu busy %.0f%%",
+                                         ts_to_timestr( ts, 2 ).c_str(),
+                                         density.events[ hovered_bin ],
+                                         density.gpu_busy[ hovered_bin ] * 100.0f );
+
+        if ( m_graph.density_hitches[ hovered_bin ] )
+            str += "\nLong frame";
+        ImGui::SetTooltip( "%s", str.c_str() );
+    }
+}
+
 void TraceWin::graph_render_resizer( graph_info_t &gi )
 {
     bool mouse_captured = ( m_graph.mouse_captured == MOUSE_CAPTURED_RESIZE_GRAPH );
@@ -3934,6 +4670,9 @@ bool TraceWin::graph_render_popupmenu( graph_info_t &gi )
         }
     }
 
+    if ( is_valid_id( gi.hovered_eventid ) )
+        api_links_render_menuitems( gi.hovered_eventid );
+
     // Frame Markers
     {
         if ( is_valid_id( gi.hovered_eventid ) &&
@@ -4029,6 +4768,67 @@ void TraceWin::graph_mouse_tooltip_rowinfo( std::string &ttip, graph_info_t &gi,
         ttip += "\nFilter: " + m_graph.mouse_over_row_filter_expr;
     }
 
+    if ( m_graph.mouse_over_row_type == LOC_TYPE_BlockDev )
+    {
+        block_stats_t stats;
+
+        if ( m_trace_events.get_block_stats( row_name.c_str(), gi.ts0, gi.ts1, stats ) && stats.count )
+        {
+            double secs = std::max< int64_t >( 1, gi.ts1 - gi.ts0 ) / ( double )NSECS_PER_SEC;
+
+            ttip += string_format( "\nRequests in view: %u (%.2f MB/s) queued avg:%s", stats.count,
+                                   stats.bytes / ( 1024.0 * 1024.0 ) / secs,
+                                   ts_to_timestr( stats.queued_avg, 4 ).c_str() );
+            ttip += string_format( "\nDevice latency p50:%s p90:%s p99:%s max:%s",
+                                   ts_to_timestr( stats.p50, 4 ).c_str(), ts_to_timestr( stats.p90, 4 ).c_str(),
+                                   ts_to_timestr( stats.p99, 4 ).c_str(), ts_to_timestr( stats.max, 4 ).c_str() );
+        }
+    }
+
+    if ( ( m_graph.mouse_over_row_type == LOC_TYPE_Plot ) && !strncmp( row_name.c_str(), "plot:gpumem ", 12 ) )
+    {
+        uint32_t domain = GPU_MEM_Max;
+        std::vector< const gpu_mem_alloc_t * > allocs;
+
+        for ( const auto &plot : m_trace_events.m_gpu_mem.plots )
+        {
+            if ( plot.first == row_name )
+                domain = plot.second;
+        }
+
+        m_trace_events.get_gpu_mem_live( mouse_ts, domain, 5, allocs );
+
+        if ( !allocs.empty() )
+            ttip += string_format( "\nLargest live %s allocations:", TraceEvents::gpu_mem_domain_str( domain ) );
+
+        for ( const gpu_mem_alloc_t *alloc : allocs )
+        {
+            const trace_event_t &event = get_event( alloc->eventid );
+            const char *handle = get_event_field_val( event, event.name[ 0 ] == 'a' ? "bo" : "obj", "" );
+
+            ttip += string_format( "\n  %s %.2f MB age:%s", handle, alloc->size / ( 1024.0 * 1024.0 ),
+                                   ts_to_timestr( mouse_ts - alloc->ts0, 4 ).c_str() );
+        }
+    }
+
+    if ( m_graph.mouse_over_row_type == LOC_TYPE_Workqueue )
+    {
+        const work_stats_t *stats = m_trace_events.m_workqueue.func_stats.get_val( hashval );
+
+        if ( stats && stats->count )
+        {
+            ttip += string_format( "\nExecuted: %u avg:%s max:%s", stats->count,
+                                   ts_to_timestr( stats->exec_total / stats->count, 4 ).c_str(),
+                                   ts_to_timestr( stats->exec_max, 4 ).c_str() );
+        }
+        if ( stats && stats->latency_count )
+        {
+            ttip += string_format( "\nQueue latency: avg:%s max:%s",
+                                   ts_to_timestr( stats->latency_total / stats->latency_count, 4 ).c_str(),
+                                   ts_to_timestr( stats->latency_max, 4 ).c_str() );
+        }
+    }
+
     if ( row_filters && !row_filters->filters.empty() )
     {
         std::string str;
@@ -4102,12 +4902,47 @@ void TraceWin::graph_mouse_tooltip_markers( std::string &ttip, graph_info_t &gi,
     if ( graph_marker_valid( 1 ) )
         ttip += "\nMarker B: " + ts_to_timestr( m_graph.ts_markers[ 1 ] - mouse_ts, 2 );
 
+    if ( gi.hovered_missed_events )
+    {
+        const missed_events_t &missed = *gi.hovered_missed_events;
+
+        if ( missed.count > 0 )
+        {
+            ttip += string_format( "\n\n%sCpu %u lost %" PRId64 " events%s",
+                                   gi.clr_bright, gi.hovered_missed_events_cpu, missed.count, gi.clr_def );
+        }
+        else
+        {
+            ttip += string_format( "\n\n%sCpu %u lost events (count unknown)%s",
+                                   gi.clr_bright, gi.hovered_missed_events_cpu, gi.clr_def );
+        }
+    }
+
     if ( gi.hovered_framemarker_frame != -1 )
     {
         int64_t ts = m_frame_markers.get_frame_len( m_trace_events, gi.hovered_framemarker_frame );
 
         ttip += string_format( "\n\nFrame %d (", gi.hovered_framemarker_frame );
         ttip += ts_to_timestr( ts, 4 ) + ")";
+
+        if ( m_critical_path.is_ready() &&
+             ( m_critical_path.m_frames_gen == m_frame_markers.m_frames_gen ) &&
+             ( ( size_t )gi.hovered_framemarker_frame < m_critical_path.m_frames.size() ) )
+        {
+            const CriticalPath::frame_t &frame = m_critical_path.m_frames[ gi.hovered_framemarker_frame ];
+
+            ttip += "\n  Critical path:";
+
+            for ( uint32_t type = 0; type < CriticalPath::CPATH_Max; type++ )
+            {
+                if ( frame.seg_ts[ type ] )
+                {
+                    ttip += string_format( "\n    %s: %s%s%s",
+                                           CriticalPath::seg_type_str( ( CriticalPath::seg_type_t )type ),
+                                           gi.clr_bright, ts_to_timestr( frame.seg_ts[ type ], 4 ).c_str(), gi.clr_def );
+                }
+            }
+        }
     }
 }
 
@@ -4144,10 +4979,152 @@ void TraceWin::graph_mouse_tooltip_sched_switch( std::string &ttip, graph_info_t
                 ttip += string_format( " (Time Pct:%.2f%%)",
                                        ( *val * 100.0 / m_trace_events.m_sched_switch_time_total ) );
             }
+
+            // Work functions this kworker ran during the slice
+            std::vector< const work_item_t * > work_items;
+
+            m_trace_events.get_work_items( prev_pid, event.ts - event.duration, event.ts, work_items );
+
+            for ( size_t i = 0; i < std::min< size_t >( work_items.size(), 8 ); i++ )
+            {
+                const work_item_t *item = work_items[ i ];
+
+                ttip += string_format( "\n  %s%s%s (%s)", gi.clr_brightcomp, item->function, gi.clr_def,
+                                       ts_to_timestr( item->end_ts - item->start_ts, 4 ).c_str() );
+                if ( item->queue_pid >= 0 )
+                {
+                    ttip += string_format( " queued by %s Cpu:%d",
+                                           m_trace_events.comm_from_pid( item->queue_pid, "<...>" ), item->queue_cpu );
+                }
+            }
+            if ( work_items.size() > 8 )
+                ttip += string_format( "\n  ... %lu more work items", work_items.size() - 8 );
         }
     }
 }
 
+void TraceWin::graph_mouse_tooltip_thread_states( std::string &ttip, graph_info_t &gi, int64_t mouse_ts )
+{
+    if ( gi.hovered_thread_state_pid < 0 )
+        return;
+
+    const thread_states_t *pstates = m_trace_events.m_thread_states.get_val( gi.hovered_thread_state_pid );
+    const std::vector< thread_state_run_t > &runs = pstates->runs;
+    size_t idx = gi.hovered_thread_state_idx;
+    int64_t end_ts = m_trace_events.m_events.back().ts;
+    int64_t ts1 = ( idx + 1 < runs.size() ) ? runs[ idx + 1 ].ts : end_ts;
+
+    ttip += string_format( "\n\nThread state: %s%s%s (%s)",
+                           gi.clr_bright, thread_states_t::state_str( runs[ idx ].state ), gi.clr_def,
+                           ts_to_timestr( ts1 - runs[ idx ].ts, 4 ).c_str() );
+
+    // Break down thread time in hovered frame
+    if ( gi.hovered_framemarker_frame != -1 )
+    {
+        std::array< int64_t, THREAD_STATE_Max > times;
+        int frame = gi.hovered_framemarker_frame;
+        int64_t frame_ts0 = get_event( m_frame_markers.m_left_frames[ frame ] ).ts;
+        int64_t frame_ts1 = get_event( m_frame_markers.m_right_frames[ frame ] ).ts;
+
+        pstates->get_state_times( frame_ts0, frame_ts1, end_ts, times );
+
+        ttip += string_format( "\n  Frame %d:", frame );
+
+        for ( uint32_t state = THREAD_STATE_Running; state < THREAD_STATE_Max; state++ )
+        {
+            if ( times[ state ] )
+            {
+                ttip += string_format( "\n    %s: %s%s%s",
+                                       thread_states_t::state_str( state ),
+                                       gi.clr_bright, ts_to_timestr( times[ state ], 4 ).c_str(), gi.clr_def );
+            }
+        }
+    }
+}
+
+void TraceWin::graph_mouse_tooltip_irqs( std::string &ttip, graph_info_t &gi, int64_t mouse_ts )
+{
+    if ( !gi.hovered_irq )
+        return;
+
+    const irq_interval_t &interval = *gi.hovered_irq;
+    util_umap< uint32_t, irq_stats_t > stats;
+    std::vector< std::pair< uint32_t, irq_stats_t > > sorted;
+
+    ttip += string_format( "\n\n%s%u%s %s%s%s Cpu:%u %s",
+                           gi.clr_bright, interval.entry_eventid, gi.clr_def,
+                           gi.clr_brightcomp, m_trace_events.get_irq_name( interval.key() ).c_str(), gi.clr_def,
+                           gi.hovered_irq_cpu, ts_to_timestr( interval.ts1 - interval.ts0, 4 ).c_str() );
+
+    // Stats for visible graph range on this cpu
+    int64_t total = m_trace_events.get_irq_stats( gi.hovered_irq_cpu, gi.ts0, gi.ts1, stats );
+
+    ttip += string_format( "\n  Cpu %u irq time in view: %s%s%s (%.2f%%)",
+                           gi.hovered_irq_cpu, gi.clr_bright, ts_to_timestr( total, 4 ).c_str(), gi.clr_def,
+                           total * 100.0 / std::max< int64_t >( 1, gi.ts1 - gi.ts0 ) );
+
+    for ( const auto &it : stats.m_map )
+        sorted.push_back( it );
+
+    std::sort( sorted.begin(), sorted.end(),
+               []( const std::pair< uint32_t, irq_stats_t > &lx, const std::pair< uint32_t, irq_stats_t > &rx )
+               { return lx.second.total_ts > rx.second.total_ts; } );
+
+    for ( size_t i = 0; i < std::min< size_t >( sorted.size(), 10 ); i++ )
+    {
+        const irq_stats_t &irq_stats = sorted[ i ].second;
+
+        ttip += string_format( "\n    %s: %s%s%s count:%u max:%s",
+                               m_trace_events.get_irq_name( sorted[ i ].first ).c_str(),
+                               gi.clr_bright, ts_to_timestr( irq_stats.total_ts, 4 ).c_str(), gi.clr_def,
+                               irq_stats.count, ts_to_timestr( irq_stats.max_ts, 4 ).c_str() );
+    }
+}
+
+void TraceWin::graph_mouse_tooltip_cpu_power( std::string &ttip, graph_info_t &gi, int64_t mouse_ts )
+{
+    if ( !gi.hovered_cpu_step )
+        return;
+
+    uint32_t cpu = gi.hovered_cpu_step_cpu;
+    const cpu_step_t &step = *gi.hovered_cpu_step;
+    util_umap< uint32_t, int64_t > times;
+    std::vector< std::pair< uint32_t, int64_t > > sorted;
+    int64_t len = std::max< int64_t >( 1, gi.ts1 - gi.ts0 );
+
+    if ( gi.hovered_cpu_step_idle )
+        ttip += string_format( "\n\nCpu %u idle state: %s%u%s", cpu, gi.clr_bright, step.val, gi.clr_def );
+    else
+        ttip += string_format( "\n\nCpu %u frequency: %s%.2fGHz%s", cpu, gi.clr_bright, step.val / 1000000.0, gi.clr_def );
+
+    // Idle residency and average frequency for visible graph range
+    m_trace_events.get_cpu_step_times( m_trace_events.m_cpu_idle[ cpu ], gi.ts0, gi.ts1, times );
+
+    for ( const auto &it : times.m_map )
+        sorted.push_back( it );
+    std::sort( sorted.begin(), sorted.end() );
+
+    if ( !sorted.empty() )
+    {
+        ttip += "\n  Idle residency in view:";
+
+        for ( const auto &it : sorted )
+        {
+            if ( it.first == CPU_IDLE_ACTIVE )
+                ttip += "\n    Active: ";
+            else
+                ttip += string_format( "\n    State %u: ", it.first );
+
+            ttip += string_format( "%s%.2f%%%s (%s)", gi.clr_bright, it.second * 100.0 / len, gi.clr_def,
+                                   ts_to_timestr( it.second, 4 ).c_str() );
+        }
+    }
+
+    uint32_t freq_avg = m_trace_events.get_cpu_freq_avg( cpu, gi.ts0, gi.ts1 );
+    if ( freq_avg )
+        ttip += string_format( "\n  Average frequency in view: %s%.2fGHz%s", gi.clr_bright, freq_avg / 1000000.0, gi.clr_def );
+}
+
 void TraceWin::graph_mouse_tooltip_hovered_amd_fence_signaled( std::string &ttip, graph_info_t &gi, int64_t mouse_ts )
 {
     if ( !is_valid_id( gi.hovered_fence_signaled ) )
@@ -4214,6 +5191,8 @@ void TraceWin::graph_mouse_tooltip_hovered_items( std::string &ttip, graph_info_
         graph_info_t::hovered_t &hov = gi.hovered_items[ i ];
         trace_event_t &event = get_event( hov.eventid );
         i915_type_t i915_type = get_i915_reqtype( event );
+        const work_item_t *work_item = m_trace_events.get_work_item( event.id );
+        const block_rq_t *block_rq = m_trace_events.get_block_rq( event );
 
         m_eventlist.highlight_ids.push_back( event.id );
 
@@ -4280,6 +5259,42 @@ void TraceWin::graph_mouse_tooltip_hovered_items( std::string &ttip, graph_info_
                 ttip += str;
             }
         }
+        else if ( event.is_dma_fence() )
+        {
+            uint64_t key = get_dma_fence_key( event );
+
+            if ( key )
+            {
+                const std::vector< uint32_t > *plocs = m_trace_events.m_dma_fence.wait_locs.get_val( key );
+
+                ttip += string_format( " fence:[%s%u%s-%s%u%s]",
+                                       gi.clr_bright, ( uint32_t )( key >> 32 ), gi.clr_def,
+                                       gi.clr_bright, ( uint32_t )key, gi.clr_def );
+                if ( plocs )
+                    ttip += string_format( " waiters:%s%lu%s", gi.clr_bright, plocs->size(), gi.clr_def );
+            }
+
+            if ( event.has_duration() )
+                ttip += " duration: " + ts_to_timestr( event.duration, 4 );
+        }
+        else if ( block_rq )
+        {
+            ttip += string_format( " %s sector:%s%" PRIu64 "%s +%u queued:%s",
+                                   block_rq->rwbs, gi.clr_bright, block_rq->sector, gi.clr_def, block_rq->nr_sector,
+                                   ts_to_timestr( block_rq->issue_ts - block_rq->insert_ts, 4 ).c_str() );
+        }
+        else if ( work_item )
+        {
+            ttip += string_format( " %s%s%s", gi.clr_brightcomp, work_item->function, gi.clr_def );
+
+            if ( work_item->queue_pid >= 0 )
+            {
+                const char *queue_comm = m_trace_events.comm_from_pid( work_item->queue_pid, "<...>" );
+
+                ttip += string_format( " queued by %s Cpu:%d latency: %s", queue_comm, work_item->queue_cpu,
+                                       ts_to_timestr( work_item->start_ts - work_item->queue_ts, 4 ).c_str() );
+            }
+        }
         else if ( event.is_ftrace_print() )
         {
             // Add colored string for ftrace print events
@@ -4311,6 +5326,28 @@ void TraceWin::graph_mouse_tooltip_hovered_items( std::string &ttip, graph_info_
             ttip += " (" + timestr + ")" + gi.clr_def;
         }
 
+        // Api marker <-> gpu job submission links
+        const uint32_t *marker_id = m_trace_events.m_api_links.job_marker.get_val( event.id );
+        const std::vector< uint32_t > *marker_jobs = m_trace_events.m_api_links.marker_jobs.get_val( event.id );
+
+        if ( marker_id )
+        {
+            const trace_event_t &marker = get_event( *marker_id );
+
+            ttip += string_format( "\n  api marker: %s",
+                                   s_textclrs().mstr( get_event_field_val( marker, "buf" ), marker.color ).c_str() );
+        }
+        if ( marker_jobs )
+        {
+            int64_t exec_ts = 0;
+
+            for ( uint32_t ijob : *marker_jobs )
+                exec_ts += m_trace_events.m_gpu_jobs[ ijob ].end_ts - m_trace_events.m_gpu_jobs[ ijob ].exec_ts;
+
+            ttip += string_format( "\n  gpu jobs: %s%lu%s executing: %s", gi.clr_bright, marker_jobs->size(),
+                                   gi.clr_def, ts_to_timestr( exec_ts, 4 ).c_str() );
+        }
+
         if ( hov.dist_ts < dist_ts )
         {
             gi.hovered_eventid = hov.eventid;
@@ -4337,6 +5374,9 @@ void TraceWin::graph_mouse_tooltip( graph_info_t &gi, int64_t mouse_ts )
     graph_mouse_tooltip_vblanks( ttip, gi, mouse_ts );
     graph_mouse_tooltip_markers( ttip, gi, mouse_ts );
     graph_mouse_tooltip_sched_switch( ttip, gi, mouse_ts );
+    graph_mouse_tooltip_thread_states( ttip, gi, mouse_ts );
+    graph_mouse_tooltip_irqs( ttip, gi, mouse_ts );
+    graph_mouse_tooltip_cpu_power( ttip, gi, mouse_ts );
     graph_mouse_tooltip_hovered_items( ttip, gi, mouse_ts );
     graph_mouse_tooltip_hovered_amd_fence_signaled( ttip, gi, mouse_ts );
 
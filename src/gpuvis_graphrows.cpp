@@ -327,6 +327,41 @@ void GraphRows::init( TraceEvents &trace_events )
         }
     }
 
+    // Generic dma_fence / drm_sched timelines
+    for ( auto &timeline_locs : trace_events.m_dma_fence.timeline_locs.m_locs.m_map )
+    {
+        std::vector< uint32_t > &locs = timeline_locs.second;
+        const char *name = trace_events.m_strpool.findstr( timeline_locs.first );
+
+        push_row( name, LOC_TYPE_DmaFence, locs.size() );
+    }
+
+    // Block device request timelines
+    for ( auto &block_dev : trace_events.m_block_devs.m_map )
+    {
+        const block_dev_t &dev = block_dev.second;
+
+        push_row( dev.name, LOC_TYPE_BlockDev, dev.locs.size() );
+    }
+
+    // Workqueue function timelines. Hidden by default as there can be lots of them.
+    for ( auto &func_locs : trace_events.m_workqueue.func_locs.m_locs.m_map )
+    {
+        std::vector< uint32_t > &locs = func_locs.second;
+        const char *name = trace_events.m_strpool.findstr( func_locs.first );
+
+        push_row( name, LOC_TYPE_Workqueue, locs.size(), true );
+    }
+
+    // Gpu memory ledger plots
+    for ( const auto &plot : trace_events.m_gpu_mem.plots )
+    {
+        GraphPlot *pplot = trace_events.get_plot_ptr( plot.first.c_str() );
+
+        if ( pplot )
+            push_row( plot.first, LOC_TYPE_Plot, pplot->m_plotdata.size() );
+    }
+
     if ( ( plocs = trace_events.get_locs( "cpu graph", &type ) ) )
     {
         push_row( "cpu graph", type, plocs->size(), false );
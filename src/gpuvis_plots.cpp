@@ -315,42 +315,3 @@ uint32_t GraphPlot::find_ts_index( int64_t ts0 )
 
     return ( uint32_t )-1;
 }
-
-bool ParsePlotStr::init( const char *scanf_str )
-{
-    const char *pct_f = strstr( scanf_str, "%f" );
-
-    if ( pct_f )
-    {
-        m_scanf_str = scanf_str;
-        m_scanf_len = pct_f - scanf_str;
-        return true;
-    }
-
-    return false;
-}
-
-bool ParsePlotStr::parse( const char *buf )
-{
-    if ( buf )
-    {
-        const char *pat_start = strncasestr( buf, m_scanf_str, m_scanf_len );
-
-        if ( pat_start )
-        {
-            char *val_end;
-            const char *val_start = pat_start + m_scanf_len;
-
-            m_valf = strtof( val_start, &val_end );
-
-            if ( val_start != val_end )
-            {
-                m_val_start = val_start;
-                m_val_end = val_end;
-                return true;
-            }
-        }
-    }
-
-    return false;
-}
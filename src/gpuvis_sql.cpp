@@ -0,0 +1,797 @@
+/*
+ * Copyright 2019 Valve Software
+ *
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <string>
+
+#include <SDL.h>
+
+#if defined( USE_SQLITE3 )
+#include <sqlite3.h>
+#endif
+
+#include "imgui/imgui.h"
+#include "gpuvis_macros.h"
+#include "stlini.h"
+#include "trace-cmd/trace-read.h"
+#include "gpuvis_utils.h"
+#include "gpuvis.h"
+
+/*
+  SQL over loaded trace data:
+
+  Each table is an eponymous sqlite virtual table which reads straight from
+  TraceEvents - nothing is copied into sqlite. Rows of a table are a list of
+  keys (event ids for events, fields, prints and sched_switch, indices for
+  gpu_jobs) and xBestIndex tells sqlite which constraints we can use to cut
+  that list down:
+
+    - name = 'x': event name locations (events, fields)
+    - pid = #: pid locations (events, fields), sched_switch prev_pid locations
+    - ts, id ranges: binary search, as key lists are sorted on both
+
+  Range bounds are treated as inclusive and left for sqlite to double check.
+ */
+
+// Max result rows we hold on to (rows past this are counted but dropped)
+static const size_t s_max_result_rows = 100000;
+
+const std::vector< uint32_t > *TraceSql::get_pid_locs( int pid )
+{
+    if ( !m_pid_locs_inited )
+    {
+        for ( const trace_event_t &event : m_trace_events->m_events )
+            m_pid_locs.m_map[ event.pid ].push_back( event.id );
+
+        m_pid_locs_inited = true;
+    }
+
+    return m_pid_locs.get_val( pid );
+}
+
+void TraceSql::print( FILE *fp ) const
+{
+    size_t cols = m_cols.size();
+
+    if ( !cols )
+        return;
+
+    for ( size_t i = 0; i < cols; i++ )
+        fprintf( fp, "%s%c", m_cols[ i ].c_str(), ( i + 1 < cols ) ? '\t' : '\n' );
+
+    for ( size_t i = 0; i < m_vals.size(); i++ )
+        fprintf( fp, "%s%c", m_vals[ i ].c_str(), ( ( i + 1 ) % cols ) ? '\t' : '\n' );
+
+    if ( m_truncated )
+        fprintf( fp, "(%lu rows, first %lu shown)\n", m_rows, m_vals.size() / cols );
+}
+
+#if defined( USE_SQLITE3 )
+
+enum sql_table_type_t
+{
+    SQL_Events,
+    SQL_Fields,
+    SQL_Prints,
+    SQL_SchedSwitch,
+    SQL_GpuJobs,
+    SQL_Max
+};
+
+struct sql_table_info_t
+{
+    const char *name;
+    const char *schema;
+
+    int ts_col;     // ts column rows are sorted on (or -1)
+    int id_col;     // event id column rows are sorted on (or -1)
+    int pid_col;    // pid column with location lists (or -1)
+    int name_col;   // event name column with location lists (or -1)
+};
+
+static const sql_table_info_t s_sql_tables[ SQL_Max ] =
+{
+    { "events",
+      "CREATE TABLE x(id INTEGER, ts INTEGER, duration INTEGER, id_start INTEGER, pid INTEGER, "
+      "cpu INTEGER, flags INTEGER, seqno INTEGER, crtc INTEGER, comm TEXT, system TEXT, name TEXT, "
+      "user_comm TEXT)",
+      1, 0, 4, 11 },
+    { "fields",
+      "CREATE TABLE x(event_id INTEGER, ts INTEGER, pid INTEGER, name TEXT, key TEXT, value TEXT)",
+      1, 0, 2, 3 },
+    { "prints",
+      "CREATE TABLE x(event_id INTEGER, ts INTEGER, pid INTEGER, tgid INTEGER, duration INTEGER, buf TEXT)",
+      1, -1, -1, -1 },
+    { "sched_switch",
+      "CREATE TABLE x(event_id INTEGER, ts INTEGER, start_ts INTEGER, duration INTEGER, cpu INTEGER, "
+      "pid INTEGER, comm TEXT, next_pid INTEGER, preempted INTEGER)",
+      1, 0, 5, -1 },
+    { "gpu_jobs",
+      "CREATE TABLE x(row TEXT, submit_ts INTEGER, submit_pid INTEGER, exec_ts INTEGER, end_ts INTEGER, "
+      "end_eventid INTEGER, end_cpu INTEGER)",
+      4, -1, -1, -1 },
+};
+
+// xBestIndex idxNum bits. Constraint values are passed to xFilter in bit order.
+enum sql_idx_t
+{
+    SQL_IDX_TsLo   = 0x01,
+    SQL_IDX_TsHi   = 0x02,
+    SQL_IDX_TsEq   = 0x04,
+    SQL_IDX_IdLo   = 0x08,
+    SQL_IDX_IdHi   = 0x10,
+    SQL_IDX_IdEq   = 0x20,
+    SQL_IDX_Pid    = 0x40,
+    SQL_IDX_Name   = 0x80,
+    SQL_IDX_Max    = 0x100
+};
+
+// Bit number of a single sql_idx_t bit: index into xBestIndex constraints and xFilter vals
+static constexpr int sql_idx_bitnum( uint32_t bit )
+{
+    return ( bit <= 1 ) ? 0 : ( 1 + sql_idx_bitnum( bit >> 1 ) );
+}
+
+struct sql_module_t
+{
+    TraceSql *sql;
+    sql_table_type_t type;
+};
+
+struct sql_vtab_t
+{
+    sqlite3_vtab base;
+    TraceSql *sql;
+    sql_table_type_t type;
+};
+
+struct sql_cursor_t
+{
+    sqlite3_vtab_cursor base;
+
+    // Row keys (NULL: keys are 0..count-1)
+    const std::vector< uint32_t > *locs;
+    size_t pos;
+    size_t end;
+
+    // Field index for fields table
+    uint32_t field;
+};
+
+static const std::vector< uint32_t > s_empty_locs;
+
+static uint32_t sql_key( const sql_cursor_t *cursor, size_t pos )
+{
+    return cursor->locs ? ( *cursor->locs )[ pos ] : ( uint32_t )pos;
+}
+
+// All row keys for a table. Returns NULL with count for 0..count-1.
+static const std::vector< uint32_t > *sql_table_locs( TraceEvents &trace_events, sql_table_type_t type, size_t &count )
+{
+    const std::vector< uint32_t > *locs = NULL;
+
+    count = 0;
+    switch ( type )
+    {
+    case SQL_Events:
+    case SQL_Fields:
+        count = trace_events.m_events.size();
+        break;
+    case SQL_Prints:
+        locs = &trace_events.m_ftrace.print_locs;
+        break;
+    case SQL_SchedSwitch:
+        locs = trace_events.m_eventnames_locs.get_locations_str( "sched_switch" );
+        if ( !locs )
+            locs = &s_empty_locs;
+        break;
+    case SQL_GpuJobs:
+        count = trace_events.m_gpu_jobs.size();
+        break;
+    case SQL_Max:
+        break;
+    }
+
+    if ( locs )
+        count = locs->size();
+    return locs;
+}
+
+static int64_t sql_key_ts( TraceEvents &trace_events, sql_table_type_t type, uint32_t key )
+{
+    if ( type == SQL_Prints )
+        return trace_events.get_print_info( key )->ts;
+    else if ( type == SQL_GpuJobs )
+        return trace_events.m_gpu_jobs[ key ].end_ts;
+
+    return trace_events.m_events[ key ].ts;
+}
+
+static int sql_connect( sqlite3 *db, void *aux, int argc, const char *const *argv,
+                        sqlite3_vtab **pvtab, char **errstr )
+{
+    sql_module_t *module = ( sql_module_t * )aux;
+    int rc = sqlite3_declare_vtab( db, s_sql_tables[ module->type ].schema );
+
+    if ( rc == SQLITE_OK )
+    {
+        sql_vtab_t *vtab = ( sql_vtab_t * )sqlite3_malloc( sizeof( sql_vtab_t ) );
+
+        if ( !vtab )
+            return SQLITE_NOMEM;
+
+        memset( vtab, 0, sizeof( *vtab ) );
+        vtab->sql = module->sql;
+        vtab->type = module->type;
+        *pvtab = &vtab->base;
+    }
+    return rc;
+}
+
+static int sql_disconnect( sqlite3_vtab *vtab )
+{
+    sqlite3_free( vtab );
+    return SQLITE_OK;
+}
+
+static int sql_best_index( sqlite3_vtab *base, sqlite3_index_info *info )
+{
+    sql_vtab_t *vtab = ( sql_vtab_t * )base;
+    const sql_table_info_t &table = s_sql_tables[ vtab->type ];
+    int constraints[ 8 ];
+    int idx_num = 0;
+    size_t count;
+
+    for ( int i = 0; i < info->nConstraint; i++ )
+    {
+        const sqlite3_index_info::sqlite3_index_constraint &constraint = info->aConstraint[ i ];
+        int col = constraint.iColumn;
+        int bit = 0;
+
+        if ( !constraint.usable || ( col < 0 ) )
+            continue;
+
+        if ( ( col == table.ts_col ) || ( col == table.id_col ) )
+        {
+            int shift = ( col == table.ts_col ) ? 0 : 3;
+
+            switch ( constraint.op )
+            {
+            case SQLITE_INDEX_CONSTRAINT_GT:
+            case SQLITE_INDEX_CONSTRAINT_GE:
+                bit = SQL_IDX_TsLo << shift;
+                break;
+            case SQLITE_INDEX_CONSTRAINT_LT:
+            case SQLITE_INDEX_CONSTRAINT_LE:
+                bit = SQL_IDX_TsHi << shift;
+                break;
+            case SQLITE_INDEX_CONSTRAINT_EQ:
+                bit = SQL_IDX_TsEq << shift;
+                break;
+            }
+        }
+        else if ( constraint.op == SQLITE_INDEX_CONSTRAINT_EQ )
+        {
+            if ( col == table.pid_col )
+                bit = SQL_IDX_Pid;
+            else if ( col == table.name_col )
+                bit = SQL_IDX_Name;
+        }
+
+        if ( bit && !( idx_num & bit ) )
+        {
+            idx_num |= bit;
+            constraints[ sql_idx_bitnum( bit ) ] = i;
+        }
+    }
+
+    // Name lists are generally shorter than pid lists
+    if ( idx_num & SQL_IDX_Name )
+        idx_num &= ~SQL_IDX_Pid;
+
+    double rows;
+    int argv_index = 1;
+
+    sql_table_locs( *vtab->sql->m_trace_events, vtab->type, count );
+    rows = count;
+
+    for ( int bit = 0; ( 1 << bit ) < SQL_IDX_Max; bit++ )
+    {
+        if ( !( idx_num & ( 1 << bit ) ) )
+            continue;
+
+        // omit isn't set: sql_filter ignores values that aren't numbers, so
+        //  SQLite still has to check the constraints itself
+        info->aConstraintUsage[ constraints[ bit ] ].argvIndex = argv_index++;
+
+        if ( ( 1 << bit ) & ( SQL_IDX_TsEq | SQL_IDX_IdEq ) )
+            rows /= 1000;
+        else if ( ( 1 << bit ) & ( SQL_IDX_Pid | SQL_IDX_Name ) )
+            rows /= 100;
+        else
+            rows /= 4;
+    }
+
+    // Results come out in ts and id order
+    if ( ( info->nOrderBy == 1 ) && !info->aOrderBy[ 0 ].desc &&
+         ( ( info->aOrderBy[ 0 ].iColumn == table.ts_col ) ||
+           ( ( info->aOrderBy[ 0 ].iColumn == table.id_col ) && ( table.id_col >= 0 ) ) ) )
+    {
+        info->orderByConsumed = 1;
+    }
+
+    info->idxNum = idx_num;
+    info->estimatedCost = rows + 1;
+    info->estimatedRows = ( sqlite3_int64 )rows + 1;
+    return SQLITE_OK;
+}
+
+static int sql_open( sqlite3_vtab *vtab, sqlite3_vtab_cursor **pcursor )
+{
+    sql_cursor_t *cursor = ( sql_cursor_t * )sqlite3_malloc( sizeof( sql_cursor_t ) );
+
+    if ( !cursor )
+        return SQLITE_NOMEM;
+
+    memset( cursor, 0, sizeof( *cursor ) );
+    *pcursor = &cursor->base;
+    return SQLITE_OK;
+}
+
+static int sql_close( sqlite3_vtab_cursor *cursor )
+{
+    sqlite3_free( cursor );
+    return SQLITE_OK;
+}
+
+// Skip events without fields
+static void sql_fields_skip( TraceEvents &trace_events, sql_cursor_t *cursor )
+{
+    while ( ( cursor->pos < cursor->end ) &&
+            ( cursor->field >= trace_events.m_events[ sql_key( cursor, cursor->pos ) ].numfields ) )
+    {
+        cursor->pos++;
+        cursor->field = 0;
+    }
+}
+
+// First position in [pos, end) with val( key ) >= lo (or > hi when upper is set)
+template < typename F >
+static size_t sql_search( const sql_cursor_t *cursor, size_t pos, size_t end,
+                          int64_t val, bool upper, F key_val )
+{
+    while ( pos < end )
+    {
+        size_t mid = pos + ( end - pos ) / 2;
+        int64_t mid_val = key_val( sql_key( cursor, mid ) );
+
+        if ( upper ? ( mid_val <= val ) : ( mid_val < val ) )
+            pos = mid + 1;
+        else
+            end = mid;
+    }
+    return pos;
+}
+
+// Returns val if it's an integer or float, NULL for text, blobs, and NULL
+static sqlite3_value *sql_numeric_value( sqlite3_value *val )
+{
+    if ( val )
+    {
+        int type = sqlite3_value_numeric_type( val );
+
+        if ( ( type != SQLITE_INTEGER ) && ( type != SQLITE_FLOAT ) )
+            return NULL;
+    }
+    return val;
+}
+
+static int sql_filter( sqlite3_vtab_cursor *base, int idx_num, const char *idx_str,
+                       int argc, sqlite3_value **argv )
+{
+    sql_cursor_t *cursor = ( sql_cursor_t * )base;
+    sql_vtab_t *vtab = ( sql_vtab_t * )base->pVtab;
+    TraceEvents &trace_events = *vtab->sql->m_trace_events;
+    sql_table_type_t type = vtab->type;
+    sqlite3_value *vals[ 8 ] = { NULL };
+    size_t count;
+
+    for ( int bit = 0, arg = 0; ( 1 << bit ) < SQL_IDX_Max; bit++ )
+    {
+        if ( ( idx_num & ( 1 << bit ) ) && ( arg < argc ) )
+            vals[ bit ] = argv[ arg++ ];
+    }
+
+    cursor->locs = sql_table_locs( trace_events, type, count );
+    cursor->field = 0;
+
+    if ( vals[ sql_idx_bitnum( SQL_IDX_Name ) ] )
+    {
+        const char *name = ( const char * )sqlite3_value_text( vals[ sql_idx_bitnum( SQL_IDX_Name ) ] );
+
+        cursor->locs = name ? trace_events.m_eventnames_locs.get_locations_str( name ) : NULL;
+        if ( !cursor->locs )
+            cursor->locs = &s_empty_locs;
+    }
+    else if ( sql_numeric_value( vals[ sql_idx_bitnum( SQL_IDX_Pid ) ] ) )
+    {
+        int pid = sqlite3_value_int( vals[ sql_idx_bitnum( SQL_IDX_Pid ) ] );
+
+        if ( type == SQL_SchedSwitch )
+            cursor->locs = trace_events.m_sched_switch_prev_locs.get_locations_u32( pid );
+        else
+            cursor->locs = vtab->sql->get_pid_locs( pid );
+
+        if ( !cursor->locs )
+            cursor->locs = &s_empty_locs;
+    }
+
+    cursor->pos = 0;
+    cursor->end = cursor->locs ? cursor->locs->size() : count;
+
+    // ts and id bounds
+    for ( int shift = 0; shift <= 3; shift += 3 )
+    {
+        sqlite3_value *lo = sql_numeric_value( vals[ sql_idx_bitnum( SQL_IDX_TsLo << shift ) ] );
+        sqlite3_value *hi = sql_numeric_value( vals[ sql_idx_bitnum( SQL_IDX_TsHi << shift ) ] );
+        sqlite3_value *eq = sql_numeric_value( vals[ sql_idx_bitnum( SQL_IDX_TsEq << shift ) ] );
+        auto key_val = [&]( uint32_t key )
+        {
+            return shift ? ( int64_t )key : sql_key_ts( trace_events, type, key );
+        };
+
+        if ( eq )
+            lo = hi = eq;
+
+        if ( lo )
+        {
+            cursor->pos = sql_search( cursor, cursor->pos, cursor->end,
+                                      sqlite3_value_int64( lo ), false, key_val );
+        }
+        if ( hi )
+        {
+            cursor->end = sql_search( cursor, cursor->pos, cursor->end,
+                                      sqlite3_value_int64( hi ), true, key_val );
+        }
+    }
+
+    if ( type == SQL_Fields )
+        sql_fields_skip( trace_events, cursor );
+
+    return SQLITE_OK;
+}
+
+static int sql_next( sqlite3_vtab_cursor *base )
+{
+    sql_cursor_t *cursor = ( sql_cursor_t * )base;
+    sql_vtab_t *vtab = ( sql_vtab_t * )base->pVtab;
+
+    if ( vtab->type == SQL_Fields )
+    {
+        cursor->field++;
+        sql_fields_skip( *vtab->sql->m_trace_events, cursor );
+    }
+    else
+    {
+        cursor->pos++;
+    }
+    return SQLITE_OK;
+}
+
+static int sql_eof( sqlite3_vtab_cursor *base )
+{
+    sql_cursor_t *cursor = ( sql_cursor_t * )base;
+
+    return cursor->pos >= cursor->end;
+}
+
+static void sql_result_str( sqlite3_context *ctx, const char *str )
+{
+    if ( str )
+        sqlite3_result_text( ctx, str, -1, SQLITE_STATIC );
+    else
+        sqlite3_result_null( ctx );
+}
+
+static void sql_result_ts( sqlite3_context *ctx, int64_t val, int64_t null_val )
+{
+    if ( val == null_val )
+        sqlite3_result_null( ctx );
+    else
+        sqlite3_result_int64( ctx, val );
+}
+
+static void sql_column_event( sqlite3_context *ctx, const trace_event_t &event, int col )
+{
+    switch ( col )
+    {
+    case 0: sqlite3_result_int64( ctx, event.id ); break;
+    case 1: sqlite3_result_int64( ctx, event.ts ); break;
+    case 2: sql_result_ts( ctx, event.duration, INT64_MAX ); break;
+    case 3: sql_result_ts( ctx, event.id_start, INVALID_ID ); break;
+    case 4: sqlite3_result_int( ctx, event.pid ); break;
+    case 5: sqlite3_result_int64( ctx, event.cpu ); break;
+    case 6: sqlite3_result_int64( ctx, event.flags ); break;
+    case 7: sqlite3_result_int64( ctx, event.seqno ); break;
+    case 8: sql_result_ts( ctx, event.crtc, -1 ); break;
+    case 9: sql_result_str( ctx, event.comm ); break;
+    case 10: sql_result_str( ctx, event.system ); break;
+    case 11: sql_result_str( ctx, event.name ); break;
+    case 12: sql_result_str( ctx, event.user_comm ); break;
+    }
+}
+
+static void sql_column_field( sqlite3_context *ctx, const trace_event_t &event, uint32_t field, int col )
+{
+    switch ( col )
+    {
+    case 0: sqlite3_result_int64( ctx, event.id ); break;
+    case 1: sqlite3_result_int64( ctx, event.ts ); break;
+    case 2: sqlite3_result_int( ctx, event.pid ); break;
+    case 3: sql_result_str( ctx, event.name ); break;
+    case 4: sql_result_str( ctx, event.fields[ field ].key ); break;
+    case 5: sql_result_str( ctx, event.fields[ field ].value ); break;
+    }
+}
+
+static void sql_column_print( sqlite3_context *ctx, const trace_event_t &event,
+                              const print_info_t *print_info, int col )
+{
+    switch ( col )
+    {
+    case 0: sqlite3_result_int64( ctx, event.id ); break;
+    case 1: sqlite3_result_int64( ctx, print_info ? print_info->ts : event.ts ); break;
+    case 2: sqlite3_result_int( ctx, event.pid ); break;
+    case 3: sqlite3_result_int( ctx, print_info ? print_info->tgid : 0 ); break;
+    case 4: sql_result_ts( ctx, event.duration, INT64_MAX ); break;
+    case 5: sql_result_str( ctx, print_info ? print_info->buf : NULL ); break;
+    }
+}
+
+static void sql_column_sched_switch( sqlite3_context *ctx, const trace_event_t &event, int col )
+{
+    switch ( col )
+    {
+    case 0: sqlite3_result_int64( ctx, event.id ); break;
+    case 1: sqlite3_result_int64( ctx, event.ts ); break;
+    case 2:
+        if ( event.has_duration() )
+            sqlite3_result_int64( ctx, event.ts - event.duration );
+        else
+            sqlite3_result_null( ctx );
+        break;
+    case 3: sql_result_ts( ctx, event.duration, INT64_MAX ); break;
+    case 4: sqlite3_result_int64( ctx, event.cpu ); break;
+    case 5: sqlite3_result_int( ctx, atoi( get_event_field_val( event, "prev_pid" ) ) ); break;
+    case 6: sql_result_str( ctx, get_event_field_val( event, "prev_comm", NULL ) ); break;
+    case 7: sqlite3_result_int( ctx, atoi( get_event_field_val( event, "next_pid" ) ) ); break;
+    case 8: sqlite3_result_int( ctx, !!( event.flags & TRACE_FLAG_SCHED_SWITCH_TASK_RUNNING ) ); break;
+    }
+}
+
+static void sql_column_gpu_job( sqlite3_context *ctx, TraceEvents &trace_events, const gpu_job_t &job, int col )
+{
+    switch ( col )
+    {
+    case 0: sql_result_str( ctx, trace_events.m_strpool.findstr( job.row_hashval ) ); break;
+    case 1: sqlite3_result_int64( ctx, job.submit_ts ); break;
+    case 2: sqlite3_result_int( ctx, job.submit_pid ); break;
+    case 3: sqlite3_result_int64( ctx, job.exec_ts ); break;
+    case 4: sqlite3_result_int64( ctx, job.end_ts ); break;
+    case 5: sql_result_ts( ctx, job.end_eventid, INVALID_ID ); break;
+    case 6: sqlite3_result_int64( ctx, job.end_cpu ); break;
+    }
+}
+
+static int sql_column( sqlite3_vtab_cursor *base, sqlite3_context *ctx, int col )
+{
+    sql_cursor_t *cursor = ( sql_cursor_t * )base;
+    sql_vtab_t *vtab = ( sql_vtab_t * )base->pVtab;
+    TraceEvents &trace_events = *vtab->sql->m_trace_events;
+    uint32_t key = sql_key( cursor, cursor->pos );
+
+    switch ( vtab->type )
+    {
+    case SQL_Events:
+        sql_column_event( ctx, trace_events.m_events[ key ], col );
+        break;
+    case SQL_Fields:
+        sql_column_field( ctx, trace_events.m_events[ key ], cursor->field, col );
+        break;
+    case SQL_Prints:
+        sql_column_print( ctx, trace_events.m_events[ key ], trace_events.get_print_info( key ), col );
+        break;
+    case SQL_SchedSwitch:
+        sql_column_sched_switch( ctx, trace_events.m_events[ key ], col );
+        break;
+    case SQL_GpuJobs:
+        sql_column_gpu_job( ctx, trace_events, trace_events.m_gpu_jobs[ key ], col );
+        break;
+    case SQL_Max:
+        break;
+    }
+    return SQLITE_OK;
+}
+
+static int sql_rowid( sqlite3_vtab_cursor *base, sqlite3_int64 *rowid )
+{
+    sql_cursor_t *cursor = ( sql_cursor_t * )base;
+    sql_vtab_t *vtab = ( sql_vtab_t * )base->pVtab;
+    sqlite3_int64 key = sql_key( cursor, cursor->pos );
+
+    *rowid = ( vtab->type == SQL_Fields ) ? ( ( key << 16 ) | cursor->field ) : key;
+    return SQLITE_OK;
+}
+
+static void sql_module_destroy( void *aux )
+{
+    delete ( sql_module_t * )aux;
+}
+
+static sqlite3_module *sql_get_module()
+{
+    static sqlite3_module module;
+
+    if ( !module.xConnect )
+    {
+        // No xCreate: eponymous-only tables
+        module.xConnect = sql_connect;
+        module.xBestIndex = sql_best_index;
+        module.xDisconnect = sql_disconnect;
+        module.xOpen = sql_open;
+        module.xClose = sql_close;
+        module.xFilter = sql_filter;
+        module.xNext = sql_next;
+        module.xEof = sql_eof;
+        module.xColumn = sql_column;
+        module.xRowid = sql_rowid;
+    }
+    return &module;
+}
+
+TraceSql::~TraceSql()
+{
+    if ( m_db )
+        sqlite3_close( m_db );
+}
+
+bool TraceSql::query( TraceEvents &trace_events, const char *sql, std::string &errstr )
+{
+    util_time_t t0 = util_get_time();
+
+    if ( m_trace_events != &trace_events )
+    {
+        if ( m_db )
+            sqlite3_close( m_db );
+        m_db = NULL;
+
+        m_pid_locs.m_map.clear();
+        m_pid_locs_inited = false;
+        m_trace_events = &trace_events;
+    }
+
+    if ( !m_db )
+    {
+        if ( sqlite3_open( ":memory:", &m_db ) != SQLITE_OK )
+        {
+            errstr = string_format( "sqlite3_open failed: %s", sqlite3_errmsg( m_db ) );
+            sqlite3_close( m_db );
+            m_db = NULL;
+            return false;
+        }
+
+        for ( int type = 0; type < SQL_Max; type++ )
+        {
+            sql_module_t *module = new sql_module_t;
+
+            module->sql = this;
+            module->type = ( sql_table_type_t )type;
+            sqlite3_create_module_v2( m_db, s_sql_tables[ type ].name, sql_get_module(),
+                                      module, sql_module_destroy );
+        }
+    }
+
+    m_cols.clear();
+    m_vals.clear();
+    m_rows = 0;
+    m_truncated = false;
+
+    // Run all statements, keeping results of the last one which returns columns
+    const char *tail = sql;
+    while ( tail && *tail )
+    {
+        sqlite3_stmt *stmt = NULL;
+        int rc = sqlite3_prepare_v2( m_db, tail, -1, &stmt, &tail );
+
+        if ( rc != SQLITE_OK )
+        {
+            errstr = sqlite3_errmsg( m_db );
+            return false;
+        }
+        if ( !stmt )
+            break;
+
+        int cols = sqlite3_column_count( stmt );
+        if ( cols )
+        {
+            m_cols.clear();
+            m_vals.clear();
+            m_rows = 0;
+            m_truncated = false;
+
+            for ( int i = 0; i < cols; i++ )
+                m_cols.push_back( sqlite3_column_name( stmt, i ) );
+        }
+
+        while ( ( rc = sqlite3_step( stmt ) ) == SQLITE_ROW )
+        {
+            if ( m_rows++ >= s_max_result_rows )
+            {
+                m_truncated = true;
+                continue;
+            }
+
+            for ( int i = 0; i < cols; i++ )
+            {
+                const char *val = ( const char * )sqlite3_column_text( stmt, i );
+
+                m_vals.push_back( val ? val : "" );
+            }
+        }
+
+        sqlite3_finalize( stmt );
+
+        if ( rc != SQLITE_DONE )
+        {
+            errstr = sqlite3_errmsg( m_db );
+            return false;
+        }
+    }
+
+    m_time_ms = util_time_to_ms( t0, util_get_time() );
+    return true;
+}
+
+#else
+
+TraceSql::~TraceSql()
+{
+}
+
+bool TraceSql::query( TraceEvents &trace_events, const char *sql, std::string &errstr )
+{
+    errstr = "gpuvis was built without sqlite3 support (USE_SQLITE3)";
+    return false;
+}
+
+#endif // USE_SQLITE3
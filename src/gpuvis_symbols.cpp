@@ -0,0 +1,1279 @@
+/*
+ * Copyright 2019 Valve Software
+ *
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <string>
+#include <atomic>
+#include <future>
+#include <thread>
+
+#if defined( __GNUC__ )
+#include <cxxabi.h>
+#endif
+
+#if !defined( _WIN32 )
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
+#include <SDL.h>
+
+#include "imgui/imgui.h"
+#include "imgui/imgui_internal.h"   // BeginColumns(), EndColumns() WIP
+#include "gpuvis_macros.h"
+#include "stlini.h"
+#include "trace-cmd/trace-read.h"
+#include "gpuvis_utils.h"
+#include "gpuvis.h"
+#include "miniz.h"
+
+/*
+  Offline stack symbolizer. Stack events come from trace-cmd -T (kernel_stack),
+  the userstacktrace option (user_stack), and perf callchains. Kernel addresses
+  are resolved with kallsyms while the trace is read. User addresses are looked
+  up here:
+
+    - Unique stacks are gathered first, so each stack string is parsed once.
+    - Each unique (tgid, address) is placed in its process memory map (trace-cmd
+      -P proc maps or perf mmap records), and addresses are grouped per binary.
+    - Binaries are loaded from the sysroot in parallel, one per worker at a time.
+      Symbols come from .symtab or .dynsym, and file:line from .debug_line. If the
+      binary is stripped, a separate debug file is found by build id or debuglink
+      under sysroot/usr/lib/debug.
+    - Results go into the address -> symbol tables in m_stack_syms, so tooltips
+      and the Stacks list are plain lookups.
+
+  ELF and DWARF are parsed by hand (little endian only) so this works without
+  libelf / libdw, and on Windows with a copied sysroot.
+ */
+
+#define SHT_SYMTAB          2
+#define SHT_NOBITS          8
+#define SHT_DYNSYM          11
+#define SHF_COMPRESSED      0x800
+#define PT_LOAD             1
+#define STT_FUNC            2
+#define STT_GNU_IFUNC       10
+#define NT_GNU_BUILD_ID     3
+#define ELFCOMPRESS_ZLIB    1
+
+#define DW_LNS_copy                 1
+#define DW_LNS_advance_pc           2
+#define DW_LNS_advance_line         3
+#define DW_LNS_set_file             4
+#define DW_LNS_const_add_pc         8
+#define DW_LNS_fixed_advance_pc     9
+#define DW_LNE_end_sequence         1
+#define DW_LNE_set_address          2
+#define DW_LNCT_path                1
+#define DW_LNCT_directory_index     2
+#define DW_FORM_block               0x09
+#define DW_FORM_data1               0x0b
+#define DW_FORM_data2               0x05
+#define DW_FORM_data4               0x06
+#define DW_FORM_data8               0x07
+#define DW_FORM_data16              0x1e
+#define DW_FORM_string              0x08
+#define DW_FORM_strp                0x0e
+#define DW_FORM_udata               0x0f
+#define DW_FORM_line_strp           0x1f
+
+// Bounds checked little endian reader. Reads past end return 0 and clear ok.
+struct byte_reader_t
+{
+    const uint8_t *p;
+    const uint8_t *end;
+    bool ok = true;
+
+    byte_reader_t( const uint8_t *_p, const uint8_t *_end ) : p( _p ), end( _end ) {}
+
+    bool check( size_t size )
+    {
+        if ( ok && ( size <= ( size_t )( end - p ) ) )
+            return true;
+
+        ok = false;
+        p = end;
+        return false;
+    }
+    uint64_t read( size_t size )
+    {
+        uint64_t val = 0;
+
+        if ( check( size ) )
+        {
+            memcpy( &val, p, std::min< size_t >( size, sizeof( val ) ) );
+            p += size;
+        }
+        return val;
+    }
+    void skip( uint64_t size )
+    {
+        if ( check( size ) )
+            p += size;
+    }
+    uint64_t uleb()
+    {
+        uint64_t val = 0;
+
+        for ( uint32_t shift = 0; check( 1 ); shift += 7 )
+        {
+            uint8_t byte = *p++;
+
+            if ( shift < 64 )
+                val |= ( uint64_t )( byte & 0x7f ) << shift;
+            if ( !( byte & 0x80 ) )
+                break;
+        }
+        return val;
+    }
+    int64_t sleb()
+    {
+        int64_t val = 0;
+        uint32_t shift = 0;
+        uint8_t byte = 0;
+
+        while ( check( 1 ) )
+        {
+            byte = *p++;
+            if ( shift < 64 )
+                val |= ( int64_t )( byte & 0x7f ) << shift;
+            shift += 7;
+            if ( !( byte & 0x80 ) )
+                break;
+        }
+        if ( ( shift < 64 ) && ( byte & 0x40 ) )
+            val |= -( ( int64_t )1 << shift );
+        return val;
+    }
+    const char *str()
+    {
+        const uint8_t *nul = ( const uint8_t * )memchr( p, 0, end - p );
+
+        if ( !ok || !nul )
+        {
+            ok = false;
+            return "";
+        }
+
+        const char *ret = ( const char * )p;
+
+        p = nul + 1;
+        return ret;
+    }
+};
+
+struct elf_section_t
+{
+    const char *name;
+    uint32_t type;
+    uint64_t flags;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t link;
+    uint64_t entsize;
+};
+
+struct elf_load_t
+{
+    uint64_t offset;
+    uint64_t vaddr;
+    uint64_t filesz;
+    uint64_t align;
+};
+
+struct elf_sym_t
+{
+    uint64_t addr;
+    uint64_t size;
+    const char *name;
+};
+
+class ElfFile
+{
+public:
+    ElfFile() {}
+    ~ElfFile() { close(); }
+
+    bool load( const std::string &filename );
+    void close();
+
+    const elf_section_t *find_section( const char *name ) const;
+    // Return section contents, decompressing SHF_COMPRESSED sections into buf
+    bool get_section_data( const elf_section_t *section, std::vector< uint8_t > &buf,
+                           const uint8_t *&data, size_t &size ) const;
+
+    // Add function symbols from .symtab (or .dynsym if there's no .symtab)
+    void add_symbols( std::vector< elf_sym_t > &syms ) const;
+
+    std::string get_build_id() const;
+    std::string get_debuglink() const;
+
+public:
+    bool m_is64 = false;
+
+    // File is mmap'd read-only, so only the sections we look at get paged in
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+#if defined( _WIN32 )
+    std::vector< uint8_t > m_buf;
+#endif
+
+    std::vector< elf_section_t > m_sections;
+    std::vector< elf_load_t > m_loads;
+};
+
+void ElfFile::close()
+{
+#if defined( _WIN32 )
+    m_buf.clear();
+#else
+    if ( m_data )
+        munmap( ( void * )m_data, m_size );
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+    m_is64 = false;
+    m_sections.clear();
+    m_loads.clear();
+}
+
+bool ElfFile::load( const std::string &filename )
+{
+    close();
+
+#if defined( _WIN32 )
+    FILE *fp = fopen( filename.c_str(), "rb" );
+
+    if ( !fp )
+        return false;
+
+    fseek( fp, 0, SEEK_END );
+    long size = ftell( fp );
+    fseek( fp, 0, SEEK_SET );
+
+    if ( size > 0x40 )
+    {
+        m_buf.resize( size );
+        if ( fread( m_buf.data(), 1, size, fp ) != ( size_t )size )
+            m_buf.clear();
+    }
+    fclose( fp );
+
+    m_data = m_buf.data();
+    m_size = m_buf.size();
+#else
+    int fd = TEMP_FAILURE_RETRY( open( filename.c_str(), O_RDONLY ) );
+    struct stat st;
+
+    if ( fd < 0 )
+        return false;
+
+    if ( !fstat( fd, &st ) && S_ISREG( st.st_mode ) && ( st.st_size > 0x40 ) )
+    {
+        void *ptr = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+        if ( ptr != MAP_FAILED )
+        {
+            m_data = ( const uint8_t * )ptr;
+            m_size = st.st_size;
+        }
+    }
+    ::close( fd );
+#endif
+
+    const uint8_t *data = m_data;
+
+    // "\x7fELF", little endian only
+    if ( ( m_size <= 0x40 ) || memcmp( data, "\x7f" "ELF", 4 ) || ( data[ 5 ] != 1 ) )
+        return false;
+
+    m_is64 = ( data[ 4 ] == 2 );
+
+    byte_reader_t hdr( data, data + m_size );
+
+    hdr.skip( m_is64 ? 0x20 : 0x1c );
+    uint64_t phoff = hdr.read( m_is64 ? 8 : 4 );
+    uint64_t shoff = hdr.read( m_is64 ? 8 : 4 );
+    hdr.skip( 6 );
+    uint32_t phentsize = hdr.read( 2 );
+    uint32_t phnum = hdr.read( 2 );
+    uint32_t shentsize = hdr.read( 2 );
+    uint32_t shnum = hdr.read( 2 );
+    uint32_t shstrndx = hdr.read( 2 );
+
+    // Ignore header tables that don't fit in the file
+    if ( ( phoff > m_size ) || ( ( uint64_t )phnum * phentsize > m_size - phoff ) )
+        phnum = 0;
+    if ( ( shoff > m_size ) || ( ( uint64_t )shnum * shentsize > m_size - shoff ) )
+        shnum = 0;
+
+    for ( uint32_t i = 0; i < phnum; i++ )
+    {
+        byte_reader_t ph( data + phoff + i * phentsize, data + m_size );
+        elf_load_t load;
+        uint32_t type = ph.read( 4 );
+
+        if ( m_is64 )
+        {
+            ph.skip( 4 );
+            load.offset = ph.read( 8 );
+            load.vaddr = ph.read( 8 );
+            ph.skip( 8 );
+            load.filesz = ph.read( 8 );
+            ph.skip( 8 );
+            load.align = ph.read( 8 );
+        }
+        else
+        {
+            load.offset = ph.read( 4 );
+            load.vaddr = ph.read( 4 );
+            ph.skip( 4 );
+            load.filesz = ph.read( 4 );
+            ph.skip( 8 );
+            load.align = ph.read( 4 );
+        }
+
+        if ( ( type == PT_LOAD ) && ph.ok )
+            m_loads.push_back( load );
+    }
+
+    std::vector< uint64_t > name_offsets;
+
+    for ( uint32_t i = 0; i < shnum; i++ )
+    {
+        byte_reader_t sh( data + shoff + i * shentsize, data + m_size );
+        elf_section_t section;
+        uint32_t name_offset = sh.read( 4 );
+        size_t wordsize = m_is64 ? 8 : 4;
+
+        section.name = "";
+        section.type = sh.read( 4 );
+        section.flags = sh.read( wordsize );
+        sh.skip( wordsize );
+        section.offset = sh.read( wordsize );
+        section.size = sh.read( wordsize );
+        section.link = sh.read( 4 );
+        sh.skip( 4 + wordsize );
+        section.entsize = sh.read( wordsize );
+
+        // NOBITS sections have no file data, so they read as empty
+        if ( ( section.type == SHT_NOBITS ) ||
+             ( section.offset > m_size ) || ( section.size > m_size - section.offset ) )
+        {
+            section.size = 0;
+        }
+
+        m_sections.push_back( section );
+        name_offsets.push_back( name_offset );
+    }
+
+    if ( shstrndx < m_sections.size() )
+    {
+        const elf_section_t &strtab = m_sections[ shstrndx ];
+
+        for ( size_t i = 0; i < m_sections.size(); i++ )
+        {
+            if ( name_offsets[ i ] < strtab.size )
+            {
+                const char *name = ( const char * )data + strtab.offset + name_offsets[ i ];
+
+                if ( memchr( name, 0, strtab.size - name_offsets[ i ] ) )
+                    m_sections[ i ].name = name;
+            }
+        }
+    }
+
+    return true;
+}
+
+const elf_section_t *ElfFile::find_section( const char *name ) const
+{
+    for ( const elf_section_t &section : m_sections )
+    {
+        if ( !strcmp( section.name, name ) )
+            return &section;
+    }
+
+    return NULL;
+}
+
+bool ElfFile::get_section_data( const elf_section_t *section, std::vector< uint8_t > &buf,
+                                const uint8_t *&data, size_t &size ) const
+{
+    if ( !section || !section->size )
+        return false;
+
+    data = m_data + section->offset;
+    size = section->size;
+
+    if ( section->flags & SHF_COMPRESSED )
+    {
+        // Elf_Chdr: ch_type, [ch_reserved], ch_size, ch_addralign
+        byte_reader_t chdr( data, data + size );
+        uint32_t type = chdr.read( 4 );
+
+        chdr.skip( m_is64 ? 4 : 0 );
+        uint64_t ch_size = chdr.read( m_is64 ? 8 : 4 );
+        chdr.skip( m_is64 ? 8 : 4 );
+
+        // Deflate tops out around 1032:1, so anything claiming more is bogus
+        if ( !chdr.ok || ( type != ELFCOMPRESS_ZLIB ) || ( ch_size > ( uint64_t )size * 1032 ) )
+            return false;
+
+        mz_ulong dest_len = ch_size;
+
+        buf.resize( dest_len );
+        if ( mz_uncompress( buf.data(), &dest_len, chdr.p, chdr.end - chdr.p ) != MZ_OK )
+            return false;
+
+        data = buf.data();
+        size = dest_len;
+    }
+
+    return true;
+}
+
+void ElfFile::add_symbols( std::vector< elf_sym_t > &syms ) const
+{
+    const uint8_t *data = m_data;
+    uint32_t type = find_section( ".symtab" ) ? SHT_SYMTAB : SHT_DYNSYM;
+
+    for ( const elf_section_t &section : m_sections )
+    {
+        if ( ( section.type != type ) || !section.entsize || ( section.link >= m_sections.size() ) )
+            continue;
+
+        const elf_section_t &strtab = m_sections[ section.link ];
+
+        for ( uint64_t off = 0; off + section.entsize <= section.size; off += section.entsize )
+        {
+            byte_reader_t sym( data + section.offset + off, data + section.offset + section.size );
+            elf_sym_t elfsym;
+            uint32_t name;
+            uint8_t info;
+            uint16_t shndx;
+
+            name = sym.read( 4 );
+            if ( m_is64 )
+            {
+                info = sym.read( 1 );
+                sym.skip( 1 );
+                shndx = sym.read( 2 );
+                elfsym.addr = sym.read( 8 );
+                elfsym.size = sym.read( 8 );
+            }
+            else
+            {
+                elfsym.addr = sym.read( 4 );
+                elfsym.size = sym.read( 4 );
+                info = sym.read( 1 );
+                sym.skip( 1 );
+                shndx = sym.read( 2 );
+            }
+
+            uint8_t symtype = info & 0xf;
+
+            if ( ( ( symtype != STT_FUNC ) && ( symtype != STT_GNU_IFUNC ) ) ||
+                 !shndx || !elfsym.addr || ( name >= strtab.size ) )
+                continue;
+
+            elfsym.name = ( const char * )data + strtab.offset + name;
+            if ( memchr( elfsym.name, 0, strtab.size - name ) )
+                syms.push_back( elfsym );
+        }
+    }
+}
+
+std::string ElfFile::get_build_id() const
+{
+    const elf_section_t *section = find_section( ".note.gnu.build-id" );
+
+    if ( !section )
+        return "";
+
+    const uint8_t *data = m_data + section->offset;
+    byte_reader_t note( data, data + section->size );
+    uint32_t namesz = note.read( 4 );
+    uint32_t descsz = note.read( 4 );
+    uint32_t type = note.read( 4 );
+
+    note.skip( ( namesz + 3 ) & ~3 );
+    if ( !note.check( descsz ) || ( type != NT_GNU_BUILD_ID ) )
+        return "";
+
+    std::string build_id;
+    for ( uint32_t i = 0; i < descsz; i++ )
+        build_id += string_format( "%02x", note.p[ i ] );
+    return build_id;
+}
+
+std::string ElfFile::get_debuglink() const
+{
+    const elf_section_t *section = find_section( ".gnu_debuglink" );
+
+    if ( !section )
+        return "";
+
+    const uint8_t *data = m_data + section->offset;
+    byte_reader_t link( data, data + section->size );
+
+    return link.str();
+}
+
+static std::string demangle( const char *name )
+{
+#if defined( __GNUC__ )
+    if ( ( name[ 0 ] == '_' ) && ( name[ 1 ] == 'Z' ) )
+    {
+        int status = 0;
+        char *str = abi::__cxa_demangle( name, NULL, NULL, &status );
+
+        if ( str )
+        {
+            std::string ret( str );
+
+            free( str );
+            return ret;
+        }
+    }
+#endif
+    return name;
+}
+
+// Address in a module waiting to be resolved
+struct stack_request_t
+{
+    uint64_t addr;
+    proc_map_t map;
+    stack_sym_t *sym;
+
+    uint64_t vaddr;
+    std::string func;
+    std::string line;
+};
+
+struct stack_module_t
+{
+    const char *filename;
+    std::vector< stack_request_t > requests;
+    bool found = false;
+};
+
+struct line_row_t
+{
+    uint64_t addr;
+    uint32_t file;
+    uint32_t line;
+};
+
+// Read v5 directory / file entry formats and entries, returning paths
+static void dwarf_read_entries( byte_reader_t &rd, bool is64,
+                                const uint8_t *str, size_t str_size,
+                                const uint8_t *line_str, size_t line_str_size,
+                                std::vector< std::string > &paths )
+{
+    std::vector< std::pair< uint64_t, uint64_t > > formats;
+    uint32_t format_count = rd.read( 1 );
+
+    for ( uint32_t i = 0; i < format_count; i++ )
+    {
+        uint64_t content = rd.uleb();
+        uint64_t form = rd.uleb();
+
+        formats.push_back( { content, form } );
+    }
+
+    uint64_t count = rd.uleb();
+
+    for ( uint64_t i = 0; ( i < count ) && rd.ok; i++ )
+    {
+        std::string path;
+
+        for ( const auto &format : formats )
+        {
+            const char *val = NULL;
+
+            switch ( format.second )
+            {
+            case DW_FORM_string:    val = rd.str(); break;
+            case DW_FORM_line_strp:
+            case DW_FORM_strp:
+            {
+                bool is_line = ( format.second == DW_FORM_line_strp );
+                const uint8_t *strs = is_line ? line_str : str;
+                size_t strs_size = is_line ? line_str_size : str_size;
+                uint64_t offset = rd.read( is64 ? 8 : 4 );
+
+                if ( strs && ( offset < strs_size ) && memchr( strs + offset, 0, strs_size - offset ) )
+                    val = ( const char * )strs + offset;
+                break;
+            }
+            case DW_FORM_udata:     rd.uleb(); break;
+            case DW_FORM_data1:     rd.skip( 1 ); break;
+            case DW_FORM_data2:     rd.skip( 2 ); break;
+            case DW_FORM_data4:     rd.skip( 4 ); break;
+            case DW_FORM_data8:     rd.skip( 8 ); break;
+            case DW_FORM_data16:    rd.skip( 16 ); break;
+            case DW_FORM_block:     rd.skip( rd.uleb() ); break;
+            default:
+                // Unsupported form: can't find the end of this entry
+                rd.ok = false;
+                return;
+            }
+
+            if ( ( format.first == DW_LNCT_path ) && val )
+                path = val;
+        }
+
+        paths.push_back( path );
+    }
+}
+
+// Run .debug_line programs and resolve requests (sorted by vaddr) which fall in
+//  each sequence. Only the current sequence's rows are kept around.
+static void dwarf_resolve_lines( const ElfFile &elf, std::vector< stack_request_t > &requests )
+{
+    std::vector< uint8_t > line_buf, str_buf, line_str_buf;
+    const uint8_t *lines, *str = NULL, *line_str = NULL;
+    size_t lines_size, str_size = 0, line_str_size = 0;
+
+    if ( !elf.get_section_data( elf.find_section( ".debug_line" ), line_buf, lines, lines_size ) )
+        return;
+    elf.get_section_data( elf.find_section( ".debug_str" ), str_buf, str, str_size );
+    elf.get_section_data( elf.find_section( ".debug_line_str" ), line_str_buf, line_str, line_str_size );
+
+    byte_reader_t unit( lines, lines + lines_size );
+
+    while ( unit.ok && ( unit.p < unit.end ) )
+    {
+        bool is64 = false;
+        uint64_t unit_length = unit.read( 4 );
+
+        if ( unit_length == 0xffffffff )
+        {
+            is64 = true;
+            unit_length = unit.read( 8 );
+        }
+        if ( !unit.check( unit_length ) )
+            break;
+
+        byte_reader_t rd( unit.p, unit.p + unit_length );
+        unit.skip( unit_length );
+
+        uint32_t version = rd.read( 2 );
+        if ( ( version < 2 ) || ( version > 5 ) )
+            continue;
+        if ( version >= 5 )
+            rd.skip( 2 ); // address_size, segment_selector_size
+
+        uint64_t header_length = rd.read( is64 ? 8 : 4 );
+        if ( !rd.check( header_length ) )
+            continue;
+
+        const uint8_t *program = rd.p + header_length;
+        uint32_t min_inst_length = rd.read( 1 );
+        if ( version >= 4 )
+            rd.skip( 1 ); // maximum_operations_per_instruction
+        rd.skip( 1 ); // default_is_stmt
+        int8_t line_base = ( int8_t )rd.read( 1 );
+        uint32_t line_range = rd.read( 1 );
+        uint32_t opcode_base = rd.read( 1 );
+        std::vector< uint8_t > opcode_lengths( opcode_base ? opcode_base - 1 : 0 );
+
+        for ( uint8_t &len : opcode_lengths )
+            len = rd.read( 1 );
+
+        // We only print file basenames, so directories are skipped
+        std::vector< std::string > dir_paths, paths;
+
+        if ( version >= 5 )
+        {
+            dwarf_read_entries( rd, is64, str, str_size, line_str, line_str_size, dir_paths );
+            dwarf_read_entries( rd, is64, str, str_size, line_str, line_str_size, paths );
+        }
+        else
+        {
+            for ( ;; )
+            {
+                const char *dir = rd.str();
+
+                if ( !rd.ok || !dir[ 0 ] )
+                    break;
+            }
+
+            // File indices start at 1 before v5
+            paths.push_back( "" );
+            for ( ;; )
+            {
+                const char *name = rd.str();
+
+                if ( !rd.ok || !name[ 0 ] )
+                    break;
+
+                paths.push_back( name );
+                rd.uleb(); // directory index
+                rd.uleb(); // mtime
+                rd.uleb(); // length
+            }
+        }
+
+        if ( !rd.ok || !line_range || ( program < rd.p ) )
+            continue;
+
+        rd.p = program;
+
+        uint64_t addr = 0;
+        uint32_t file = 1;
+        int64_t line = 1;
+        std::vector< line_row_t > rows;
+
+        auto add_row = [&]() { rows.push_back( { addr, file, ( uint32_t )line } ); };
+
+        while ( rd.ok && ( rd.p < rd.end ) )
+        {
+            uint32_t opcode = rd.read( 1 );
+
+            if ( opcode >= opcode_base )
+            {
+                uint32_t adj = opcode - opcode_base;
+
+                addr += ( adj / line_range ) * min_inst_length;
+                line += line_base + ( int32_t )( adj % line_range );
+                add_row();
+            }
+            else if ( opcode == 0 )
+            {
+                uint64_t len = rd.uleb();
+                const uint8_t *next = rd.p + len;
+
+                if ( !len || !rd.check( len ) )
+                    break;
+
+                uint32_t sub = rd.read( 1 );
+
+                if ( sub == DW_LNE_end_sequence )
+                {
+                    // Resolve requests in [first row, end of sequence)
+                    if ( !rows.empty() && ( rows[ 0 ].addr < addr ) )
+                    {
+                        auto it = std::lower_bound( requests.begin(), requests.end(), rows[ 0 ].addr,
+                                                    []( const stack_request_t &req, uint64_t val ) { return req.vaddr < val; } );
+
+                        for ( ; ( it != requests.end() ) && ( it->vaddr < addr ); it++ )
+                        {
+                            auto row = std::upper_bound( rows.begin(), rows.end(), it->vaddr,
+                                                         []( uint64_t val, const line_row_t &r ) { return val < r.addr; } );
+                            const line_row_t &r = *( row - 1 );
+
+                            if ( it->line.empty() && ( r.file < paths.size() ) )
+                                it->line = string_format( "%s:%u", util_basename( paths[ r.file ].c_str() ), r.line );
+                        }
+                    }
+
+                    rows.clear();
+                    addr = 0;
+                    file = 1;
+                    line = 1;
+                }
+                else if ( sub == DW_LNE_set_address )
+                {
+                    addr = rd.read( len - 1 );
+                }
+
+                rd.p = next;
+            }
+            else if ( opcode == DW_LNS_copy )
+                add_row();
+            else if ( opcode == DW_LNS_advance_pc )
+                addr += rd.uleb() * min_inst_length;
+            else if ( opcode == DW_LNS_advance_line )
+                line += rd.sleb();
+            else if ( opcode == DW_LNS_set_file )
+                file = rd.uleb();
+            else if ( opcode == DW_LNS_const_add_pc )
+                addr += ( ( 255 - opcode_base ) / line_range ) * min_inst_length;
+            else if ( opcode == DW_LNS_fixed_advance_pc )
+                addr += rd.read( 2 );
+            else
+            {
+                // Skip operands of opcodes we don't care about
+                for ( uint32_t i = 0; i < opcode_lengths[ opcode - 1 ]; i++ )
+                    rd.uleb();
+            }
+        }
+    }
+}
+
+// Map address in a process to a link time vaddr in the module
+static bool module_get_vaddr( const ElfFile &elf, const stack_request_t &req, uint64_t &vaddr )
+{
+    if ( req.map.has_pgoff )
+    {
+        // perf mmap records have file offsets, so go through the load segments
+        uint64_t offset = req.addr - req.map.start + req.map.pgoff;
+
+        for ( const elf_load_t &load : elf.m_loads )
+        {
+            if ( ( offset >= load.offset ) && ( offset < load.offset + load.filesz ) )
+            {
+                vaddr = offset - load.offset + load.vaddr;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // No offset: map.start is the lowest mapping of this module, which is
+    //  where the first load segment went.
+    if ( elf.m_loads.empty() )
+        return false;
+
+    const elf_load_t &load = elf.m_loads[ 0 ];
+    uint64_t align = load.align ? load.align : 1;
+
+    vaddr = req.addr - req.map.start + ( load.vaddr & ~( align - 1 ) );
+    return true;
+}
+
+static std::string sysroot_path( const std::string &sysroot, const std::string &filename )
+{
+    std::string path = sysroot;
+
+    while ( !path.empty() && ( path.back() == '/' ) )
+        path.pop_back();
+    if ( filename[ 0 ] != '/' )
+        path += '/';
+    return path + filename;
+}
+
+// Look for separate debug info by build id, then by debuglink
+static bool load_debug_file( const std::string &sysroot, const char *filename,
+                             const ElfFile &elf, ElfFile &debug_elf )
+{
+    std::string build_id = elf.get_build_id();
+
+    if ( build_id.size() > 2 )
+    {
+        std::string path = string_format( "/usr/lib/debug/.build-id/%s/%s.debug",
+                                          build_id.substr( 0, 2 ).c_str(), build_id.substr( 2 ).c_str() );
+
+        if ( debug_elf.load( sysroot_path( sysroot, path ) ) )
+            return true;
+    }
+
+    std::string debuglink = elf.get_debuglink();
+
+    if ( !debuglink.empty() )
+    {
+        std::string dir = filename;
+
+        dir = dir.substr( 0, dir.rfind( '/' ) + 1 );
+
+        const std::string paths[] =
+        {
+            dir + debuglink,
+            dir + ".debug/" + debuglink,
+            "/usr/lib/debug" + dir + debuglink
+        };
+
+        for ( const std::string &path : paths )
+        {
+            if ( debug_elf.load( sysroot_path( sysroot, path ) ) )
+                return true;
+        }
+    }
+
+    return false;
+}
+
+// Resolve all requested addresses in one module. Runs on worker threads and
+//  only writes to the module's requests.
+static void resolve_module( const std::string &sysroot, stack_module_t &module )
+{
+    ElfFile elf;
+
+    if ( !elf.load( sysroot_path( sysroot, module.filename ) ) )
+        return;
+
+    module.found = true;
+
+    std::vector< stack_request_t > &requests = module.requests;
+
+    for ( stack_request_t &req : requests )
+    {
+        if ( !module_get_vaddr( elf, req, req.vaddr ) )
+            req.vaddr = 0;
+    }
+
+    std::sort( requests.begin(), requests.end(),
+               []( const stack_request_t &lx, const stack_request_t &rx ) { return lx.vaddr < rx.vaddr; } );
+
+    ElfFile debug_elf;
+    bool stripped = !elf.find_section( ".symtab" ) || !elf.find_section( ".debug_line" );
+    const ElfFile &sym_elf = ( stripped && load_debug_file( sysroot, module.filename, elf, debug_elf ) ) ?
+                debug_elf : elf;
+
+    std::vector< elf_sym_t > syms;
+
+    sym_elf.add_symbols( syms );
+    if ( syms.empty() && ( &sym_elf != &elf ) )
+        elf.add_symbols( syms );
+
+    std::sort( syms.begin(), syms.end(),
+               []( const elf_sym_t &lx, const elf_sym_t &rx ) { return lx.addr < rx.addr; } );
+
+    for ( stack_request_t &req : requests )
+    {
+        if ( !req.vaddr )
+            continue;
+
+        auto it = std::upper_bound( syms.begin(), syms.end(), req.vaddr,
+                                    []( uint64_t val, const elf_sym_t &sym ) { return val < sym.addr; } );
+
+        if ( it != syms.begin() )
+        {
+            const elf_sym_t &sym = *( it - 1 );
+
+            if ( !sym.size || ( req.vaddr < sym.addr + sym.size ) )
+            {
+                req.func = string_format( "%s+0x%llx", demangle( sym.name ).c_str(),
+                                          ( unsigned long long )( req.vaddr - sym.addr ) );
+            }
+        }
+    }
+
+    dwarf_resolve_lines( sym_elf, requests );
+}
+
+const char *TraceEvents::get_event_stack( const trace_event_t &event )
+{
+    if ( !m_stack_syms.caller_str )
+        return NULL;
+
+    for ( uint32_t i = 0; i < event.numfields; i++ )
+    {
+        const event_field_t &field = event.fields[ i ];
+
+        if ( ( field.key == m_stack_syms.caller_str ) || ( field.key == m_stack_syms.callchain_str ) )
+            return field.value;
+    }
+
+    return NULL;
+}
+
+const stack_sym_t *TraceEvents::get_stack_sym( int tgid, uint64_t addr )
+{
+    const stack_sym_t *sym = m_stack_syms.kernel.get_val( addr );
+
+    if ( !sym )
+    {
+        const util_umap< uint64_t, stack_sym_t > *syms = m_stack_syms.user.get_val( tgid );
+
+        if ( syms )
+            sym = syms->get_val( addr );
+    }
+
+    return sym;
+}
+
+static int get_event_tgid( trace_info_t &trace_info, int pid )
+{
+    int *tgid = trace_info.pid_tgid_map.get_val( pid );
+
+    return tgid ? *tgid : pid;
+}
+
+std::string TraceEvents::get_stack_str( const trace_event_t &event, const char *prefix, uint32_t max_frames )
+{
+    std::string ret;
+    const char *stack = get_event_stack( event );
+    int tgid = get_event_tgid( m_trace_info, event.pid );
+
+    for ( uint32_t frame = 0; stack && ( frame < max_frames ); frame++ )
+    {
+        char *end;
+        uint64_t addr = strtoull( stack, &end, 16 );
+
+        if ( end == stack )
+            break;
+        stack = end;
+
+        const stack_sym_t *sym = get_stack_sym( tgid, addr );
+
+        ret += prefix;
+        if ( sym && sym->func )
+            ret += sym->func;
+        else
+            ret += string_format( "0x%llx", ( unsigned long long )addr );
+
+        if ( sym && sym->line )
+            ret += string_format( " (%s)", sym->line );
+        if ( sym && sym->module )
+            ret += string_format( " [%s]", util_basename( sym->module ) );
+        ret += "\n";
+    }
+
+    return ret;
+}
+
+void TraceEvents::calculate_stack_syms()
+{
+    util_time_t t0 = util_get_time();
+    util_umap< uint64_t, const char * > &kernel_syms = m_trace_info.kernel_syms;
+    std::map< std::pair< int, const char * >, uint32_t > stack_index;
+    std::vector< stack_info_t > &stacks = m_stack_syms.stacks;
+
+    GPUVIS_TRACE_BLOCK( __func__ );
+
+    m_stack_syms.caller_str = m_strpool.getstr( "caller" );
+    m_stack_syms.callchain_str = m_strpool.getstr( "callchain" );
+
+    // Gather unique stacks per process
+    for ( const trace_event_t &event : m_events )
+    {
+        const char *stack = get_event_stack( event );
+
+        if ( !stack || !stack[ 0 ] )
+            continue;
+
+        int tgid = get_event_tgid( m_trace_info, event.pid );
+        auto res = stack_index.emplace( std::make_pair( tgid, stack ), stacks.size() );
+
+        if ( res.second )
+            stacks.push_back( { stack, tgid, 1, event.id } );
+        else
+            stacks[ res.first->second ].count++;
+    }
+
+    if ( stacks.empty() )
+        return;
+
+    // Split addresses into kernel symbols and per module user requests
+    std::unordered_map< const char *, uint32_t > module_index;
+    std::vector< stack_module_t > modules;
+
+    for ( const stack_info_t &info : stacks )
+    {
+        const char *stack = info.stack;
+        std::vector< proc_map_t > *maps = m_trace_info.proc_maps.get_val( info.tgid );
+
+        for ( ;; )
+        {
+            char *end;
+            uint64_t addr = strtoull( stack, &end, 16 );
+
+            if ( end == stack )
+                break;
+            stack = end;
+
+            const char **kernel_sym = kernel_syms.get_val( addr );
+
+            if ( kernel_sym )
+            {
+                if ( !m_stack_syms.kernel.get_val( addr ) )
+                {
+                    m_stack_syms.kernel.get_val( addr, stack_sym_t() )->func = *kernel_sym;
+                    m_stack_syms.addrs++;
+                }
+                continue;
+            }
+
+            util_umap< uint64_t, stack_sym_t > &user = *m_stack_syms.user.get_val_create( info.tgid );
+
+            if ( user.get_val( addr ) )
+                continue;
+
+            stack_sym_t &sym = *user.get_val( addr, stack_sym_t() );
+
+            m_stack_syms.addrs++;
+
+            if ( !maps )
+                continue;
+
+            // Maps are sorted by start address
+            auto it = std::upper_bound( maps->begin(), maps->end(), addr,
+                                        []( uint64_t val, const proc_map_t &map ) { return val < map.start; } );
+            if ( it == maps->begin() )
+                continue;
+
+            const proc_map_t &map = *( it - 1 );
+
+            if ( ( addr >= map.end ) || !map.filename ||
+                 ( map.filename[ 0 ] == '[' ) || !strncmp( map.filename, "//anon", 6 ) )
+                continue;
+
+            sym.module = map.filename;
+
+            stack_request_t req;
+
+            req.addr = addr;
+            req.map = map;
+            req.sym = &sym;
+            req.vaddr = 0;
+
+            if ( !map.has_pgoff )
+            {
+                // Without file offsets we need the lowest mapping of this module
+                for ( const proc_map_t &m : *maps )
+                {
+                    if ( m.filename == map.filename )
+                    {
+                        req.map.start = m.start;
+                        break;
+                    }
+                }
+            }
+
+            auto idx = module_index.find( map.filename );
+
+            if ( idx == module_index.end() )
+            {
+                idx = module_index.insert( { map.filename, modules.size() } ).first;
+                modules.push_back( stack_module_t() );
+                modules.back().filename = map.filename;
+            }
+
+            modules[ idx->second ].requests.push_back( req );
+        }
+    }
+
+    // Symbolize modules in parallel. Workers grab the next module until we're out.
+    std::atomic< uint32_t > next_module( 0 );
+    uint32_t thread_count = std::min< uint32_t >( modules.size(),
+                                                  std::max< uint32_t >( 1, std::thread::hardware_concurrency() ) );
+    std::vector< std::future< void > > threads;
+    const std::string &sysroot = m_stack_syms.sysroot;
+
+    for ( uint32_t i = 0; i < thread_count; i++ )
+    {
+        threads.push_back( std::async( std::launch::async, [&]()
+        {
+            for ( uint32_t idx = next_module++; idx < modules.size(); idx = next_module++ )
+                resolve_module( sysroot, modules[ idx ] );
+        } ) );
+    }
+    for ( std::future< void > &thread : threads )
+        thread.wait();
+
+    // Intern results. The req.sym pointers are into unordered_map nodes, which
+    //  don't move when the maps grow.
+    for ( const stack_module_t &module : modules )
+    {
+        if ( !module.found )
+        {
+            logf( "[Warning] %s: %s not found in sysroot %s", __func__, module.filename, sysroot.c_str() );
+            continue;
+        }
+
+        m_stack_syms.modules++;
+
+        for ( const stack_request_t &req : module.requests )
+        {
+            if ( !req.func.empty() )
+            {
+                req.sym->func = m_strpool.getstr( req.func.c_str() );
+                m_stack_syms.resolved++;
+            }
+            if ( !req.line.empty() )
+                req.sym->line = m_strpool.getstr( req.line.c_str() );
+        }
+    }
+
+    for ( const auto &it : m_stack_syms.kernel.m_map )
+    {
+        if ( it.second.func )
+            m_stack_syms.resolved++;
+    }
+
+    std::stable_sort( stacks.begin(), stacks.end(),
+                      []( const stack_info_t &lx, const stack_info_t &rx ) { return lx.count > rx.count; } );
+
+    m_stack_syms.time_ms = util_time_to_ms( t0, util_get_time() );
+
+    logf( "Resolved %u of %u stack addresses from %lu stacks, %u modules in %.2fms",
+          m_stack_syms.resolved, m_stack_syms.addrs, stacks.size(), m_stack_syms.modules,
+          m_stack_syms.time_ms );
+}
+
+void TraceWin::stacks_render_info()
+{
+    const std::vector< stack_info_t > &stacks = m_trace_events.m_stack_syms.stacks;
+
+    if ( stacks.empty() || !ImGui::CollapsingHeader( "Stacks" ) )
+        return;
+
+    ImGui::Text( "%lu unique stacks, %u of %u addresses resolved (%.2fms)", stacks.size(),
+                 m_trace_events.m_stack_syms.resolved, m_trace_events.m_stack_syms.addrs,
+                 m_trace_events.m_stack_syms.time_ms );
+    ImGui::Text( "Sysroot: %s", m_trace_events.m_stack_syms.sysroot.c_str() );
+
+    if ( imgui_begin_columns( "stacks", { "Count", "Process", "Top Frame" } ) )
+        ImGui::SetColumnWidth( 1, imgui_scale( 200.0f ) );
+
+    ImGuiListClipper clipper( stacks.size() );
+    while ( clipper.Step() )
+    {
+        for ( int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++ )
+        {
+            const stack_info_t &info = stacks[ i ];
+            const trace_event_t &event = get_event( info.eventid );
+            bool selected = ( m_eventlist.selected_eventid == event.id );
+            std::string label = std::to_string( info.count );
+
+            // Click on stack to go to its first event in the graph
+            ImGui::PushID( i );
+            if ( ImGui::Selectable( label.c_str(), selected, ImGuiSelectableFlags_SpanAllColumns ) )
+                graph_center_event( info.eventid );
+            if ( ImGui::IsItemHovered() )
+                ImGui::SetTooltip( "%s", m_trace_events.get_stack_str( event, "" ).c_str() );
+            ImGui::PopID();
+            ImGui::NextColumn();
+
+            ImGui::Text( "%s", m_trace_events.tgidcomm_from_pid( event.pid ) );
+            ImGui::NextColumn();
+
+            std::string top = m_trace_events.get_stack_str( event, "", 1 );
+
+            ImGui::Text( "%s", string_trimmed( top ).c_str() );
+            ImGui::NextColumn();
+        }
+    }
+
+    ImGui::EndColumns();
+}
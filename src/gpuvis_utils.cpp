@@ -355,6 +355,45 @@ std::string string_remove_punct( const std::string &s )
     return ret;
 }
 
+bool ParsePlotStr::init( const char *scanf_str )
+{
+    const char *pct_f = strstr( scanf_str, "%f" );
+
+    if ( pct_f )
+    {
+        m_scanf_str = scanf_str;
+        m_scanf_len = pct_f - scanf_str;
+        return true;
+    }
+
+    return false;
+}
+
+bool ParsePlotStr::parse( const char *buf )
+{
+    if ( buf && m_scanf_str )
+    {
+        const char *pat_start = strncasestr( buf, m_scanf_str, m_scanf_len );
+
+        if ( pat_start )
+        {
+            char *val_end;
+            const char *val_start = pat_start + m_scanf_len;
+
+            m_valf = strtof( val_start, &val_end );
+
+            if ( val_start != val_end )
+            {
+                m_val_start = val_start;
+                m_val_end = val_end;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
 std::string gen_random_str( size_t len )
 {
     std::string str;
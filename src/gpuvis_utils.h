@@ -112,6 +112,26 @@ bool comp_str_parse( const char *comp, uint32_t &a, uint32_t &b, uint32_t &c );
 bool comp_val_to_abc( uint32_t val, uint32_t &a, uint32_t &b, uint32_t &c );
 uint32_t comp_abc_to_val( uint32_t a, uint32_t b, uint32_t c );
 
+// Find float value in a string using plot scanf string. Ie:
+//   "[Compositor] TimeSyncLastVsync: %f("
+class ParsePlotStr
+{
+public:
+    ParsePlotStr() {}
+    ~ParsePlotStr() {}
+
+    bool init( const char *scanf_str );
+    bool parse( const char *buf );
+
+public:
+    float m_valf;
+    const char *m_val_start;
+    const char *m_val_end;
+
+    const char *m_scanf_str = nullptr;
+    size_t m_scanf_len = 0;
+};
+
 class TipWindows
 {
 public:
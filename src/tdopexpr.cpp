@@ -35,6 +35,9 @@
 #include "tdopexpr.h"
 #include "gpuvis_macros.h"
 
+// Max paren nesting. tdop_expression recurses per paren level.
+static const int s_max_paren_depth = 64;
+
 // TDOP: "Top down operator precedence parsing"
 //   http://eli.thegreenplace.net/2010/01/02/top-down-operator-precedence-parsing
 //   http://effbot.org/zone/simple-top-down-parsing.htm
@@ -184,8 +187,8 @@ static void next_token( tdop_state *s )
         {
             const char *value = ++s->next;
 
-            while ( isalpha( s->next[ 0 ] ) ||
-                    isdigit( s->next[ 0 ] ) ||
+            while ( isalpha( ( unsigned char )s->next[ 0 ] ) ||
+                    isdigit( ( unsigned char )s->next[ 0 ] ) ||
                     ( s->next[ 0 ] == '_' ) )
             {
                 s->next++;
@@ -212,13 +215,13 @@ static void next_token( tdop_state *s )
                 s->tok.type = TOK_ERROR;
             }
         }
-        else if ( isalpha( s->next [ 0 ] ) )
+        else if ( isalpha( ( unsigned char )s->next[ 0 ] ) )
         {
             s->tok.type = TOK_STRING;
             const char *value = s->next;
 
-            while ( isalpha( s->next[ 0 ] ) ||
-                    isdigit( s->next[ 0 ] ) ||
+            while ( isalpha( ( unsigned char )s->next[ 0 ] ) ||
+                    isdigit( ( unsigned char )s->next[ 0 ] ) ||
                     ( s->next[ 0 ] == '_' ) )
             {
                 s->next++;
@@ -238,8 +241,8 @@ static void next_token( tdop_state *s )
             s->next = endptr;
             s->tok.set_value_buf( value, endptr - value );
         }
-        else if ( isdigit( s->next[ 0 ] ) ||
-                  ( ( s->next[ 0 ] == '-' ) && isdigit( s->next[ 1 ] ) ) )
+        else if ( isdigit( ( unsigned char )s->next[ 0 ] ) ||
+                  ( ( s->next[ 0 ] == '-' ) && isdigit( ( unsigned char )s->next[ 1 ] ) ) )
         {
             char *endptr;
 
@@ -480,7 +483,8 @@ static std::string validate_info_tokens( std::vector< tdop_state_token > &tokens
                 return "ERROR: Unexpected token left of left paren";
             }
 
-            num_parens++;
+            if ( ++num_parens > s_max_paren_depth )
+                return "ERROR: Too many nested parens";
             break;
 
         case TOK_RPAREN:
@@ -62,12 +62,19 @@ char *strerror_r(int errnum, char *buf, size_t buflen);
 /* From include/linux/threads.h */
 #define PID_MAX_LIMIT (4 * 1024 * 1024)
 
-static const char *input_buf;
-static unsigned long long input_buf_ptr;
-static unsigned long long input_buf_siz;
+/* Tokenizer state is per thread so several traces can be parsed at once */
+#if defined(_MSC_VER)
+#define PARSE_TLS __declspec(thread)
+#else
+#define PARSE_TLS __thread
+#endif
+
+static PARSE_TLS const char *input_buf;
+static PARSE_TLS unsigned long long input_buf_ptr;
+static PARSE_TLS unsigned long long input_buf_siz;
 
-static int is_flag_field;
-static int is_symbolic_field;
+static PARSE_TLS int is_flag_field;
+static PARSE_TLS int is_symbolic_field;
 
 static int show_warning = 1;
 
@@ -1715,6 +1722,8 @@ static int event_read_fields(struct event_format *event, struct format_field **f
 
 		*fields = field;
 		fields = &field->next;
+		/* field is on the list now: don't free it if the next one fails */
+		field = NULL;
 
 	} while (1);
 
@@ -2509,7 +2518,7 @@ static int arg_num_eval(struct print_arg *arg, long long *val)
 static char *arg_eval (struct print_arg *arg)
 {
 	long long val;
-	static char buf[32];
+	static PARSE_TLS char buf[32];
 
 	switch (arg->type) {
 	case PRINT_ATOM:
@@ -57,6 +57,7 @@ enum {
  * @next		- offset from @data to the start of next event
  * @size		- The size of data on @data
  * @start		- The offset from @subbuffer where @data lives
+ * @subbuf_size	- Size of the @subbuffer page (0 if unknown)
  *
  * @read_4		- Function to read 4 raw bytes (may swap)
  * @read_8		- Function to read 8 raw bytes (may swap)
@@ -73,6 +74,7 @@ struct kbuffer {
 	unsigned int		next;
 	unsigned int		size;
 	unsigned int		start;
+	unsigned int		subbuf_size;
 
 	unsigned int (*read_4)(void *ptr);
 	unsigned long long (*read_8)(void *ptr);
@@ -348,6 +350,54 @@ static unsigned int old_update_pointers(struct kbuffer *kbuf)
 	return type;
 }
 
+/*
+ * Check that the event header at @kbuf->curr is inside the subbuffer
+ * data, and that the event it describes ends inside the data as well.
+ * Headers are read before their lengths are known, so a corrupted
+ * subbuffer could otherwise walk us off the end of the page or loop.
+ */
+static int header_fits(struct kbuffer *kbuf)
+{
+	unsigned int type_len_ts;
+	unsigned int size = 4;
+
+	if (kbuf->curr + 4 > kbuf->size)
+		return 0;
+
+	if (kbuf->flags & KBUFFER_FL_OLD_FORMAT)
+		return 1;
+
+	type_len_ts = read_4(kbuf, (char *)kbuf->data + kbuf->curr);
+
+	switch (type_len4host(kbuf, type_len_ts)) {
+	case KBUFFER_TYPE_PADDING:
+	case KBUFFER_TYPE_TIME_EXTEND:
+	case 0:
+		size = 8;
+		break;
+	case KBUFFER_TYPE_TIME_STAMP:
+		size = 16;
+		break;
+	}
+
+	return kbuf->curr + size <= kbuf->size;
+}
+
+static int event_fits(struct kbuffer *kbuf)
+{
+	return kbuf->index <= kbuf->next &&
+		kbuf->next > kbuf->curr &&
+		kbuf->next <= kbuf->size;
+}
+
+static int bad_event(struct kbuffer *kbuf)
+{
+	kbuf->curr = kbuf->size;
+	kbuf->next = kbuf->size;
+	kbuf->index = kbuf->size;
+	return -1;
+}
+
 static int __old_next_event(struct kbuffer *kbuf)
 {
 	int type;
@@ -356,7 +406,11 @@ static int __old_next_event(struct kbuffer *kbuf)
 		kbuf->curr = kbuf->next;
 		if (kbuf->next >= kbuf->size)
 			return -1;
+		if (!header_fits(kbuf))
+			return bad_event(kbuf);
 		type = old_update_pointers(kbuf);
+		if (!event_fits(kbuf))
+			return bad_event(kbuf);
 	} while (type == OLD_RINGBUF_TYPE_TIME_EXTEND || type == OLD_RINGBUF_TYPE_PADDING);
 
 	return 0;
@@ -474,7 +528,11 @@ static int __next_event(struct kbuffer *kbuf)
 		kbuf->curr = kbuf->next;
 		if (kbuf->next >= kbuf->size)
 			return -1;
+		if (!header_fits(kbuf))
+			return bad_event(kbuf);
 		type = update_pointers(kbuf);
+		if (!event_fits(kbuf))
+			return bad_event(kbuf);
 	} while (type == KBUFFER_TYPE_TIME_EXTEND || type == KBUFFER_TYPE_PADDING);
 
 	return 0;
@@ -550,6 +608,21 @@ int kbuffer_load_subbuffer(struct kbuffer *kbuf, void *subbuffer)
 	flags = read_long(kbuf, ptr);
 	kbuf->size = (unsigned int)flags & COMMIT_MASK;
 
+	if (kbuf->subbuf_size) {
+		unsigned int max_size = kbuf->subbuf_size - kbuf->start;
+
+		if ((flags & MISSING_EVENTS) && (flags & MISSING_STORED))
+			max_size -= (kbuf->flags & KBUFFER_FL_LONG_8) ? 8 : 4;
+
+		if (kbuf->size > max_size) {
+			kbuf->size = 0;
+			kbuf->lost_events = 0;
+			kbuf->index = 0;
+			kbuf->next = 0;
+			return -1;
+		}
+	}
+
 	if (flags & MISSING_EVENTS) {
 		if (flags & MISSING_STORED) {
 			ptr = (char *)kbuf->data + kbuf->size;
@@ -748,6 +821,19 @@ int kbuffer_missed_events(struct kbuffer *kbuf)
 	return kbuf->lost_events;
 }
 
+/**
+ * kbuffer_set_subbuffer_size - set the size of subbuffers loaded into @kbuf
+ * @kbuf:	The kbuffer to set
+ * @size:	The size of the subbuffer pages
+ *
+ * When set, kbuffer_load_subbuffer() fails on subbuffers whose commit
+ * size doesn't fit in @size bytes instead of reading past the page.
+ */
+void kbuffer_set_subbuffer_size(struct kbuffer *kbuf, unsigned int size)
+{
+	kbuf->subbuf_size = size;
+}
+
 /**
  * kbuffer_set_old_forma - set the kbuffer to use the old format parsing
  * @kbuf:	The kbuffer to set
@@ -65,6 +65,7 @@ int kbuffer_missed_events(struct kbuffer *kbuf);
 int kbuffer_subbuffer_size(struct kbuffer *kbuf);
 
 void kbuffer_set_old_format(struct kbuffer *kbuf);
+void kbuffer_set_subbuffer_size(struct kbuffer *kbuf, unsigned int size);
 int kbuffer_start_of_data(struct kbuffer *kbuf);
 
 /* Debugging */
@@ -32,6 +32,8 @@
 #include <unordered_set>
 #include <algorithm>
 #include <future>
+#include <thread>
+#include <atomic>
 
 #ifdef WIN32
 #include <io.h>
@@ -75,6 +77,8 @@ enum
     TRACECMD_OPTION_HOOK,
     TRACECMD_OPTION_OFFSET,
     TRACEMCD_OPTION_CPUCOUNT,
+    TRACECMD_OPTION_VERSION,
+    TRACECMD_OPTION_PROCMAPS,
     TRACECMD_OPTION_SAVED_TGIDS = 32,
 };
 
@@ -89,12 +93,24 @@ typedef struct pevent pevent_t;
 typedef struct pevent_record pevent_record_t;
 typedef struct kbuffer kbuffer_t;
 typedef struct event_format event_format_t;
+struct kallsyms_t;
+
+// Sanity limits for trace.dat header values
+static const unsigned long s_min_page_size = 256;
+static const unsigned long s_max_page_size = 16 * 1024 * 1024;
+static const unsigned int s_max_cpus = 8192;
 
 typedef struct file_info
 {
     int done;
     tracecmd_input_t *handle;
     pevent_record_t *record;
+
+    // Clock alignment to top level buffer (see trace_clock_info_t)
+    int clock_adjust;
+    int64_t clock_offset;
+    int64_t clock_ref_ts;
+    double clock_drift;
 } file_info_t;
 
 typedef struct page
@@ -114,6 +130,12 @@ typedef struct cpu_data
     unsigned long long size = 0;
     unsigned long long timestamp = 0;
 
+    /* lost events to report on the next record read, -1 if count unknown */
+    long long missed_events = 0;
+    /* current page failed validation and is being skipped */
+    bool skip_page = false;
+    unsigned long long bad_pages = 0;
+
     std::forward_list< page_t * > pages;
     pevent_record_t *next_record = nullptr;
     page_t *page = nullptr;
@@ -140,15 +162,18 @@ typedef struct tracecmd_input
     int ref = 0;
     int nr_buffers = 0; /* buffer instances */
     bool use_trace_clock = false;
+    bool recover_bad_pages = false;
 #ifdef USE_MMAP
     bool read_page = false;
 #endif
     cpu_data_t *cpu_data = nullptr;
     unsigned long long ts_offset = 0;
     input_buffer_instance_t *buffers = nullptr;
+    kallsyms_t *kallsyms = nullptr;
 
     std::string file;
     std::string uname;
+    std::string proc_maps;
     std::vector< std::string > cpustats;
 
     /* file information */
@@ -440,54 +465,206 @@ static void read_event_files( tracecmd_input_t *handle )
     }
 }
 
-static void parse_proc_kallsyms( pevent_t *pevent, char *file )
+/*
+ * Kernel symbols from the kallsyms section, sorted by address. Lookups only
+ * touch the addrs array. Names point into buf, which the table owns.
+ */
+struct kallsyms_sym_t
 {
-    char *line;
-    char *next = NULL;
+    const char *func;
+    const char *mod;
+};
 
-    line = strtok_r( file, "\n", &next );
-    while ( line )
+struct kallsyms_t
+{
+    char *buf = nullptr;
+
+    std::vector< uint64_t > addrs;
+    std::vector< kallsyms_sym_t > syms;
+
+    ~kallsyms_t() { free( buf ); }
+};
+
+struct kallsyms_entry_t
+{
+    uint64_t addr;
+    kallsyms_sym_t sym;
+};
+
+static const char *kallsyms_parse_hex( const char *str, uint64_t &val )
+{
+    val = 0;
+
+    for ( ;; str++ )
     {
-        char *endptr;
-        unsigned long long addr;
+        uint32_t c = ( unsigned char )*str;
+
+        if ( c - '0' < 10 )
+            val = ( val << 4 ) | ( c - '0' );
+        else if ( ( c | 0x20 ) - 'a' < 6 )
+            val = ( val << 4 ) | ( ( c | 0x20 ) - 'a' + 10 );
+        else
+            return str;
+    }
+}
+
+// Parse kallsyms lines in [start, end) in place
+static void kallsyms_parse_chunk( char *start, char *end, std::vector< kallsyms_entry_t > &entries )
+{
+    for ( char *line = start; line < end; )
+    {
+        char *eol = ( char * )memchr( line, '\n', end - line );
+
+        if ( !eol )
+            eol = end;
+        *eol = 0;
 
         // Parse lines of this form:
         //   addr             ch            func   mod
         //   ffffffffc07ec678 d descriptor.58652\t[bnep]
+        uint64_t addr;
+        char *p = ( char * )kallsyms_parse_hex( line, addr );
 
-        addr = strtoull( line, &endptr, 16 );
-
-        if ( endptr && *endptr == ' ' )
+        if ( ( p > line ) && ( p[ 0 ] == ' ' ) )
         {
-            char ch;
-            char *mod;
-            char *func;
-
-            line = endptr + 1;
-
-            ch = *line;
+            char ch = p[ 1 ];
 
             // Skip: x86-64 reports per-cpu variable offsets as absolute (A)
-            if ( ch && ( ch != 'A' ) && ( line[ 1 ] == ' ' ) && line[ 2 ] )
+            if ( ch && ( ch != 'A' ) && ( p[ 2 ] == ' ' ) && p[ 3 ] )
             {
-                func = line + 2;
+                char *func = p + 3;
+                char *mod = ( char * )memchr( func, '\t', eol - func );
 
-                mod = strchr( func, '\t' );
-                if ( mod && mod[ 1 ] == '[' )
+                if ( mod && ( mod[ 1 ] == '[' ) )
                 {
                     *mod = 0;
                     mod += 2;
-                    mod[ strlen( mod ) - 1 ] = 0;
+                    if ( eol > mod && eol[ -1 ] == ']' )
+                        eol[ -1 ] = 0;
+                }
+                else
+                {
+                    mod = NULL;
                 }
 
-                //$ TODO mikesart PERF: This is adding the item to a func_list
-                // which gets converted to a sorted array afterwords.
-                pevent_register_function( pevent, func, addr, mod );
+                entries.push_back( { addr, { func, mod } } );
             }
         }
 
-        line = strtok_r( NULL, "\n", &next );
+        line = eol + 1;
+    }
+}
+
+static kallsyms_t *parse_proc_kallsyms( char *buf, size_t size )
+{
+    GPUVIS_TRACE_BLOCK( __func__ );
+
+    kallsyms_t *kallsyms = new kallsyms_t;
+    size_t nthreads = std::max< size_t >( 1, std::thread::hardware_concurrency() );
+    size_t chunk_size = std::max< size_t >( size / nthreads + 1, 256 * 1024 );
+    std::vector< std::vector< kallsyms_entry_t > > chunks;
+    std::vector< std::future< void > > futures;
+
+    kallsyms->buf = buf;
+
+    std::vector< std::pair< char *, char * > > ranges;
+
+    // Split into line aligned chunks and parse them in parallel
+    for ( char *start = buf, *end = buf + size; start < end; )
+    {
+        char *chunk_end = start + std::min< size_t >( chunk_size, end - start );
+
+        if ( chunk_end < end )
+        {
+            char *eol = ( char * )memchr( chunk_end, '\n', end - chunk_end );
+
+            chunk_end = eol ? eol + 1 : end;
+        }
+
+        ranges.push_back( { start, chunk_end } );
+        start = chunk_end;
+    }
+
+    chunks.resize( ranges.size() );
+    for ( size_t i = 0; i < ranges.size(); i++ )
+    {
+        futures.push_back( std::async( std::launch::async, kallsyms_parse_chunk,
+                                       ranges[ i ].first, ranges[ i ].second, std::ref( chunks[ i ] ) ) );
+    }
+
+    for ( std::future< void > &future : futures )
+        future.wait();
+
+    std::vector< kallsyms_entry_t > entries;
+    bool sorted = true;
+
+    for ( std::vector< kallsyms_entry_t > &chunk : chunks )
+    {
+        for ( const kallsyms_entry_t &entry : chunk )
+        {
+            sorted &= ( entries.empty() || ( entries.back().addr <= entry.addr ) );
+            entries.push_back( entry );
+        }
+    }
+
+    // Core kernel symbols are sorted, module symbols usually aren't
+    if ( !sorted )
+    {
+        std::stable_sort( entries.begin(), entries.end(),
+                          []( const kallsyms_entry_t &a, const kallsyms_entry_t &b ) { return a.addr < b.addr; } );
+    }
+
+    kallsyms->addrs.reserve( entries.size() );
+    kallsyms->syms.reserve( entries.size() );
+
+    for ( const kallsyms_entry_t &entry : entries )
+    {
+        kallsyms->addrs.push_back( entry.addr );
+        kallsyms->syms.push_back( entry.sym );
+    }
+
+    return kallsyms;
+}
+
+// Return index of symbol containing addr or -1
+static size_t kallsyms_find( const kallsyms_t *kallsyms, uint64_t addr )
+{
+    const uint64_t *base = kallsyms->addrs.data();
+    size_t n = kallsyms->addrs.size();
+
+    if ( !n || ( addr < base[ 0 ] ) )
+        return ( size_t )-1;
+
+    // Branch-free search for the last address <= addr
+    while ( n > 1 )
+    {
+        size_t half = n / 2;
+
+        base = ( base[ half ] <= addr ) ? ( base + half ) : base;
+        n -= half;
     }
+
+    size_t idx = base - kallsyms->addrs.data();
+
+    // Like libtraceevent, nothing contains addresses past the last symbol
+    if ( ( idx == kallsyms->addrs.size() - 1 ) && ( *base != addr ) )
+        return ( size_t )-1;
+
+    return idx;
+}
+
+// pevent_func_resolver_t for pevent_find_function, etc.
+static char *kallsyms_resolve( void *priv, unsigned long long *addrp, char **modp )
+{
+    const kallsyms_t *kallsyms = ( const kallsyms_t * )priv;
+    size_t idx = kallsyms_find( kallsyms, *addrp );
+
+    if ( idx == ( size_t )-1 )
+        return NULL;
+
+    *addrp = kallsyms->addrs[ idx ];
+    *modp = ( char * )kallsyms->syms[ idx ].mod;
+    return ( char * )kallsyms->syms[ idx ].func;
 }
 
 static void read_proc_kallsyms( tracecmd_input_t *handle )
@@ -506,9 +683,10 @@ static void read_proc_kallsyms( tracecmd_input_t *handle )
 
     buf[ size ] = 0;
 
-    parse_proc_kallsyms( pevent, buf );
+    delete handle->kallsyms;
+    handle->kallsyms = parse_proc_kallsyms( buf, size );
 
-    free( buf );
+    pevent_set_function_resolver( pevent, kallsyms_resolve, handle->kallsyms );
 }
 
 static void parse_ftrace_printk( tracecmd_input_t *handle, pevent_t *pevent, char *file )
@@ -654,6 +832,10 @@ static int read_page( tracecmd_input_t *handle, off64_t offset,
     if ( ret < 0 )
         return -1;
 
+    /* truncated file: zero the rest of the page so it reads as empty */
+    if ( ( unsigned long )ret < handle->page_size )
+        memset( ( char * )map + ret, 0, handle->page_size - ret );
+
     /* reset the file pointer back */
     lseek64( handle->fd, save_seek, SEEK_SET );
     return 0;
@@ -804,21 +986,49 @@ static void free_next( tracecmd_input_t *handle, int cpu )
 static void update_page_info( tracecmd_input_t *handle, int cpu )
 {
     pevent_t *pevent = handle->pevent;
-    void *ptr = handle->cpu_data[ cpu ].page->map;
-    kbuffer_t *kbuf = handle->cpu_data[ cpu ].kbuf;
+    cpu_data_t *cpu_data = &handle->cpu_data[ cpu ];
+    void *ptr = cpu_data->page->map;
+    kbuffer_t *kbuf = cpu_data->kbuf;
+    unsigned long long prev_ts = cpu_data->timestamp;
+    const char *err = NULL;
 
     /* FIXME: handle header page */
     if ( pevent->header_page_ts_size != 8 )
         die( handle, "%s: expected a long long type for timestamp.\n", __func__ );
 
-    kbuffer_load_subbuffer( kbuf, ptr );
-    if ( ( unsigned long )kbuffer_subbuffer_size( kbuf ) > handle->page_size )
+    cpu_data->skip_page = false;
+
+    if ( ( kbuffer_load_subbuffer( kbuf, ptr ) < 0 ) ||
+         ( ( unsigned long )kbuffer_subbuffer_size( kbuf ) > handle->page_size ) )
+        err = "bad page size";
+    else if ( prev_ts && ( kbuffer_timestamp( kbuf ) + handle->ts_offset < prev_ts ) )
+        err = "page timestamp went backwards";
+
+    if ( err )
     {
-        die( handle, "%s: bad page read, with size of %d\n", __func__,
-                 kbuffer_subbuffer_size( kbuf ) );
+        if ( !handle->recover_bad_pages )
+        {
+            die( handle, "%s: %s, cpu %d offset %llx\n", __func__, err,
+                 cpu, cpu_data->offset );
+        }
+
+        /*
+         * Skip the page and keep the previous timestamp so following
+         * pages are still checked against the last good event.
+         */
+        logf( "[Warning] %s: skipping page: %s, cpu %d offset %llx\n", __func__, err,
+              cpu, cpu_data->offset );
+
+        cpu_data->skip_page = true;
+        cpu_data->missed_events = -1;
+        cpu_data->bad_pages++;
+        return;
     }
 
-    handle->cpu_data[ cpu ].timestamp = kbuffer_timestamp( kbuf ) + handle->ts_offset;
+    if ( kbuffer_missed_events( kbuf ) && !cpu_data->missed_events )
+        cpu_data->missed_events = kbuffer_missed_events( kbuf );
+
+    cpu_data->timestamp = kbuffer_timestamp( kbuf ) + handle->ts_offset;
 }
 
 /*
@@ -851,6 +1061,13 @@ static int get_page( tracecmd_input_t *handle, int cpu,
         return -1;
     }
 
+    /* mmap'ing past the end of the file would fault when the page is read */
+    if ( offset + handle->page_size > ( unsigned long long )handle->total_file_size )
+    {
+        die( handle, "%s: page offset %llx past end of file\n", __func__, offset );
+        return -1;
+    }
+
     handle->cpu_data[ cpu ].offset = offset;
     handle->cpu_data[ cpu ].size = ( handle->cpu_data[ cpu ].file_offset +
                                      handle->cpu_data[ cpu ].file_size ) - offset;
@@ -927,7 +1144,7 @@ read_again:
     if ( !page )
         return NULL;
 
-    data = kbuffer_read_event( kbuf, &ts );
+    data = handle->cpu_data[ cpu ].skip_page ? NULL : kbuffer_read_event( kbuf, &ts );
     if ( !data )
     {
         if ( get_next_page( handle, cpu ) )
@@ -943,7 +1160,7 @@ read_again:
 
     record->ts = handle->cpu_data[ cpu ].timestamp;
     record->offset = handle->cpu_data[ cpu ].offset + kbuffer_curr_offset( kbuf );
-    record->missed_events = 0;
+    record->missed_events = handle->cpu_data[ cpu ].missed_events;
     record->record_size = kbuffer_curr_size( kbuf );
     record->size = kbuffer_event_size( kbuf );
     record->data = data;
@@ -953,6 +1170,7 @@ read_again:
     record->priv = page;
 
     handle->cpu_data[ cpu ].next_record = record;
+    handle->cpu_data[ cpu ].missed_events = 0;
 
     page->ref_count++;
 
@@ -1215,6 +1433,12 @@ static int handle_options( tracecmd_input_t *handle )
         case TRACECMD_OPTION_SAVED_TGIDS:
             tracecmd_parse_tgids(handle->pevent, buf, size);
             break;
+        case TRACECMD_OPTION_VERSION:
+            break;
+        case TRACECMD_OPTION_PROCMAPS:
+            // trace-cmd record -P / --proc-map
+            handle->proc_maps.assign( buf, strnlen( buf, size ) );
+            break;
         default:
             die( handle, "%s: unknown option %d\n", __func__, option );
             break;
@@ -1275,6 +1499,8 @@ static void read_cpu_data( tracecmd_input_t *handle )
         if ( handle->pevent->old_format )
             kbuffer_set_old_format( handle->cpu_data[ cpu ].kbuf );
 
+        kbuffer_set_subbuffer_size( handle->cpu_data[ cpu ].kbuf, handle->page_size );
+
         offset = read8( handle );
         size = read8( handle );
 
@@ -1320,6 +1546,8 @@ void tracecmd_init_data( tracecmd_input_t *handle )
     pevent_t *pevent = handle->pevent;
 
     handle->cpus = read4( handle );
+    if ( ( unsigned int )handle->cpus > s_max_cpus )
+        die( handle, "%s: bad cpu count %u\n", __func__, handle->cpus );
 
     pevent_set_cpus( pevent, handle->cpus );
 
@@ -1406,8 +1634,15 @@ static tracecmd_input_t *tracecmd_alloc_fd( const char *file, int fd )
 
     do_read_check( handle, buf, 1 );
     handle->long_size = buf[ 0 ];
+    if ( ( handle->long_size != 4 ) && ( handle->long_size != 8 ) )
+        die( handle, "[Error] %s: bad long size %d.\n", __func__, handle->long_size );
 
     handle->page_size = read4( handle );
+    if ( ( handle->page_size < s_min_page_size ) || ( handle->page_size > s_max_page_size ) ||
+         ( handle->page_size & ( handle->page_size - 1 ) ) )
+    {
+        die( handle, "[Error] %s: bad page size %lu.\n", __func__, handle->page_size );
+    }
 
     handle->header_files_start = lseek64( handle->fd, 0, SEEK_CUR );
     handle->total_file_size = lseek64( handle->fd, 0, SEEK_END );
@@ -1492,6 +1727,7 @@ static void tracecmd_close( tracecmd_input_t *handle )
     {
         /* Only main handle frees pevent */
         pevent_free( handle->pevent );
+        delete handle->kallsyms;
     }
 
     delete handle;
@@ -1576,7 +1812,9 @@ public:
         crtc_str = strpool.getstr( "crtc" );
         ip_str = strpool.getstr( "ip" );
         parent_ip_str = strpool.getstr( "parent_ip" );
+        function_str = strpool.getstr( "function" );
         buf_str = strpool.getstr( "buf" );
+        caller_str = strpool.getstr( "caller" );
 
         ftrace_print_str = strpool.getstr( "ftrace-print" );
         ftrace_function_str = strpool.getstr( "ftrace-function" );
@@ -1594,14 +1832,138 @@ public:
     const char *crtc_str;
     const char *ip_str;
     const char *parent_ip_str;
+    const char *function_str;
     const char *buf_str;
+    const char *caller_str;
 
     const char *ftrace_print_str;
     const char *ftrace_function_str;
     const char *drm_vblank_event_str;
     const char *sched_switch_str;
+
+    // Event type key to indices of load filters matching its system / name
+    util_umap< uintptr_t, std::vector< uint32_t > > load_filter_idx;
 };
 
+// Parse a non-negative decimal number up to max, rejecting trailing junk
+static bool parse_load_filter_num( const std::string &val, long long max, long long &num )
+{
+    char *end;
+
+    errno = 0;
+    num = strtoll( val.c_str(), &end, 10 );
+    return !errno && ( end != val.c_str() ) && !*end && ( num >= 0 ) && ( num <= max );
+}
+
+bool parse_load_filter( const char *str, load_filter_t &filter, std::string &errstr )
+{
+    filter = load_filter_t();
+
+    for ( const std::string &item : string_explode( str, ',' ) )
+    {
+        size_t eq = item.find( '=' );
+        std::string key = string_trimmed( item.substr( 0, eq ) );
+        std::string val = ( eq == std::string::npos ) ? "" : string_trimmed( item.substr( eq + 1 ) );
+
+        if ( val.empty() )
+        {
+            errstr = string_format( "load filter '%s': expected key=value", item.c_str() );
+            return false;
+        }
+
+        if ( key == "system" )
+            filter.system = val;
+        else if ( key == "name" )
+            filter.name = val;
+        else if ( ( key == "pid" ) || ( key == "cpu" ) || ( key == "sample" ) )
+        {
+            long long num;
+
+            if ( !parse_load_filter_num( val, ( key == "sample" ) ? UINT32_MAX : INT_MAX, num ) )
+            {
+                errstr = string_format( "load filter '%s': bad %s '%s'", str, key.c_str(), val.c_str() );
+                return false;
+            }
+
+            if ( key == "pid" )
+                filter.pid = num;
+            else if ( key == "cpu" )
+                filter.cpu = num;
+            else
+                filter.sample = num;
+        }
+        else
+        {
+            errstr = string_format( "load filter '%s': unknown key '%s'", str, key.c_str() );
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::string load_filter_str( const load_filter_t &filter )
+{
+    std::string str;
+
+    if ( !filter.system.empty() )
+        str += ",system=" + filter.system;
+    if ( !filter.name.empty() )
+        str += ",name=" + filter.name;
+    if ( filter.pid != -1 )
+        str += string_format( ",pid=%d", filter.pid );
+    if ( filter.cpu != -1 )
+        str += string_format( ",cpu=%d", filter.cpu );
+    if ( filter.sample )
+        str += string_format( ",sample=%u", filter.sample );
+
+    return str.empty() ? "all" : str.substr( 1 );
+}
+
+// Return true if this record should be dropped. key identifies the event type so
+//  system / name strings are only compared the first time we see each type.
+static bool load_filter_drop( trace_data_t &trace_data, uintptr_t key,
+                              const char *system, const char *name, int pid, int cpu )
+{
+    std::vector< load_filter_t > &filters = trace_data.trace_info.load_filters;
+    std::vector< uint32_t > *pidx = trace_data.load_filter_idx.get_val( key );
+
+    if ( !pidx )
+    {
+        std::vector< uint32_t > idx;
+
+        for ( uint32_t i = 0; i < filters.size(); i++ )
+        {
+            const load_filter_t &filter = filters[ i ];
+
+            if ( ( filter.system.empty() || ( filter.system == system ) ) &&
+                 ( filter.name.empty() || ( filter.name == name ) ) )
+            {
+                idx.push_back( i );
+            }
+        }
+
+        pidx = trace_data.load_filter_idx.get_val( key, idx );
+    }
+
+    for ( uint32_t i : *pidx )
+    {
+        load_filter_t &filter = filters[ i ];
+
+        if ( ( ( filter.pid == -1 ) || ( filter.pid == pid ) ) &&
+             ( ( filter.cpu == -1 ) || ( filter.cpu == cpu ) ) )
+        {
+            bool keep = filter.sample && !( filter.matched % filter.sample );
+
+            filter.matched++;
+            filter.dropped += !keep;
+            return !keep;
+        }
+    }
+
+    return false;
+}
+
 static void init_event_flags( trace_data_t &trace_data, trace_event_t &event )
 {
     // Make sure our event type bits are cleared
@@ -1613,7 +1975,8 @@ static void init_event_flags( trace_data_t &trace_data, trace_event_t &event )
                       TRACE_FLAG_HW_QUEUE |
                       TRACE_FLAG_SCHED_SWITCH |
                       TRACE_FLAG_SCHED_SWITCH_TASK_RUNNING |
-                      TRACE_FLAG_AUTOGEN_COLOR );
+                      TRACE_FLAG_AUTOGEN_COLOR |
+                      TRACE_FLAG_DMA_FENCE );
 
     // fence_signaled was renamed to dma_fence_signaled post v4.9
     if ( event.system == trace_data.ftrace_print_str )
@@ -1628,6 +1991,170 @@ static void init_event_flags( trace_data_t &trace_data, trace_event_t &event )
         event.flags |= TRACE_FLAG_SW_QUEUE;
     else if ( strstr( event.name, "amdgpu_sched_run_job" ) )
         event.flags |= TRACE_FLAG_HW_QUEUE;
+
+    // Driver agnostic fence events. fence system was renamed to dma_fence post v4.9
+    if ( !strcmp( event.system, "dma_fence" ) ||
+         !strcmp( event.system, "fence" ) ||
+         !strcmp( event.system, "gpu_scheduler" ) )
+    {
+        event.flags |= TRACE_FLAG_DMA_FENCE;
+    }
+}
+
+// Parse trace-cmd proc maps option. For each process:
+//   "<pid> <nr_lib_maps> <comm>\n" followed by nr_lib_maps "<start> <end> <path>\n" lines,
+//  with all numbers in hex.
+static void parse_proc_maps( const char *buf, StrPool &strpool, trace_info_t &trace_info )
+{
+    uint32_t count = 0;
+    std::vector< proc_map_t > *maps = NULL;
+
+    for ( const std::string &line : string_explode( buf, '\n' ) )
+    {
+        if ( !count )
+        {
+            unsigned int pid;
+
+            if ( sscanf( line.c_str(), "%x %x", &pid, &count ) == 2 )
+                maps = trace_info.proc_maps.get_val_create( pid );
+        }
+        else
+        {
+            unsigned long long start, end;
+            int pos = 0;
+
+            count--;
+            if ( ( sscanf( line.c_str(), "%llx %llx %n", &start, &end, &pos ) >= 2 ) && pos )
+                maps->push_back( { start, end, 0, false, strpool.getstr( line.c_str() + pos ) } );
+        }
+    }
+
+    for ( auto &it : trace_info.proc_maps.m_map )
+    {
+        std::sort( it.second.begin(), it.second.end(),
+                   []( const proc_map_t &a, const proc_map_t &b ) { return a.start < b.start; } );
+    }
+}
+
+// Resolve kernel stack address with kallsyms the first time we see it
+static void add_kernel_sym( trace_data_t &trace_data, pevent_t *pevent, uint64_t addr )
+{
+    util_umap< uint64_t, const char * > &kernel_syms = trace_data.trace_info.kernel_syms;
+
+    if ( kernel_syms.get_val( addr ) )
+        return;
+
+    const char *func = pevent ? pevent_find_function( pevent, addr ) : NULL;
+
+    if ( func )
+    {
+        unsigned long long offset = addr - pevent_find_function_address( pevent, addr );
+
+        kernel_syms.set_val( addr, trace_data.strpool.getstrf( "%s+0x%llx", func, offset ) );
+    }
+    else
+    {
+        kernel_syms.set_val( addr, NULL );
+    }
+}
+
+// Print kernel_stack / user_stack caller array as space separated hex addresses
+static void print_stack_field( trace_data_t &trace_data, pevent_t *pevent, struct trace_seq *seq,
+                               pevent_record_t *record, event_format_t *event,
+                               struct format_field *format, bool is_kernel )
+{
+    unsigned int elsize = format->elementsize ? format->elementsize : pevent->long_size;
+    unsigned int count = format->arraylen;
+
+    if ( !elsize || ( format->offset >= record->size ) )
+        return;
+
+    // kernel_stack size field is the real entry count, which can be past the
+    //  end of caller[8] in records with deeper stacks.
+    struct format_field *size_field = pevent_find_field( event, "size" );
+
+    if ( size_field )
+    {
+        count = pevent_read_number( pevent, ( char * )record->data + size_field->offset,
+                                    size_field->size );
+    }
+    count = std::min< unsigned int >( count, ( record->size - format->offset ) / elsize );
+
+    for ( unsigned int i = 0; i < count; i++ )
+    {
+        uint64_t addr = pevent_read_number( pevent,
+                ( char * )record->data + format->offset + i * elsize, elsize );
+
+        // Older kernels end stacks with ULONG_MAX, user stacks are zero filled
+        if ( !addr || ( addr == ( ( elsize == 4 ) ? UINT32_MAX : UINT64_MAX ) ) )
+            break;
+
+        if ( is_kernel )
+            add_kernel_sym( trace_data, pevent, addr );
+
+        trace_seq_printf( seq, "%s0x%llx", i ? " " : "", ( unsigned long long )addr );
+    }
+}
+
+// gpuvis_trace_utils buffered markers come in batches: one marker per line,
+//  each tagged with "offset=". Return the number of lines if buf is a batch.
+static uint32_t print_batch_lines( const char *buf, size_t len )
+{
+    static const char tag[] = "offset=";
+    const char *end = buf + len;
+    uint32_t lines = 0;
+
+    while ( buf < end )
+    {
+        const char *eol = std::find( buf, end, '\n' );
+
+        if ( eol != buf )
+        {
+            if ( std::search( buf, eol, tag, tag + sizeof( tag ) - 1 ) == eol )
+                return 0;
+            lines++;
+        }
+
+        buf = eol + ( eol != end );
+    }
+
+    return ( lines > 1 ) ? lines : 0;
+}
+
+// Send an ftrace print event to the callback for each marker in a batch
+static int add_print_batch( trace_data_t &trace_data, trace_event_t &trace_event, const std::string &batch )
+{
+    int ret = 0;
+    bool first = true;
+    const std::vector< event_field_t > fields( trace_event.fields,
+                                               trace_event.fields + trace_event.numfields );
+
+    for ( const std::string &line : string_explode( batch, '\n' ) )
+    {
+        if ( line.empty() )
+            continue;
+
+        // Callback owns the fields array, so each marker gets its own copy
+        if ( !first )
+        {
+            trace_event.id = trace_data.events++;
+            trace_event.fields = new event_field_t[ fields.size() ];
+            std::copy( fields.begin(), fields.end(), trace_event.fields );
+        }
+        first = false;
+
+        for ( uint32_t i = 0; i < trace_event.numfields; i++ )
+        {
+            if ( trace_event.fields[ i ].key == trace_data.buf_str )
+                trace_event.fields[ i ].value = trace_data.strpool.getstr( line.c_str() );
+        }
+
+        ret = trace_data.cb( trace_event );
+        if ( ret )
+            break;
+    }
+
+    return ret;
 }
 
 static int trace_enum_events( trace_data_t &trace_data, tracecmd_input_t *handle, pevent_record_t *record )
@@ -1641,12 +2168,23 @@ static int trace_enum_events( trace_data_t &trace_data, tracecmd_input_t *handle
     if ( event )
     {
         struct trace_seq seq;
+        std::string print_batch;
         trace_event_t trace_event;
         struct format_field *format;
         int pid = pevent_data_pid( pevent, record );
+
+        if ( !trace_data.trace_info.load_filters.empty() &&
+             load_filter_drop( trace_data, ( uintptr_t )event, event->system, event->name, pid, record->cpu ) )
+        {
+            return 0;
+        }
+
         const char *comm = pevent_data_comm_from_pid( pevent, pid );
         bool is_ftrace_function = !strcmp( "ftrace", event->system ) && !strcmp( "function", event->name );
         bool is_printk_function = !strcmp( "ftrace", event->system ) && !strcmp( "print", event->name );
+        bool is_workqueue = !strcmp( "workqueue", event->system );
+        bool is_kernel_stack = !strcmp( "ftrace", event->system ) && !strcmp( "kernel_stack", event->name );
+        bool is_user_stack = !strcmp( "ftrace", event->system ) && !strcmp( "user_stack", event->name );
 
         trace_seq_init( &seq );
 
@@ -1709,6 +2247,10 @@ static int trace_enum_events( trace_data_t &trace_data, tracecmd_input_t *handle
 
                 trace_event.system = trace_data.ftrace_print_str;
 
+                // Buffered markers are split into separate events below
+                if ( print_batch_lines( seq.buffer, seq.len ) )
+                    print_batch.assign( seq.buffer, seq.len );
+
                 // Convert all LFs to spaces.
                 for ( unsigned int i = 0; i < seq.len; i++ )
                 {
@@ -1716,6 +2258,10 @@ static int trace_enum_events( trace_data_t &trace_data, tracecmd_input_t *handle
                         seq.buffer[ i ] = ' ';
                 }
             }
+            else if ( ( is_kernel_stack || is_user_stack ) && ( format_name == trace_data.caller_str ) )
+            {
+                print_stack_field( trace_data, pevent, &seq, record, event, format, is_kernel_stack );
+            }
             else
             {
                 pevent_print_field( &seq, record->data, format );
@@ -1758,6 +2304,16 @@ static int trace_enum_events( trace_data_t &trace_data, tracecmd_input_t *handle
                         }
                     }
                 }
+                else if ( is_workqueue && ( format_name == trace_data.function_str ) )
+                {
+                    // workqueue_queue_work, execute_start, etc: "function=0xffffffff8112d0a0 (vmstat_update)"
+                    unsigned long long val = pevent_read_number( pevent,
+                            ( char * )record->data + format->offset, format->size );
+                    const char *func = pevent_find_function( pevent, val );
+
+                    if ( func )
+                        trace_seq_printf( &seq, " (%s)", func );
+                }
             }
 
             // Trim trailing whitespace
@@ -1776,7 +2332,10 @@ static int trace_enum_events( trace_data_t &trace_data, tracecmd_input_t *handle
 
         init_event_flags( trace_data, trace_event );
 
-        ret = trace_data.cb( trace_event );
+        if ( !print_batch.empty() )
+            ret = add_print_batch( trace_data, trace_event, print_batch );
+        else
+            ret = trace_data.cb( trace_event );
 
         trace_seq_destroy( &seq );
     }
@@ -1784,6 +2343,18 @@ static int trace_enum_events( trace_data_t &trace_data, tracecmd_input_t *handle
     return ret;
 }
 
+static unsigned long long clock_adjust_ts( const file_info_t *file_info, unsigned long long ts )
+{
+    if ( file_info->clock_adjust )
+    {
+        int64_t delta = ( int64_t )ts - file_info->clock_ref_ts;
+
+        ts += file_info->clock_offset + ( int64_t )( delta * file_info->clock_drift );
+    }
+
+    return ts;
+}
+
 static pevent_record_t *get_next_record( file_info_t *file_info )
 {
     if ( file_info->record )
@@ -1795,6 +2366,8 @@ static pevent_record_t *get_next_record( file_info_t *file_info )
     file_info->record = tracecmd_read_next_data( file_info->handle, NULL );
     if ( !file_info->record )
         file_info->done = 1;
+    else
+        file_info->record->ts = clock_adjust_ts( file_info, file_info->record->ts );
 
     return file_info->record;
 }
@@ -1825,28 +2398,2001 @@ void tgid_info_t::add_pid( int pid )
     }
 }
 
-static int64_t geti64( const char *str, const char *var )
+/*
+  Clock sync markers are ftrace print events written to the top level trace_marker
+  and to each buffer instance trace_marker (instances/<name>/trace_marker) with
+  the same id, ie:
+
+    gpuvis_clock_sync=42
+
+  Matching ids give us pairs of (buffer ts, top level ts) which we fit to an
+  offset and linear drift. Buffer timestamps are then mapped to the top level
+  clock as records are merged.
+ */
+static const char s_clock_sync_marker[] = "gpuvis_clock_sync=";
+
+static void read_clock_sync_markers( tracecmd_input_t *handle, util_umap< uint64_t, int64_t > &markers )
+{
+    struct trace_seq seq;
+    pevent_t *pevent = handle->pevent;
+
+    trace_seq_init( &seq );
+
+    for ( ;; )
+    {
+        pevent_record_t *record = tracecmd_read_next_data( handle, NULL );
+
+        if ( !record )
+            break;
+
+        event_format_t *event = pevent_find_event_by_record( pevent, record );
+
+        if ( event && !strcmp( "ftrace", event->system ) && !strcmp( "print", event->name ) )
+        {
+            struct print_arg *args = event->print_fmt.args;
+
+            if ( args->type != PRINT_FIELD )
+                args = args->next;
+
+            trace_seq_reset( &seq );
+            print_str_arg( &seq, record->data, record->size,
+                           event, "%s", -1, args );
+            trace_seq_terminate( &seq );
+
+            const char *marker = strstr( seq.buffer, s_clock_sync_marker );
+            if ( marker )
+            {
+                uint64_t id = strtoull( marker + sizeof( s_clock_sync_marker ) - 1, NULL, 10 );
+
+                // Keep the first ts we see for each id
+                markers.get_val( id, record->ts );
+            }
+        }
+
+        free_record( handle, record );
+    }
+
+    trace_seq_destroy( &seq );
+}
+
+// Least squares fit of buffer ts -> top level ts for all matching sync markers
+static void calc_clock_sync_drift( trace_clock_info_t &clock,
+                                   const util_umap< uint64_t, int64_t > &ref_markers,
+                                   const util_umap< uint64_t, int64_t > &markers )
+{
+    std::vector< std::pair< int64_t, int64_t > > pairs;
+
+    for ( const auto &it : markers.m_map )
+    {
+        const int64_t *ref_ts = ref_markers.get_val( it.first );
+
+        if ( ref_ts )
+            pairs.push_back( { it.second, *ref_ts } );
+    }
+
+    if ( pairs.empty() )
+        return;
+
+    // Work with deltas from the first pair to keep precision
+    int64_t x0 = pairs[ 0 ].first;
+    int64_t y0 = pairs[ 0 ].second;
+    long double mx = 0, my = 0;
+
+    for ( const auto &pair : pairs )
+    {
+        mx += pair.first - x0;
+        my += pair.second - y0;
+    }
+    mx /= pairs.size();
+    my /= pairs.size();
+
+    long double sxx = 0, sxy = 0;
+
+    for ( const auto &pair : pairs )
+    {
+        long double dx = ( pair.first - x0 ) - mx;
+        long double dy = ( pair.second - y0 ) - my;
+
+        sxx += dx * dx;
+        sxy += dx * dy;
+    }
+
+    clock.ref_ts = x0 + ( int64_t )mx;
+    clock.offset = ( y0 - x0 ) + ( int64_t )( my - mx );
+    clock.drift = ( sxx > 0 ) ? ( double )( sxy / sxx - 1 ) : 0.0;
+    clock.sync_pairs = pairs.size();
+}
+
+// Read all clock sync markers from a separate handle and fit each buffer instance to the top level clock
+static void calc_clock_sync( const char *file, trace_info_t &trace_info )
+{
+    GPUVIS_TRACE_BLOCK( __func__ );
+
+    util_umap< uint64_t, int64_t > ref_markers;
+    tracecmd_input_t *handle = tracecmd_alloc( file );
+
+    if ( !handle )
+        return;
+
+    handle->recover_bad_pages = trace_info.recover_bad_pages;
+    tracecmd_read_headers( handle );
+    tracecmd_init_data( handle );
+
+    read_clock_sync_markers( handle, ref_markers );
+
+    for ( int i = 0; !ref_markers.m_map.empty() && ( i < handle->nr_buffers ); i++ )
+    {
+        util_umap< uint64_t, int64_t > markers;
+        tracecmd_input_t *new_handle = tracecmd_buffer_instance_handle( handle, i );
+
+        if ( !new_handle )
+            continue;
+
+        read_clock_sync_markers( new_handle, markers );
+        calc_clock_sync_drift( trace_info.clocks[ i + 1 ], ref_markers, markers );
+
+        tracecmd_close( new_handle );
+    }
+
+    tracecmd_close( handle );
+}
+
+static void init_buffer_clocks( const char *file, std::vector< file_info_t * > &file_list, trace_info_t &trace_info )
+{
+    tracecmd_input_t *handle = file_list[ 0 ]->handle;
+    const char *trace_clock = ( handle->use_trace_clock && handle->pevent->trace_clock ) ?
+                handle->pevent->trace_clock : "local";
+
+    trace_info.clocks.resize( file_list.size() );
+
+    for ( size_t i = 0; i < file_list.size(); i++ )
+    {
+        trace_clock_info_t &clock = trace_info.clocks[ i ];
+
+        // All buffers in a trace file share the trace_clock from the file header
+        clock.buffer = i ? handle->buffers[ i - 1 ].name : "";
+        clock.trace_clock = trace_clock;
+    }
+
+    if ( trace_info.clock_sync && ( file_list.size() > 1 ) )
+        calc_clock_sync( file, trace_info );
+
+    // User specified anchors override sync markers
+    for ( const trace_clock_info_t &anchor : trace_info.clock_anchors )
+    {
+        bool found = false;
+
+        for ( size_t i = 1; i < trace_info.clocks.size(); i++ )
+        {
+            trace_clock_info_t &clock = trace_info.clocks[ i ];
+
+            if ( clock.buffer == anchor.buffer )
+            {
+                pevent_record_t *record = tracecmd_peek_next_data( file_list[ i ]->handle, NULL );
+
+                clock.offset = anchor.offset;
+                clock.ref_ts = record ? record->ts : 0;
+                clock.drift = anchor.drift;
+                clock.sync_pairs = 0;
+                found = true;
+            }
+        }
+
+        if ( !found )
+            logf( "[Error] %s: clock anchor buffer \"%s\" not found.", __func__, anchor.buffer.c_str() );
+    }
+
+    for ( size_t i = 1; i < file_list.size(); i++ )
+    {
+        file_info_t *file_info = file_list[ i ];
+        const trace_clock_info_t &clock = trace_info.clocks[ i ];
+
+        if ( clock.offset || ( clock.drift != 0.0 ) )
+        {
+            file_info->clock_adjust = 1;
+            file_info->clock_offset = clock.offset;
+            file_info->clock_ref_ts = clock.ref_ts;
+            file_info->clock_drift = clock.drift;
+
+            logf( "Buffer %s clock offset: %lldns drift: %.3fppm (sync pairs: %u)",
+                  clock.buffer.c_str(), ( long long )clock.offset, clock.drift * 1000000.0, clock.sync_pairs );
+        }
+    }
+}
+
+static int64_t geti64( const char *str, const char *var )
+{
+    const char *val = strstr( str, var );
+
+    if ( val )
+        return strtoull( val + strlen( var ), NULL, 10 );
+    return 0;
+}
+
+static int64_t getf64( const char *str, const char *var )
+{
+    const char *val = strstr( str, var );
+
+    if ( val )
+        return strtold( val + strlen( var ), NULL ) * NSECS_PER_SEC;
+    return 0;
+}
+
+/*
+ * perf.data import
+ *
+ * perf.data layout (tools/perf/util/header.h):
+ *   perf_file_header
+ *   attrs:    { perf_event_attr, perf_file_section ids } * nr_attrs
+ *   data:     perf_event_header records
+ *   features: perf_file_section for each feature bit set in adds_features
+ *
+ * The HEADER_TRACING_DATA feature section is the same format as the start of a
+ * trace.dat file, so we use tracecmd_read_headers() on it to get our pevent and
+ * event formats for decoding raw tracepoint payloads.
+ */
+#define PERF_MAGIC2                     0x32454c4946524550ULL // "PERFILE2"
+
+#define PERF_TYPE_TRACEPOINT            2
+
+#define PERF_SAMPLE_IP                  ( 1U << 0 )
+#define PERF_SAMPLE_TID                 ( 1U << 1 )
+#define PERF_SAMPLE_TIME                ( 1U << 2 )
+#define PERF_SAMPLE_ADDR                ( 1U << 3 )
+#define PERF_SAMPLE_READ                ( 1U << 4 )
+#define PERF_SAMPLE_CALLCHAIN           ( 1U << 5 )
+#define PERF_SAMPLE_ID                  ( 1U << 6 )
+#define PERF_SAMPLE_CPU                 ( 1U << 7 )
+#define PERF_SAMPLE_PERIOD              ( 1U << 8 )
+#define PERF_SAMPLE_STREAM_ID           ( 1U << 9 )
+#define PERF_SAMPLE_RAW                 ( 1U << 10 )
+#define PERF_SAMPLE_IDENTIFIER          ( 1U << 16 )
+
+#define PERF_FORMAT_TOTAL_TIME_ENABLED  ( 1U << 0 )
+#define PERF_FORMAT_TOTAL_TIME_RUNNING  ( 1U << 1 )
+#define PERF_FORMAT_ID                  ( 1U << 2 )
+#define PERF_FORMAT_GROUP               ( 1U << 3 )
+#define PERF_FORMAT_LOST                ( 1U << 4 )
+
+#define PERF_ATTR_FLAG_SAMPLE_ID_ALL    ( 1ULL << 18 )
+
+// Callchain context markers: following ips are kernel / user addresses
+#define PERF_CONTEXT_KERNEL             ( ( uint64_t )-128 )
+#define PERF_CONTEXT_USER               ( ( uint64_t )-512 )
+#define PERF_CONTEXT_MAX                ( ( uint64_t )-4095 )
+
+#define PERF_RECORD_MMAP                1
+#define PERF_RECORD_COMM                3
+#define PERF_RECORD_FORK                7
+#define PERF_RECORD_SAMPLE              9
+#define PERF_RECORD_MMAP2               10
+#define PERF_RECORD_SWITCH              14
+#define PERF_RECORD_SWITCH_CPU_WIDE     15
+
+#define PERF_RECORD_MISC_SWITCH_OUT             ( 1 << 13 )
+#define PERF_RECORD_MISC_SWITCH_OUT_PREEMPT     ( 1 << 14 )
+
+#define HEADER_TRACING_DATA             1
+#define HEADER_OSRELEASE                4
+#define HEADER_NRCPUS                   7
+#define HEADER_EVENT_DESC               12
+
+struct perf_file_section_t
+{
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct perf_file_header_t
+{
+    uint64_t magic;
+    uint64_t size;
+    uint64_t attr_size;
+    perf_file_section_t attrs;
+    perf_file_section_t data;
+    perf_file_section_t event_types;
+    uint64_t adds_features[ 4 ];
+};
+
+// Start of struct perf_event_attr. That's all we need.
+struct perf_event_attr_t
+{
+    uint32_t type;
+    uint32_t size;
+    uint64_t config;
+    uint64_t sample_period;
+    uint64_t sample_type;
+    uint64_t read_format;
+    uint64_t flags;
+};
+
+struct perf_event_header_t
+{
+    uint32_t type;
+    uint16_t misc;
+    uint16_t size;
+};
+
+struct perf_attr_info_t
+{
+    perf_event_attr_t attr;
+    const char *name = nullptr;
+    event_format_t *event = nullptr;
+};
+
+struct perf_sample_t
+{
+    uint64_t id = 0;
+    uint64_t ip = 0;
+    uint32_t pid = 0;
+    uint32_t tid = 0;
+    uint64_t time = 0;
+    uint32_t cpu = 0;
+    uint64_t period = 0;
+    uint32_t raw_size = 0;
+    const uint8_t *raw = nullptr;
+    uint64_t callchain_nr = 0;
+    const uint8_t *callchain = nullptr;
+};
+
+struct perf_record_t
+{
+    int64_t ts;
+    uint64_t offset;
+};
+
+class perf_file_t
+{
+public:
+    perf_file_t( trace_data_t &_trace_data ) : trace_data( _trace_data ) {}
+    ~perf_file_t();
+
+    bool open( const char *file );
+    void read_attrs();
+    void read_features( const char *file );
+    void index_records();
+    int enum_record( const perf_record_t &rec );
+
+protected:
+    const perf_attr_info_t *get_attr( const uint8_t *body, const uint8_t *end, bool is_sample );
+    bool parse_sample( const perf_attr_info_t *info, const uint8_t *p, const uint8_t *end, perf_sample_t &sample );
+    void parse_sample_id( const perf_attr_info_t *info, const uint8_t *body, const uint8_t *end, perf_sample_t &sample );
+    const char *get_comm( int pid );
+    int add_event( const perf_sample_t &sample, const char *name,
+                   const std::vector< std::pair< const char *, std::string > > &fields );
+
+public:
+    trace_data_t &trace_data;
+
+    const uint8_t *map = nullptr;
+    size_t map_size = 0;
+
+    perf_file_header_t header;
+
+    std::vector< perf_attr_info_t > attrs;
+    util_umap< uint64_t, uint32_t > id_to_attr;
+
+    // Handle for HEADER_TRACING_DATA event formats (or NULL)
+    tracecmd_input_t *handle = nullptr;
+
+    uint32_t nr_cpus = 0;
+    bool has_sched_switch_tracepoint = false;
+
+    std::vector< std::vector< perf_record_t > > cpu_records;
+};
+
+perf_file_t::~perf_file_t()
+{
+    if ( handle )
+        tracecmd_close( handle );
+
+    if ( map )
+    {
+#ifdef USE_MMAP
+        munmap( ( void * )map, map_size );
+#else
+        free( ( void * )map );
+#endif
+    }
+}
+
+bool perf_file_t::open( const char *file )
+{
+    int fd = TEMP_FAILURE_RETRY( ::open( file, O_RDONLY ) );
+
+    if ( fd < 0 )
+    {
+        logf( "[Error] %s: open(\"%s\") failed: %d\n", __func__, file, errno );
+        return false;
+    }
+
+    map_size = lseek64( fd, 0, SEEK_END );
+    lseek64( fd, 0, SEEK_SET );
+
+    if ( map_size >= sizeof( header ) )
+    {
+#ifdef USE_MMAP
+        void *ptr = mmap( NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+        map = ( ptr != MAP_FAILED ) ? ( const uint8_t * )ptr : NULL;
+#else
+        uint8_t *buf = ( uint8_t * )malloc( map_size );
+
+        if ( buf && ( TEMP_FAILURE_RETRY( read( fd, buf, map_size ) ) == ( ssize_t )map_size ) )
+            map = buf;
+        else
+            free( buf );
+#endif
+    }
+
+    close( fd );
+
+    if ( !map )
+    {
+        logf( "[Error] %s: failed to map \"%s\".\n", __func__, file );
+        return false;
+    }
+
+    memcpy( &header, map, sizeof( header ) );
+
+    if ( header.magic != PERF_MAGIC2 )
+    {
+        logf( "[Error] %s: unsupported perf.data format (cross endian or pre PERFILE2).\n", __func__ );
+        return false;
+    }
+
+    if ( ( header.data.offset > map_size ) || ( header.data.size > map_size - header.data.offset ) ||
+         ( header.attrs.offset > map_size ) || ( header.attrs.size > map_size - header.attrs.offset ) ||
+         ( header.attr_size < sizeof( perf_file_section_t ) ) )
+    {
+        logf( "[Error] %s: bad perf.data header.\n", __func__ );
+        return false;
+    }
+
+    return true;
+}
+
+void perf_file_t::read_attrs()
+{
+    size_t count = header.attrs.size / header.attr_size;
+
+    for ( size_t i = 0; i < count; i++ )
+    {
+        perf_attr_info_t info;
+        perf_file_section_t ids;
+        const uint8_t *entry = map + header.attrs.offset + i * header.attr_size;
+        size_t attr_size = header.attr_size - sizeof( ids );
+
+        memset( &info.attr, 0, sizeof( info.attr ) );
+        memcpy( &info.attr, entry, std::min< size_t >( attr_size, sizeof( info.attr ) ) );
+        memcpy( &ids, entry + attr_size, sizeof( ids ) );
+
+        if ( ( ids.offset > map_size ) || ( ids.size > map_size - ids.offset ) )
+            ids.size = 0;
+
+        for ( uint64_t j = 0; j < ids.size / sizeof( uint64_t ); j++ )
+        {
+            uint64_t id;
+
+            memcpy( &id, map + ids.offset + j * sizeof( id ), sizeof( id ) );
+            id_to_attr.m_map[ id ] = attrs.size();
+        }
+
+        attrs.push_back( info );
+    }
+}
+
+static std::string perf_read_string( const uint8_t *&p, const uint8_t *end )
+{
+    uint32_t len;
+
+    if ( p + sizeof( len ) > end )
+        return "";
+
+    memcpy( &len, p, sizeof( len ) );
+    p += sizeof( len );
+
+    if ( p + len > end )
+        return "";
+
+    // String is NUL padded to len
+    std::string str( ( const char * )p, strnlen( ( const char * )p, len ) );
+
+    p += len;
+    return str;
+}
+
+// Read event formats, kallsyms, etc from HEADER_TRACING_DATA.
+//  Returns false if die() was called while reading them.
+static bool perf_read_tracing_data( tracecmd_input_t *handle )
+{
+    if ( setjmp( handle->jump_buffer ) )
+    {
+        logf( "[Error] %s: failed to read perf tracing data.\n", __func__ );
+        return false;
+    }
+
+    tracecmd_read_headers( handle );
+    return true;
+}
+
+void perf_file_t::read_features( const char *file )
+{
+    StrPool &strpool = trace_data.strpool;
+    const perf_file_section_t *sections = ( const perf_file_section_t * )
+            ( map + header.data.offset + header.data.size );
+    uint32_t isection = 0;
+
+    for ( uint32_t feat = 1; feat < 256; feat++ )
+    {
+        if ( !( header.adds_features[ feat / 64 ] & ( 1ULL << ( feat % 64 ) ) ) )
+            continue;
+
+        perf_file_section_t section;
+        const uint8_t *psection = ( const uint8_t * )&sections[ isection++ ];
+
+        if ( psection + sizeof( section ) > map + map_size )
+            break;
+
+        memcpy( &section, psection, sizeof( section ) );
+        if ( ( section.offset > map_size ) || ( section.size > map_size - section.offset ) )
+            continue;
+
+        const uint8_t *p = map + section.offset;
+        const uint8_t *end = p + section.size;
+
+        if ( feat == HEADER_TRACING_DATA )
+        {
+            int fd = TEMP_FAILURE_RETRY( ::open( file, O_RDONLY ) );
+
+            if ( ( fd >= 0 ) && ( lseek64( fd, section.offset, SEEK_SET ) >= 0 ) )
+                handle = tracecmd_alloc_fd( file, fd );
+            else if ( fd >= 0 )
+                close( fd );
+
+            // Continue without tracepoint payloads if the formats can't be read
+            if ( handle && !perf_read_tracing_data( handle ) )
+            {
+                tracecmd_close( handle );
+                handle = NULL;
+            }
+        }
+        else if ( feat == HEADER_OSRELEASE )
+        {
+            trace_data.trace_info.uname = perf_read_string( p, end );
+        }
+        else if ( feat == HEADER_NRCPUS )
+        {
+            // u32 nr_cpus_available, u32 nr_cpus_online
+            if ( p + sizeof( nr_cpus ) <= end )
+                memcpy( &nr_cpus, p, sizeof( nr_cpus ) );
+        }
+        else if ( feat == HEADER_EVENT_DESC )
+        {
+            uint32_t nr_events = 0;
+            uint32_t attr_size = 0;
+
+            if ( p + 8 > end )
+                continue;
+
+            memcpy( &nr_events, p, 4 );
+            memcpy( &attr_size, p + 4, 4 );
+            p += 8;
+
+            // { attr, u32 nr_ids, string name, u64 ids[ nr_ids ] } * nr_events
+            for ( uint32_t i = 0; ( i < nr_events ) && ( p + attr_size + 4 <= end ); i++ )
+            {
+                uint32_t nr_ids;
+                uint32_t iattr = i;
+
+                p += attr_size;
+                memcpy( &nr_ids, p, 4 );
+                p += 4;
+
+                const char *name = strpool.getstr( perf_read_string( p, end ).c_str() );
+
+                if ( nr_ids && ( p + sizeof( uint64_t ) <= end ) )
+                {
+                    uint64_t id;
+                    const uint32_t *pattr;
+
+                    memcpy( &id, p, sizeof( id ) );
+                    if ( ( pattr = id_to_attr.get_val( id ) ) )
+                        iattr = *pattr;
+                }
+                p += nr_ids * sizeof( uint64_t );
+
+                if ( iattr < attrs.size() )
+                    attrs[ iattr ].name = name;
+            }
+        }
+    }
+
+    for ( perf_attr_info_t &info : attrs )
+    {
+        if ( ( info.attr.type == PERF_TYPE_TRACEPOINT ) && handle )
+        {
+            info.event = pevent_find_event( handle->pevent, info.attr.config );
+
+            if ( info.event && !strcmp( info.event->name, "sched_switch" ) )
+                has_sched_switch_tracepoint = true;
+        }
+
+        if ( !info.name )
+        {
+            info.name = info.event ?
+                        strpool.getstrf( "%s:%s", info.event->system, info.event->name ) :
+                        strpool.getstrf( "perf_type%u_config%llu", info.attr.type,
+                                         ( unsigned long long )info.attr.config );
+        }
+    }
+}
+
+const perf_attr_info_t *perf_file_t::get_attr( const uint8_t *body, const uint8_t *end, bool is_sample )
+{
+    if ( attrs.size() == 1 )
+        return &attrs[ 0 ];
+
+    // All attrs share the same sample_id layout, so use the first to find the id
+    uint64_t id;
+    const uint8_t *pid = NULL;
+    uint64_t sample_type = attrs[ 0 ].attr.sample_type;
+
+    if ( is_sample )
+    {
+        if ( sample_type & PERF_SAMPLE_IDENTIFIER )
+        {
+            pid = body;
+        }
+        else if ( sample_type & PERF_SAMPLE_ID )
+        {
+            pid = body;
+            pid += ( sample_type & PERF_SAMPLE_IP ) ? 8 : 0;
+            pid += ( sample_type & PERF_SAMPLE_TID ) ? 8 : 0;
+            pid += ( sample_type & PERF_SAMPLE_TIME ) ? 8 : 0;
+            pid += ( sample_type & PERF_SAMPLE_ADDR ) ? 8 : 0;
+        }
+    }
+    else if ( attrs[ 0 ].attr.flags & PERF_ATTR_FLAG_SAMPLE_ID_ALL )
+    {
+        if ( sample_type & PERF_SAMPLE_IDENTIFIER )
+        {
+            pid = end - 8;
+        }
+        else if ( sample_type & PERF_SAMPLE_ID )
+        {
+            pid = end - 8;
+            pid -= ( sample_type & PERF_SAMPLE_CPU ) ? 8 : 0;
+            pid -= ( sample_type & PERF_SAMPLE_STREAM_ID ) ? 8 : 0;
+        }
+    }
+
+    if ( pid && ( pid >= body ) && ( pid + sizeof( id ) <= end ) )
+    {
+        memcpy( &id, pid, sizeof( id ) );
+
+        const uint32_t *iattr = id_to_attr.get_val( id );
+        if ( iattr )
+            return &attrs[ *iattr ];
+    }
+
+    return attrs.empty() ? NULL : &attrs[ 0 ];
+}
+
+#define PERF_READ( _p, _end, _val ) \
+    do { \
+        if ( ( _p ) + sizeof( _val ) > ( _end ) ) return false; \
+        memcpy( &( _val ), ( _p ), sizeof( _val ) ); \
+        ( _p ) += sizeof( _val ); \
+    } while ( 0 )
+
+bool perf_file_t::parse_sample( const perf_attr_info_t *info, const uint8_t *p, const uint8_t *end, perf_sample_t &sample )
+{
+    uint64_t val;
+    uint64_t sample_type = info->attr.sample_type;
+    uint64_t read_format = info->attr.read_format;
+
+    if ( sample_type & PERF_SAMPLE_IDENTIFIER )
+        PERF_READ( p, end, sample.id );
+    if ( sample_type & PERF_SAMPLE_IP )
+        PERF_READ( p, end, sample.ip );
+    if ( sample_type & PERF_SAMPLE_TID )
+    {
+        PERF_READ( p, end, sample.pid );
+        PERF_READ( p, end, sample.tid );
+    }
+    if ( sample_type & PERF_SAMPLE_TIME )
+        PERF_READ( p, end, sample.time );
+    if ( sample_type & PERF_SAMPLE_ADDR )
+        PERF_READ( p, end, val );
+    if ( sample_type & PERF_SAMPLE_ID )
+        PERF_READ( p, end, sample.id );
+    if ( sample_type & PERF_SAMPLE_STREAM_ID )
+        PERF_READ( p, end, val );
+    if ( sample_type & PERF_SAMPLE_CPU )
+    {
+        uint32_t res;
+
+        PERF_READ( p, end, sample.cpu );
+        PERF_READ( p, end, res );
+    }
+    if ( sample_type & PERF_SAMPLE_PERIOD )
+        PERF_READ( p, end, sample.period );
+    if ( sample_type & PERF_SAMPLE_READ )
+    {
+        uint64_t nr = 1;
+        uint64_t value_size = 8;
+
+        value_size += ( read_format & PERF_FORMAT_ID ) ? 8 : 0;
+        value_size += ( read_format & PERF_FORMAT_LOST ) ? 8 : 0;
+
+        if ( read_format & PERF_FORMAT_GROUP )
+            PERF_READ( p, end, nr );
+        if ( read_format & PERF_FORMAT_TOTAL_TIME_ENABLED )
+            PERF_READ( p, end, val );
+        if ( read_format & PERF_FORMAT_TOTAL_TIME_RUNNING )
+            PERF_READ( p, end, val );
+
+        if ( nr * value_size > ( uint64_t )( end - p ) )
+            return false;
+        p += nr * value_size;
+    }
+    if ( sample_type & PERF_SAMPLE_CALLCHAIN )
+    {
+        uint64_t nr;
+
+        PERF_READ( p, end, nr );
+        if ( nr * 8 > ( uint64_t )( end - p ) )
+            return false;
+        sample.callchain = p;
+        sample.callchain_nr = nr;
+        p += nr * 8;
+    }
+    if ( sample_type & PERF_SAMPLE_RAW )
+    {
+        PERF_READ( p, end, sample.raw_size );
+        if ( sample.raw_size > ( uint64_t )( end - p ) )
+            return false;
+        sample.raw = p;
+    }
+
+    return true;
+}
+
+void perf_file_t::parse_sample_id( const perf_attr_info_t *info, const uint8_t *body, const uint8_t *end, perf_sample_t &sample )
+{
+    uint64_t sample_type = info->attr.sample_type;
+
+    if ( !( info->attr.flags & PERF_ATTR_FLAG_SAMPLE_ID_ALL ) )
+        return;
+
+    // sample_id trailer: { pid, tid }, time, id, stream_id, { cpu, res }, identifier
+    size_t size = 0;
+    size += ( sample_type & PERF_SAMPLE_TID ) ? 8 : 0;
+    size += ( sample_type & PERF_SAMPLE_TIME ) ? 8 : 0;
+    size += ( sample_type & PERF_SAMPLE_ID ) ? 8 : 0;
+    size += ( sample_type & PERF_SAMPLE_STREAM_ID ) ? 8 : 0;
+    size += ( sample_type & PERF_SAMPLE_CPU ) ? 8 : 0;
+    size += ( sample_type & PERF_SAMPLE_IDENTIFIER ) ? 8 : 0;
+
+    if ( size > ( size_t )( end - body ) )
+        return;
+
+    const uint8_t *p = end - size;
+
+    if ( sample_type & PERF_SAMPLE_TID )
+    {
+        memcpy( &sample.pid, p, 4 );
+        memcpy( &sample.tid, p + 4, 4 );
+        p += 8;
+    }
+    if ( sample_type & PERF_SAMPLE_TIME )
+    {
+        memcpy( &sample.time, p, 8 );
+        p += 8;
+    }
+    if ( sample_type & PERF_SAMPLE_ID )
+        p += 8;
+    if ( sample_type & PERF_SAMPLE_STREAM_ID )
+        p += 8;
+    if ( sample_type & PERF_SAMPLE_CPU )
+        memcpy( &sample.cpu, p, 4 );
+}
+
+void perf_file_t::index_records()
+{
+    trace_info_t &trace_info = trace_data.trace_info;
+    StrPool &strpool = trace_data.strpool;
+    const uint8_t *data = map + header.data.offset;
+    const uint8_t *data_end = data + header.data.size;
+
+    for ( const uint8_t *p = data; p + sizeof( perf_event_header_t ) <= data_end; )
+    {
+        perf_event_header_t hdr;
+
+        memcpy( &hdr, p, sizeof( hdr ) );
+        if ( ( hdr.size < sizeof( hdr ) ) || ( p + hdr.size > data_end ) )
+        {
+            logf( "[Error] %s: bad perf record size at offset %lu.\n", __func__,
+                  ( unsigned long )( p - map ) );
+            break;
+        }
+
+        const uint8_t *body = p + sizeof( hdr );
+        const uint8_t *end = p + hdr.size;
+        bool is_sample = ( hdr.type == PERF_RECORD_SAMPLE );
+
+        if ( is_sample ||
+             ( hdr.type == PERF_RECORD_SWITCH ) ||
+             ( hdr.type == PERF_RECORD_SWITCH_CPU_WIDE ) )
+        {
+            perf_sample_t sample;
+            const perf_attr_info_t *info = get_attr( body, end, is_sample );
+
+            if ( info )
+            {
+                if ( is_sample )
+                    parse_sample( info, body, end, sample );
+                else
+                    parse_sample_id( info, body, end, sample );
+
+                if ( sample.cpu >= s_max_cpus )
+                {
+                    logf( "[Error] %s: bad perf sample cpu %u at offset %lu.\n", __func__,
+                          sample.cpu, ( unsigned long )( p - map ) );
+                    p = end;
+                    continue;
+                }
+
+                if ( sample.cpu >= cpu_records.size() )
+                    cpu_records.resize( sample.cpu + 1 );
+
+                cpu_records[ sample.cpu ].push_back( { ( int64_t )sample.time, ( uint64_t )( p - map ) } );
+            }
+        }
+        else if ( hdr.type == PERF_RECORD_COMM )
+        {
+            // u32 pid, tid; char comm[]
+            if ( body + 8 < end )
+            {
+                int pid = *( const uint32_t * )body;
+                int tid = *( const uint32_t * )( body + 4 );
+                const char *comm = strpool.getstr( ( const char * )body + 8,
+                                                   strnlen( ( const char * )body + 8, end - body - 8 ) );
+
+                trace_info.pid_comm_map.set_val( tid, comm );
+                trace_info.pid_tgid_map.set_val( tid, pid );
+
+                if ( handle )
+                    pevent_register_comm( handle->pevent, comm, tid );
+
+                tgid_info_t *tgid_info = trace_info.tgid_pids.get_val_create( pid );
+                if ( !tgid_info->tgid )
+                {
+                    tgid_info->tgid = pid;
+                    tgid_info->hashval += hashstr32( comm );
+                }
+                tgid_info->add_pid( tid );
+            }
+        }
+        else if ( ( hdr.type == PERF_RECORD_MMAP ) || ( hdr.type == PERF_RECORD_MMAP2 ) )
+        {
+            // u32 pid, tid; u64 addr, len, pgoff; [mmap2: u32 maj, min; u64 ino, ino_generation;
+            //  u32 prot, flags;] char filename[]
+            const uint8_t *filename = body + 32 + ( ( hdr.type == PERF_RECORD_MMAP2 ) ? 32 : 0 );
+
+            if ( filename < end )
+            {
+                int pid = *( const uint32_t * )body;
+                proc_map_t pmap;
+
+                memcpy( &pmap.start, body + 8, 8 );
+                memcpy( &pmap.end, body + 16, 8 );
+                memcpy( &pmap.pgoff, body + 24, 8 );
+                pmap.end += pmap.start;
+                pmap.has_pgoff = true;
+                pmap.filename = strpool.getstr( ( const char * )filename,
+                                               strnlen( ( const char * )filename, end - filename ) );
+
+                // Kernel and module maps come in with pid -1
+                if ( pid > 0 )
+                {
+                    std::vector< proc_map_t > *maps = trace_info.proc_maps.get_val_create( pid );
+                    auto it = std::upper_bound( maps->begin(), maps->end(), pmap.start,
+                                                []( uint64_t val, const proc_map_t &m ) { return val < m.start; } );
+
+                    maps->insert( it, pmap );
+                }
+            }
+        }
+        else if ( hdr.type == PERF_RECORD_FORK )
+        {
+            // u32 pid, ppid, tid, ptid; u64 time
+            if ( body + 16 <= end )
+            {
+                int pid = *( const uint32_t * )body;
+                int tid = *( const uint32_t * )( body + 8 );
+
+                trace_info.pid_tgid_map.set_val( tid, pid );
+                trace_info.tgid_pids.get_val_create( pid )->add_pid( tid );
+            }
+        }
+
+        p += hdr.size;
+    }
+
+    // Records are mostly in order per cpu, so sort each cpu stream in parallel
+    std::vector< std::future< void > > futures;
+
+    for ( std::vector< perf_record_t > &records : cpu_records )
+    {
+        futures.push_back( std::async( std::launch::async, [ &records ]()
+        {
+            std::stable_sort( records.begin(), records.end(),
+                              []( const perf_record_t &a, const perf_record_t &b ) { return a.ts < b.ts; } );
+        } ) );
+    }
+
+    for ( std::future< void > &future : futures )
+        future.wait();
+}
+
+const char *perf_file_t::get_comm( int pid )
+{
+    const char **comm = trace_data.trace_info.pid_comm_map.get_val( pid );
+
+    if ( comm )
+        return *comm;
+
+    return ( handle && pid ) ? pevent_data_comm_from_pid( handle->pevent, pid ) : "<idle>";
+}
+
+int perf_file_t::add_event( const perf_sample_t &sample, const char *name,
+                            const std::vector< std::pair< const char *, std::string > > &fields )
+{
+    trace_event_t trace_event;
+    StrPool &strpool = trace_data.strpool;
+
+    // Interned names are unique per event type, so they key the load filter cache
+    name = strpool.getstr( name );
+
+    if ( !trace_data.trace_info.load_filters.empty() &&
+         load_filter_drop( trace_data, ( uintptr_t )name, "perf", name, sample.tid, sample.cpu ) )
+    {
+        return 0;
+    }
+
+    trace_event.pid = sample.tid;
+    trace_event.id = trace_data.events++;
+    trace_event.cpu = sample.cpu;
+    trace_event.ts = sample.time - trace_data.trace_info.min_file_ts;
+
+    trace_event.comm = strpool.getstrf( "%s-%u", get_comm( sample.tid ), sample.tid );
+    trace_event.system = strpool.getstr( "perf" );
+    trace_event.name = name;
+    trace_event.user_comm = trace_event.comm;
+
+    trace_event.numfields = fields.size();
+    trace_event.fields = new event_field_t[ fields.size() ];
+
+    for ( size_t i = 0; i < fields.size(); i++ )
+    {
+        trace_event.fields[ i ].key = strpool.getstr( fields[ i ].first );
+        trace_event.fields[ i ].value = strpool.getstr( fields[ i ].second.c_str() );
+    }
+
+    init_event_flags( trace_data, trace_event );
+
+    return trace_data.cb( trace_event );
+}
+
+int perf_file_t::enum_record( const perf_record_t &rec )
+{
+    perf_event_header_t hdr;
+    perf_sample_t sample;
+    const uint8_t *p = map + rec.offset;
+
+    memcpy( &hdr, p, sizeof( hdr ) );
+
+    const uint8_t *body = p + sizeof( hdr );
+    const uint8_t *end = p + hdr.size;
+    const perf_attr_info_t *info = get_attr( body, end, hdr.type == PERF_RECORD_SAMPLE );
+
+    if ( hdr.type == PERF_RECORD_SAMPLE )
+    {
+        if ( !parse_sample( info, body, end, sample ) )
+            return 0;
+
+        if ( info->event && sample.raw )
+        {
+            // Tracepoint: raw payload is the same as a trace.dat record
+            pevent_record_t record;
+
+            memset( &record, 0, sizeof( record ) );
+            record.ts = sample.time;
+            record.cpu = sample.cpu;
+            record.size = sample.raw_size;
+            record.data = ( void * )sample.raw;
+
+            return trace_enum_events( trace_data, handle, &record );
+        }
+
+        std::vector< std::pair< const char *, std::string > > fields;
+        const char *func = handle ? pevent_find_function( handle->pevent, sample.ip ) : NULL;
+
+        fields.push_back( { "ip", func ? string_format( "0x%llx (%s)", ( unsigned long long )sample.ip, func ) :
+                                         string_format( "0x%llx", ( unsigned long long )sample.ip ) } );
+        fields.push_back( { "period", std::to_string( sample.period ) } );
+
+        if ( sample.callchain_nr )
+        {
+            std::string callchain;
+            bool is_kernel = false;
+
+            for ( uint64_t i = 0; i < sample.callchain_nr; i++ )
+            {
+                uint64_t addr;
+
+                memcpy( &addr, sample.callchain + i * 8, 8 );
+
+                if ( addr >= PERF_CONTEXT_MAX )
+                {
+                    is_kernel = ( addr == PERF_CONTEXT_KERNEL );
+                    continue;
+                }
+
+                if ( is_kernel )
+                    add_kernel_sym( trace_data, handle ? handle->pevent : NULL, addr );
+
+                callchain += string_format( "%s0x%llx", callchain.empty() ? "" : " ", ( unsigned long long )addr );
+            }
+
+            fields.push_back( { "callchain", callchain } );
+        }
+
+        return add_event( sample, info->name, fields );
+    }
+
+    parse_sample_id( info, body, end, sample );
+
+    if ( hdr.type == PERF_RECORD_SWITCH_CPU_WIDE )
+    {
+        // Only switch out records, and only if we don't have real sched_switch events
+        if ( !( hdr.misc & PERF_RECORD_MISC_SWITCH_OUT ) || has_sched_switch_tracepoint ||
+             ( body + 8 > end ) )
+        {
+            return 0;
+        }
+
+        // u32 next_prev_pid, next_prev_tid
+        uint32_t next_tid = *( const uint32_t * )( body + 4 );
+        bool preempted = !!( hdr.misc & PERF_RECORD_MISC_SWITCH_OUT_PREEMPT );
+        std::vector< std::pair< const char *, std::string > > fields;
+
+        fields.push_back( { "prev_comm", get_comm( sample.tid ) } );
+        fields.push_back( { "prev_pid", std::to_string( sample.tid ) } );
+        fields.push_back( { "prev_prio", "120" } );
+        // TASK_RUNNING if preempted, otherwise TASK_INTERRUPTIBLE
+        fields.push_back( { "prev_state", preempted ? "0" : "1" } );
+        fields.push_back( { "next_comm", get_comm( next_tid ) } );
+        fields.push_back( { "next_pid", std::to_string( next_tid ) } );
+        fields.push_back( { "next_prio", "120" } );
+
+        return add_event( sample, "sched_switch", fields );
+    }
+    else if ( hdr.type == PERF_RECORD_SWITCH )
+    {
+        std::vector< std::pair< const char *, std::string > > fields;
+
+        return add_event( sample, ( hdr.misc & PERF_RECORD_MISC_SWITCH_OUT ) ?
+                              "switch_out" : "switch_in", fields );
+    }
+
+    return 0;
+}
+
+static bool is_perf_file( const char *file )
+{
+    uint64_t magic = 0;
+    int fd = TEMP_FAILURE_RETRY( open( file, O_RDONLY ) );
+
+    if ( fd < 0 )
+        return false;
+
+    if ( TEMP_FAILURE_RETRY( read( fd, &magic, sizeof( magic ) ) ) != sizeof( magic ) )
+        magic = 0;
+
+    close( fd );
+    return ( magic == PERF_MAGIC2 );
+}
+
+static int read_perf_file( const char *file, StrPool &strpool, trace_info_t &trace_info, EventCallback &cb )
+{
+    GPUVIS_TRACE_BLOCK( __func__ );
+
+    trace_data_t trace_data( cb, trace_info, strpool );
+    perf_file_t perf( trace_data );
+
+    if ( !perf.open( file ) )
+        return -1;
+
+    perf.read_attrs();
+    perf.read_features( file );
+    perf.index_records();
+
+    trace_info.cpus = std::max< uint32_t >( perf.nr_cpus, perf.cpu_records.size() );
+    trace_info.file = file;
+    trace_info.timestamp_in_us = true;
+
+    // Explicitly add idle thread at pid 0
+    trace_info.pid_comm_map.get_val( 0, strpool.getstr( "<idle>" ) );
+
+    std::vector< size_t > cpu_pos( perf.cpu_records.size() );
+
+    for ( const std::vector< perf_record_t > &records : perf.cpu_records )
+    {
+        if ( !records.empty() )
+            trace_info.min_file_ts = std::min< int64_t >( trace_info.min_file_ts, records[ 0 ].ts );
+    }
+    if ( trace_info.min_file_ts == INT64_MAX )
+        trace_info.min_file_ts = 0;
+
+    trace_info.cpu_info.resize( trace_info.cpus );
+    for ( size_t cpu = 0; cpu < perf.cpu_records.size(); cpu++ )
+    {
+        if ( !perf.cpu_records[ cpu ].empty() )
+            trace_info.cpu_info[ cpu ].min_ts = perf.cpu_records[ cpu ][ 0 ].ts - trace_info.min_file_ts;
+    }
+
+    int64_t trim_ts = trace_info.min_file_ts + trace_info.m_tracestart;
+
+    // Merge per cpu record streams by timestamp
+    for ( ;; )
+    {
+        int ret = 0;
+        size_t last_cpu = ( size_t )-1;
+        const perf_record_t *last_record = NULL;
+
+        for ( size_t cpu = 0; cpu < perf.cpu_records.size(); cpu++ )
+        {
+            const std::vector< perf_record_t > &records = perf.cpu_records[ cpu ];
+
+            if ( ( cpu_pos[ cpu ] < records.size() ) &&
+                 ( !last_record || ( records[ cpu_pos[ cpu ] ].ts < last_record->ts ) ) )
+            {
+                last_record = &records[ cpu_pos[ cpu ] ];
+                last_cpu = cpu;
+            }
+        }
+
+        if ( !last_record )
+            break;
+
+        cpu_info_t &cpu_info = trace_info.cpu_info[ last_cpu ];
+
+        cpu_info.tot_events++;
+        cpu_info.max_ts = last_record->ts - trace_info.min_file_ts;
+
+        if ( last_record->ts >= trim_ts )
+        {
+            cpu_info.events++;
+            ret = perf.enum_record( *last_record );
+
+            // Bail if user specified read length and we hit it
+            if ( trace_info.m_tracelen && ( last_record->ts - trim_ts > ( int64_t )trace_info.m_tracelen ) )
+                break;
+        }
+
+        cpu_pos[ last_cpu ]++;
+
+        if ( ret )
+            break;
+    }
+
+    trace_info.trimmed_ts = trim_ts - trace_info.min_file_ts;
+
+    logf( "Read perf.data %s: %lu attrs, %u cpus", file, perf.attrs.size(), trace_info.cpus );
+    return 0;
+}
+
+/*
+ * ftrace text import: "cat trace", "trace-cmd report", and systrace / atrace html
+ *
+ *   # tracer: nop
+ *   #           TASK-PID     CPU#  ||||   TIMESTAMP  FUNCTION
+ *             <idle>-0       [001] d..2  1234.567890: sched_switch: prev_comm=swapper/1 prev_pid=0 ...
+ *         SurfaceFlinger-552 (  552) [003] ...1  1234.567899: tracing_mark_write: B|552|onMessageReceived
+ *
+ * The file is split into line aligned chunks which are parsed in parallel into
+ * text_event_t spans. Converting spans to trace_event_t needs the StrPool, so that
+ * happens on the loader thread after the chunks have been merged by timestamp.
+ */
+struct text_field_t
+{
+    uint32_t key;
+    uint32_t key_len;
+    uint32_t val;
+    uint32_t val_len;
+};
+
+struct text_event_t
+{
+    int64_t ts;
+    int pid;
+    int tgid;
+    uint32_t cpu;
+    uint32_t flags;
+
+    // Offsets from start of chunk
+    uint32_t comm;
+    uint32_t comm_len;
+    uint32_t name;
+    uint32_t name_len;
+    uint32_t buf;
+    uint32_t buf_len;
+
+    uint32_t field_first;
+    uint32_t field_count;
+};
+
+struct text_chunk_t
+{
+    const char *start;
+    const char *end;
+
+    std::vector< text_event_t > events;
+    std::vector< text_field_t > fields;
+};
+
+// Max size of a chunk. Offsets in text_event_t are 32-bit.
+static const size_t s_text_chunk_max = 256 * 1024 * 1024;
+
+static const char *text_skip_spaces( const char *p, const char *end )
+{
+    while ( ( p < end ) && ( *p == ' ' || *p == '\t' ) )
+        p++;
+    return p;
+}
+
+static uint32_t text_parse_irq_flags( const char *p, const char *end )
+{
+    uint32_t flags = 0;
+
+    // "d..2": irqs-off, need-resched, hardirq/softirq, preempt-depth
+    if ( end - p < 3 )
+        return 0;
+
+    if ( p[ 0 ] == 'd' )
+        flags |= 0x01;
+    else if ( p[ 0 ] == 'X' )
+        flags |= 0x02;
+
+    if ( p[ 1 ] == 'N' || p[ 1 ] == 'n' || p[ 1 ] == 'p' )
+        flags |= 0x04;
+
+    if ( p[ 2 ] == 'h' )
+        flags |= 0x08;
+    else if ( p[ 2 ] == 's' )
+        flags |= 0x10;
+    else if ( p[ 2 ] == 'H' )
+        flags |= 0x18;
+
+    return flags;
+}
+
+// "1234.567890" -> ns
+static bool text_parse_ts( const char *p, const char *end, int64_t &ts )
+{
+    int64_t secs = 0;
+    int64_t frac = 0;
+    int digits = 0;
+
+    if ( ( p >= end ) || !isdigit( ( unsigned char )*p ) )
+        return false;
+
+    for ( ; ( p < end ) && isdigit( ( unsigned char )*p ); p++ )
+    {
+        secs = secs * 10 + ( *p - '0' );
+
+        // secs * NSECS_PER_SEC + frac would overflow
+        if ( secs >= ( int64_t )( INT64_MAX / NSECS_PER_SEC ) )
+            return false;
+    }
+
+    if ( ( p < end ) && ( *p == '.' ) )
+    {
+        for ( p++; ( p < end ) && isdigit( ( unsigned char )*p ); p++ )
+        {
+            if ( digits < 9 )
+            {
+                frac = frac * 10 + ( *p - '0' );
+                digits++;
+            }
+        }
+    }
+
+    for ( ; digits < 9; digits++ )
+        frac *= 10;
+
+    ts = secs * NSECS_PER_SEC + frac;
+    return ( p == end );
+}
+
+// Keys for fields from trace-cmd report sched plugin output, which has no "key=".
+//  text_field_t key_len is 0 for these and key is an index into this table.
+static const char *s_text_plugin_keys[] =
+{
+    "prev_comm", "prev_pid", "prev_prio", "prev_state",
+    "next_comm", "next_pid", "next_prio",
+    "comm", "pid", "prio", "target_cpu"
+};
+
+enum text_plugin_key_t
+{
+    TEXT_KEY_prev_comm = 0,
+    TEXT_KEY_prev_state = 3,
+    TEXT_KEY_next_comm = 4,
+    TEXT_KEY_comm = 7,
+    TEXT_KEY_target_cpu = 10,
+};
+
+static void text_add_plugin_field( text_chunk_t &chunk, uint32_t key, const char *val, const char *val_end )
+{
+    text_field_t field;
+
+    field.key = key;
+    field.key_len = 0;
+    field.val = val - chunk.start;
+    field.val_len = val_end - val;
+
+    chunk.fields.push_back( field );
+}
+
+// "comm:pid [prio]" -> comm, pid, prio fields starting at key. Returns end of task or NULL.
+static const char *text_parse_plugin_task( text_chunk_t &chunk, const char *p, const char *end, uint32_t key )
+{
+    // Comms can have spaces and colons, so find " [" first and the last colon before it
+    const char *bracket = p;
+
+    while ( ( bracket + 1 < end ) && !( ( bracket[ 0 ] == ' ' ) && ( bracket[ 1 ] == '[' ) ) )
+        bracket++;
+    if ( bracket + 1 >= end )
+        return NULL;
+
+    const char *colon = bracket;
+    while ( ( colon > p ) && ( *colon != ':' ) )
+        colon--;
+
+    const char *prio = bracket + 2;
+    const char *prio_end = ( const char * )memchr( prio, ']', end - prio );
+
+    if ( ( colon == p ) || !prio_end )
+        return NULL;
+
+    text_add_plugin_field( chunk, key, p, colon );
+    text_add_plugin_field( chunk, key + 1, colon + 1, bracket );
+    text_add_plugin_field( chunk, key + 2, prio, prio_end );
+
+    return text_skip_spaces( prio_end + 1, end );
+}
+
+// trace-cmd report formats sched events with its sched plugin:
+//   sched_switch: prev_comm:prev_pid [prev_prio] prev_state ==> next_comm:next_pid [next_prio]
+//   sched_wakeup: comm:pid [prio] success=1 CPU:001
+//  Returns false if this isn't one of those.
+static bool text_parse_sched_plugin( text_chunk_t &chunk, const char *name, size_t name_len,
+                                     const char *p, const char *end )
+{
+    static const char s_arrow[] = " ==> ";
+
+    if ( ( name_len == 12 ) && !strncmp( name, "sched_switch", 12 ) )
+    {
+        if ( ( end - p >= 10 ) && !memcmp( p, "prev_comm=", 10 ) )
+            return false;
+
+        const char *arrow = std::search( p, end, s_arrow, s_arrow + sizeof( s_arrow ) - 1 );
+        if ( arrow == end )
+            return false;
+
+        const char *state = text_parse_plugin_task( chunk, p, arrow, TEXT_KEY_prev_comm );
+        if ( !state )
+            return false;
+
+        text_add_plugin_field( chunk, TEXT_KEY_prev_state, state, arrow );
+
+        return !!text_parse_plugin_task( chunk, arrow + sizeof( s_arrow ) - 1, end, TEXT_KEY_next_comm );
+    }
+
+    if ( ( ( name_len == 12 ) && !strncmp( name, "sched_wakeup", 12 ) ) ||
+         ( ( name_len == 16 ) && !strncmp( name, "sched_wakeup_new", 16 ) ) ||
+         ( ( name_len == 12 ) && !strncmp( name, "sched_waking", 12 ) ) )
+    {
+        if ( ( end - p >= 5 ) && !memcmp( p, "comm=", 5 ) )
+            return false;
+
+        p = text_parse_plugin_task( chunk, p, end, TEXT_KEY_comm );
+        if ( !p )
+            return false;
+
+        // Optional "success=1", then "CPU:001"
+        while ( p < end )
+        {
+            const char *token_end = p;
+
+            while ( ( token_end < end ) && ( *token_end != ' ' ) )
+                token_end++;
+
+            if ( ( token_end - p >= 4 ) && !memcmp( p, "CPU:", 4 ) )
+            {
+                p += 4;
+                while ( ( token_end - p > 1 ) && ( *p == '0' ) )
+                    p++;
+
+                text_add_plugin_field( chunk, TEXT_KEY_target_cpu, p, token_end );
+            }
+
+            p = text_skip_spaces( token_end, end );
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+static bool text_parse_line( text_chunk_t &chunk, const char *line, const char *end )
+{
+    text_event_t event;
+    const char *p;
+    const char *cpu_start = NULL;
+
+    memset( &event, 0, sizeof( event ) );
+
+    line = text_skip_spaces( line, end );
+    if ( ( line >= end ) || ( *line == '#' ) )
+        return false;
+
+    // Find " [ddd] " cpu field. Comms can have spaces and dashes, so search for it.
+    for ( p = line; p + 3 < end; p++ )
+    {
+        if ( ( p[ 0 ] == ' ' ) && ( p[ 1 ] == '[' ) && isdigit( ( unsigned char )p[ 2 ] ) )
+        {
+            const char *q = p + 2;
+            uint32_t cpu = 0;
+
+            for ( ; ( q < end ) && isdigit( ( unsigned char )*q ); q++ )
+            {
+                if ( cpu < s_max_cpus )
+                    cpu = cpu * 10 + ( *q - '0' );
+            }
+
+            if ( ( q < end ) && ( *q == ']' ) )
+            {
+                // Skip lines with bogus cpus rather than sizing per-cpu state to them
+                if ( cpu >= s_max_cpus )
+                    return false;
+
+                cpu_start = p;
+                event.cpu = cpu;
+                p = q + 1;
+                break;
+            }
+        }
+    }
+    if ( !cpu_start )
+        return false;
+
+    // comm-pid, optionally followed by "( tgid)"
+    const char *task_end = cpu_start;
+
+    while ( ( task_end > line ) && ( task_end[ -1 ] == ' ' ) )
+        task_end--;
+
+    if ( ( task_end > line ) && ( task_end[ -1 ] == ')' ) )
+    {
+        const char *paren = task_end - 1;
+
+        while ( ( paren > line ) && ( *paren != '(' ) )
+            paren--;
+
+        event.tgid = atoi( text_skip_spaces( paren + 1, task_end ) );
+
+        task_end = paren;
+        while ( ( task_end > line ) && ( task_end[ -1 ] == ' ' ) )
+            task_end--;
+    }
+
+    const char *dash = task_end;
+    while ( ( dash > line ) && ( *dash != '-' ) )
+        dash--;
+    if ( dash == line )
+        return false;
+
+    event.pid = atoi( dash + 1 );
+    event.comm = line - chunk.start;
+    event.comm_len = dash - line;
+
+    // Optional irq flags, then "ts:"
+    for ( int i = 0; i < 2; i++ )
+    {
+        p = text_skip_spaces( p, end );
+
+        const char *token_end = p;
+        while ( ( token_end < end ) && ( *token_end != ' ' ) )
+            token_end++;
+
+        if ( ( token_end > p ) && ( token_end[ -1 ] == ':' ) &&
+             text_parse_ts( p, token_end - 1, event.ts ) )
+        {
+            p = token_end;
+            break;
+        }
+
+        if ( i )
+            return false;
+
+        event.flags = text_parse_irq_flags( p, token_end );
+        p = token_end;
+    }
+
+    // "event_name: fields"
+    p = text_skip_spaces( p, end );
+
+    const char *name_end = p;
+    while ( ( name_end < end ) && ( *name_end != ':' ) && ( *name_end != ' ' ) )
+        name_end++;
+    if ( ( name_end >= end ) || ( *name_end != ':' ) || ( name_end == p ) )
+        return false;
+
+    event.name = p - chunk.start;
+    event.name_len = name_end - p;
+
+    p = text_skip_spaces( name_end + 1, end );
+
+    // Trim trailing whitespace / CR
+    while ( ( end > p ) && isspace( ( unsigned char )end[ -1 ] ) )
+        end--;
+
+    event.buf = p - chunk.start;
+    event.buf_len = end - p;
+
+    event.field_first = chunk.fields.size();
+
+    if ( text_parse_sched_plugin( chunk, chunk.start + event.name, event.name_len, p, end ) )
+        p = end;
+    else
+        chunk.fields.resize( event.field_first );
+
+    // Split "key=value key=value" fields. Values run until the next key=.
+    while ( p < end )
+    {
+        const char *token_end = p;
+        const char *eq = NULL;
+
+        while ( ( token_end < end ) && ( *token_end != ' ' ) )
+        {
+            if ( !eq && ( *token_end == '=' ) )
+                eq = token_end;
+            token_end++;
+        }
+
+        if ( eq && ( eq > p ) )
+        {
+            text_field_t field;
+
+            field.key = p - chunk.start;
+            field.key_len = eq - p;
+            field.val = ( eq + 1 ) - chunk.start;
+            field.val_len = token_end - ( eq + 1 );
+
+            chunk.fields.push_back( field );
+        }
+        else if ( ( event.field_first < chunk.fields.size() ) &&
+                  ( ( token_end - p < 3 ) || memcmp( p, "==>", 3 ) ) )
+        {
+            // Value with spaces: extend previous value
+            chunk.fields.back().val_len = token_end - ( chunk.start + chunk.fields.back().val );
+        }
+
+        p = text_skip_spaces( token_end, end );
+    }
+
+    event.field_count = chunk.fields.size() - event.field_first;
+
+    chunk.events.push_back( event );
+    return true;
+}
+
+static void text_parse_chunk( text_chunk_t &chunk )
 {
-    const char *val = strstr( str, var );
+    const char *line = chunk.start;
 
-    if ( val )
-        return strtoull( val + strlen( var ), NULL, 10 );
-    return 0;
+    while ( line < chunk.end )
+    {
+        const char *eol = ( const char * )memchr( line, '\n', chunk.end - line );
+
+        if ( !eol )
+            eol = chunk.end;
+
+        text_parse_line( chunk, line, eol );
+        line = eol + 1;
+    }
 }
 
-static int64_t getf64( const char *str, const char *var )
+// Get ranges of ftrace text in the file. For systrace html, that's the trace-data script blocks.
+static void text_get_ranges( const char *data, size_t size, std::vector< std::pair< const char *, const char * > > &ranges )
 {
-    const char *val = strstr( str, var );
+    const char *end = data + size;
+    const char *html = ( const char * )memmem( data, std::min< size_t >( size, 4096 ), "<html", 5 );
 
-    if ( val )
-        return strtold( val + strlen( var ), NULL ) * NSECS_PER_SEC;
-    return 0;
+    if ( !html )
+    {
+        ranges.push_back( { data, end } );
+        return;
+    }
+
+    static const char s_script[] = "<script class=\"trace-data\"";
+    static const char s_script_end[] = "</script>";
+
+    for ( const char *p = data; p < end; )
+    {
+        const char *start = ( const char * )memmem( p, end - p, s_script, sizeof( s_script ) - 1 );
+        if ( !start )
+            break;
+
+        start = ( const char * )memchr( start, '>', end - start );
+        if ( !start )
+            break;
+        start++;
+
+        const char *stop = ( const char * )memmem( start, end - start, s_script_end, sizeof( s_script_end ) - 1 );
+        if ( !stop )
+            stop = end;
+
+        ranges.push_back( { start, stop } );
+        p = stop;
+    }
+}
+
+static bool is_text_file( const char *file )
+{
+    char buf[ 4096 ];
+    int fd = TEMP_FAILURE_RETRY( open( file, O_RDONLY ) );
+
+    if ( fd < 0 )
+        return false;
+
+    ssize_t len = TEMP_FAILURE_RETRY( read( fd, buf, sizeof( buf ) ) );
+
+    close( fd );
+
+    // trace.dat, perf.data, zip, etc. all have binary headers
+    return ( len > 0 ) && !memchr( buf, 0, len ) && !( buf[ 0 ] & 0x80 ) && isprint( ( unsigned char )buf[ 0 ] );
+}
+
+// Convert sched_switch prev_state letters to the TASK_* bits trace.dat has
+static std::string text_prev_state( const char *val, size_t len )
+{
+    uint32_t state = 0;
+
+    for ( size_t i = 0; i < len; i++ )
+    {
+        switch ( val[ i ] )
+        {
+        case 'S': state |= 0x01; break;
+        case 'D': state |= 0x02; break;
+        case 'T': state |= 0x04; break;
+        case 't': state |= 0x08; break;
+        case 'X': state |= 0x10; break;
+        case 'Z': state |= 0x20; break;
+        case 'P': state |= 0x40; break;
+        case 'I': state |= 0x80; break;
+        case '|': break;
+        // 'R', 'R+': TASK_RUNNING
+        default: break;
+        }
+    }
+
+    return std::to_string( state );
+}
+
+// Text output doesn't include event systems, so guess from the event name
+static const char *text_get_system( StrPool &strpool, const char *name )
+{
+    if ( !strncmp( name, "dma_fence_", 10 ) )
+        return strpool.getstr( "dma_fence" );
+    if ( !strncmp( name, "drm_sched_", 10 ) || !strcmp( name, "drm_run_job" ) )
+        return strpool.getstr( "gpu_scheduler" );
+
+    const char *underscore = strchr( name, '_' );
+
+    return underscore ? strpool.getstr( name, underscore - name ) : name;
+}
+
+static int text_enum_event( trace_data_t &trace_data, const text_chunk_t &chunk, const text_event_t &text_event,
+                            const char *tracing_mark_write_str, const char *print_str )
+{
+    trace_event_t trace_event;
+    trace_info_t &trace_info = trace_data.trace_info;
+    StrPool &strpool = trace_data.strpool;
+
+    if ( !trace_info.load_filters.empty() )
+    {
+        // Event names repeat, so interning the name is cheap. System is guessed from it.
+        const char *name = strpool.getstr( chunk.start + text_event.name, text_event.name_len );
+        bool is_print = ( name == tracing_mark_write_str ) || ( name == print_str );
+        const char *system = is_print ? "ftrace" : text_get_system( strpool, name );
+
+        if ( load_filter_drop( trace_data, ( uintptr_t )name, system, name, text_event.pid, text_event.cpu ) )
+            return 0;
+    }
+
+    const char *comm = strpool.getstr( chunk.start + text_event.comm, text_event.comm_len );
+
+    trace_event.pid = text_event.pid;
+    trace_event.id = trace_data.events++;
+    trace_event.cpu = text_event.cpu;
+    trace_event.ts = text_event.ts - trace_info.min_file_ts;
+    trace_event.flags = text_event.flags;
+
+    trace_event.comm = strpool.getstrf( "%s-%u", comm, text_event.pid );
+    trace_event.name = strpool.getstr( chunk.start + text_event.name, text_event.name_len );
+    trace_event.user_comm = trace_event.comm;
+
+    if ( ( trace_event.name == tracing_mark_write_str ) || ( trace_event.name == print_str ) )
+    {
+        const char *buf = chunk.start + text_event.buf;
+        size_t buf_len = text_event.buf_len;
+
+        // trace-cmd report: "print: tracing_mark_write: buf"
+        if ( ( trace_event.name == print_str ) && ( buf_len > 20 ) &&
+             !strncmp( buf, "tracing_mark_write: ", 20 ) )
+        {
+            buf += 20;
+            buf_len -= 20;
+        }
+
+        trace_event.system = trace_data.ftrace_print_str;
+        trace_event.name = print_str;
+
+        trace_event.numfields = 1;
+        trace_event.fields = new event_field_t[ 1 ];
+        trace_event.fields[ 0 ].key = trace_data.buf_str;
+        trace_event.fields[ 0 ].value = strpool.getstr( buf, buf_len );
+    }
+    else
+    {
+        trace_event.system = text_get_system( strpool, trace_event.name );
+
+        trace_event.numfields = text_event.field_count;
+        trace_event.fields = new event_field_t[ text_event.field_count ];
+
+        for ( uint32_t i = 0; i < text_event.field_count; i++ )
+        {
+            const text_field_t &field = chunk.fields[ text_event.field_first + i ];
+            const char *key = field.key_len ?
+                        strpool.getstr( chunk.start + field.key, field.key_len ) :
+                        strpool.getstr( s_text_plugin_keys[ field.key ] );
+            const char *val = chunk.start + field.val;
+
+            trace_event.fields[ i ].key = key;
+
+            if ( trace_event.name == trace_data.sched_switch_str && !strcmp( key, "prev_state" ) )
+                trace_event.fields[ i ].value = strpool.getstr( text_prev_state( val, field.val_len ).c_str() );
+            else
+                trace_event.fields[ i ].value = strpool.getstr( val, field.val_len );
+
+            if ( key == trace_data.seqno_str )
+                trace_event.seqno = strtoul( trace_event.fields[ i ].value, NULL, 10 );
+            else if ( key == trace_data.crtc_str )
+                trace_event.crtc = atoi( trace_event.fields[ i ].value );
+        }
+    }
+
+    // Add to pid --> comm / tgid maps
+    trace_info.pid_comm_map.get_val( text_event.pid, comm );
+
+    if ( text_event.tgid > 0 )
+    {
+        tgid_info_t *tgid_info = trace_info.tgid_pids.get_val_create( text_event.tgid );
+
+        if ( !tgid_info->tgid )
+        {
+            tgid_info->tgid = text_event.tgid;
+            tgid_info->hashval += hashstr32( comm );
+        }
+        tgid_info->add_pid( text_event.pid );
+
+        trace_info.pid_tgid_map.get_val( text_event.pid, text_event.tgid );
+    }
+
+    init_event_flags( trace_data, trace_event );
+
+    return trace_data.cb( trace_event );
+}
+
+static int read_text_file( const char *file, StrPool &strpool, trace_info_t &trace_info, EventCallback &cb )
+{
+    GPUVIS_TRACE_BLOCK( __func__ );
+
+    int fd = TEMP_FAILURE_RETRY( open( file, O_RDONLY ) );
+    if ( fd < 0 )
+    {
+        logf( "[Error] %s: open(\"%s\") failed: %d\n", __func__, file, errno );
+        return -1;
+    }
+
+    size_t size = lseek64( fd, 0, SEEK_END );
+    lseek64( fd, 0, SEEK_SET );
+
+#ifdef USE_MMAP
+    void *map = mmap( NULL, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    const char *data = ( map != MAP_FAILED ) ? ( const char * )map : NULL;
+
+    if ( data )
+        madvise( map, size, MADV_SEQUENTIAL );
+#else
+    char *data = ( char * )malloc( size );
+
+    if ( data && ( TEMP_FAILURE_RETRY( read( fd, data, size ) ) != ( ssize_t )size ) )
+    {
+        free( data );
+        data = NULL;
+    }
+#endif
+
+    close( fd );
+
+    if ( !data )
+    {
+        logf( "[Error] %s: failed to read \"%s\".\n", __func__, file );
+        return -1;
+    }
+
+    // Split text ranges into line aligned chunks
+    std::vector< std::pair< const char *, const char * > > ranges;
+    std::vector< text_chunk_t > chunks;
+    size_t nthreads = std::max< size_t >( 1, std::thread::hardware_concurrency() );
+    size_t chunk_size = Clamp< size_t >( size / ( nthreads * 4 ) + 1, 1024 * 1024, s_text_chunk_max );
+
+    text_get_ranges( data, size, ranges );
+
+    for ( const auto &range : ranges )
+    {
+        for ( const char *start = range.first; start < range.second; )
+        {
+            const char *end = start + std::min< size_t >( chunk_size, range.second - start );
+
+            // Extend to end of line
+            if ( end < range.second )
+            {
+                const char *eol = ( const char * )memchr( end, '\n', range.second - end );
+
+                end = eol ? eol + 1 : range.second;
+            }
+
+            chunks.push_back( text_chunk_t() );
+            chunks.back().start = start;
+            chunks.back().end = end;
+            start = end;
+        }
+    }
+
+    // Parse chunks in parallel
+    {
+        GPUVIS_TRACE_BLOCKF( "text_parse_chunks: %lu chunks", chunks.size() );
+
+        std::atomic< size_t > next_chunk( 0 );
+        std::vector< std::future< void > > futures;
+
+        for ( size_t i = 0; i < std::min< size_t >( nthreads, chunks.size() ); i++ )
+        {
+            futures.push_back( std::async( std::launch::async, [ &chunks, &next_chunk ]()
+            {
+                for ( size_t ichunk = next_chunk++; ichunk < chunks.size(); ichunk = next_chunk++ )
+                    text_parse_chunk( chunks[ ichunk ] );
+            } ) );
+        }
+
+        for ( std::future< void > &future : futures )
+            future.wait();
+    }
+
+    // Merge chunk events by timestamp. Text traces are normally sorted, so this
+    //  is mostly just walking each chunk in order.
+    struct text_loc_t
+    {
+        int64_t ts;
+        uint32_t chunk;
+        uint32_t index;
+    };
+    std::vector< text_loc_t > locs;
+    bool sorted = true;
+    int64_t prev_ts = INT64_MIN;
+
+    for ( size_t ichunk = 0; ichunk < chunks.size(); ichunk++ )
+    {
+        const std::vector< text_event_t > &events = chunks[ ichunk ].events;
+
+        for ( size_t i = 0; i < events.size(); i++ )
+        {
+            sorted &= ( events[ i ].ts >= prev_ts );
+            prev_ts = events[ i ].ts;
+
+            locs.push_back( { events[ i ].ts, ( uint32_t )ichunk, ( uint32_t )i } );
+        }
+    }
+
+    if ( !sorted )
+    {
+        std::stable_sort( locs.begin(), locs.end(),
+                          []( const text_loc_t &a, const text_loc_t &b ) { return a.ts < b.ts; } );
+    }
+
+    uint32_t max_cpu = 0;
+    for ( const text_loc_t &loc : locs )
+        max_cpu = std::max< uint32_t >( max_cpu, chunks[ loc.chunk ].events[ loc.index ].cpu );
+
+    trace_info.cpus = locs.empty() ? 0 : ( max_cpu + 1 );
+    trace_info.file = file;
+    trace_info.timestamp_in_us = true;
+    trace_info.min_file_ts = locs.empty() ? 0 : locs[ 0 ].ts;
+    trace_info.cpu_info.resize( trace_info.cpus );
+
+    // Explicitly add idle thread at pid 0
+    trace_info.pid_comm_map.get_val( 0, strpool.getstr( "<idle>" ) );
+
+    trace_data_t trace_data( cb, trace_info, strpool );
+    const char *tracing_mark_write_str = strpool.getstr( "tracing_mark_write" );
+    const char *print_str = strpool.getstr( "print" );
+    int64_t trim_ts = trace_info.min_file_ts + trace_info.m_tracestart;
+
+    for ( const text_loc_t &loc : locs )
+    {
+        const text_chunk_t &chunk = chunks[ loc.chunk ];
+        const text_event_t &event = chunk.events[ loc.index ];
+        cpu_info_t &cpu_info = trace_info.cpu_info[ event.cpu ];
+
+        if ( !cpu_info.tot_events )
+            cpu_info.min_ts = event.ts - trace_info.min_file_ts;
+        cpu_info.max_ts = event.ts - trace_info.min_file_ts;
+        cpu_info.tot_events++;
+
+        if ( event.ts < trim_ts )
+            continue;
+
+        cpu_info.events++;
+
+        if ( text_enum_event( trace_data, chunk, event, tracing_mark_write_str, print_str ) )
+            break;
+
+        // Bail if user specified read length and we hit it
+        if ( trace_info.m_tracelen && ( event.ts - trim_ts > ( int64_t )trace_info.m_tracelen ) )
+            break;
+    }
+
+    trace_info.trimmed_ts = trim_ts - trace_info.min_file_ts;
+
+    logf( "Read text trace %s: %lu events in %lu chunks", file, locs.size(), chunks.size() );
+
+#ifdef USE_MMAP
+    munmap( map, size );
+#else
+    free( data );
+#endif
+
+    return locs.empty() ? -1 : 0;
 }
 
 int read_trace_file( const char *file, StrPool &strpool, trace_info_t &trace_info, EventCallback &cb )
 {
     GPUVIS_TRACE_BLOCK( __func__ );
 
+    if ( is_perf_file( file ) )
+        return read_perf_file( file, strpool, trace_info, cb );
+    if ( is_text_file( file ) )
+        return read_text_file( file, strpool, trace_info, cb );
+
     tracecmd_input_t *handle;
     std::vector< file_info_t * > file_list;
     // Latest ts value where a cpu data starts
@@ -1859,6 +4405,9 @@ int read_trace_file( const char *file, StrPool &strpool, trace_info_t &trace_inf
         return -1;
     }
 
+    // Buffer instance handles are copied from this one
+    handle->recover_bad_pages = trace_info.recover_bad_pages;
+
     add_file( file_list, handle, file );
 
     // Read header information from trace.dat file.
@@ -1891,8 +4440,12 @@ int read_trace_file( const char *file, StrPool &strpool, trace_info_t &trace_inf
     trace_info.cpus = handle->cpus;
     trace_info.file = handle->file;
     trace_info.uname = handle->uname;
+    parse_proc_maps( handle->proc_maps.c_str(), strpool, trace_info );
     trace_info.timestamp_in_us = is_timestamp_in_us( handle->pevent->trace_clock, handle->use_trace_clock );
 
+    // Get trace clocks and offset / drift for buffer instances
+    init_buffer_clocks( file, file_list, trace_info );
+
     // Explicitly add idle thread at pid 0
     trace_info.pid_comm_map.get_val( 0, strpool.getstr( "<idle>" ) );
 
@@ -1933,6 +4486,21 @@ int read_trace_file( const char *file, StrPool &strpool, trace_info_t &trace_inf
             trace_info.min_file_ts = std::min< int64_t >( trace_info.min_file_ts, record->ts );
     }
 
+    // Buffer instances can start before the top level buffer once their clocks are aligned
+    for ( size_t i = 1; i < file_list.size(); i++ )
+    {
+        file_info_t *file_info = file_list[ i ];
+        pevent_record_t *record = file_info->clock_adjust ?
+                    tracecmd_peek_next_data( file_info->handle, NULL ) : NULL;
+
+        if ( record )
+        {
+            int64_t ts = clock_adjust_ts( file_info, record->ts );
+
+            trace_info.min_file_ts = std::min< int64_t >( trace_info.min_file_ts, ts );
+        }
+    }
+
     trace_info.cpu_info.resize( handle->cpus );
     for ( size_t cpu = 0; cpu < ( size_t )handle->cpus; cpu++ )
     {
@@ -2000,6 +4568,16 @@ int read_trace_file( const char *file, StrPool &strpool, trace_info_t &trace_inf
             // Bump up total event count for this cpu
             cpu_info.tot_events++;
 
+            // Ring buffer overrun or skipped pages before this record
+            if ( last_record->missed_events )
+            {
+                int64_t count = last_record->missed_events;
+
+                cpu_info.missed_events.push_back( { ( int64_t )last_record->ts - trace_info.min_file_ts, count } );
+                if ( count > 0 )
+                    cpu_info.missed_events_count += count;
+            }
+
             // Store the max ts value we've seen for this cpu
             cpu_info.max_ts = last_record->ts - trace_info.min_file_ts;
 
@@ -2025,6 +4603,28 @@ int read_trace_file( const char *file, StrPool &strpool, trace_info_t &trace_inf
     if ( trim_ts )
         trace_info.trimmed_ts = trim_ts - trace_info.min_file_ts;
 
+    for ( file_info_t *file_info : file_list )
+    {
+        tracecmd_input_t *file_handle = file_info->handle;
+
+        for ( int cpu = 0; cpu < file_handle->cpus; cpu++ )
+        {
+            if ( ( size_t )cpu < trace_info.cpu_info.size() )
+                trace_info.cpu_info[ cpu ].bad_pages += file_handle->cpu_data[ cpu ].bad_pages;
+        }
+    }
+
+    for ( size_t cpu = 0; cpu < trace_info.cpu_info.size(); cpu++ )
+    {
+        const cpu_info_t &cpu_info = trace_info.cpu_info[ cpu ];
+
+        if ( !cpu_info.missed_events.empty() || cpu_info.bad_pages )
+        {
+            logf( "[Warning] cpu %lu: %lu lost events in %lu gaps, %lu bad pages skipped",
+                  cpu, ( unsigned long )cpu_info.missed_events_count, cpu_info.missed_events.size(), ( unsigned long )cpu_info.bad_pages );
+        }
+    }
+
     for ( file_info_t *file_info : file_list )
     {
         tracecmd_close( file_info->handle );
@@ -79,6 +79,14 @@ struct tgid_info_t
     void add_pid( int pid );
 };
 
+struct missed_events_t
+{
+    // ts of the first event read after the gap
+    int64_t ts;
+    // Number of events lost, or -1 if the kernel didn't record the count
+    int64_t count;
+};
+
 struct cpu_info_t
 {
     // per_cpu/cpu0/stats
@@ -115,6 +123,55 @@ struct cpu_info_t
     uint64_t events = 0;
     // Total events read for this cpu
     uint64_t tot_events = 0;
+
+    // Ring buffer overruns reported in page headers and skipped bad pages
+    std::vector< missed_events_t > missed_events;
+    uint64_t missed_events_count = 0;
+    uint64_t bad_pages = 0;
+};
+
+struct trace_clock_info_t
+{
+    // Buffer instance name ("" for the top level buffer)
+    std::string buffer;
+    // trace_clock used to record this buffer: local, global, x86-tsc, mono, etc.
+    std::string trace_clock;
+
+    // Buffer timestamps are mapped to top level buffer clock with:
+    //   ts + offset + ( ts - ref_ts ) * drift
+    int64_t offset = 0;
+    int64_t ref_ts = 0;
+    double drift = 0.0;
+
+    // Number of clock sync marker pairs used to calculate offset and drift
+    uint32_t sync_pairs = 0;
+};
+
+// Load time event filter. Matching records are dropped (or sampled 1 in N) as
+//  they're decoded, before fields are formatted or strings are interned.
+struct load_filter_t
+{
+    std::string system;     // Event system (empty matches all)
+    std::string name;       // Event name (empty matches all)
+    int pid = -1;           // Event pid (-1 matches all)
+    int cpu = -1;           // Event cpu (-1 matches all)
+    uint32_t sample = 0;    // 0: drop matching events, N: keep 1 in N
+
+    // Matching events seen and dropped while loading
+    uint64_t matched = 0;
+    uint64_t dropped = 0;
+};
+
+// Process memory mapping from trace-cmd -P proc maps or perf mmap records
+struct proc_map_t
+{
+    uint64_t start;
+    uint64_t end;
+    // File offset of start. trace-cmd collapses each library into a single range
+    //  starting at its load address, so only perf mmap records have this.
+    uint64_t pgoff;
+    bool has_pgoff;
+    const char *filename;
 };
 
 struct trace_info_t
@@ -137,6 +194,19 @@ struct trace_info_t
     uint64_t m_tracestart = 0;
     uint64_t m_tracelen = 0;
 
+    // Skip pages with bad headers or timestamps instead of failing the load
+    bool recover_bad_pages = true;
+
+    // Events to drop or sample while loading. First matching filter wins.
+    std::vector< load_filter_t > load_filters;
+
+    // Align buffer instance clocks with paired clock sync markers
+    bool clock_sync = false;
+    // User specified buffer clock offset and drift anchors
+    std::vector< trace_clock_info_t > clock_anchors;
+    // Trace clock info for each buffer we read
+    std::vector< trace_clock_info_t > clocks;
+
     // Map tgid to vector of child pids and color
     util_umap< int, tgid_info_t > tgid_pids;
     // Map pid to tgid
@@ -145,6 +215,12 @@ struct trace_info_t
     util_umap< int, const char * > pid_comm_map;
     // Map pid from sched_switch event prev_pid, next_pid fields to comm
     util_umap< int, const char * > sched_switch_pid_comm_map;
+
+    // Map tgid to memory maps sorted by start
+    util_umap< int, std::vector< proc_map_t > > proc_maps;
+    // Kernel stack addresses resolved with kallsyms while loading: "func+0x1c".
+    //  NULL for kernel addresses which couldn't be resolved.
+    util_umap< uint64_t, const char * > kernel_syms;
 };
 
 struct event_field_t
@@ -170,6 +246,7 @@ enum trace_flag_type_t {
     TRACE_FLAG_SCHED_SWITCH_TASK_RUNNING    = 0x08000, // TASK_RUNNING
     TRACE_FLAG_SCHED_SWITCH_SYSTEM_EVENT    = 0x10000,
     TRACE_FLAG_AUTOGEN_COLOR                = 0x20000,
+    TRACE_FLAG_DMA_FENCE                    = 0x40000, // dma_fence_*, drm_sched_job, drm_run_job
 };
 
 struct trace_event_t
@@ -211,6 +288,7 @@ public:
     bool is_vblank() const          { return !!( flags & TRACE_FLAG_VBLANK ); }
     bool is_timeline() const        { return !!( flags & TRACE_FLAG_TIMELINE ); }
     bool is_sched_switch() const    { return !!( flags & TRACE_FLAG_SCHED_SWITCH ); }
+    bool is_dma_fence() const       { return !!( flags & TRACE_FLAG_DMA_FENCE ); }
 
     bool has_duration() const       { return duration != INT64_MAX; }
 
@@ -230,5 +308,9 @@ public:
 const char *get_event_field_val( const trace_event_t &event, const char *name, const char *defval = "" );
 event_field_t *get_event_field( trace_event_t &event, const char *name );
 
+// Parse load filter: "system=irq,name=softirq_raise,pid=0,cpu=1,sample=10"
+bool parse_load_filter( const char *str, load_filter_t &filter, std::string &errstr );
+std::string load_filter_str( const load_filter_t &filter );
+
 typedef std::function< int ( const trace_event_t &event ) > EventCallback;
 int read_trace_file( const char *file, StrPool &strpool, trace_info_t &trace_info, EventCallback &cb );